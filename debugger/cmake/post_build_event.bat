@@ -1,3 +1,4 @@
 @echo off
 @echo riscvdebugger.exe -c %2/../targets/func_river_x1_gui.json > %1\_run_func_river_x1_gui.bat
+@echo riscvdebugger.exe -c %2/../targets/func_river_x4_smp.json > %1\_run_func_river_x4_smp.bat
 @echo riscvdebugger.exe -c %2/../targets/sysc_river_x1_gui.json > %1\_run_sysc_river_x1_gui.bat
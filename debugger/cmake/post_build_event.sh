@@ -2,6 +2,10 @@ echo "#!/bin/bash" > $1/_run_func_river_x1_gui.sh
 echo "export LD_LIBRARY_PATH=$1:$1/qtlib" >> $1/_run_func_river_x1_gui.sh
 echo "./riscvdebugger -c $2/../targets/func_river_x1_gui.json" >> $1/_run_func_river_x1_gui.sh
 
+echo "#!/bin/bash" > $1/_run_func_river_x4_smp.sh
+echo "export LD_LIBRARY_PATH=$1:$1/qtlib" >> $1/_run_func_river_x4_smp.sh
+echo "./riscvdebugger -c $2/../targets/func_river_x4_smp.json" >> $1/_run_func_river_x4_smp.sh
+
 echo "#!/bin/bash" > $1/_run_sysc_river_x1_gui.sh
 echo "export LD_LIBRARY_PATH=$1:$1/qtlib" >> $1/_run_sysc_river_x1_gui.sh
 echo "./riscvdebugger -c $2/../targets/sysc_river_x1_gui.json" >> $1/_run_sysc_river_x1_gui.sh
@@ -291,6 +291,20 @@ int RISCV_get_pid();
 /** Memory barrier */
 void RISCV_memory_barrier();
 
+/**
+ * Atomic compare and swap of the pointer, 32-bits or 64-bits value
+ * @return previous value of *dst, exchange done if it equals 'cmp'
+ */
+void *RISCV_atomic_cas_ptr(void *volatile *dst, void *cmp, void *xchg);
+uint32_t RISCV_atomic_cas32(volatile uint32_t *dst, uint32_t cmp,
+                            uint32_t xchg);
+uint64_t RISCV_atomic_cas64(volatile uint64_t *dst, uint64_t cmp,
+                            uint64_t xchg);
+
+/** Atomic bitwise OR and AND of the 32-bits value */
+void RISCV_atomic_or32(volatile uint32_t *dst, uint32_t v);
+void RISCV_atomic_and32(volatile uint32_t *dst, uint32_t v);
+
 void RISCV_thread_create(void *data);
 uint64_t RISCV_thread_id();
 
@@ -317,6 +331,15 @@ void RISCV_memshare_delete(sharemem_def h);
 void *RISCV_malloc(uint64_t sz);
 void RISCV_free(void *p);
 
+/**
+ * Memory for the generated host code. It is allocated writable and never
+ * is writable and executable at the same time (W^X).
+ */
+void *RISCV_exec_malloc(uint64_t sz);
+void RISCV_exec_free(void *p, uint64_t sz);
+/** Switch code memory between writable (exec = 0) and executable */
+int RISCV_exec_protect(void *p, uint64_t sz, int exec);
+
 /** Get absolute directory where core library is placed. */
 int RISCV_get_core_folder(char *out, int sz);
 int RISCV_get_core_folderw(wchar_t* out, int sz);
@@ -73,98 +73,158 @@ void AsyncTQueueType::initProc() {
 
 /** Clock queue */
 ClockAsyncTQueueType::ClockAsyncTQueueType() {
-    size_ = 1;
-    queue_ = new StepQueueItemType[size_];
-
-    RISCV_mutex_init(&mutex_);
+    size_ = 16;
+    heap_ = new StepQueueItemType[size_];
+    prequeue_ = 0;
     hardReset();
 }
 
 ClockAsyncTQueueType::~ClockAsyncTQueueType() {
-    RISCV_mutex_destroy(&mutex_);
-    delete [] queue_;
+    hardReset();
+    delete [] heap_;
 }
 
 void ClockAsyncTQueueType::hardReset() {
+    PreQueueItemType *p = takePreQueued();
+    PreQueueItemType *pnext;
+    while (p) {
+        pnext = p->next;
+        delete p;
+        p = pnext;
+    }
     item_total_ = 0;
-    precnt_ = 0;
-    item_cnt_ = 0;
+    seqnum_ = 0;
+    deadline_ = ~0ull;
 }
 
-
 void ClockAsyncTQueueType::put(uint64_t time, IFace *cb) {
-    RISCV_mutex_lock(&mutex_);
-    if (precnt_ >= 1024) {
-        RISCV_mutex_unlock(&mutex_);
-        RISCV_printf(0, 0, "clock pre-queue overflow: %d", precnt_);
-        return;
-    }
-    prequeue_[precnt_].left = 0;
-    prequeue_[precnt_].right = 0;
-    prequeue_[precnt_].time = time;
-    prequeue_[precnt_++].iface = cb;
-    RISCV_mutex_unlock(&mutex_);
+    pushRequest(time, cb, false);
 }
 
-bool ClockAsyncTQueueType::move(IFace *cb, uint64_t time) {
-    RISCV_mutex_lock(&mutex_);
-    for (int i = 0; i < precnt_; i++) {
-        if (prequeue_[i].iface == cb) {
-            prequeue_[i].time = time;
-            RISCV_mutex_unlock(&mutex_);
-            return true;
-        }
-    }
-    for (int i = 0; i < item_total_; i++) {
-        if (queue_[i].iface == cb) {
-            queue_[i].time = time;
-            RISCV_mutex_unlock(&mutex_);
-            return true;
-        }
-    }
-    RISCV_mutex_unlock(&mutex_);
-    return false;
+void ClockAsyncTQueueType::move(IFace *cb, uint64_t time) {
+    pushRequest(time, cb, true);
+}
+
+void ClockAsyncTQueueType::pushRequest(uint64_t time, IFace *cb, bool move) {
+    PreQueueItemType *p = new PreQueueItemType;
+    PreQueueItemType *head;
+    p->time = time;
+    p->iface = cb;
+    p->move = move;
+    do {
+        head = prequeue_;
+        p->next = head;
+    } while (RISCV_atomic_cas_ptr(
+                reinterpret_cast<void *volatile *>(&prequeue_),
+                head, p) != head);
+}
+
+ClockAsyncTQueueType::PreQueueItemType *
+ClockAsyncTQueueType::takePreQueued() {
+    PreQueueItemType *head;
+    do {
+        head = prequeue_;
+    } while (RISCV_atomic_cas_ptr(
+                reinterpret_cast<void *volatile *>(&prequeue_),
+                head, 0) != head);
+    return head;
 }
 
 void ClockAsyncTQueueType::pushPreQueued() {
-    if (precnt_ == 0) {
+    PreQueueItemType *head, *p, *prev;
+    if (prequeue_ == 0) {
         return;
     }
-    RISCV_mutex_lock(&mutex_);
-    while ((precnt_ + item_total_) > size_) {
-        int t1 = 2*size_;
-        StepQueueItemType *p1 = new StepQueueItemType[t1];
-        memcpy(p1, queue_, item_total_*sizeof(StepQueueItemType));
-        delete [] queue_;
-        queue_ = p1;
-        size_ = t1;
+    head = takePreQueued();
+
+    // Restore registration order
+    prev = 0;
+    while (head) {
+        p = head->next;
+        head->next = prev;
+        prev = head;
+        head = p;
     }
-    memcpy(&queue_[item_total_], prequeue_, precnt_*sizeof(StepQueueItemType));
-    item_total_ += precnt_;
-    precnt_ = 0;
-    RISCV_mutex_unlock(&mutex_);
-}
 
+    int i;
+    for (p = prev; p; p = prev) {
+        prev = p->next;
+        for (i = 0; p->move && i < item_total_; i++) {
+            if (heap_[i].iface != p->iface) {
+                continue;
+            }
+            heap_[i].time = p->time;
+            heap_[i].seqnum = seqnum_++;
+            if (i > 0 && less(i, (i - 1) / 2)) {
+                heapUp(i);
+            } else {
+                heapDown(i);
+            }
+            break;
+        }
+        if (!p->move || i == item_total_) {
+            heapInsert(p->time, p->iface);
+        }
+        delete p;
+    }
+    deadline_ = item_total_ ? heap_[0].time : ~0ull;
+}
 
-IFace *ClockAsyncTQueueType::getNext(uint64_t step_cnt) {
-    IFace *ret = 0;
-    if (item_cnt_ >= item_total_) {
-        return ret;
+void ClockAsyncTQueueType::heapInsert(uint64_t time, IFace *cb) {
+    if (item_total_ == size_) {
+        StepQueueItemType *p1 = new StepQueueItemType[2*size_];
+        memcpy(p1, heap_, item_total_*sizeof(StepQueueItemType));
+        delete [] heap_;
+        heap_ = p1;
+        size_ *= 2;
     }
-    for (; item_cnt_ < item_total_; item_cnt_++) {
-        if (step_cnt < queue_[item_cnt_].time) {
-            continue;
+    heap_[item_total_].time = time;
+    heap_[item_total_].seqnum = seqnum_++;
+    heap_[item_total_].iface = cb;
+    heapUp(item_total_++);
+}
+
+void ClockAsyncTQueueType::heapUp(int idx) {
+    StepQueueItemType t;
+    int parent;
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (!less(idx, parent)) {
+            break;
         }
-        ret = queue_[item_cnt_].iface;
+        t = heap_[idx];
+        heap_[idx] = heap_[parent];
+        heap_[parent] = t;
+        idx = parent;
+    }
+}
 
-        // remove item from list using swap function to avoid usage
-        // of allocation/deallocation calls.
-        if (item_cnt_ < (item_total_ - 1)) {
-            queue_[item_cnt_] = queue_[item_total_ - 1];
+void ClockAsyncTQueueType::heapDown(int idx) {
+    StepQueueItemType t;
+    int child;
+    while ((child = 2*idx + 1) < item_total_) {
+        if (child + 1 < item_total_ && less(child + 1, child)) {
+            child++;
+        }
+        if (!less(child, idx)) {
+            break;
         }
-        item_total_--;
-        break;
+        t = heap_[idx];
+        heap_[idx] = heap_[child];
+        heap_[child] = t;
+        idx = child;
+    }
+}
+
+IFace *ClockAsyncTQueueType::getNext(uint64_t step_cnt) {
+    IFace *ret;
+    if (item_total_ == 0 || step_cnt < heap_[0].time) {
+        return 0;
     }
+    ret = heap_[0].iface;
+    heap_[0] = heap_[--item_total_];
+    heapDown(0);
+    deadline_ = item_total_ ? heap_[0].time : ~0ull;
     return ret;
 }
 
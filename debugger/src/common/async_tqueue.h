@@ -51,6 +51,11 @@ class AsyncTQueueType {
 };
 
 
+/**
+ * Step callbacks queue: binary min-heap ordered by time (and registration
+ * order for the same time) owned by the clock thread, and unbounded
+ * lock-free pre-queue for the registration from any thread.
+ */
 class ClockAsyncTQueueType {
  public:
     ClockAsyncTQueueType();
@@ -62,14 +67,22 @@ class ClockAsyncTQueueType {
     /** Thread safe method of the callbacks registration */
     void put(uint64_t time, IFace *cb);
 
+    /**
+     * Thread safe re-scheduling of the previously registered callback.
+     * Callback is registered if it isn't in the queue.
+     */
+    void move(IFace *cb, uint64_t time);
+
     /** push registered to the main queue */
     void pushPreQueued();
 
-    /** Reset proccessed counter at the begining of each iteration */
-    void initProc() { item_cnt_ = 0; }
-
-    /** move previously regsiterd callbacks: true: moved; false: not found */
-    bool move(IFace *cb, uint64_t time);
+    /**
+     * Step counter of the nearest callback or 0 if there are pre-queued
+     * requests, so that the queue can be skipped while step_cnt is less.
+     */
+    uint64_t getNextDeadline() {
+        return prequeue_ ? 0 : deadline_;
+    }
 
     /**
      * Get next registered interface with counter less or equal to 'step_cnt'
@@ -78,20 +91,36 @@ class ClockAsyncTQueueType {
 
  private:
     struct StepQueueItemType {
-        StepQueueItemType *left;
-        StepQueueItemType *right;
+        uint64_t time;
+        uint64_t seqnum;        // registration order
+        IFace *iface;
+    };
+    struct PreQueueItemType {
+        PreQueueItemType *next;
         uint64_t time;
         IFace *iface;
+        bool move;
     };
-    StepQueueItemType *queue_;
+
+    void pushRequest(uint64_t time, IFace *cb, bool move);
+    PreQueueItemType *takePreQueued();
+    void heapInsert(uint64_t time, IFace *cb);
+    void heapUp(int idx);
+    void heapDown(int idx);
+    bool less(int a, int b) {
+        return heap_[a].time < heap_[b].time
+            || (heap_[a].time == heap_[b].time
+                && heap_[a].seqnum < heap_[b].seqnum);
+    }
+
+    StepQueueItemType *heap_;
     int size_;
     int item_total_;
-    int item_cnt_;
-
-    int precnt_;
-    StepQueueItemType prequeue_[1024];
+    uint64_t seqnum_;
+    uint64_t deadline_;     // time of heap_[0] or ~0ull
 
-    mutex_def mutex_;
+    // LIFO list of pending requests, reversed when moved into the heap
+    PreQueueItemType *volatile prequeue_;
 };
 
 
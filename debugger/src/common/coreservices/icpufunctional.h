@@ -71,6 +71,8 @@ class ICpuFunctional : public IFace {
     virtual void setBranch(uint64_t npc) = 0;
     virtual void pushStackTrace() = 0;
     virtual void popStackTrace() = 0;
+    /** Return from trap handler to npc */
+    virtual void returnFromTrap() = 0;
     virtual uint64_t getPrvLevel() = 0;
     virtual void setPrvLevel(uint64_t lvl) = 0;
     virtual ETransStatus dma_memop(Axi4TransactionType *tr, int flags=0) = 0;
@@ -84,7 +86,8 @@ class ICpuFunctional : public IFace {
     virtual bool isMpuEnabled() = 0;
     virtual bool checkMpu(uint64_t addr, uint32_t sz, const char *rwx) = 0;
     virtual bool isMmuEnabled() = 0;
-    virtual uint64_t translateMmu(uint64_t addr) = 0;
+    /** Virtual to physical address, false on page fault */
+    virtual bool translateMmu(uint64_t va, const char *rwx, uint64_t *pa) = 0;
     virtual void flushMmu() = 0;
 
   protected:
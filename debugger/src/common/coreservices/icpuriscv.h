@@ -42,9 +42,9 @@ public:
     virtual uint64_t readNonStandardReg(uint32_t regno) = 0;
     virtual void writeNonStandardReg(uint32_t regno, uint64_t val) = 0;
 
-    // atomic instruction LR/SC reservation
-    virtual void mmuAddrReserve(uint64_t addr) = 0;
-    virtual bool mmuAddrRelease(uint64_t addr) = 0;
+    // atomic instruction LR/SC reservation of the loaded value
+    virtual void mmuAddrReserve(uint64_t addr, uint64_t val) = 0;
+    virtual bool mmuAddrRelease(uint64_t addr, uint64_t *val) = 0;
 
     enum ERiscvRegNames {
         Reg_Zero,
@@ -204,6 +204,14 @@ public:
     static const uint16_t CSR_frm            = 0x002;
     /** FPU Control and Status register (frm + fflags) */
     static const uint16_t CSR_fcsr           = 0x003;
+    /** Vector start element index */
+    static const uint16_t CSR_vstart         = 0x008;
+    /** Vector fixed-point saturation flag */
+    static const uint16_t CSR_vxsat          = 0x009;
+    /** Vector fixed-point rounding mode */
+    static const uint16_t CSR_vxrm           = 0x00A;
+    /** Vector control and status register (vxrm + vxsat) */
+    static const uint16_t CSR_vcsr           = 0x00F;
     /** machine mode status read/write register. */
     static const uint16_t CSR_mstatus        = 0x300;
     /** ISA and extensions supported. */
@@ -216,6 +224,11 @@ public:
     static const uint16_t CSR_mie            = 0x304;
     /** The base address of the M-mode trap vector. */
     static const uint16_t CSR_mtvec          = 0x305;
+    /** Machine counter-inhibit register */
+    static const uint16_t CSR_mcountinhibit  = 0x320;
+    /** Machine performance-monitoring event selectors (see HPM_EVENT_*) */
+    static const uint16_t CSR_mhpmevent3     = 0x323;
+    static const uint16_t CSR_mhpmevent31    = 0x33F;
     /** Scratch register for machine trap handlers. */
     static const uint16_t CSR_mscratch       = 0x340;
     /** Exception program counters. */
@@ -271,6 +284,9 @@ public:
     static const uint16_t CSR_mcycle         = 0xB00;
     /** Machine Instructions-retired counter */
     static const uint16_t CSR_minsret        = 0xB02;
+    /** Machine performance-monitoring counters */
+    static const uint16_t CSR_mhpmcounter3   = 0xB03;
+    static const uint16_t CSR_mhpmcounter31  = 0xB1F;
 
     // Non-standard machine mode CSR
     /** Stack overflow. */
@@ -290,7 +306,16 @@ public:
     static const uint16_t CSR_time           = 0xC01;
     /** User Instructions-retired counter for RDINSTRET pseudo-instruction */
     static const uint16_t CSR_insret         = 0xC02;
+    /** User read-only shadows of mhpmcounter3..31 */
+    static const uint16_t CSR_hpmcounter3    = 0xC03;
+    static const uint16_t CSR_hpmcounter31   = 0xC1F;
     /** 0xC00 to 0xC1F reserved for counters */
+    /** Vector length */
+    static const uint16_t CSR_vl             = 0xC20;
+    /** Vector data type */
+    static const uint16_t CSR_vtype          = 0xC21;
+    /** VLEN/8 vector register length in bytes */
+    static const uint16_t CSR_vlenb          = 0xC22;
     /** Vendor ID. */
     static const uint16_t CSR_mvendorid         = 0xf11;
     /** Architecture ID. */
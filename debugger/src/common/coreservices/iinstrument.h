@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_COMMON_CORESERVICES_IINSTRUMENT_H__
+#define __DEBUGGER_COMMON_CORESERVICES_IINSTRUMENT_H__
+
+#include <inttypes.h>
+#include <iface.h>
+#include "coreservices/icpufunctional.h"
+
+namespace debugger {
+
+enum EInstrumentEvent {
+    InstrEvent_Retire,      // instruction executed
+    InstrEvent_BlockEntry,  // first instruction after jump, branch or trap
+    InstrEvent_MemAccess,   // load, store or atomic of the instruction
+    InstrEvent_Trap,        // exception or interrupt is taken
+    InstrEvent_CsrWrite,    // csrrw/csrrs/csrrc (and immediate) wrote CSR
+    InstrEvent_Call,        // jump with link to the return address register
+    InstrEvent_Return,      // jump to the return address register
+    InstrEvent_TrapReturn,  // mret, sret or uret
+    InstrEvent_Total
+};
+
+static const uint32_t INSTR_EVENT_ALL = (1u << InstrEvent_Total) - 1;
+
+/**
+ * Subscription filter. Address range is checked against the data address
+ * of InstrEvent_MemAccess and against pc of all other events.
+ */
+struct InstrumentFilterType {
+    uint32_t events;        // bit per EInstrumentEvent
+    uint64_t addrmin;
+    uint64_t addrmax;       // inclusive
+    uint32_t prvmask;       // bit per privilege level
+    uint64_t hartmask;      // bit per hart index
+    int tag;                // copied into each event of the subscription
+};
+
+struct InstrumentEventType {
+    int tag;
+    int hart;
+    uint64_t prv;
+    uint64_t step;          // step counter of the hart
+    uint64_t pc;
+    IInstruction *instr;    // Retire: decoded instruction
+    uint32_t payload;       // Retire: opcode
+    uint32_t oplen;         // Retire: instruction length in bytes
+    uint64_t addr;          // MemAccess: physical address, Trap: cause,
+                            // CsrWrite: CSR index, Call, Return and
+                            // TrapReturn: target address
+    uint64_t value;         // MemAccess, CsrWrite: written or read value
+    uint32_t size;          // MemAccess: bytes
+    bool write;             // MemAccess: store, Trap: interrupt
+};
+
+static const char *const IFACE_INSTRUMENT_LISTENER = "IInstrumentListener";
+
+/**
+ * Consumer of the instrumentation events. Called from the thread of the
+ * hart so that listener subscribed to several SMP harts must not share
+ * unprotected state between them, InstrumentEventType::tag may be used
+ * to select per hart storage.
+ */
+class IInstrumentListener : public IFace {
+ public:
+    IInstrumentListener() : IFace(IFACE_INSTRUMENT_LISTENER) {}
+
+    virtual void instrumentEvent(int event,
+                                 const InstrumentEventType *ev) = 0;
+};
+
+static const char *const IFACE_INSTRUMENTATION = "IInstrumentation";
+
+/**
+ * Event source implemented by the functional CPU models. Subscriptions
+ * are expected from postinitService() before simulation starts and
+ * removed in predeleteService().
+ */
+class IInstrumentation : public IFace {
+ public:
+    IInstrumentation() : IFace(IFACE_INSTRUMENTATION) {}
+
+    /** Return false if no more subscribers can be added */
+    virtual bool subscribeInstrument(IInstrumentListener *l,
+                                     const InstrumentFilterType *filter) = 0;
+    virtual void unsubscribeInstrument(IInstrumentListener *l) = 0;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_COMMON_CORESERVICES_IINSTRUMENT_H__
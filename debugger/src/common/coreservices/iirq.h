@@ -38,6 +38,17 @@ static const int IRQ_REQUEST_NONE = 0;
 //   HART1_TIMER_IRQ = 3
 //   etc
 
+static const char *const IFACE_IRQ_LISTENER = "IIrqListener";
+
+class IIrqListener : public IFace {
+ public:
+    IIrqListener() : IFace(IFACE_IRQ_LISTENER) {}
+
+    // Called by controller on each change of the context request state,
+    // 'level' is the same as (getPendingRequest(ctxid) != IRQ_REQUEST_NONE)
+    virtual void irqLevelChanged(IFace *isrc, int ctxid, int level) = 0;
+};
+
 class IIrqController : public IFace {
  public:
     IIrqController() : IFace(IFACE_IRQ_CONTROLLER) {}
@@ -49,6 +60,14 @@ class IIrqController : public IFace {
     // prioiry and enabled for context. Called by CPU.
     // @ret IRQ_REQUEST_NONE if no requests
     virtual int getPendingRequest(int ctxid) = 0;
+
+    // Subscribe IIrqListener on the context request changes so that CPU
+    // doesn't need to poll getPendingRequest() on each instruction.
+    // Current level is reported to the listener as soon as it is known.
+    // @ret false if the controller doesn't support notifications
+    virtual bool registerIrqListener(int ctxid, IFace *listener) {
+        return false;
+    }
 };
 
 }  // namespace debugger
@@ -27,6 +27,7 @@ class IService;
 static const char *const IFACE_MEMORY_OPERATION = "IMemoryOperation";
 static const char *const IFACE_AXI4_NB_RESPONSE = "IAxi4NbResponse";
 static const char *const IFACE_ADDRESS_TRANSLATOR = "IAddressTranslator";
+static const char *const IFACE_MEMORY_WRITE_LISTENER = "IMemoryWriteListener";
 
 static const int PAYLOAD_MAX_BYTES = 8;
 
@@ -62,6 +63,25 @@ typedef struct Axi4TransactionType {
     int source_idx;             // Need for bus utilization statistic
 } Axi4TransactionType;
 
+enum EMemoryWindowAccess {
+    MemWindow_Read = 0x1,
+    MemWindow_Write = 0x2
+};
+
+/**
+ * Host memory window: direct pointer into the storage of a RAM-like device
+ * so that initiator may access it without b_transport() calls. Window
+ * stays valid while the device generation counter isn't changed.
+ */
+typedef struct MemoryWindowType {
+    uint64_t addr;              // bus address of the first byte
+    uint64_t size;              // [Bytes]
+    uint8_t *hostptr;           // host pointer to the first byte
+    uint32_t access;            // EMemoryWindowAccess bits
+    const volatile uint32_t *pgeneration;
+    uint32_t generation;
+} MemoryWindowType;
+
 /**
  * Non-blocking memory access response interface (Initiator/Master)
  */
@@ -72,6 +92,16 @@ class IAxi4NbResponse : public IFace {
     virtual void nb_response(Axi4TransactionType *trans) = 0;
 };
 
+/**
+ * Write transactions observer (to invalidate decoded instructions)
+ */
+class IMemoryWriteListener : public IFace {
+ public:
+    IMemoryWriteListener() : IFace(IFACE_MEMORY_WRITE_LISTENER) {}
+
+    virtual void memoryWritten(uint64_t addr, uint32_t sz) = 0;
+};
+
 /**
  * Slave/Targer interface
  */
@@ -82,6 +112,7 @@ class IMemoryOperation : public IFace {
         listMap_.make_list(0);
         baseAddress_.make_uint64(0);
         length_.make_uint64(0);
+        windowGeneration_ = 0;
     }
 
     /** 
@@ -113,6 +144,36 @@ class IMemoryOperation : public IFace {
         return ret;
     }
 
+    /**
+     * Direct memory window containing the specified address.
+     *
+     * Could be implemented by RAM-like devices without side effects.
+     * Default implementation opts out so that all accesses use b_transport.
+     * @return false if window cannot be provided
+     */
+    virtual bool getMemoryWindow(uint64_t addr, MemoryWindowType *w) {
+        return false;
+    }
+
+    /** Invalidate all windows previously given by the device */
+    virtual void revokeMemoryWindows() {
+        windowGeneration_++;
+    }
+
+    /**
+     * Bus notifies IMemoryWriteListener about each write transaction from
+     * any master. Default implementation doesn't support listeners.
+     */
+    virtual void registerWriteListener(IFace *listener) {}
+    virtual void unregisterWriteListener(IFace *listener) {}
+
+    /**
+     * Master wrote memory through a host window bypassing b_transport().
+     * Bus notifies all write listeners except 'source' that has already
+     * handled its own write.
+     */
+    virtual void windowWritten(Axi4TransactionType *trans, IFace *source) {}
+
     virtual uint64_t getBaseAddress() { return baseAddress_.to_uint64(); }
     virtual void setBaseAddress(uint64_t addr) {
         baseAddress_.make_uint64(addr);
@@ -125,6 +186,17 @@ class IMemoryOperation : public IFace {
     virtual int getPriority() { return priority_.to_int(); }
     virtual void setPriority(int v) { priority_.make_int64(v); }
 
+ protected:
+    void makeMemoryWindow(MemoryWindowType *w, uint64_t addr, uint64_t size,
+                          uint8_t *hostptr, uint32_t access) {
+        w->addr = addr;
+        w->size = size;
+        w->hostptr = hostptr;
+        w->access = access;
+        w->pgeneration = &windowGeneration_;
+        w->generation = windowGeneration_;
+    }
+
  protected:
     friend class IService;
     AttributeType listMap_;
@@ -132,6 +204,7 @@ class IMemoryOperation : public IFace {
     AttributeType baseAddress_;
     AttributeType length_;
     AttributeType priority_;
+    volatile uint32_t windowGeneration_;
 };
 
 }  // namespace debugger
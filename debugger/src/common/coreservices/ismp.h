@@ -0,0 +1,70 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <inttypes.h>
+#include <iface.h>
+
+namespace debugger {
+
+static const char *const IFACE_SMP_SCHEDULER = "ISmpScheduler";
+
+/**
+ * Synchronization of the harts running in parallel: each hart executes
+ * the quantum of steps and waits others at the end of it.
+ */
+class ISmpScheduler : public IFace {
+ public:
+    ISmpScheduler() : IFace(IFACE_SMP_SCHEDULER) {}
+
+    /** Number of steps in the current quantum */
+    virtual uint64_t getQuantumSteps() = 0;
+
+    /**
+     * Barrier called from the hart thread at the end of the quantum.
+     * Returns when all harts are done and the next quantum is started.
+     * @param hartidx index in the scheduler hart list
+     * @param executed instructions executed by the hart in this quantum
+     */
+    virtual void quantumDone(int hartidx, uint64_t executed) = 0;
+
+    /** Hart request that should end the sleep of all-halted system */
+    virtual void wakeupSmp() = 0;
+};
+
+
+static const char *const IFACE_SMP_HART = "ISmpHart";
+
+class ISmpHart : public IFace {
+ public:
+    ISmpHart() : IFace(IFACE_SMP_HART) {}
+
+    /**
+     * Put hart under control of the scheduler. In parallel mode the hart
+     * executes quanta in its own thread, otherwise the scheduler thread
+     * calls runQuantum() of all harts in turn.
+     * @return false if hart is disabled and won't take part
+     */
+    virtual bool attachSmp(ISmpScheduler *isched, int hartidx,
+                           bool ownthread) = 0;
+
+    /** Execute up to 'steps' instructions, return the executed number */
+    virtual uint64_t runQuantum(uint64_t steps) = 0;
+};
+
+}  // namespace debugger
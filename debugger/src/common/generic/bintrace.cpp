@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include "bintrace.h"
+
+namespace debugger {
+
+BinaryTraceWriter::BinaryTraceWriter() : IThread() {
+    AttributeType t1;
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventFull_, t1.to_string());
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventIdle_, t1.to_string());
+    fd_ = 0;
+    buf_[0] = new uint8_t[BUFFER_SIZE];
+    buf_[1] = new uint8_t[BUFFER_SIZE];
+    cur_ = buf_[0];
+    cnt_ = 0;
+    pending_ = 0;
+    pendingCnt_ = 0;
+    pc_ = 0;
+    oplen_ = 0;
+    step_ = 0;
+    memaddr_ = 0;
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+    close();
+    RISCV_event_close(&eventFull_);
+    RISCV_event_close(&eventIdle_);
+    delete [] buf_[0];
+    delete [] buf_[1];
+}
+
+bool BinaryTraceWriter::open(const char *filename) {
+    fd_ = fopen(filename, "wb");
+    if (!fd_) {
+        return false;
+    }
+    uint32_t hdr[2] = {BINTRACE_MAGIC, BINTRACE_VERSION};
+    fwrite(hdr, sizeof(hdr), 1, fd_);
+    RISCV_event_set(&eventIdle_);
+    return run();
+}
+
+void BinaryTraceWriter::close() {
+    if (!fd_) {
+        return;
+    }
+    RISCV_event_wait(&eventIdle_);
+    stop();
+    join(1000);
+    fwrite(cur_, 1, cnt_, fd_);
+    cnt_ = 0;
+    fclose(fd_);
+    fd_ = 0;
+}
+
+void BinaryTraceWriter::busyLoop() {
+    while (isEnabled()) {
+        if (RISCV_event_wait_ms(&eventFull_, 100)) {
+            continue;
+        }
+        RISCV_event_clear(&eventFull_);
+        fwrite(pending_, 1, pendingCnt_, fd_);
+        RISCV_event_set(&eventIdle_);
+    }
+}
+
+void BinaryTraceWriter::swapBuffers() {
+    RISCV_event_wait(&eventIdle_);
+    RISCV_event_clear(&eventIdle_);
+    pending_ = cur_;
+    pendingCnt_ = cnt_;
+    RISCV_event_set(&eventFull_);
+
+    cur_ = cur_ == buf_[0] ? buf_[1] : buf_[0];
+    cnt_ = 0;
+}
+
+void BinaryTraceWriter::instruction(uint64_t step, uint64_t pc,
+                                    uint32_t instr, int oplen,
+                                    int actions) {
+    reserve(BINTRACE_RECORD_MAX);
+    uint8_t *p = &cur_[cnt_];
+    int off = 1;
+    uint8_t flags = 0;
+
+    if (pc == pc_ + static_cast<uint64_t>(oplen_)) {
+        flags |= BINTRACE_PC_SEQ;
+    } else {
+        off += bintrace_put_svarint(&p[off], static_cast<int64_t>(pc - pc_));
+    }
+    if (step == step_ + 1) {
+        flags |= BINTRACE_STEP_SEQ;
+    } else {
+        off += bintrace_put_svarint(&p[off],
+                                    static_cast<int64_t>(step - step_ - 1));
+    }
+    if (oplen == 2) {
+        flags |= BINTRACE_RVC;
+        p[off++] = static_cast<uint8_t>(instr);
+        p[off++] = static_cast<uint8_t>(instr >> 8);
+    } else {
+        memcpy(&p[off], &instr, 4);
+        off += 4;
+    }
+    if (actions < BINTRACE_ACTIONS_EXT) {
+        flags |= static_cast<uint8_t>(actions << BINTRACE_ACTIONS_SHIFT);
+    } else {
+        flags |= static_cast<uint8_t>(BINTRACE_ACTIONS_EXT
+                                      << BINTRACE_ACTIONS_SHIFT);
+        off += bintrace_put_varint(&p[off], static_cast<uint64_t>(actions));
+    }
+    p[0] = flags;
+    cnt_ += off;
+
+    pc_ = pc;
+    oplen_ = oplen == 2 ? 2 : 4;
+    step_ = step;
+}
+
+void BinaryTraceWriter::regWrite(int idx, uint64_t v) {
+    uint8_t *p = &cur_[cnt_];
+    p[0] = static_cast<uint8_t>(idx << 1);
+    cnt_ += 1 + bintrace_put_svarint(&p[1], static_cast<int64_t>(v));
+}
+
+void BinaryTraceWriter::memop(bool write, uint64_t addr, uint64_t v,
+                              uint32_t sz) {
+    uint8_t *p = &cur_[cnt_];
+    int off = 1;
+    p[0] = static_cast<uint8_t>(((sz & 0x3F) << 2) | BINTRACE_ACT_MEMOP
+                                | (write ? BINTRACE_ACT_WRITE : 0));
+    off += bintrace_put_svarint(&p[off],
+                                static_cast<int64_t>(addr - memaddr_));
+    off += bintrace_put_varint(&p[off], v);
+    cnt_ += off;
+    memaddr_ = addr;
+}
+
+}  // namespace debugger
@@ -0,0 +1,184 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __SRC_COMMON_GENERIC_BINTRACE_H__
+#define __SRC_COMMON_GENERIC_BINTRACE_H__
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <api_core.h>
+#include "coreservices/ithread.h"
+#include "coreservices/isrccode.h"
+
+namespace debugger {
+
+/**
+ * Binary execution trace (GenerateTraceFile with TraceFormat 'binary').
+ *
+ * File starts with 4 bytes magic "RVTR" and 32-bit version, then one
+ * record per executed instruction:
+ *
+ *     u8       flags: [0] pc = previous pc + previous length,
+ *                     [1] step = previous step + 1,
+ *                     [2] 16-bit instruction,
+ *                     [7:3] actions, 31 = varint with actions follows
+ *     svarint  pc delta, if not [0]
+ *     svarint  step - (previous step + 1), if not [1]
+ *     u16/u32  instruction word
+ *     actions:
+ *         u8 (idx << 1)                                register write
+ *         svarint value
+ *     or
+ *         u8 (size << 2) | (write << 1) | 1            memory access
+ *         svarint address - previous memory address
+ *         varint value
+ *
+ * varint is LEB128, svarint is zigzag encoded LEB128.
+ */
+static const uint32_t BINTRACE_MAGIC = 0x52545652;    // "RVTR"
+static const uint32_t BINTRACE_VERSION = 1;
+
+static const uint8_t BINTRACE_PC_SEQ = 0x01;
+static const uint8_t BINTRACE_STEP_SEQ = 0x02;
+static const uint8_t BINTRACE_RVC = 0x04;
+static const int BINTRACE_ACTIONS_SHIFT = 3;
+static const int BINTRACE_ACTIONS_EXT = 31;
+
+static const uint8_t BINTRACE_ACT_MEMOP = 0x01;
+static const uint8_t BINTRACE_ACT_WRITE = 0x02;
+
+/** Longest record: header, deltas, instruction and 64 actions */
+static const size_t BINTRACE_RECORD_MAX = 32 + 64 * 24;
+
+inline int bintrace_put_varint(uint8_t *buf, uint64_t v) {
+    int cnt = 0;
+    while (v >= 0x80) {
+        buf[cnt++] = static_cast<uint8_t>(v | 0x80);
+        v >>= 7;
+    }
+    buf[cnt++] = static_cast<uint8_t>(v);
+    return cnt;
+}
+
+inline int bintrace_put_svarint(uint8_t *buf, int64_t v) {
+    return bintrace_put_varint(buf, (static_cast<uint64_t>(v) << 1)
+                                    ^ static_cast<uint64_t>(v >> 63));
+}
+
+/** Return 0 if the buffer ends before the last byte of the value */
+inline int bintrace_get_varint(const uint8_t *buf, size_t sz, uint64_t *v) {
+    uint64_t t = 0;
+    for (size_t i = 0; i < sz && i < 10; i++) {
+        t |= static_cast<uint64_t>(buf[i] & 0x7F) << (7 * i);
+        if (!(buf[i] & 0x80)) {
+            *v = t;
+            return static_cast<int>(i + 1);
+        }
+    }
+    return 0;
+}
+
+inline int bintrace_get_svarint(const uint8_t *buf, size_t sz, int64_t *v) {
+    uint64_t t = 0;
+    int cnt = bintrace_get_varint(buf, sz, &t);
+    *v = static_cast<int64_t>(t >> 1) ^ -static_cast<int64_t>(t & 0x1);
+    return cnt;
+}
+
+/**
+ * Mnemonic of the first disassembled instruction of ISourceCode::disasm()
+ * output, the list may start with the symbol label.
+ */
+inline const char *bintrace_mnemonic(AttributeType *asmlist) {
+    for (unsigned i = 0; i < asmlist->size(); i++) {
+        AttributeType &item = (*asmlist)[i];
+        if (item[ASM_list_type].to_int() == AsmList_disasm) {
+            return item[ASM_mnemonic].to_string();
+        }
+    }
+    return "";
+}
+
+/** Text trace lines, the same for the simulator and the decoder */
+inline int bintrace_text_instr(char *buf, size_t sz, uint64_t step,
+                               uint64_t pc, const char *mnemonic) {
+    return RISCV_sprintf(buf, sz,
+                         "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \r\n",
+                         step, pc, mnemonic);
+}
+
+inline int bintrace_text_reg(char *buf, size_t sz, const char *name,
+                             uint64_t v) {
+    return RISCV_sprintf(buf, sz, "%20s %10s <= %016" RV_PRI64 "x\r\n",
+                         "", name, v);
+}
+
+inline int bintrace_text_memop(char *buf, size_t sz, bool write,
+                               uint64_t addr, uint64_t v) {
+    return RISCV_sprintf(buf, sz, "%20s [%08" RV_PRI64 "x] %s %016"
+                         RV_PRI64 "x\r\n", "", addr, write ? "<=" : "=>", v);
+}
+
+/**
+ * Encoder with the double buffered output: the simulation thread fills
+ * one buffer while the writer thread stores another one into the file.
+ */
+class BinaryTraceWriter : public IThread {
+ public:
+    BinaryTraceWriter();
+    virtual ~BinaryTraceWriter();
+
+    bool open(const char *filename);
+    void close();
+
+    void instruction(uint64_t step, uint64_t pc, uint32_t instr, int oplen,
+                     int actions);
+    void regWrite(int idx, uint64_t v);
+    void memop(bool write, uint64_t addr, uint64_t v, uint32_t sz);
+
+ protected:
+    /** IThread */
+    virtual void busyLoop() override;
+
+ private:
+    void reserve(size_t sz) {
+        if (cnt_ + sz > BUFFER_SIZE) {
+            swapBuffers();
+        }
+    }
+    void swapBuffers();
+
+ private:
+    static const size_t BUFFER_SIZE = 4 << 20;
+
+    FILE *fd_;
+    uint8_t *buf_[2];
+    uint8_t *cur_;              // filled by the simulation thread
+    size_t cnt_;
+    uint8_t *pending_;          // stored by the writer thread
+    size_t pendingCnt_;
+    event_def eventFull_;
+    event_def eventIdle_;
+
+    uint64_t pc_;
+    int oplen_;
+    uint64_t step_;
+    uint64_t memaddr_;
+};
+
+}  // namespace debugger
+
+#endif  // __SRC_COMMON_GENERIC_BINTRACE_H__
@@ -27,6 +27,7 @@ BusGeneric::BusGeneric(const char *name) : IService(name),
     RISCV_mutex_init(&mutexNBAccess_);
     RISCV_register_hap(static_cast<IHap *>(this));
     imaphash_ = 0;
+    writeListeners_.make_list(0);
 
     memset(imemtbl_, 0, sizeof(imemtbl_));
     for (int i = 0; i < HASH_TBL_SIZE; i++) {
@@ -106,6 +107,9 @@ ETransStatus BusGeneric::b_transport(Axi4TransactionType *trans) {
         ret = TRANS_ERROR;
     } else {
         memdev->b_transport(trans);
+        if (trans->action == MemAction_Write) {
+            notifyWrite(trans, 0);
+        }
         RISCV_debug("[%08" RV_PRI64 "x] => [%08x %08x]",
             trans->addr,
             trans->rpayload.b32[1], trans->rpayload.b32[0]);
@@ -132,6 +136,9 @@ ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
         cb->nb_response(trans);
         ret = TRANS_ERROR;
     } else {
+        if (trans->action == MemAction_Write) {
+            notifyWrite(trans, 0);
+        }
         memdev->nb_transport(trans, cb);
         RISCV_debug("Non-blocking request to [%08" RV_PRI64 "x]",
                     trans->addr);
@@ -140,6 +147,111 @@ ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
     return ret;
 }
 
+void BusGeneric::registerWriteListener(IFace *listener) {
+    AttributeType lstn(listener);
+    RISCV_mutex_lock(&mutexNBAccess_);
+    RISCV_mutex_lock(&mutexBAccess_);
+    writeListeners_.add_to_list(&lstn);
+    RISCV_mutex_unlock(&mutexBAccess_);
+    RISCV_mutex_unlock(&mutexNBAccess_);
+}
+
+void BusGeneric::unregisterWriteListener(IFace *listener) {
+    RISCV_mutex_lock(&mutexNBAccess_);
+    RISCV_mutex_lock(&mutexBAccess_);
+    for (unsigned i = 0; i < writeListeners_.size(); i++) {
+        if (writeListeners_[i].to_iface() == listener) {
+            writeListeners_.remove_from_list(i);
+            break;
+        }
+    }
+    RISCV_mutex_unlock(&mutexBAccess_);
+    RISCV_mutex_unlock(&mutexNBAccess_);
+}
+
+void BusGeneric::windowWritten(Axi4TransactionType *trans, IFace *source) {
+    // Listeners are registered on init, so that a single hart doesn't
+    // need the lock on each store
+    if (writeListeners_.size() == 1
+        && writeListeners_[0u].to_iface() == source) {
+        return;
+    }
+    RISCV_mutex_lock(&mutexBAccess_);
+    notifyWrite(trans, source);
+    RISCV_mutex_unlock(&mutexBAccess_);
+}
+
+/** Called with the access mutex locked */
+void BusGeneric::notifyWrite(Axi4TransactionType *trans, IFace *source) {
+    IMemoryWriteListener *lstn;
+    for (unsigned i = 0; i < writeListeners_.size(); i++) {
+        if (writeListeners_[i].to_iface() == source) {
+            continue;
+        }
+        lstn = static_cast<IMemoryWriteListener *>(
+                    writeListeners_[i].to_iface());
+        lstn->memoryWritten(trans->addr, trans->xsize);
+    }
+}
+
+/**
+ * Forward request to the mapped device and clip its window to the
+ * hash table slot excluding other devices so that window never hides
+ * higher priority device.
+ */
+bool BusGeneric::getMemoryWindow(uint64_t addr, MemoryWindowType *w) {
+    IMemoryOperation *memdev = 0;
+    IMemoryOperation *imem;
+    Axi4TransactionType tr;
+    uint32_t sz;
+    uint64_t bar, barend, t;
+    bool ret = false;
+
+    RISCV_mutex_lock(&mutexBAccess_);
+    tr.addr = addr;
+    getMapedDevice(&tr, &memdev, &sz);
+    if (memdev == 0 || !memdev->getMemoryWindow(addr, w)) {
+        RISCV_mutex_unlock(&mutexBAccess_);
+        return ret;
+    }
+
+    uint64_t slotsz = 1ull << HASH_LVL1_OFFSET_;
+    uint64_t slotstart = addr & ~(slotsz - 1);
+    if (w->addr < slotstart) {
+        t = slotstart - w->addr;
+        w->addr += t;
+        w->hostptr += t;
+        w->size -= t;
+    }
+    if (w->addr + w->size > slotstart + slotsz) {
+        w->size = slotstart + slotsz - w->addr;
+    }
+
+    uint64_t hashidx = (addr & ADDR_MASK_) >> HASH_LVL1_OFFSET_;
+    HashTableItemType &item = imemtbl_[hashidx];
+    if (item.nxtlvlena) {
+        for (unsigned i = 0; i < item.devlist.size(); i++) {
+            imem = static_cast<IMemoryOperation *>(item.devlist[i].to_iface());
+            bar = imem->getBaseAddress();
+            barend = bar + imem->getLength();
+            if (imem == memdev || (bar <= addr && addr < barend)) {
+                continue;
+            }
+            if (bar > addr && bar < w->addr + w->size) {
+                w->size = bar - w->addr;
+            } else if (barend <= addr && barend > w->addr) {
+                t = barend - w->addr;
+                w->addr += t;
+                w->hostptr += t;
+                w->size -= t;
+            }
+        }
+    }
+    ret = true;
+    RISCV_mutex_unlock(&mutexBAccess_);
+    return ret;
+}
+
 void BusGeneric::getMapedDevice(Axi4TransactionType *trans,
                          IMemoryOperation **pdev, uint32_t *sz) {
     IMemoryOperation *imem;
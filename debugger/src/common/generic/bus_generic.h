@@ -39,6 +39,10 @@ class BusGeneric : public IService,
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
     virtual ETransStatus nb_transport(Axi4TransactionType *trans,
                                       IAxi4NbResponse *cb);
+    virtual bool getMemoryWindow(uint64_t addr, MemoryWindowType *w);
+    virtual void registerWriteListener(IFace *listener);
+    virtual void unregisterWriteListener(IFace *listener);
+    virtual void windowWritten(Axi4TransactionType *trans, IFace *source);
 
     /** IHap */
     virtual void hapTriggered(EHapType type, uint64_t param,
@@ -47,6 +51,7 @@ class BusGeneric : public IService,
  protected:
     /** Speed-optimized mapping */
     virtual void maphash();
+    void notifyWrite(Axi4TransactionType *trans, IFace *source);
     void getMapedDevice(Axi4TransactionType *trans,
                         IMemoryOperation **pdev, uint32_t *sz);
 
@@ -60,6 +65,7 @@ class BusGeneric : public IService,
     Axi4TransactionType nb_tr_;
 
     IMemoryOperation **imaphash_;
+    AttributeType writeListeners_;
 
     struct HashTableItemType {
         bool nxtlvlena;
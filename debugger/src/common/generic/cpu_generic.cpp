@@ -31,6 +31,9 @@ CpuGeneric::CpuGeneric(const char *name)
     registerInterface(static_cast<IDPort *>(this));
     registerInterface(static_cast<IPower *>(this));
     registerInterface(static_cast<IResetListener *>(this));
+    registerInterface(static_cast<IMemoryWriteListener *>(this));
+    registerInterface(static_cast<ISmpHart *>(this));
+    registerInterface(static_cast<IInstrumentation *>(this));
     registerInterface(static_cast<IHap *>(this));
     registerAttribute("Enable", &isEnable_);
     registerAttribute("SysBus", &sysBus_);
@@ -41,38 +44,73 @@ CpuGeneric::CpuGeneric(const char *name)
     registerAttribute("StackTraceSize", &stackTraceSize_);
     registerAttribute("FreqHz", &freqHz_);
     registerAttribute("GenerateTraceFile", &generateTraceFile_);
+    registerAttribute("TraceFormat", &traceFormat_);
     registerAttribute("ResetVector", &resetVector_);
     registerAttribute("SysBusMasterID", &sysBusMasterID_);
     registerAttribute("CacheBaseAddress", &cacheBaseAddr_);
     registerAttribute("CacheAddressMask", &cacheAddrMask_);
+    registerAttribute("CacheRegions", &cacheRegions_);
+    registerAttribute("CacheAutoRegions", &cacheAutoRegions_);
     registerAttribute("CoverageTracker", &coverageTracker_);
     registerAttribute("TriggersTotal", &triggersTotal_);
     registerAttribute("McontrolMaskmax", &mcontrolMaskmax_);
     registerAttribute("ResetState", &resetState_);
+    registerAttribute("BlockCacheSize", &blockCacheSize_);
+    registerAttribute("BurstSize", &burstSize_);
+    registerAttribute("BurstExits", &burstExits_);
+    registerAttribute("IdleSkip", &idleSkip_);
+    registerAttribute("IdleSkipMax", &idleSkipMax_);
+    registerAttribute("IdleSkipped", &idleSkipped_);
 
     char tstr[256];
     RISCV_sprintf(tstr, sizeof(tstr), "eventConfigDone_%s", name);
     RISCV_event_create(&eventConfigDone_, tstr);
     RISCV_sprintf(tstr, sizeof(tstr), "eventDbgRequest_%s", name);
     RISCV_event_create(&eventDbgRequest_, tstr);
-    RISCV_mutex_init(&mutex_csr_);
+    RISCV_sprintf(tstr, sizeof(tstr), "eventWakeup_%s", name);
+    RISCV_event_create(&eventWakeup_, tstr);
     RISCV_register_hap(static_cast<IHap *>(this));
 
     isysbus_ = 0;
+    ismp_ = 0;
+    smpidx_ = 0;
+    smpthread_ = false;
     estate_ = CORE_OFF;
     step_cnt_ = 0;
+    stall_cnt_ = 0;
     pc_z_ = 0;
     exceptions_ = 0;
     interrupt_pending_[0] = 0;
     interrupt_pending_[1] = 0;
     do_not_cache_ = false;
-    haltreq_ = false;
+    attention_ = 0;
+    burst_end_ = 0;
+    burst_size_ = 0;
+    burstSize_.make_int64(1024);
+    burstExits_.make_list(BurstExit_Total);
+    for (unsigned i = 0; i < burstExits_.size(); i++) {
+        burstExits_[i].make_uint64(0);
+    }
+    idleSkip_.make_boolean(false);
+    idleSkipMax_.make_uint64(0x1000000);
+    traceFormat_.make_string("text");
+    idleSkipped_.make_uint64(0);
+    idle_skip_ = false;
+    idle_skip_max_ = 0;
+    quantum_end_ = ~0ull;
     procbufexecreq_ = false;
     resumereq_ = false;
     resumeack_ = false;
 
     ptriggers_ = 0;
+    trigexec_ = 0;
+    trigExecTotal_ = 0;
+    trigicount_ = 0;
+    trigICountTotal_ = 0;
     trace_file_ = 0;
+    trace_bin_ = 0;
+    memset(instrSubsTotal_, 0, sizeof(instrSubsTotal_));
+    instrEvents_ = 0;
     trace_data_.step_cnt = 0;
     trace_data_.pc = 0;
     trace_data_.instrbuf.make_data(8);
@@ -80,14 +118,24 @@ CpuGeneric::CpuGeneric(const char *name)
     memset(&trace_data_.action, 0, sizeof(trace_data_.action));
     trace_data_.action_cnt = 0;
 
-    icache_ = 0;
-    memcache_sz_ = 0;
+    cacheRegions_.make_list(0);
+    cacheAutoRegions_.make_boolean(false);
+    memset(icachehash_, 0, sizeof(icachehash_));
+    icachelast_ = 0;
+    icachepage_ = 0;
+    icacheline_ = 0;
+    icachePages_ = 0;
+    RISCV_mutex_init(&mutex_icache_);
     fetch_addr_ = 0;
-    cache_offset_ = 0;
-    cachable_pc_ = false;
-    CACHE_BASE_ADDR_ = 0;
-    CACHE_MASK_ = 0;
     oplen_ = 0;
+    blockCacheSize_.make_int64(0);      // disabled by default
+    blockcache_ = 0;
+    blockcache_mask_ = 0;
+    blkrec_ = 0;
+    blkrec_next_ = 0;
+    jit_threshold_ = 0;
+    jit_verify_ = false;
+    flushMemoryWindows();
     RISCV_set_default_clock(static_cast<IClock *>(this));
 
     R = portRegs_.getpR64();
@@ -101,17 +149,25 @@ CpuGeneric::~CpuGeneric() {
     RISCV_set_default_clock(0);
     RISCV_event_close(&eventConfigDone_);
     RISCV_event_close(&eventDbgRequest_);
-    RISCV_mutex_destroy(&mutex_csr_);
-    if (icache_) {
-        delete [] icache_;
+    RISCV_event_close(&eventWakeup_);
+    flushICache(~0ull);
+    RISCV_mutex_destroy(&mutex_icache_);
+    if (blockcache_) {
+        delete [] blockcache_;
     }
     if (ptriggers_) {
         delete [] ptriggers_;
+        delete [] trigexec_;
+        delete [] trigicount_;
     }
     if (trace_file_) {
         trace_file_->close();
         delete trace_file_;
     }
+    if (trace_bin_) {
+        trace_bin_->close();
+        delete trace_bin_;
+    }
 }
 
 void CpuGeneric::postinitService() {
@@ -128,6 +184,7 @@ void CpuGeneric::postinitService() {
                     sysBus_.to_string());
         return;
     }
+    isysbus_->registerWriteListener(static_cast<IMemoryWriteListener *>(this));
 
     isrc_ = static_cast<ISourceCode *>(
        RISCV_get_service_iface(sourceCode_.to_string(), IFACE_SOURCE_CODE));
@@ -157,16 +214,33 @@ void CpuGeneric::postinitService() {
     }
 
     stackTraceBuf_.setRegTotal(2 * stackTraceSize_.to_int());
+    burst_size_ = burstSize_.to_uint64();
+    idle_skip_ = idleSkip_.to_bool();
+    idle_skip_max_ = idleSkipMax_.to_uint64();
 
     ptriggers_ = new TriggerStorageType[triggersTotal_.to_int()];
     memset(ptriggers_, 0, triggersTotal_.to_int()*sizeof(TriggerStorageType));
+    trigexec_ = new TriggerExecType[triggersTotal_.to_int()];
+    trigicount_ = new int[triggersTotal_.to_int()];
+    updateTriggers();
 
-    CACHE_BASE_ADDR_ = cacheBaseAddr_.to_uint64();
-    CACHE_MASK_ = ~cacheAddrMask_.to_uint64();
     if (cacheAddrMask_.to_uint64()) {
-        memcache_sz_ = cacheAddrMask_.to_int() + 1;
-        icache_ = new ICacheType[memcache_sz_];
-        memset(icache_, 0, memcache_sz_*sizeof(ICacheType));
+        // Legacy single region configuration
+        AttributeType region;
+        region.make_list(2);
+        region[0u].make_uint64(cacheBaseAddr_.to_uint64());
+        region[1].make_uint64(cacheAddrMask_.to_uint64() + 1);
+        cacheRegions_.add_to_list(&region);
+    }
+
+    if (blockCacheSize_.to_int() > 0) {
+        int blocks_total = 1;
+        while (blocks_total < blockCacheSize_.to_int()) {
+            blocks_total <<= 1;
+        }
+        blockcache_ = new BlockType[blocks_total];
+        memset(blockcache_, 0, blocks_total*sizeof(BlockType));
+        blockcache_mask_ = static_cast<uint64_t>(blocks_total - 1);
     }
 
     // Get global settings:
@@ -177,7 +251,17 @@ void CpuGeneric::postinitService() {
             return;
         }
         if (generateTraceFile_.is_string() && generateTraceFile_.size()) {
-            trace_file_ = new std::ofstream(generateTraceFile_.to_string());
+            const char *fname = generateTraceFile_.to_string();
+            if (traceFormat_.is_equal("binary")) {
+                trace_bin_ = new BinaryTraceWriter();
+                if (!trace_bin_->open(fname)) {
+                    RISCV_error("Can't open trace file %s", fname);
+                    delete trace_bin_;
+                    trace_bin_ = 0;
+                }
+            } else {
+                trace_file_ = new std::ofstream(fname);
+            }
         }
     }
 
@@ -195,35 +279,125 @@ void CpuGeneric::hapTriggered(EHapType type,
 void CpuGeneric::busyLoop() {
     RISCV_event_wait(&eventConfigDone_);
 
+    if (ismp_) {
+        // Scheduler thread executes all harts in round-robin mode
+        while (smpthread_ && isEnabled()) {
+            ismp_->quantumDone(smpidx_,
+                               runQuantum(ismp_->getQuantumSteps()));
+        }
+        return;
+    }
     while (isEnabled()) {
         updatePipeline();
     }
 }
 
+void CpuGeneric::stop() {
+    IThread::stop();
+    RISCV_event_set(&eventWakeup_);
+}
+
+/**
+ * Block halted or turned-off core until any request changes its state or
+ * step callback becomes due. Event is cleared before the conditions check
+ * so that a request set in between isn't lost.
+ */
+void CpuGeneric::waitWakeup() {
+    if (ismp_) {
+        // Hart can't hold the barrier, scheduler sleeps instead
+        return;
+    }
+    RISCV_event_clear(&eventWakeup_);
+    if (!isHalted() || procbufexecreq_ || resumereq_ || !isEnabled()
+        || getClockCounter() >= queue_.getNextDeadline()) {
+        return;
+    }
+    RISCV_event_wait(&eventWakeup_);
+}
+
+void CpuGeneric::wakeup() {
+    RISCV_event_set(&eventWakeup_);
+    if (ismp_) {
+        ismp_->wakeupSmp();
+    }
+}
+
+bool CpuGeneric::attachSmp(ISmpScheduler *isched, int hartidx,
+                           bool ownthread) {
+    if (!isEnable_.to_bool()) {
+        return false;
+    }
+    ismp_ = isched;
+    smpidx_ = hartidx;
+    smpthread_ = ownthread;
+    return true;
+}
+
+/**
+ * Execute instructions till the end of the quantum. Halted hart returns
+ * once its debug requests are processed.
+ */
+uint64_t CpuGeneric::runQuantum(uint64_t steps) {
+    uint64_t start = getClockCounter();
+    uint64_t end = start + steps;
+    quantum_end_ = end;
+    do {
+        updatePipeline();
+    } while (getClockCounter() < end && !isHalted() && isEnabled());
+    return getClockCounter() - start;
+}
+
 void CpuGeneric::updatePipeline() {
     if (!updateState()) {
         return;
     }
 
     setPC(getNPC());
+    if (isInstrumented(InstrEvent_BlockEntry)
+        && getPC() != pc_z_ + oplen_) {
+        InstrumentEventType ev;
+        instrumentInit(&ev);
+        instrumentNotify(InstrEvent_BlockEntry, &ev, ev.pc);
+    }
     branch_ = false;
     oplen_ = 0;
 
-    if (!isTriggerInstruction()) {
-        fetchILine();
-        instr_ = decodeInstruction(cacheline_);
-
-        trackContextStart();
-        if (instr_) {
-            oplen_ = instr_->exec(cacheline_);
-        } else {
-            generateIllegalOpcode();
+    if (!trigExecTotal_ || !isTriggerInstruction()) {
+        if (blockcache_ && isBlockCacheAllowed()) {
+            BlockType *blk = &blockcache_[(getPC() >> 1) & blockcache_mask_];
+            if (blk->total && blk->addr == getPC()
+                && blk->page->generation == blk->generation) {
+                executeBlock(blk);
+                return;
+            }
         }
-        trackContextEnd();
+        executeInstruction();
+    }
 
-        pc_z_ = getPC();
+    finishInstruction();
+}
+
+void CpuGeneric::executeInstruction() {
+    fetchILine();
+    if (!instr_) {
+        instr_ = decodeInstruction(cacheline_);
+    }
+
+    trackContextStart();
+    if (instr_) {
+        oplen_ = instr_->exec(cacheline_);
+    } else {
+        generateIllegalOpcode();
+    }
+    if (blockcache_) {
+        recordBlockInstruction();
     }
+    trackContextEnd();
 
+    pc_z_ = getPC();
+}
+
+void CpuGeneric::finishInstruction() {
     if (!branch_) {
         setNPC(getPC() + oplen_);
     }
@@ -232,13 +406,265 @@ void CpuGeneric::updatePipeline() {
 
     handleTrap();
 
-    if (trace_file_) {
+    if (trace_bin_) {
+        traceBinaryOutput();
+    } else if (trace_file_) {
         traceOutput();
     }
 }
 
+/**
+ * Replay predecoded block. Fetch and decode stages are skipped, all other
+ * stages (state update, triggers, step queue, traps and tracer) are called
+ * on each instruction exactly as in updatePipeline(). Exit on any control
+ * transfer, trap or halt.
+ */
+void CpuGeneric::executeBlock(BlockType *blk) {
+    BlockInstrType *p;
+    int idx = 0;
+
+    blkrec_ = 0;
+    icachepage_ = 0;
+    icacheline_ = 0;
+    if (jit_threshold_) {
+        idx = executeJit(blk);
+        if (idx) {
+            // Queue, traps and tracer after the last translated instruction
+            finishInstruction();
+            if (!continueBlock(blk, idx)) {
+                return;
+            }
+        }
+    }
+    while (true) {
+        p = &blk->op[idx++];
+        fetch_addr_ = getPC();
+        cacheline_[0].val = p->payload.val;
+        instr_ = p->instr;
+
+        trackContextStart();
+        oplen_ = instr_->exec(cacheline_);
+        trackContextEnd();
+
+        pc_z_ = getPC();
+
+        finishInstruction();
+
+        if (!continueBlock(blk, idx)) {
+            return;
+        }
+    }
+}
+
+/**
+ * Switch to the next instruction of the block after idx instructions were
+ * executed. Returns false when the rest of the block must be skipped.
+ */
+bool CpuGeneric::continueBlock(BlockType *blk, int idx) {
+    // Block could be flushed by the last executed instruction
+    if (idx >= blk->total || getNPC() != (getPC() + oplen_)) {
+        return false;
+    }
+
+    if (!updateState()) {
+        return false;
+    }
+    setPC(getNPC());
+    branch_ = false;
+    oplen_ = 0;
+
+    if (trigExecTotal_ && isTriggerInstruction()) {
+        finishInstruction();
+        return false;
+    }
+    if (blk->page->generation != blk->generation) {
+        // Block modified itself or was written by another master
+        executeInstruction();
+        finishInstruction();
+        return false;
+    }
+    if (!isBlockCacheAllowed()) {
+        // MMU or MPU was switched on inside of the block
+        executeInstruction();
+        finishInstruction();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Run host code of the block translated after JitThreshold replays. It is
+ * used only while no per instruction control is required: inside of the
+ * burst, without tracer, coverage tracker or execution triggers. Returns
+ * number of executed instructions, 0 if the block should be interpreted.
+ */
+int CpuGeneric::executeJit(BlockType *blk) {
+    uint64_t regs[JIT_REGS_TOTAL];
+    uint64_t pc[2];
+    BlockInstrType *p;
+    int cnt;
+
+    if (attention_ || isTracing() || icovtracker_ || trigExecTotal_
+        || isInstrumented(InstrEvent_Retire)) {
+        return 0;
+    }
+    if (!blk->jitcode) {
+        if (++blk->hits != jit_threshold_ || !translateBlock(blk)) {
+            return 0;
+        }
+    }
+    // The first instruction was counted by updateState()
+    if (step_cnt_ + static_cast<uint64_t>(blk->jittotal) > burst_end_) {
+        return 0;
+    }
+
+    if (jit_verify_) {
+        memcpy(regs, R, sizeof(regs));
+    }
+    cnt = blk->jitcode(R, pc);
+    if (jit_verify_) {
+        verifyJit(blk, cnt, regs, pc);
+    }
+
+    step_cnt_ += cnt - 1;
+    p = &blk->op[cnt - 1];
+    fetch_addr_ = pc[0];
+    cacheline_[0].val = p->payload.val;
+    instr_ = p->instr;
+    oplen_ = p->oplen;
+    setPC(pc[0]);
+    setNPC(pc[1]);
+    branch_ = pc[1] != pc[0] + static_cast<uint64_t>(oplen_);
+    pc_z_ = pc[0];
+    return cnt;
+}
+
+/**
+ * Lock-step check of the translated code (JitVerify). The same instructions
+ * are replayed by the interpreter from the registers saved before the host
+ * code and the results are compared. Interpreter state is kept and the
+ * block is never translated again on mismatch.
+ */
+void CpuGeneric::verifyJit(BlockType *blk, int cnt, const uint64_t *regs,
+                           uint64_t *pc) {
+    uint64_t jitregs[JIT_REGS_TOTAL];
+    bool idle_skip = idle_skip_;
+    BlockInstrType *p;
+    unsigned oplen;
+
+    memcpy(jitregs, R, sizeof(jitregs));
+    memcpy(R, regs, sizeof(jitregs));
+    // Translated code doesn't skip idle loops
+    idle_skip_ = false;
+    for (int i = 0; i < cnt; i++) {
+        p = &blk->op[i];
+        if (i) {
+            setPC(getNPC());
+        }
+        fetch_addr_ = getPC();
+        cacheline_[0].val = p->payload.val;
+        branch_ = false;
+        oplen = p->instr->exec(cacheline_);
+        if (!branch_) {
+            setNPC(getPC() + oplen);
+        }
+    }
+    idle_skip_ = idle_skip;
+
+    for (int i = 0; i < JIT_REGS_TOTAL; i++) {
+        if (jitregs[i] != R[i]) {
+            RISCV_error("JIT block %" RV_PRI64 "x: r%d = %" RV_PRI64 "x, "
+                        "expected %" RV_PRI64 "x",
+                        blk->addr, i, jitregs[i], R[i]);
+            blk->jittotal = -1;
+        }
+    }
+    if (pc[0] != getPC() || pc[1] != getNPC()) {
+        RISCV_error("JIT block %" RV_PRI64 "x: pc %" RV_PRI64 "x->"
+                    "%" RV_PRI64 "x, expected %" RV_PRI64 "x->%" RV_PRI64 "x",
+                    blk->addr, pc[0], pc[1], getPC(), getNPC());
+        blk->jittotal = -1;
+    }
+    if (blk->jittotal < 0) {
+        blk->jitcode = 0;
+        blk->jittotal = 0;
+        blk->hits = jit_threshold_;
+    }
+    pc[0] = getPC();
+    pc[1] = getNPC();
+}
+
+/** Translated code buffer is going to be reused */
+void CpuGeneric::dropJitCode() {
+    for (uint64_t i = 0; i <= blockcache_mask_; i++) {
+        blockcache_[i].jitcode = 0;
+        blockcache_[i].hits = 0;
+    }
+}
+
+/**
+ * Append just executed instruction into the block started at the address
+ * of the first instruction of the straight-line sequence.
+ */
+void CpuGeneric::recordBlockInstruction() {
+    uint64_t pc = getPC();
+    if (!instr_ || do_not_cache_ || exceptions_ || icachepage_ == 0
+        || estate_ != CORE_Normal || !isBlockCacheAllowed()) {
+        blkrec_ = 0;
+        return;
+    }
+
+    if (blkrec_ == 0 || blkrec_next_ != pc
+        || blkrec_->page != icachepage_
+        || blkrec_->generation != icachepage_->generation) {
+        blkrec_ = &blockcache_[(pc >> 1) & blockcache_mask_];
+        blkrec_->addr = pc;
+        blkrec_->total = 0;
+        blkrec_->page = icachepage_;
+        blkrec_->generation = icachepage_->generation;
+        blkrec_->hits = 0;
+        blkrec_->jitcode = 0;
+        blkrec_->jittotal = 0;
+    }
+
+    BlockInstrType *p = &blkrec_->op[blkrec_->total++];
+    p->instr = instr_;
+    p->payload.val = cacheline_[0].val;
+    p->oplen = oplen_;
+    blkrec_next_ = pc + oplen_;
+    blkrec_->endaddr = blkrec_next_;
+
+    if (branch_ || blkrec_->total >= BLOCK_INSTR_MAX) {
+        blkrec_ = 0;
+    }
+}
+
+/** Fetch stage is skipped in a block so it shouldn't be used when
+ *  fetch address translation or access checking is required.
+ */
+bool CpuGeneric::isBlockCacheAllowed() {
+    return estate_ == CORE_Normal && !isMmuEnabled() && !isMpuEnabled();
+}
+
+/**
+ * Control checks are done only at the end of a burst: when a step callback
+ * is due, after BurstSize instructions or when any attention bit is set.
+ */
 bool CpuGeneric::updateState() {
+    if (!attention_ && step_cnt_ < burst_end_) {
+        step_cnt_++;
+        return true;
+    }
+
     bool upd = true;
+    if (estate_ == CORE_Normal) {
+        countBurstExit();
+    } else {
+        burst_end_ = 0;
+    }
+    if (attention_ & ATTN_State) {
+        clearAttention(ATTN_State);
+    }
     switch (estate_) {
     case CORE_OFF:
     case CORE_Halted:
@@ -253,17 +679,18 @@ bool CpuGeneric::updateState() {
             resume();
         } else {
             updateQueue();
+            waitWakeup();
         }
         break;
     case CORE_Normal:
-        if (haltreq_) {
-            haltreq_ = false;
+        if (attention_ & ATTN_HaltReq) {
+            clearAttention(ATTN_HaltReq);
             upd = false;
             halt(HALT_CAUSE_HALTREQ, "External Halt request");
-        } else if (isTriggerICount()) {
+        } else if ((attention_ & ATTN_ICount) && isTriggerICount()) {
             upd = false;
             halt(HALT_CAUSE_TRIGGER, "Trigger icount hit");
-        } else if (isStepEnabled()) {
+        } else if ((attention_ & ATTN_Step) && isStepEnabled()) {
             upd = false;
             halt(HALT_CAUSE_STEP, "Stepping breakpoint");
         }
@@ -278,20 +705,65 @@ bool CpuGeneric::updateState() {
     return upd;
 }
 
+/**
+ * Callbacks are scheduled in clock cycles while the burst is counted in
+ * instructions, the stall cycles shorten the burst in addStallCycles().
+ */
 void CpuGeneric::updateQueue() {
     IFace *cb;
-    queue_.initProc();
-    queue_.pushPreQueued();
+    if (!attention_ && step_cnt_ < burst_end_) {
+        return;
+    }
+    if (attention_ & ATTN_Queue) {
+        clearAttention(ATTN_Queue);
+    }
+    uint64_t clk = getClockCounter();
+    if (clk >= queue_.getNextDeadline()) {
+        queue_.pushPreQueued();
 
-    while ((cb = queue_.getNext(step_cnt_)) != 0) {
-        static_cast<IClockListener *>(cb)->stepCallback(step_cnt_);
+        while ((cb = queue_.getNext(clk)) != 0) {
+            static_cast<IClockListener *>(cb)->stepCallback(clk);
+        }
+    }
+
+    if (estate_ != CORE_Normal) {
+        return;
+    }
+    // Next burst
+    uint64_t dt = 0;
+    if (queue_.getNextDeadline() > clk) {
+        dt = queue_.getNextDeadline() - clk;
     }
+    burst_end_ = step_cnt_ + (dt < burst_size_ ? dt : burst_size_);
+}
+
+void CpuGeneric::addStallCycles(uint64_t t) {
+    stall_cnt_ += t;
+    burst_end_ = burst_end_ > t ? burst_end_ - t : 0;
+}
+
+void CpuGeneric::countBurstExit() {
+    int reason = 0;
+    uint32_t t = attention_;
+    if (t) {
+        while (!(t & 0x1)) {
+            t >>= 1;
+            reason++;
+        }
+    } else if (getClockCounter() >= queue_.getNextDeadline()) {
+        reason = BurstExit_Deadline;
+    } else {
+        reason = BurstExit_Limit;
+    }
+    AttributeType &cnt = burstExits_[reason];
+    cnt.make_uint64(cnt.to_uint64() + 1);
 }
 
 void CpuGeneric::fetchILine() {
     bool generate_trap = false;
     fetch_addr_ = fetchingAddress();
-    cachable_pc_ = false;
+    icachepage_ = 0;
+    icacheline_ = 0;
     instr_ = 0;
 
     if (estate_ == CORE_ProgbufExec) {
@@ -301,11 +773,17 @@ void CpuGeneric::fetchILine() {
         return;
     }
 
-    if ((fetch_addr_ & CACHE_MASK_) == CACHE_BASE_ADDR_) {
-        cachable_pc_ = true;
-        cache_offset_ = fetch_addr_ - CACHE_BASE_ADDR_;
-        instr_ = icache_[cache_offset_].instr;
-        cacheline_[0].buf32[0] = icache_[cache_offset_].buf;  // for tracer
+    if (icachePages_ && !isMmuEnabled()
+        && (!isMpuEnabled() || checkMpu(fetch_addr_, 4, "x"))) {
+        icacheline_ = getICacheLine(fetch_addr_, false);
+        if (icacheline_) {
+            icachepage_ = icachelast_;
+        }
+        if (icacheline_ && icacheline_->instr) {
+            instr_ = icacheline_->instr;
+            cacheline_[0].buf32[0] = icacheline_->buf;  // for tracer
+            return;
+        }
     }
 
     trans_.action = MemAction_Read;
@@ -316,6 +794,13 @@ void CpuGeneric::fetchILine() {
         generate_trap = true;
     } else {
         cacheline_[0].val = trans_.rpayload.b64[0];
+        if (!isMmuEnabled() && isCacheableAddress(trans_.addr)) {
+            icacheline_ = getICacheLine(trans_.addr, true);
+            icachepage_ = icachelast_;
+        } else {
+            icachepage_ = 0;
+            icacheline_ = 0;
+        }
     }
 
     if (generate_trap) {
@@ -327,7 +812,9 @@ void CpuGeneric::fetchILine() {
 }
 
 void CpuGeneric::handleTrap() {
-    checkStackProtection();
+    if (attention_ & ATTN_StackCheck) {
+        checkStackProtection();
+    }
     if (exceptions_) {
         uint64_t t = exceptions_;
         int e = 0;
@@ -336,28 +823,173 @@ void CpuGeneric::handleTrap() {
             e++;
         }
         exceptions_ &= ~(1ull << e);
+        if (isInstrumented(InstrEvent_Trap)) {
+            instrumentTrap(e, false);
+        }
         handleException(e);
-    } else {
+    } else if (attention_ & ATTN_Irq) {
         handleInterrupts();
     }
 }
 
 void CpuGeneric::flush(uint64_t addr) {
-    if (icache_ == 0) {
+    /** SW breakpoint manager must call this flush operation */
+    flushBlocks(addr);
+    flushICache(addr);
+}
+
+/**
+ * Configured regions or, if enabled, any plain memory accessed via
+ * host window (RAM, ROM) are cached.
+ */
+bool CpuGeneric::isCacheableAddress(uint64_t addr) {
+    uint64_t base;
+    for (unsigned i = 0; i < cacheRegions_.size(); i++) {
+        const AttributeType &region = cacheRegions_[i];
+        base = region[0u].to_uint64();
+        if (addr >= base && addr < base + region[1].to_uint64()) {
+            return true;
+        }
+    }
+    if (cacheAutoRegions_.to_bool()) {
+        MemoryWindowType *w = &memwin_[0];
+        uint64_t off = addr - w->addr;
+        if (off < w->size && *w->pgeneration == w->generation) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CpuGeneric::ICacheType *CpuGeneric::getICacheLine(uint64_t addr,
+                                                  bool alloc) {
+    uint64_t pageaddr = addr >> ICACHE_PAGE_BITS;
+    ICachePageType *p = icachelast_;
+    if (p == 0 || p->pageaddr != pageaddr) {
+        ICachePageType **pp = &icachehash_[pageaddr & (ICACHE_HASH_SIZE - 1)];
+        p = *pp;
+        while (p && p->pageaddr != pageaddr) {
+            p = p->next;
+        }
+        if (p == 0) {
+            if (!alloc) {
+                return 0;
+            }
+            p = new ICachePageType;
+            memset(p->line, 0, sizeof(p->line));
+            memset(p->codemask, 0, sizeof(p->codemask));
+            p->generation = 0;
+            p->pageaddr = pageaddr;
+            p->next = *pp;
+            *pp = p;
+            icachePages_++;
+        }
+        icachelast_ = p;
+    }
+    return &p->line[(addr & ((1ull << ICACHE_PAGE_BITS) - 1)) >> 1];
+}
+
+CpuGeneric::ICachePageType *CpuGeneric::findICachePage(uint64_t pageaddr) {
+    ICachePageType *p = icachehash_[pageaddr & (ICACHE_HASH_SIZE - 1)];
+    while (p && p->pageaddr != pageaddr) {
+        p = p->next;
+    }
+    return p;
+}
+
+void CpuGeneric::flushICache(uint64_t addr) {
+    ICacheType *e;
+    if (addr == ~0ull) {
+        ICachePageType *p, *pnext;
+        RISCV_mutex_lock(&mutex_icache_);
+        for (int i = 0; i < ICACHE_HASH_SIZE; i++) {
+            p = icachehash_[i];
+            while (p) {
+                pnext = p->next;
+                delete p;
+                p = pnext;
+            }
+            icachehash_[i] = 0;
+        }
+        icachelast_ = 0;
+        icachepage_ = 0;
+        icacheline_ = 0;
+        icachePages_ = 0;
+        RISCV_mutex_unlock(&mutex_icache_);
+        return;
+    }
+    // 32-bits instruction may start at the previous halfword
+    if ((e = getICacheLine(addr, false)) != 0) {
+        e->instr = 0;
+    }
+    if ((e = getICacheLine(addr - 2, false)) != 0) {
+        e->instr = 0;
+    }
+}
+
+/**
+ * Drop decoded instructions overlapped by the written bytes. Only pages
+ * that really hold decoded code in the written range are touched, and
+ * their generation counter invalidates predecoded blocks.
+ */
+void CpuGeneric::invalidateCode(uint64_t addr, uint32_t sz) {
+    ICachePageType *p = 0;
+    uint64_t pageaddr;
+    unsigned idx;
+    uint64_t a = addr & ~0x1ull;
+    uint64_t aend = addr + sz;
+    // 32-bits instruction may start at the previous halfword
+    if (a >= 2) {
+        a -= 2;
+    }
+    for (; a < aend; a += 2) {
+        pageaddr = a >> ICACHE_PAGE_BITS;
+        if (p == 0 || p->pageaddr != pageaddr) {
+            p = findICachePage(pageaddr);
+            if (p == 0) {
+                // skip the rest of the page without code
+                a = ((pageaddr + 1) << ICACHE_PAGE_BITS) - 2;
+                continue;
+            }
+        }
+        idx = static_cast<unsigned>(a & ((1ull << ICACHE_PAGE_BITS) - 1)) >> 1;
+        if (p->codemask[idx >> 6] & (1ull << (idx & 0x3F))) {
+            p->codemask[idx >> 6] &= ~(1ull << (idx & 0x3F));
+            p->line[idx].instr = 0;
+            p->generation++;
+        }
+    }
+}
+
+void CpuGeneric::memoryWritten(uint64_t addr, uint32_t sz) {
+    if (icachePages_ == 0) {
         return;
     }
+    RISCV_mutex_lock(&mutex_icache_);
+    invalidateCode(addr, sz);
+    RISCV_mutex_unlock(&mutex_icache_);
+}
+
+void CpuGeneric::flushBlocks(uint64_t addr) {
+    if (blockcache_ == 0) {
+        return;
+    }
+    blkrec_ = 0;
     if (addr == ~0ull) {
-        memset(icache_, 0, memcache_sz_*sizeof(ICacheType));
-    } else if ((addr & CACHE_MASK_) == CACHE_BASE_ADDR_) {
-        /** SW breakpoint manager must call this flush operation */
-        if ((addr & CACHE_MASK_) == CACHE_BASE_ADDR_) {
-            icache_[addr - CACHE_BASE_ADDR_].instr = 0;
+        memset(blockcache_, 0, (blockcache_mask_ + 1)*sizeof(BlockType));
+        return;
+    }
+    BlockType *blk;
+    for (uint64_t i = 0; i <= blockcache_mask_; i++) {
+        blk = &blockcache_[i];
+        if (blk->total && addr >= blk->addr && addr < blk->endaddr) {
+            blk->total = 0;
         }
     }
 }
 
 void CpuGeneric::trackContextStart() {
-    if (!trace_file_) {
+    if (!isTracing()) {
         return;
     }
     trace_data_.action_cnt = 0;
@@ -367,21 +999,50 @@ void CpuGeneric::trackContextStart() {
 }
 
 void CpuGeneric::trackContextEnd() {
+    unsigned idx;
     if (do_not_cache_) {
-        if (cachable_pc_) {
-            icache_[cache_offset_].instr = 0;
+        if (icacheline_) {
+            icacheline_->instr = 0;
         }
     } else {
         if (icovtracker_) {
             icovtracker_->markAddress(fetch_addr_,
                                       static_cast<uint8_t>(oplen_));
         }
-        if (cachable_pc_) {
-            icache_[cache_offset_].instr = instr_;
-            icache_[cache_offset_].buf = cacheline_[0].buf32[0];
+        if (icacheline_ && icacheline_->instr != instr_) {
+            icacheline_->instr = instr_;
+            icacheline_->buf = cacheline_[0].buf32[0];
+            idx = static_cast<unsigned>(icacheline_ - icachepage_->line);
+            icachepage_->codemask[idx >> 6] |= 1ull << (idx & 0x3F);
         }
     }
     do_not_cache_ = false;
+
+    if (isInstrumented(InstrEvent_Retire)) {
+        InstrumentEventType ev;
+        instrumentInit(&ev);
+        ev.instr = instr_;
+        ev.payload = cacheline_[0].buf32[0];
+        ev.oplen = oplen_;
+        instrumentNotify(InstrEvent_Retire, &ev, ev.pc);
+    }
+}
+
+void CpuGeneric::traceBinaryOutput() {
+    uint32_t instr;
+    memcpy(&instr, trace_data_.instrbuf.data(), sizeof(uint32_t));
+    trace_bin_->instruction(trace_data_.step_cnt, trace_data_.pc, instr,
+                            oplen_, trace_data_.action_cnt);
+    for (int i = 0; i < trace_data_.action_cnt; i++) {
+        trace_action_type *pa = &trace_data_.action[i];
+        if (!pa->memop) {
+            trace_bin_->regWrite(pa->waddr, pa->wdata);
+        } else {
+            trace_bin_->memop(pa->memop_write != 0, pa->memop_addr,
+                              pa->memop_data.val,
+                              static_cast<uint32_t>(pa->memop_size));
+        }
+    }
 }
 
 void CpuGeneric::traceRegister(int idx, uint64_t v) {
@@ -406,26 +1067,140 @@ void CpuGeneric::traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz) {
     p->memop_size = sz;
 }
 
+bool CpuGeneric::subscribeInstrument(IInstrumentListener *l,
+                                     const InstrumentFilterType *filter) {
+    for (int n = 0; n < InstrEvent_Total; n++) {
+        if (((filter->events >> n) & 0x1)
+            && instrSubsTotal_[n] >= INSTR_SUBSCRIBERS_MAX) {
+            return false;
+        }
+    }
+    for (int n = 0; n < InstrEvent_Total; n++) {
+        if ((filter->events >> n) & 0x1) {
+            InstrSubscriberType *p = &instrSubs_[n][instrSubsTotal_[n]++];
+            p->listener = l;
+            p->filter = *filter;
+            instrEvents_ |= 1u << n;
+        }
+    }
+    return true;
+}
+
+void CpuGeneric::unsubscribeInstrument(IInstrumentListener *l) {
+    instrEvents_ = 0;
+    for (int n = 0; n < InstrEvent_Total; n++) {
+        int cnt = 0;
+        for (int i = 0; i < instrSubsTotal_[n]; i++) {
+            if (instrSubs_[n][i].listener != l) {
+                instrSubs_[n][cnt++] = instrSubs_[n][i];
+            }
+        }
+        instrSubsTotal_[n] = cnt;
+        if (cnt) {
+            instrEvents_ |= 1u << n;
+        }
+    }
+}
+
+void CpuGeneric::instrumentInit(InstrumentEventType *ev) {
+    memset(ev, 0, sizeof(InstrumentEventType));
+    ev->hart = smpidx_;
+    ev->prv = getPrvLevel();
+    ev->step = step_cnt_;
+    ev->pc = getPC();
+}
+
+/**
+ * Call listeners of the event which filter accepts the address, privilege
+ * level and hart. Debug program buffer execution isn't instrumented.
+ */
+void CpuGeneric::instrumentNotify(int event, InstrumentEventType *ev,
+                                  uint64_t addr) {
+    if (estate_ != CORE_Normal) {
+        return;
+    }
+    InstrSubscriberType *p = instrSubs_[event];
+    for (int i = 0; i < instrSubsTotal_[event]; i++, p++) {
+        const InstrumentFilterType &f = p->filter;
+        if (addr < f.addrmin || addr > f.addrmax
+            || !((f.prvmask >> ev->prv) & 0x1)
+            || !((f.hartmask >> ev->hart) & 0x1)) {
+            continue;
+        }
+        ev->tag = f.tag;
+        p->listener->instrumentEvent(event, ev);
+    }
+}
+
+void CpuGeneric::instrumentMemop(Axi4TransactionType *tr, bool write) {
+    InstrumentEventType ev;
+    instrumentInit(&ev);
+    ev.addr = tr->addr;
+    ev.size = tr->xsize;
+    ev.write = write;
+    if (write) {
+        memcpy(&ev.value, tr->wpayload.b8, tr->xsize < 8 ? tr->xsize : 8);
+    } else {
+        memcpy(&ev.value, tr->rpayload.b8, tr->xsize < 8 ? tr->xsize : 8);
+    }
+    instrumentNotify(InstrEvent_MemAccess, &ev, ev.addr);
+}
+
+void CpuGeneric::instrumentTrap(uint64_t cause, bool irq) {
+    InstrumentEventType ev;
+    instrumentInit(&ev);
+    if (irq) {
+        ev.pc = getNPC();       // instruction that wasn't executed yet
+    }
+    ev.addr = cause;
+    ev.write = irq;
+    instrumentNotify(InstrEvent_Trap, &ev, ev.pc);
+}
+
+void CpuGeneric::instrumentCsrWrite(uint32_t regno, uint64_t val) {
+    InstrumentEventType ev;
+    instrumentInit(&ev);
+    ev.addr = regno;
+    ev.value = val;
+    instrumentNotify(InstrEvent_CsrWrite, &ev, ev.pc);
+}
+
+void CpuGeneric::instrumentTransfer(int event) {
+    InstrumentEventType ev;
+    instrumentInit(&ev);
+    ev.addr = getNPC();
+    instrumentNotify(event, &ev, ev.pc);
+}
+
 void CpuGeneric::registerStepCallback(IClockListener *cb,
                                                uint64_t t) {
-    if (!isEnabled() && t <= step_cnt_) {
+    if (!isEnabled() && t <= getClockCounter()) {
         cb->stepCallback(t);
         return;
     }
     queue_.put(t, cb);
+    setAttention(ATTN_Queue);
+    if (isHalted()) {
+        wakeup();
+    }
 }
 
 bool CpuGeneric::moveStepCallback(IClockListener *cb, uint64_t t) {
-    if (queue_.move(cb, t)) {
-        return true;
+    if (!isEnabled() && t <= getClockCounter()) {
+        registerStepCallback(cb, t);
+        return false;
     }
-    registerStepCallback(cb, t);
-    return false;
+    queue_.move(cb, t);
+    setAttention(ATTN_Queue);
+    if (isHalted()) {
+        wakeup();
+    }
+    return true;
 }
 
 void CpuGeneric::setReg(int idx, uint64_t val) {
     R[idx] = val;
-    if (trace_file_) {
+    if (isTracing()) {
         traceRegister(idx, val);
     }
 }
@@ -433,10 +1208,43 @@ void CpuGeneric::setReg(int idx, uint64_t val) {
 void CpuGeneric::setBranch(uint64_t npc) {
     branch_ = true;
     setNPC(npc);
+    if (idle_skip_ && npc == getPC()) {
+        skipIdleSteps();
+    }
+}
+
+/**
+ * Instruction jumping to itself (wfi, "j .", branch to itself) can leave
+ * the loop only on an interrupt, so the step counter is moved directly to
+ * the nearest step callback instead of interpreting the idle loop. Timer
+ * and cycle counters are derived from the clock counter and stay in sync.
+ * Skipping is limited by IdleSkipMax when no callback is scheduled and by
+ * the end of the quantum in SMP mode.
+ */
+void CpuGeneric::skipIdleSteps() {
+    uint64_t t = queue_.getNextDeadline();
+    uint64_t clk = getClockCounter();
+    if (attention_ || estate_ != CORE_Normal || t <= clk) {
+        return;
+    }
+    if (t - clk > idle_skip_max_) {
+        t = clk + idle_skip_max_;
+    }
+    if (ismp_ && t > quantum_end_) {
+        t = quantum_end_;
+    }
+    if (t <= clk) {
+        return;
+    }
+    idleSkipped_.make_uint64(idleSkipped_.to_uint64() + (t - clk));
+    step_cnt_ += t - clk;
 }
 
 void CpuGeneric::pushStackTrace() {
     int cnt = static_cast<int>(stackTraceCnt_.getValue().val);
+    if (isInstrumented(InstrEvent_Call)) {
+        instrumentTransfer(InstrEvent_Call);
+    }
     if (cnt >= stackTraceSize_.to_int()) {
         return;
     }
@@ -447,34 +1255,44 @@ void CpuGeneric::pushStackTrace() {
 
 void CpuGeneric::popStackTrace() {
     uint64_t cnt = stackTraceCnt_.getValue().val;
+    if (isInstrumented(InstrEvent_Return)) {
+        instrumentTransfer(InstrEvent_Return);
+    }
     if (cnt) {
         stackTraceCnt_.setValue(cnt - 1);
     }
 }
 
+void CpuGeneric::returnFromTrap() {
+    if (isInstrumented(InstrEvent_TrapReturn)) {
+        instrumentTransfer(InstrEvent_TrapReturn);
+    }
+}
+
 ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr, int flags) {
     ETransStatus ret = TRANS_OK;
+    const char *rwx = "r";
+    if (flags & 0x1) {
+        rwx = "x";
+    } else if (tr->action == MemAction_Write) {
+        rwx = "w";
+    }
     tr->source_idx = sysBusMasterID_.to_int();
-    if (isMmuEnabled()) {
-        tr->addr = translateMmu(tr->addr);
+    // Debug port accesses physical memory
+    if (!(flags & 0x2) && isMmuEnabled()) {
+        if (!translateMmu(tr->addr, rwx, &tr->addr)) {
+            return TRANS_ERROR;
+        }
     }
     if (isMpuEnabled()) {
-        if (flags & 0x1) {
-            if (!checkMpu(tr->addr, tr->xsize, "x")) {
-                return TRANS_ERROR;
-            }
-        } else if (tr->action == MemAction_Write) {
-            if (!checkMpu(tr->addr, tr->xsize, "w")) {
-                return TRANS_ERROR;
-            }
-        } else {
-            if (!checkMpu(tr->addr, tr->xsize, "r")) {
-                return TRANS_ERROR;
-            }
+        if (!checkMpu(tr->addr, tr->xsize, rwx)) {
+            return TRANS_ERROR;
         }
     }
     if (tr->xsize <= sysBusWidthBytes_.to_uint32()) {
-        ret = isysbus_->b_transport(tr);
+        if ((flags & 0x2) || !memoryWindowAccess(tr)) {     // 0x2 = dport
+            ret = isysbus_->b_transport(tr);
+        }
     } else {
         // 1-byte access for HC08
         Axi4TransactionType tr1 = *tr;
@@ -493,7 +1311,7 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr, int flags) {
         }
     }
 
-    if (trace_file_) {
+    if (isTracing()) {
         int we = tr->action == MemAction_Write ? 1 : 0;
         Reg64Type memop_data;
         memop_data.val = 0;
@@ -504,14 +1322,200 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr, int flags) {
         }
         traceMemop(tr->addr, we,  memop_data.val, tr->xsize);
     }
+    // Instruction fetch and debug port accesses aren't instrumented
+    if (isInstrumented(InstrEvent_MemAccess) && !(flags & 0x3)
+        && ret == TRANS_OK) {
+        instrumentMemop(tr, tr->action == MemAction_Write);
+    }
     return ret;
 }
 
+/**
+ * Host window covering [addr, addr + sz) moved to the head of the most
+ * recently used list, or 0 if b_transport() must be used.
+ */
+MemoryWindowType *CpuGeneric::findMemoryWindow(uint64_t addr, uint32_t sz) {
+    uint64_t off;
+    int i;
+    for (i = 0; i < MEMWINDOW_TOTAL; i++) {
+        off = addr - memwin_[i].addr;
+        if (off < memwin_[i].size && (off + sz) <= memwin_[i].size
+            && *memwin_[i].pgeneration == memwin_[i].generation) {
+            break;
+        }
+    }
+
+    if (i == MEMWINDOW_TOTAL) {
+        uint64_t page = addr >> 12;
+        for (i = 0; i < MEMWINDOW_TOTAL; i++) {
+            if (memwin_nopage_[i] == page) {
+                return 0;
+            }
+        }
+        MemoryWindowType tw;
+        if (!isysbus_->getMemoryWindow(addr, &tw)) {
+            memwin_nopage_[memwin_nopage_idx_] = page;
+            memwin_nopage_idx_ = (memwin_nopage_idx_ + 1) % MEMWINDOW_TOTAL;
+            return 0;
+        }
+        off = addr - tw.addr;
+        if (off >= tw.size || (off + sz) > tw.size) {
+            return 0;
+        }
+        i = MEMWINDOW_TOTAL - 1;
+        memwin_[i] = tw;
+    }
+
+    if (i != 0) {
+        MemoryWindowType tw = memwin_[i];
+        memmove(&memwin_[1], &memwin_[0], i * sizeof(MemoryWindowType));
+        memwin_[0] = tw;
+    }
+    return &memwin_[0];
+}
+
+/**
+ * Plain RAM access via host pointer. Return false if address isn't covered
+ * by a window with required rights, so that b_transport() must be used.
+ */
+bool CpuGeneric::memoryWindowAccess(Axi4TransactionType *tr) {
+    MemoryWindowType *w = findMemoryWindow(tr->addr, tr->xsize);
+    if (w == 0) {
+        return false;
+    }
+
+    uint8_t *p = &w->hostptr[tr->addr - w->addr];
+    if (tr->action == MemAction_Write) {
+        if (!(w->access & MemWindow_Write)) {
+            return false;
+        }
+        if (((1ul << tr->xsize) - 1) == tr->wstrb) {
+            memcpy(p, tr->wpayload.b8, tr->xsize);
+        } else {
+            for (uint32_t n = 0; n < tr->xsize; n++) {
+                if ((tr->wstrb >> n) & 0x1) {
+                    p[n] = tr->wpayload.b8[n];
+                }
+            }
+        }
+        if (icachePages_) {
+            // Pages are released only by this thread so no lock is needed
+            invalidateCode(tr->addr, tr->xsize);
+        }
+        // Other harts may hold decoded code of this page
+        isysbus_->windowWritten(tr,
+                                static_cast<IMemoryWriteListener *>(this));
+    } else {
+        if (!(w->access & MemWindow_Read)) {
+            return false;
+        }
+        tr->rpayload.b64[0] = 0;
+        memcpy(tr->rpayload.b8, p, tr->xsize);
+    }
+    tr->response = MemResp_Valid;
+    return true;
+}
+
+/**
+ * Compare-and-swap for atomic instructions: 'tr->wpayload' is written only
+ * if the naturally aligned word holds 'expected', the previous value is
+ * returned in 'tr->rpayload'. Plain memory is swapped by the host atomic
+ * operation so that harts running in other threads see it as a single
+ * access, devices are accessed by read and conditional write.
+ */
+ETransStatus CpuGeneric::dma_memop_cas(Axi4TransactionType *tr,
+                                       uint64_t expected) {
+    MemoryWindowType *w = 0;
+    uint64_t mask = ~0ull;
+    if (tr->xsize < 8) {
+        mask = (1ull << (8 * tr->xsize)) - 1;
+    }
+    tr->source_idx = sysBusMasterID_.to_int();
+    if (isMmuEnabled()) {
+        if (!translateMmu(tr->addr, "w", &tr->addr)) {
+            return TRANS_ERROR;
+        }
+    }
+    if (isMpuEnabled()) {
+        if (!checkMpu(tr->addr, tr->xsize, "r")
+            || !checkMpu(tr->addr, tr->xsize, "w")) {
+            return TRANS_ERROR;
+        }
+    }
+    tr->action = MemAction_Write;
+    tr->wstrb = (1 << tr->xsize) - 1;
+    tr->rpayload.b64[0] = 0;
+    if (tr->xsize == 4 || tr->xsize == 8) {
+        w = findMemoryWindow(tr->addr, tr->xsize);
+        if (w && (w->access & (MemWindow_Read | MemWindow_Write))
+                  != (MemWindow_Read | MemWindow_Write)) {
+            w = 0;
+        }
+    }
+
+    if (w) {
+        uint8_t *p = &w->hostptr[tr->addr - w->addr];
+        if (tr->xsize == 4) {
+            tr->rpayload.b32[0] = RISCV_atomic_cas32(
+                reinterpret_cast<volatile uint32_t *>(p),
+                static_cast<uint32_t>(expected), tr->wpayload.b32[0]);
+        } else {
+            tr->rpayload.b64[0] = RISCV_atomic_cas64(
+                reinterpret_cast<volatile uint64_t *>(p),
+                expected, tr->wpayload.b64[0]);
+        }
+        tr->response = MemResp_Valid;
+    } else {
+        Axi4TransactionType tr1 = *tr;
+        tr1.action = MemAction_Read;
+        if (isysbus_->b_transport(&tr1) == TRANS_ERROR) {
+            return TRANS_ERROR;
+        }
+        tr->rpayload.b64[0] = tr1.rpayload.b64[0] & mask;
+        if (tr->rpayload.b64[0] == (expected & mask)
+            && isysbus_->b_transport(tr) == TRANS_ERROR) {
+            return TRANS_ERROR;
+        }
+    }
+
+    if (isInstrumented(InstrEvent_MemAccess)) {
+        instrumentMemop(tr, false);
+    }
+    if (tr->rpayload.b64[0] != (expected & mask)) {
+        return TRANS_OK;
+    }
+    if (isInstrumented(InstrEvent_MemAccess)) {
+        instrumentMemop(tr, true);
+    }
+    if (w) {
+        if (icachePages_) {
+            invalidateCode(tr->addr, tr->xsize);
+        }
+        isysbus_->windowWritten(tr,
+                                static_cast<IMemoryWriteListener *>(this));
+    }
+    if (isTracing()) {
+        traceMemop(tr->addr, 1, tr->wpayload.b64[0] & mask, tr->xsize);
+    }
+    return TRANS_OK;
+}
+
+void CpuGeneric::flushMemoryWindows() {
+    static const uint32_t zero_generation = 0;
+    memset(memwin_, 0, sizeof(memwin_));
+    for (int i = 0; i < MEMWINDOW_TOTAL; i++) {
+        memwin_[i].pgeneration = &zero_generation;
+        memwin_nopage_[i] = ~0ull;
+    }
+    memwin_nopage_idx_ = 0;
+}
+
 void CpuGeneric::resume() {
     if (estate_ == CORE_OFF) {
         RISCV_error("CPU is turned-off", 0);
     }
     estate_ = CORE_Normal;
+    setAttention(ATTN_State);
 }
 
 void CpuGeneric::halt(uint32_t cause, const char *descr) {
@@ -548,26 +1552,100 @@ void CpuGeneric::halt(uint32_t cause, const char *descr) {
                        getPC(), strop, descr);
     }
     estate_ = CORE_Halted;
+    setAttention(ATTN_State);
 }
 
 bool CpuGeneric::isTriggerICount() {
     bool ret = false;
     TriggerStorageType *pt;
-    for (unsigned i = 0; i < triggersTotal_.to_uint32(); i++) {
-        pt = &ptriggers_[i];
-        if (pt->data1.bitsdef.type == TriggerType_InstrCountMatch) {
-            if (pt->data1.icount_bits.count - 1 == 0) {
-                ret = true;
+    for (int i = 0; i < trigICountTotal_; i++) {
+        pt = &ptriggers_[trigicount_[i]];
+        if (pt->data1.icount_bits.count - 1 == 0) {
+            ret = true;
+        }
+        if ((pt->data1.icount_bits.count > 1) &&
+            (pt->data1.icount_bits.m || pt->data1.icount_bits.s
+            || pt->data1.icount_bits.u)) {
+            pt->data1.icount_bits.count--;
+        }
+        pt->data1.icount_bits.hit = 1;
+    }
+    return ret;
+}
+
+/**
+ * Compile trigger registers into the lists of armed triggers. Address
+ * matches are converted into [lo, hi] intervals with the NAPOT mask
+ * computed once. Must be called on each tdata1/tdata2 write.
+ */
+void CpuGeneric::updateTriggers() {
+    TriggerData1Type::bits_type2 *pt;
+    TriggerExecType *p;
+    uint64_t data2, mask;
+    int tcnt;
+    trigExecTotal_ = 0;
+    trigICountTotal_ = 0;
+    if (ptriggers_ == 0) {
+        return;
+    }
+    for (int i = 0; i < triggersTotal_.to_int(); i++) {
+        pt = &ptriggers_[i].data1.mcontrol_bits;
+        if (pt->type == TriggerType_InstrCountMatch) {
+            trigicount_[trigICountTotal_++] = i;
+            continue;
+        }
+        if (pt->type != TriggerType_AddrDataMatch
+            || !(pt->m | pt->s | pt->u) || !pt->execute) {
+            continue;
+        }
+
+        data2 = ptriggers_[i].data2;
+        p = &trigexec_[trigExecTotal_++];
+        p->idx = i;
+        p->masked = false;
+        p->lo = 1;          // empty interval for unsupported match
+        p->hi = 0;
+        switch (pt->match) {
+        case 0:
+            p->lo = data2;
+            p->hi = data2;
+            break;
+        case 1:
+            mask = 1;
+            tcnt = 0;
+            while ((tcnt < mcontrolMaskmax_.to_int()) && !(data2 & mask)) {
+                mask <<= 1;
+                tcnt++;
             }
-            if ((pt->data1.icount_bits.count > 1) &&
-                (pt->data1.icount_bits.m || pt->data1.icount_bits.s
-                || pt->data1.icount_bits.u)) {
-                pt->data1.icount_bits.count--;
+            mask = ~(mask - 1);
+            p->lo = data2 & mask;
+            p->hi = p->lo | ~mask;
+            break;
+        case 2:
+            p->lo = data2;
+            p->hi = ~0ull;
+            break;
+        case 3:
+            if (data2) {
+                p->lo = 0;
+                p->hi = data2 - 1;
             }
-            pt->data1.icount_bits.hit = 1;
+            break;
+        case 4:
+        case 5:
+            p->masked = true;
+            p->shift = pt->match == 4 ? 0 : 32;
+            p->mask = data2 >> 32;
+            p->value = data2 & 0xFFFFFFFFull;
+            break;
+        default:;
         }
     }
-    return ret;
+    if (trigICountTotal_) {
+        setAttention(ATTN_ICount);
+    } else {
+        clearAttention(ATTN_ICount);
+    }
 }
 
 void CpuGeneric::power(EPowerAction onoff) {
@@ -584,10 +1662,13 @@ void CpuGeneric::power(EPowerAction onoff) {
         estate_ = CORE_Normal;
         RISCV_trigger_hap(HAP_CpuTurnON, 0, "CPU Turned ON");
     }
+    setAttention(ATTN_State);
+    wakeup();
 }
 
 void CpuGeneric::reset(IFace *isource) {
     flush(~0ull);
+    flushMemoryWindows();
     /** Reset address can be changed in runtime */
     portRegs_.reset();
     setPC(getResetAddress());
@@ -597,6 +1678,7 @@ void CpuGeneric::reset(IFace *isource) {
         memset(ptriggers_,
                0,
                triggersTotal_.to_int()*sizeof(TriggerStorageType));
+        updateTriggers();
     }
     stackTraceCnt_.reset(isource);
     interrupt_pending_[0] = 0;
@@ -608,71 +1690,26 @@ void CpuGeneric::reset(IFace *isource) {
     } else {
         estate_ = CORE_Normal;
     }
+    setAttention(ATTN_State);
+    wakeup();
 }
 
 bool CpuGeneric::isTriggerInstruction() {
     uint64_t pc = getPC();
 
     TriggerData1Type::bits_type2 *pt;
+    TriggerExecType *p;
     bool fire = false;
     uint64_t action = 0;
-    uint64_t mask;
-    int tcnt;
-    for (int i = 0; i < triggersTotal_.to_int(); i++) {
-        pt = &ptriggers_[i].data1.mcontrol_bits;
-        if (pt->type != TriggerType_AddrDataMatch) {
-            continue;
-        }
-        if (!(pt->m | pt->s | pt->u)) {
-            // Trigger is disabled
-            continue;
-        }
-        if (!pt->execute) {
-            continue;
-        }
-
-        switch (pt->match) {
-        case 0:
-            if (pc == ptriggers_[i].data2) {
-                pt->hit = 1;
-            }
-            break;
-        case 1:
-            mask = 1;
-            tcnt = 0;
-            while ((tcnt < mcontrolMaskmax_.to_int())
-                && !(ptriggers_[i].data2 & mask)) {
-                mask <<= 1;
-                tcnt++;
-            }
-            mask = ~(mask - 1);
-            if ((pc & mask) == (ptriggers_[i].data2 & mask)) {
+    for (int i = 0; i < trigExecTotal_; i++) {
+        p = &trigexec_[i];
+        pt = &ptriggers_[p->idx].data1.mcontrol_bits;
+        if (p->masked) {
+            if (((pc >> p->shift) & p->mask) == p->value) {
                 pt->hit = 1;
             }
-            break;
-        case 2:
-            if (pc >= ptriggers_[i].data2) {
-                pt->hit = 1;
-            }
-            break;
-        case 3:
-            if (pc < ptriggers_[i].data2) {
-                pt->hit = 1;
-            }
-            break;
-        case 4:
-            mask = (pc & 0xFFFFFFFFull) & (ptriggers_[i].data2 >> 32);
-            if (mask == (ptriggers_[i].data2 & 0xFFFFFFFFull)) {
-                pt->hit = 1;
-            }
-            break;
-        case 5:
-            mask = (pc >> 32) & (ptriggers_[i].data2 >> 32);
-            if (mask == (ptriggers_[i].data2 & 0xFFFFFFFFull)) {
-                pt->hit = 1;
-            }
-            break;
-        default:;
+        } else if (pc >= p->lo && pc <= p->hi) {
+            pt->hit = 1;
         }
 
         // TODO bit 'chain'
@@ -701,6 +1738,7 @@ int CpuGeneric::resumereq() {
     }
     resumereq_ = true;
     resumeack_ = false;
+    wakeup();
     return 0;
 }
 
@@ -708,7 +1746,7 @@ int CpuGeneric::haltreq() {
     if (isHalted()) {
         return 1;
     }
-    haltreq_ = true;
+    setAttention(ATTN_HaltReq);
     return 0;
 }
 
@@ -720,12 +1758,14 @@ bool CpuGeneric::executeProgbuf(uint32_t *progbuf) {
     progbuf_ = progbuf;
     procbufexecreq_ = true;
     RISCV_event_clear(&eventDbgRequest_);
+    wakeup();
     RISCV_event_wait(&eventDbgRequest_);
     return false;
 }
 
 void CpuGeneric::enterProgbufExec() {
     estate_ = CORE_ProgbufExec;
+    setAttention(ATTN_State);
     PC_ = &ctxregs_[Ctx_ProgbufExec].pc.val;
     NPC_ = &ctxregs_[Ctx_ProgbufExec].npc.val;
     *NPC_ = 0;
@@ -734,6 +1774,7 @@ void CpuGeneric::enterProgbufExec() {
 
 void CpuGeneric::exitProgbufExec() {
     estate_ = CORE_Halted;
+    setAttention(ATTN_State);
     PC_ = &ctxregs_[Ctx_Normal].pc.val;
     NPC_ = &ctxregs_[Ctx_Normal].npc.val;
     RISCV_debug("%s", "Ending executing progbuf");
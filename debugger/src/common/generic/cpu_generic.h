@@ -30,12 +30,25 @@
 #include "coreservices/isrccode.h"
 #include "coreservices/icmdexec.h"
 #include "coreservices/icoveragetracker.h"
+#include "coreservices/iinstrument.h"
+#include "coreservices/ismp.h"
 #include "generic/mapreg.h"
+#include "generic/bintrace.h"
 #include <riscv-isa.h>
 #include <fstream>
 
 namespace debugger {
 
+/**
+ * Host code translated from the instructions of a block. Returns number of
+ * executed instructions, writes pc of the last one into pc[0] and the next
+ * pc into pc[1].
+ */
+typedef int (*JitBlockFunc)(uint64_t *regs, uint64_t *pc);
+
+/** Integer registers which could be modified by the host code */
+static const int JIT_REGS_TOTAL = 32;
+
 class CpuGeneric : public IService,
                    public IThread,
                    public ICpuFunctional,
@@ -43,6 +56,9 @@ class CpuGeneric : public IService,
                    public IClock,
                    public IPower,
                    public IResetListener,
+                   public IMemoryWriteListener,
+                   public ISmpHart,
+                   public IInstrumentation,
                    public IHap {
  public:
     explicit CpuGeneric(const char *name);
@@ -60,8 +76,10 @@ class CpuGeneric : public IService,
     virtual void setReg(int idx, uint64_t val);
     virtual void enterDebugMode(uint64_t v, uint32_t cause) {}
     virtual void setBranch(uint64_t npc);
+    virtual void skipIdleSteps();
     virtual void pushStackTrace();
     virtual void popStackTrace();
+    virtual void returnFromTrap();
     virtual uint64_t getPrvLevel() { return cur_prv_level; }
     virtual void setPrvLevel(uint64_t lvl) { cur_prv_level = lvl; }
     virtual ETransStatus dma_memop(Axi4TransactionType *tr, int flags=0);
@@ -75,7 +93,10 @@ class CpuGeneric : public IService,
     virtual bool isMpuEnabled() { return false; }
     virtual bool checkMpu(uint64_t addr, uint32_t sz, const char *rwx) { return true; }
     virtual bool isMmuEnabled() { return false; }
-    virtual uint64_t translateMmu(uint64_t addr) { return addr; }
+    virtual bool translateMmu(uint64_t va, const char *rwx, uint64_t *pa) {
+        *pa = va;
+        return true;
+    }
     virtual void flushMmu() {}
 
     /** IDPort interface */
@@ -97,6 +118,9 @@ class CpuGeneric : public IService,
     virtual bool isExecutingProgbuf() { return estate_ == CORE_ProgbufExec; }
     virtual void setResetPin(bool val) {}
 
+    /** Compare-and-swap of the aligned word atomic to other harts */
+    virtual ETransStatus dma_memop_cas(Axi4TransactionType *tr,
+                                       uint64_t expected);
 
  protected:
     virtual uint64_t getResetAddress() { return resetVector_.to_uint64(); }
@@ -112,13 +136,16 @@ class CpuGeneric : public IService,
     virtual void traceRegister(int idx, uint64_t v);
     virtual void traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz);
     virtual void traceOutput() {}
+    void traceBinaryOutput();
+    bool isTracing() { return trace_file_ || trace_bin_; }
     virtual bool isStepEnabled() { return false; }
     virtual bool isTriggerICount();
     virtual bool isTriggerInstruction();
+    void updateTriggers();
 
  public:
-    /** IClock */
-    virtual uint64_t getStepCounter() { return step_cnt_; }
+    /** IClock: time of the hart in clock cycles */
+    virtual uint64_t getStepCounter() { return getClockCounter(); }
     virtual void registerStepCallback(IClockListener *cb, uint64_t t);
     virtual bool moveStepCallback(IClockListener *cb, uint64_t t);
     virtual double getFreqHz() {
@@ -139,17 +166,79 @@ class CpuGeneric : public IService,
     virtual void hapTriggered(EHapType type, uint64_t param,
                               const char *descr);
 
+    /** IMemoryWriteListener */
+    virtual void memoryWritten(uint64_t addr, uint32_t sz);
+
+    /** IThread */
+    virtual void stop();
+
+    /** ISmpHart */
+    virtual bool attachSmp(ISmpScheduler *isched, int hartidx,
+                           bool ownthread);
+    virtual uint64_t runQuantum(uint64_t steps);
+
+    /** IInstrumentation */
+    virtual bool subscribeInstrument(IInstrumentListener *l,
+                                     const InstrumentFilterType *filter);
+    virtual void unsubscribeInstrument(IInstrumentListener *l);
+
  protected:
     /** IThread interface */
     virtual void busyLoop();
 
+    virtual void waitWakeup();
+    virtual void wakeup();
+
     virtual void updatePipeline();
+    virtual void executeInstruction();
+    virtual void finishInstruction();
+    struct BlockType;
+    virtual void executeBlock(BlockType *blk);
+    bool continueBlock(BlockType *blk, int idx);
+    virtual bool translateBlock(BlockType *blk) { return false; }
+    virtual int executeJit(BlockType *blk);
+    void verifyJit(BlockType *blk, int cnt, const uint64_t *regs,
+                   uint64_t *pc);
+    void dropJitCode();
+    virtual void recordBlockInstruction();
+    virtual bool isBlockCacheAllowed();
+    virtual void flushBlocks(uint64_t addr);
+    MemoryWindowType *findMemoryWindow(uint64_t addr, uint32_t sz);
+    virtual bool memoryWindowAccess(Axi4TransactionType *tr);
+    virtual void flushMemoryWindows();
     virtual bool updateState();
     virtual uint64_t fetchingAddress() { return getPC(); }
     virtual void fetchILine();
+    virtual bool isCacheableAddress(uint64_t addr);
+    struct ICacheType;
+    ICacheType *getICacheLine(uint64_t addr, bool alloc);
+    struct ICachePageType;
+    ICachePageType *findICachePage(uint64_t pageaddr);
+    void flushICache(uint64_t addr);
+    void invalidateCode(uint64_t addr, uint32_t sz);
     virtual void updateQueue();
+    /** Clock cycles: executed instructions plus stalls */
+    uint64_t getClockCounter() { return step_cnt_ + stall_cnt_; }
+    /** Stalls of the timing model, step callbacks are due earlier */
+    void addStallCycles(uint64_t t);
     virtual void enterProgbufExec();
     virtual void exitProgbufExec();
+    void setAttention(uint32_t bits) {
+        RISCV_atomic_or32(&attention_, bits);
+    }
+    void clearAttention(uint32_t bits) {
+        RISCV_atomic_and32(&attention_, ~bits);
+    }
+    void countBurstExit();
+    bool isInstrumented(int event) {
+        return (instrEvents_ >> event) & 0x1;
+    }
+    void instrumentInit(InstrumentEventType *ev);
+    void instrumentNotify(int event, InstrumentEventType *ev, uint64_t addr);
+    void instrumentMemop(Axi4TransactionType *tr, bool write);
+    void instrumentTrap(uint64_t cause, bool irq);
+    void instrumentCsrWrite(uint32_t regno, uint64_t val);
+    void instrumentTransfer(int event);
 
  protected:
     AttributeType isEnable_;
@@ -161,19 +250,31 @@ class CpuGeneric : public IService,
     AttributeType sourceCode_;
     AttributeType stackTraceSize_;
     AttributeType generateTraceFile_;
+    AttributeType traceFormat_;
     AttributeType resetVector_;
     AttributeType sysBusMasterID_;
-    AttributeType cacheBaseAddr_;
-    AttributeType cacheAddrMask_;
+    AttributeType cacheBaseAddr_;       // deprecated: use CacheRegions
+    AttributeType cacheAddrMask_;       // deprecated: use CacheRegions
+    AttributeType cacheRegions_;
+    AttributeType cacheAutoRegions_;
     AttributeType coverageTracker_;
     AttributeType resetState_;
     AttributeType triggersTotal_;
     AttributeType mcontrolMaskmax_;
+    AttributeType blockCacheSize_;
+    AttributeType burstSize_;
+    AttributeType burstExits_;
+    AttributeType idleSkip_;            // jump to itself skips to next event
+    AttributeType idleSkipMax_;
+    AttributeType idleSkipped_;
 
     ISourceCode *isrc_;
     ICoverageTracker *icovtracker_;
     ICmdExecutor *icmdexec_;
     IMemoryOperation *isysbus_;
+    ISmpScheduler *ismp_;           // not 0 in SMP mode
+    int smpidx_;
+    bool smpthread_;                // quanta are executed in own thread
     GenericInstruction *instr_;
 
     // DCSR register halt causes:
@@ -183,6 +284,32 @@ class CpuGeneric : public IService,
     static const uint64_t HALT_CAUSE_STEP         = 4;  // step done
     static const uint64_t HALT_CAUSE_RESETHALTREQ = 5;  // not implemented
 
+    // Attention bits end the current burst and enable per instruction
+    // control checks in updateState() and handleTrap() while set.
+    enum EAttentionBits {
+        ATTN_HaltReq = 0x01,    // halt request via debug interface
+        ATTN_Step = 0x02,       // stepping enabled
+        ATTN_ICount = 0x04,     // instruction count trigger armed
+        ATTN_Irq = 0x08,        // enabled interrupt is pending
+        ATTN_StackCheck = 0x10, // stack protection enabled
+        ATTN_Queue = 0x20,      // step callback registered
+        ATTN_State = 0x40,      // core state changed
+    };
+
+    // Reasons of the burst exit, counters in BurstExits attribute:
+    enum EBurstExitReason {
+        BurstExit_HaltReq,
+        BurstExit_Step,
+        BurstExit_ICount,
+        BurstExit_Irq,
+        BurstExit_StackCheck,
+        BurstExit_Queue,
+        BurstExit_State,
+        BurstExit_Deadline,     // step callback is due
+        BurstExit_Limit,        // BurstSize instructions executed
+        BurstExit_Total
+    };
+
     enum EContextTypes {
         Ctx_Normal,
         Ctx_ProgbufExec,
@@ -210,10 +337,31 @@ class CpuGeneric : public IService,
         uint64_t extra;
     } *ptriggers_;
 
-    uint64_t step_cnt_;
+    // Compiled trigger set rebuilt by updateTriggers() on tdata writes so
+    // that nothing is checked per instruction while no trigger is armed.
+    struct TriggerExecType {
+        int idx;            // index in ptriggers_
+        bool masked;        // match 4,5: ((pc >> shift) & mask) == value
+        int shift;
+        uint64_t mask;
+        uint64_t value;
+        uint64_t lo;        // match 0..3: lo <= pc <= hi
+        uint64_t hi;
+    } *trigexec_;
+    int trigExecTotal_;     // armed execute address match triggers
+    int *trigicount_;
+    int trigICountTotal_;   // instruction count triggers
+
+    uint64_t step_cnt_;             // executed instructions
+    uint64_t stall_cnt_;            // cycles above one per instruction
     volatile bool resumereq_;
     volatile bool resumeack_;
-    volatile bool haltreq_;
+    volatile uint32_t attention_;   // EAttentionBits
+    uint64_t burst_end_;            // control checks skipped till this step
+    uint64_t burst_size_;
+    bool idle_skip_;
+    uint64_t idle_skip_max_;
+    uint64_t quantum_end_;          // SMP: current quantum ends on this step
     volatile bool procbufexecreq_;
     bool branch_;
     unsigned oplen_;
@@ -232,9 +380,9 @@ class CpuGeneric : public IService,
     uint64_t interrupt_pending_[2];
     bool do_not_cache_;         // Do not put instruction into ICache
 
-    mutex_def mutex_csr_;
     event_def eventConfigDone_;
     event_def eventDbgRequest_;
+    event_def eventWakeup_;     // halted core sleeps on it
     ClockAsyncTQueueType queue_;
 
     enum ECoreState {
@@ -247,17 +395,65 @@ class CpuGeneric : public IService,
     Axi4TransactionType trans_;
     Reg64Type cacheline_[512/4];
     
-    // Simple memory cache to avoid access to sysbus and speed-up simulation
+    // Decoded instructions storage to avoid access to sysbus and decoding.
+    // Allocated on demand by 4 KB pages with one entry per halfword,
+    // pages are hashed by physical address.
+    static const int ICACHE_PAGE_BITS = 12;
+    static const int ICACHE_HASH_SIZE = 1 << 10;
     struct ICacheType {
         GenericInstruction *instr;
         uint32_t buf;
-    } *icache_;            // parsed instructions storage
-    int memcache_sz_;               // allocated size
-    uint64_t CACHE_BASE_ADDR_;
-    uint64_t CACHE_MASK_;
+    };
+    static const int ICACHE_PAGE_LINES = (1 << ICACHE_PAGE_BITS) / 2;
+    struct ICachePageType {
+        uint64_t pageaddr;
+        ICachePageType *next;
+        // Modified code tracking: bit per halfword with decoded instruction
+        // and counter incremented when any of them is invalidated by write
+        uint64_t codemask[ICACHE_PAGE_LINES / 64];
+        volatile uint32_t generation;
+        ICacheType line[ICACHE_PAGE_LINES];
+    };
+    ICachePageType *icachehash_[ICACHE_HASH_SIZE];
+    ICachePageType *icachelast_;    // the last accessed page
+    ICachePageType *icachepage_;    // page of the fetched instruction
+    ICacheType *icacheline_;        // entry of the fetched instruction or 0
+    int icachePages_;               // allocated pages
+    mutex_def mutex_icache_;        // writes from other masters vs flush
     uint64_t fetch_addr_;
-    uint64_t cache_offset_;         // instruction pointer - CACHE_BASE_ADDR
-    bool cachable_pc_;              // fetched_pc hit into cachable region
+
+    // Predecoded straight-line blocks of instructions. Each block is a
+    // sequence of already decoded instructions without control transfer
+    // inside, so that fetch and decode stages are skipped on replay.
+    static const int BLOCK_INSTR_MAX = 32;
+    struct BlockInstrType {
+        GenericInstruction *instr;
+        Reg64Type payload;
+        int oplen;
+    };
+    struct BlockType {
+        uint64_t addr;          // address of the first instruction
+        uint64_t endaddr;       // address of the next instruction after block
+        int total;              // 0 = empty entry
+        ICachePageType *page;   // block never crosses page boundary
+        uint32_t generation;    // page generation when block was recorded
+        uint32_t hits;          // replays before translation
+        JitBlockFunc jitcode;   // translated prefix of the block or 0
+        int jittotal;           // instructions in the translated prefix
+        BlockInstrType op[BLOCK_INSTR_MAX];
+    } *blockcache_;
+    uint64_t blockcache_mask_;
+    uint32_t jit_threshold_;        // 0 = no translation
+    bool jit_verify_;               // replay translated code by interpreter
+    BlockType *blkrec_;             // block which is being recorded
+    uint64_t blkrec_next_;          // expected address of the next instruction
+
+    // Per-hart cache of host memory windows, most recently used first.
+    // Used only by the CPU thread so that no locking is needed.
+    static const int MEMWINDOW_TOTAL = 4;
+    MemoryWindowType memwin_[MEMWINDOW_TOTAL];
+    uint64_t memwin_nopage_[MEMWINDOW_TOTAL];   // 4 KB pages without window
+    int memwin_nopage_idx_;
 
     uint64_t cur_prv_level;
 
@@ -281,6 +477,18 @@ class CpuGeneric : public IService,
         int action_cnt;
     } trace_data_;
     std::ofstream *trace_file_;
+    BinaryTraceWriter *trace_bin_;
+
+    // Instrumentation subscribers per event. Hooks test the event bit in
+    // instrEvents_ so that events without subscribers cost nothing else.
+    static const int INSTR_SUBSCRIBERS_MAX = 8;
+    struct InstrSubscriberType {
+        IInstrumentListener *listener;
+        InstrumentFilterType filter;
+    };
+    InstrSubscriberType instrSubs_[InstrEvent_Total][INSTR_SUBSCRIBERS_MAX];
+    int instrSubsTotal_[InstrEvent_Total];
+    uint32_t instrEvents_;          // bit per event with subscribers
 };
 
 }  // namespace debugger
@@ -99,4 +99,19 @@ ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+bool MemoryGeneric::getMemoryWindow(uint64_t addr, MemoryWindowType *w) {
+    uint64_t off = addr - getBaseAddress();
+    if (idpi_ || off >= getLength()) {
+        // SystemVerilog co-simulation must see each transaction;
+        // mirrored addresses go via modulo in b_transport.
+        return false;
+    }
+    uint32_t access = MemWindow_Read;
+    if (!readOnly_.to_bool()) {
+        access |= MemWindow_Write;
+    }
+    makeMemoryWindow(w, getBaseAddress(), getLength(), mem_, access);
+    return true;
+}
+
 }  // namespace debugger
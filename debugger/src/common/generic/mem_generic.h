@@ -35,6 +35,7 @@ class MemoryGeneric : public IService,
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
+    virtual bool getMemoryWindow(uint64_t addr, MemoryWindowType *w);
 
  protected:
     AttributeType readOnly_;
@@ -0,0 +1,260 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <api_core.h>
+#include "smp_generic.h"
+
+namespace debugger {
+
+SmpGeneric::SmpGeneric(const char *name) : IService(name),
+    IHap(HAP_ConfigDone) {
+    registerInterface(static_cast<IThread *>(this));
+    registerInterface(static_cast<IClock *>(this));
+    registerInterface(static_cast<ISmpScheduler *>(this));
+    registerInterface(static_cast<IHap *>(this));
+    registerAttribute("HartList", &hartList_);
+    registerAttribute("Mode", &mode_);
+    registerAttribute("Quantum", &quantum_);
+    registerAttribute("FreqHz", &freqHz_);
+
+    char tstr[256];
+    RISCV_sprintf(tstr, sizeof(tstr), "eventConfigDone_%s", name);
+    RISCV_event_create(&eventConfigDone_, tstr);
+    RISCV_sprintf(tstr, sizeof(tstr), "eventWakeup_%s", name);
+    RISCV_event_create(&eventWakeup_, tstr);
+    RISCV_mutex_init(&mutexBarrier_);
+    RISCV_register_hap(static_cast<IHap *>(this));
+
+    hartList_.make_list(0);
+    mode_.make_string("Parallel");
+    quantum_.make_int64(10000);
+    freqHz_.make_int64(12000000);
+
+    iharts_ = 0;
+    eventHart_ = 0;
+    hartTotal_ = 0;
+    arrived_ = 0;
+    busy_ = false;
+    executed_ = ~0ull;
+    time_ = 0;
+    quantum_steps_ = 1;
+}
+
+SmpGeneric::~SmpGeneric() {
+    if (hartTotal_) {
+        RISCV_set_default_clock(0);
+    }
+    for (int i = 0; i < hartTotal_; i++) {
+        RISCV_event_close(&eventHart_[i]);
+    }
+    if (iharts_) {
+        delete [] iharts_;
+        delete [] eventHart_;
+    }
+    RISCV_event_close(&eventConfigDone_);
+    RISCV_event_close(&eventWakeup_);
+    RISCV_mutex_destroy(&mutexBarrier_);
+}
+
+void SmpGeneric::postinitService() {
+    ISmpHart *ihart;
+    bool ownthread = true;
+    char tstr[256];
+
+    if (mode_.is_equal("RoundRobin")) {
+        ownthread = false;
+    } else if (!mode_.is_equal("Parallel")) {
+        RISCV_error("Unsupported mode '%s'", mode_.to_string());
+        return;
+    }
+
+    const AttributeType *glb = RISCV_get_global_settings();
+    if (!(*glb)["SimEnable"].to_bool()) {
+        return;
+    }
+
+    iharts_ = new ISmpHart *[hartList_.size()];
+    eventHart_ = new event_def[hartList_.size()];
+    for (unsigned i = 0; i < hartList_.size(); i++) {
+        ihart = static_cast<ISmpHart *>(RISCV_get_service_iface(
+                hartList_[i].to_string(), IFACE_SMP_HART));
+        if (!ihart) {
+            RISCV_error("ISmpHart interface '%s' not found",
+                        hartList_[i].to_string());
+            continue;
+        }
+        if (!ihart->attachSmp(static_cast<ISmpScheduler *>(this),
+                              hartTotal_, ownthread)) {
+            continue;
+        }
+        RISCV_sprintf(tstr, sizeof(tstr), "eventHart_%s_%d",
+                      getObjName(), hartTotal_);
+        RISCV_event_create(&eventHart_[hartTotal_], tstr);
+        iharts_[hartTotal_++] = ihart;
+    }
+    if (hartTotal_ == 0) {
+        return;
+    }
+
+    quantum_steps_ = quantum_.to_uint64();
+    if (quantum_steps_ == 0) {
+        quantum_steps_ = 1;
+    }
+    RISCV_set_default_clock(static_cast<IClock *>(this));
+
+    if (ownthread) {
+        // Barrier is driven by the harts threads, the flag only tells
+        // them that the scheduler wasn't stopped.
+        RISCV_event_set(&loopEnable_);
+    } else if (!run()) {
+        RISCV_error("Can't create thread.", NULL);
+    }
+}
+
+void SmpGeneric::hapTriggered(EHapType type,
+                              uint64_t param,
+                              const char *descr) {
+    RISCV_unregister_hap(static_cast<IHap *>(this));
+    RISCV_event_set(&eventConfigDone_);
+}
+
+void SmpGeneric::busyLoop() {
+    RISCV_event_wait(&eventConfigDone_);
+
+    while (isEnabled()) {
+        for (int i = 0; i < hartTotal_; i++) {
+            countExecuted(iharts_[i]->runQuantum(quantum_steps_));
+        }
+        if (!busy_) {
+            RISCV_event_wait(&eventWakeup_);
+        }
+        finishQuantum();
+    }
+}
+
+void SmpGeneric::stop() {
+    IThread::stop();
+    RISCV_event_set(&eventWakeup_);
+    RISCV_mutex_lock(&mutexBarrier_);
+    for (int i = 0; i < hartTotal_; i++) {
+        RISCV_event_set(&eventHart_[i]);
+    }
+    RISCV_mutex_unlock(&mutexBarrier_);
+}
+
+void SmpGeneric::quantumDone(int hartidx, uint64_t executed) {
+    RISCV_mutex_lock(&mutexBarrier_);
+    if (!isEnabled()) {
+        RISCV_mutex_unlock(&mutexBarrier_);
+        return;
+    }
+    countExecuted(executed);
+    if (++arrived_ < hartTotal_) {
+        RISCV_event_clear(&eventHart_[hartidx]);
+        RISCV_mutex_unlock(&mutexBarrier_);
+        RISCV_event_wait(&eventHart_[hartidx]);
+        return;
+    }
+    arrived_ = 0;
+    if (!busy_) {
+        // All harts are halted. Sleep without the lock, stop() takes it
+        // to release the barrier. Others can't arrive till released.
+        RISCV_mutex_unlock(&mutexBarrier_);
+        RISCV_event_wait(&eventWakeup_);
+        RISCV_mutex_lock(&mutexBarrier_);
+        if (!isEnabled()) {
+            RISCV_mutex_unlock(&mutexBarrier_);
+            return;
+        }
+    }
+    finishQuantum();
+    // Released under the lock so that no hart can reach the next barrier
+    // and clear its event before it is set here.
+    for (int i = 0; i < hartTotal_; i++) {
+        if (i != hartidx) {
+            RISCV_event_set(&eventHart_[i]);
+        }
+    }
+    RISCV_mutex_unlock(&mutexBarrier_);
+}
+
+void SmpGeneric::wakeupSmp() {
+    RISCV_event_set(&eventWakeup_);
+}
+
+/**
+ * Halted hart executes nothing and doesn't limit the time advance, hart
+ * that stopped inside of the quantum (breakpoint) does.
+ */
+void SmpGeneric::countExecuted(uint64_t executed) {
+    if (executed) {
+        busy_ = true;
+        if (executed < executed_) {
+            executed_ = executed;
+        }
+    }
+}
+
+/**
+ * Called while all harts are at the barrier. Advance global time by the
+ * steps executed by every running hart, call due callbacks and shorten
+ * the next quantum to end at the nearest deadline. Time is stopped while
+ * all harts are halted, the caller sleeps till any hart request.
+ */
+void SmpGeneric::finishQuantum() {
+    IFace *cb;
+    uint64_t deadline;
+    if (busy_) {
+        time_ += executed_;
+    }
+    RISCV_event_clear(&eventWakeup_);
+    busy_ = false;
+    executed_ = ~0ull;
+
+    queue_.pushPreQueued();
+    while ((cb = queue_.getNext(time_)) != 0) {
+        static_cast<IClockListener *>(cb)->stepCallback(time_);
+    }
+
+    quantum_steps_ = quantum_.to_uint64();
+    if (quantum_steps_ == 0) {
+        quantum_steps_ = 1;
+    }
+    deadline = queue_.getNextDeadline();
+    if (deadline > time_ && deadline - time_ < quantum_steps_) {
+        quantum_steps_ = deadline - time_;
+    }
+}
+
+void SmpGeneric::registerStepCallback(IClockListener *cb, uint64_t t) {
+    if (!isEnabled() && t <= time_) {
+        cb->stepCallback(t);
+        return;
+    }
+    queue_.put(t, cb);
+}
+
+bool SmpGeneric::moveStepCallback(IClockListener *cb, uint64_t t) {
+    if (!isEnabled() && t <= time_) {
+        registerStepCallback(cb, t);
+        return false;
+    }
+    queue_.move(cb, t);
+    return true;
+}
+
+}  // namespace debugger
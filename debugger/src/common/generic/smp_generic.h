@@ -0,0 +1,111 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __SRC_COMMON_GENERIC_SMP_GENERIC_H__
+#define __SRC_COMMON_GENERIC_SMP_GENERIC_H__
+
+#include <iclass.h>
+#include <iservice.h>
+#include <ihap.h>
+#include <async_tqueue.h>
+#include "coreservices/ithread.h"
+#include "coreservices/iclock.h"
+#include "coreservices/ismp.h"
+
+namespace debugger {
+
+/**
+ * Multi-hart scheduler with quantum based synchronization. Harts from
+ * HartList execute Quantum steps each and meet at the barrier where the
+ * global time is advanced and step callbacks are called, so that no hart
+ * runs ahead of others by more than one quantum.
+ *
+ * Mode 'Parallel': each hart runs in its own thread.
+ * Mode 'RoundRobin': all harts run in the scheduler thread one by one in
+ *                    the HartList order, execution is reproducible.
+ *
+ * Service is the clock of the global time base (CLINT 'Clock' attribute),
+ * its resolution is the quantum.
+ */
+class SmpGeneric : public IService,
+                   public IThread,
+                   public IClock,
+                   public ISmpScheduler,
+                   public IHap {
+ public:
+    explicit SmpGeneric(const char *name);
+    virtual ~SmpGeneric();
+
+    /** IService interface */
+    virtual void postinitService();
+
+    /** IThread interface */
+    virtual void stop();
+
+    /** IClock */
+    virtual uint64_t getStepCounter() { return time_; }
+    virtual void registerStepCallback(IClockListener *cb, uint64_t t);
+    virtual bool moveStepCallback(IClockListener *cb, uint64_t t);
+    virtual double getFreqHz() {
+        if (freqHz_.is_floating()) {
+            return freqHz_.to_float();
+        } else {
+            return static_cast<double>(freqHz_.to_int64());
+        }
+    }
+
+    /** ISmpScheduler */
+    virtual uint64_t getQuantumSteps() { return quantum_steps_; }
+    virtual void quantumDone(int hartidx, uint64_t executed);
+    virtual void wakeupSmp();
+
+    /** IHap */
+    virtual void hapTriggered(EHapType type, uint64_t param,
+                              const char *descr);
+
+ protected:
+    /** IThread interface */
+    virtual void busyLoop();
+
+    void countExecuted(uint64_t executed);
+    void finishQuantum();
+
+ protected:
+    AttributeType hartList_;
+    AttributeType mode_;
+    AttributeType quantum_;
+    AttributeType freqHz_;
+
+    ISmpHart **iharts_;
+    event_def *eventHart_;      // per hart barrier release
+    int hartTotal_;
+    int arrived_;               // harts waiting at the barrier
+    bool busy_;                 // any instruction executed in the quantum
+    uint64_t executed_;         // minimum steps of the running harts
+    uint64_t time_;             // global time at the quantum start
+    uint64_t quantum_steps_;
+
+    mutex_def mutexBarrier_;
+    event_def eventConfigDone_;
+    event_def eventWakeup_;
+    ClockAsyncTQueueType queue_;
+};
+
+DECLARE_CLASS(SmpGeneric)
+
+}  // namespace debugger
+
+#endif  // __SRC_COMMON_GENERIC_SMP_GENERIC_H__
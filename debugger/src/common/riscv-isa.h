@@ -91,6 +91,20 @@ union ISA_U_type {
     uint32_t value;
 };
 
+// Vector extension: arithmetic, configuration and load/store
+union ISA_V_type {
+    struct bits_type {
+        uint32_t opcode : 7;  // [6:0]
+        uint32_t vd     : 5;  // [11:7] vd, vs3 or rd
+        uint32_t funct3 : 3;  // [14:12] operands category or memory width
+        uint32_t vs1    : 5;  // [19:15] vs1, rs1 or imm5
+        uint32_t vs2    : 5;  // [24:20] vs2, rs2 or lumop/sumop
+        uint32_t vm     : 1;  // [25] 0 = masked by v0.t
+        uint32_t funct6 : 6;  // [31:26] nf, mew, mop for memory
+    } bits;
+    uint32_t value;
+};
+
 union ISA_UJ_type {
     struct bits_type {
         uint32_t opcode   : 7;   // [6:0]
@@ -351,6 +365,19 @@ union csr_fcsr_type {
     uint64_t value;
 };
 
+// Vector data type register (vtype)
+union csr_vtype_type {
+    struct bits_type {
+        uint64_t vlmul : 3;     // [2:0] LMUL = 2^vlmul, 5..7 fractional
+        uint64_t vsew : 3;      // [5:3] SEW = 8 * 2^vsew
+        uint64_t vta : 1;       // [6] tail agnostic
+        uint64_t vma : 1;       // [7] mask agnostic
+        uint64_t rsrv : 55;     // [62:8]
+        uint64_t vill : 1;      // [63] illegal configuration
+    } bits;
+    uint64_t value;
+};
+
 // Debug Control and Status (dcsr, at 0x7b0)
 union csr_dcsr_type {
     uint64_t u64;
@@ -442,11 +469,57 @@ union csr_satp_type {
     uint64_t u64;
     struct bits_type {
         uint64_t ppn : 44;  // [43:0] WARL
-        uint64_t asid : 9;  // [59:44] WARL
+        uint64_t asid : 16; // [59:44] WARL
         uint64_t mode : 4;  // [63:60] WARL
     } bits;
 };
 
+// Sv39 and Sv48 page table entry
+union sv_pte_type {
+    uint64_t u64;
+    struct bits_type {
+        uint64_t V : 1;     // [0] valid
+        uint64_t R : 1;     // [1] readable
+        uint64_t W : 1;     // [2] writable
+        uint64_t X : 1;     // [3] executable
+        uint64_t U : 1;     // [4] accessible in U-mode
+        uint64_t G : 1;     // [5] global mapping
+        uint64_t A : 1;     // [6] accessed
+        uint64_t D : 1;     // [7] dirty
+        uint64_t rsw : 2;   // [9:8] reserved for software
+        uint64_t ppn : 44;  // [53:10]
+        uint64_t rsrv : 10; // [63:54]
+    } bits;
+};
+
+static const uint32_t PTE_V = 1ul << 0;
+static const uint32_t PTE_R = 1ul << 1;
+static const uint32_t PTE_W = 1ul << 2;
+static const uint32_t PTE_X = 1ul << 3;
+static const uint32_t PTE_U = 1ul << 4;
+static const uint32_t PTE_G = 1ul << 5;
+static const uint32_t PTE_A = 1ul << 6;
+static const uint32_t PTE_D = 1ul << 7;
+
+/**
+ * Events of the mhpmevent3..31 registers (non-standard encoding): counter
+ * is incremented when any of the selected events occurs.
+ */
+static const uint32_t HPM_EVENT_LOAD = 1ul << 0;
+static const uint32_t HPM_EVENT_STORE = 1ul << 1;
+static const uint32_t HPM_EVENT_AMO = 1ul << 2;
+static const uint32_t HPM_EVENT_BRANCH = 1ul << 3;          // conditional
+static const uint32_t HPM_EVENT_BRANCH_TAKEN = 1ul << 4;
+static const uint32_t HPM_EVENT_JUMP = 1ul << 5;            // jal, jalr
+static const uint32_t HPM_EVENT_MULDIV = 1ul << 6;
+static const uint32_t HPM_EVENT_FPU = 1ul << 7;             // F/D arithmetic
+static const uint32_t HPM_EVENT_VECTOR = 1ul << 8;
+static const uint32_t HPM_EVENT_EXCEPTION = 1ul << 9;
+static const uint32_t HPM_EVENT_INTERRUPT = 1ul << 10;
+static const uint32_t HPM_EVENT_ITLB_MISS = 1ul << 11;
+static const uint32_t HPM_EVENT_DTLB_MISS = 1ul << 12;
+static const uint32_t HPM_EVENT_ALL = (1ul << 13) - 1;
+
 
 static const char *const RISCV_IREGS_NAMES[] = {
     "zero",     // [0] zero
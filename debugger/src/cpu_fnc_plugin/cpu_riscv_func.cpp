@@ -23,6 +23,7 @@ namespace debugger {
 CpuRiver_Functional::CpuRiver_Functional(const char *name) :
     CpuGeneric(name) {
     registerInterface(static_cast<ICpuRiscV *>(this));
+    registerInterface(static_cast<IIrqListener *>(this));
     registerAttribute("VendorID", &vendorid_);
     registerAttribute("ImplementationID", &implementationid_);
     registerAttribute("ContextID", &contextid_);
@@ -31,25 +32,111 @@ CpuRiver_Functional::CpuRiver_Functional(const char *name) :
     registerAttribute("CLINT", &clint_);
     registerAttribute("PLIC", &plic_);
     registerAttribute("PmpTotal", &pmpTotal_);
-
+    registerAttribute("JitEnable", &jitEnable_);
+    registerAttribute("JitThreshold", &jitThreshold_);
+    registerAttribute("JitCodeSize", &jitCodeSize_);
+    registerAttribute("JitVerify", &jitVerify_);
+    registerAttribute("TlbCounters", &tlbCounters_);
+    registerAttribute("FpuHostNative", &fpuHostNative_);
+    registerAttribute("FpuSelfTest", &fpuSelfTest_);
+    registerAttribute("VLEN", &vlen_);
+    registerAttribute("TimingEnable", &timingEnable_);
+    registerAttribute("TimingICache", &timingICache_);
+    registerAttribute("TimingDCache", &timingDCache_);
+    registerAttribute("TimingL2Cache", &timingL2Cache_);
+    registerAttribute("TimingBtbSize", &timingBtbSize_);
+    registerAttribute("TimingRasDepth", &timingRasDepth_);
+    registerAttribute("TimingL2Latency", &timingL2Latency_);
+    registerAttribute("TimingMemLatency", &timingMemLatency_);
+    registerAttribute("TimingBranchPenalty", &timingBranchPenalty_);
+    registerAttribute("TimingMulLatency", &timingMulLatency_);
+    registerAttribute("TimingDivLatency", &timingDivLatency_);
+    registerAttribute("TimingFpuLatency", &timingFpuLatency_);
+    registerAttribute("TimingCounters", &timingCounters_);
+
+    blockCacheSize_.make_int64(4096);
+    jitEnable_.make_boolean(false);
+    jitThreshold_.make_int64(16);
+    jitCodeSize_.make_int64(4 * 1024 * 1024);
+    jitVerify_.make_boolean(false);
+    tlbCounters_.make_list(2 * TLB_Total);
+    for (unsigned i = 0; i < tlbCounters_.size(); i++) {
+        tlbCounters_[i].make_uint64(0);
+    }
+    fpuHostNative_.make_boolean(false);
+    fpuSelfTest_.make_boolean(false);
+    vlen_.make_int64(128);
+    // River defaults: river_cfg.h and target_cfg.h
+    timingEnable_.make_boolean(false);
+    timingICache_.make_list(2);
+    timingICache_[0u].make_int64(16);
+    timingICache_[1].make_int64(4);
+    timingDCache_ = timingICache_;
+    timingL2Cache_.make_list(2);
+    timingL2Cache_[0u].make_int64(256);
+    timingL2Cache_[1].make_int64(16);
+    timingBtbSize_.make_int64(8);
+    timingRasDepth_.make_int64(4);
+    timingL2Latency_.make_int64(8);
+    timingMemLatency_.make_int64(24);
+    timingBranchPenalty_.make_int64(3);
+    timingMulLatency_.make_int64(3);
+    timingDivLatency_.make_int64(9);
+    timingFpuLatency_.make_int64(5);
+    timingCounters_.make_list(0);
+    cacheAutoRegions_.make_boolean(true);
     mmuReservatedAddr_ = 0;
+    mmuReservedValue_ = 0;
     mmuReservedAddrWatchdog_ = 0;
     memset(&pmpTable_, 0, sizeof(pmpTable_));
+    pmpActive_ = false;
+    flushPmpPages();
+    memset(tlb_, 0, sizeof(tlb_));
+    flushMmu();
+    decode32_ = 0;
+    decodePool_ = 0;
+    decode16_ = 0;
+    buildCsrTable();
+    hostFpu_ = false;
+    hostFpuCheck_ = false;
+    vlenb_ = 0;
+    vregs_ = 0;
+    hpmEvents_ = 0;
+    timingEna_ = false;
+    iirqloc_ = 0;
+    iirqext_ = 0;
+    irqPolling_ = false;
+    irqPending_ = 0;
+    irqEnable_ = 0;
+    RISCV_mutex_init(&mutex_irq_);
 }
 
 CpuRiver_Functional::~CpuRiver_Functional() {
+    if (decode32_) {
+        delete [] decode32_;
+    }
+    if (decodePool_) {
+        delete [] decodePool_;
+    }
+    if (decode16_) {
+        delete [] decode16_;
+    }
+    if (vregs_) {
+        delete [] vregs_;
+    }
+    RISCV_mutex_destroy(&mutex_irq_);
 }
 
 void CpuRiver_Functional::postinitService() {
     // Supported instruction sets:
-    for (int i = 0; i < INSTR_HASH_TABLE_SIZE; i++) {
-        listInstr_[i].make_list(0);
-    }
+    listInstr_.make_list(0);
     addIsaUserRV64I();
     addIsaPrivilegedRV64I();
     for (unsigned i = 0; i < listExtISA_.size(); i++) {
         if (listExtISA_[i].to_string()[0] == 'A') {
             addIsaExtensionA();
+        } else if (listExtISA_[i].to_string()[0] == 'B') {
+            addIsaExtensionB();
         } else if (listExtISA_[i].to_string()[0] == 'C') {
             addIsaExtensionC();
         } else if (listExtISA_[i].to_string()[0] == 'D') {
@@ -58,6 +145,37 @@ void CpuRiver_Functional::postinitService() {
             addIsaExtensionF();
         } else if (listExtISA_[i].to_string()[0] == 'M') {
             addIsaExtensionM();
+        } else if (listExtISA_[i].to_string()[0] == 'V') {
+            addIsaExtensionV();
+        } else if (listExtISA_[i].is_equal("Zba")) {
+            addIsaExtensionZba();
+        } else if (listExtISA_[i].is_equal("Zbb")) {
+            addIsaExtensionZbb();
+        } else if (listExtISA_[i].is_equal("Zbs")) {
+            addIsaExtensionZbs();
+        }
+    }
+    buildDecodeTables();
+
+    if (timingEnable_.to_bool()) {
+        TimingConfigType cfg;
+        cfg.icacheKBytes = timingICache_[0u].to_uint32();
+        cfg.icacheWays = timingICache_[1].to_uint32();
+        cfg.dcacheKBytes = timingDCache_[0u].to_uint32();
+        cfg.dcacheWays = timingDCache_[1].to_uint32();
+        cfg.l2KBytes = timingL2Cache_[0u].to_uint32();
+        cfg.l2Ways = timingL2Cache_[1].to_uint32();
+        cfg.btbSize = timingBtbSize_.to_uint32();
+        cfg.rasDepth = timingRasDepth_.to_uint32();
+        cfg.l2Latency = timingL2Latency_.to_uint32();
+        cfg.memLatency = timingMemLatency_.to_uint32();
+        cfg.branchPenalty = timingBranchPenalty_.to_uint32();
+        cfg.mulLatency = timingMulLatency_.to_uint32();
+        cfg.divLatency = timingDivLatency_.to_uint32();
+        cfg.fpuLatency = timingFpuLatency_.to_uint32();
+        timingEna_ = timing_.init(cfg);
+        if (!timingEna_) {
+            RISCV_error("Unsupported cache geometry, timing disabled", NULL);
         }
     }
 
@@ -66,6 +184,19 @@ void CpuRiver_Functional::postinitService() {
 
     CpuGeneric::postinitService();
 
+    // Translated code replaces replay of the predecoded blocks
+    if (jitEnable_.to_bool() && blockcache_) {
+        if (jit_.init(jitCodeSize_.to_uint64())) {
+            jit_threshold_ = jitThreshold_.to_uint32();
+            jit_verify_ = jitVerify_.to_bool();
+        } else {
+            RISCV_error("Host code translation isn't supported", NULL);
+        }
+    }
+
+    hostFpu_ = fpuHostNative_.to_bool();
+    hostFpuCheck_ = hostFpu_ && fpuSelfTest_.to_bool();
+
     iirqext_ = static_cast<IIrqController *>(RISCV_get_service_iface(
         plic_.to_string(), IFACE_IRQ_CONTROLLER));
     if (!iirqext_) {
@@ -79,23 +210,156 @@ void CpuRiver_Functional::postinitService() {
         RISCV_error("Interface IIrqController in %s not found",
                     clint_.to_string());
     }
+
+    // Request levels are pushed by controllers, fallback to polling
+    // if any of them doesn't support notifications.
+    if (iirqloc_ && iirqext_) {
+        IFace *iface = static_cast<IIrqListener *>(this);
+        int hartid = hartid_.to_int();
+        bool ena = iirqloc_->registerIrqListener(2*hartid, iface);
+        ena = iirqloc_->registerIrqListener(2*hartid + 1, iface) && ena;
+        ena = iirqext_->registerIrqListener(hartid, iface) && ena;
+        irqPolling_ = !ena;
+    }
 }
 
 void CpuRiver_Functional::predeleteService() {
     CpuGeneric::predeleteService();
 }
 
+void CpuRiver_Functional::exportCounters() {
+    for (int i = 0; i < TLB_Total; i++) {
+        tlbCounters_[2 * i].make_uint64(tlb_[i].hit);
+        tlbCounters_[2 * i + 1].make_uint64(tlb_[i].miss);
+    }
+    if (timingEna_) {
+        timingCounters_.make_list(TimingCnt_Total);
+        for (int i = 0; i < TimingCnt_Total; i++) {
+            timingCounters_[i].make_uint64(timing_.counter(i));
+        }
+    }
+}
+
+void CpuRiver_Functional::reportHostFpuMismatch(const char *instr,
+                                                uint64_t a, uint64_t b,
+                                                uint64_t host,
+                                                uint64_t model,
+                                                uint32_t hostflags,
+                                                uint32_t modelflags) {
+    RISCV_error("[%" RV_PRI64 "d] %s %016" RV_PRI64 "x, %016" RV_PRI64 "x: "
+                "host %016" RV_PRI64 "x/%02x != model %016" RV_PRI64 "x/%02x",
+                step_cnt_, instr, a, b, host, hostflags, model, modelflags);
+}
+
 unsigned CpuRiver_Functional::addSupportedInstruction(
                                     RiscvInstruction *instr) {
     AttributeType tmp(instr);
-    listInstr_[instr->hash()].add_to_list(&tmp);
+    listInstr_.add_to_list(&tmp);
     return 0;
 }
 
+/**
+ * Build direct-indexed decoder tables from the registered instructions.
+ *
+ * 32-bits instructions are indexed by major opcode, funct3 and funct7
+ * fields, each entry points to the short list of candidates (usually one)
+ * that differ only in the other fields and are checked by mask/opcode.
+ * 16-bits instructions may have additional parse() restrictions so that
+ * parse() is called once for every possible halfword here.
+ * Registration order defines priority as in the former list scanning.
+ */
+void CpuRiver_Functional::buildDecodeTables() {
+    unsigned instr_total = listInstr_.size();
+    RiscvInstruction **all = new RiscvInstruction *[instr_total];
+    RiscvInstruction **tlist = new RiscvInstruction *[instr_total + 1];
+    uint32_t *uniq = new uint32_t[DECODE32_TABLE_SIZE];
+    unsigned uniq_total = 0;
+    unsigned pool_sz = 0;
+    unsigned pool_max = 1024;
+    const uint32_t fields_mask = 0xFE00707F;
+
+    for (unsigned i = 0; i < instr_total; i++) {
+        all[i] = static_cast<RiscvInstruction *>(listInstr_[i].to_iface());
+    }
+
+    decode32_ = new uint32_t[DECODE32_TABLE_SIZE];
+    decodePool_ = new RiscvInstruction *[pool_max];
+    for (uint32_t idx = 0; idx < DECODE32_TABLE_SIZE; idx++) {
+        uint32_t fields = ((idx & 0x1f) << 2) | 0x3
+                        | (((idx >> 5) & 0x7) << 12)
+                        | ((idx >> 8) << 25);
+        unsigned cnt = 0;
+        for (unsigned i = 0; i < instr_total; i++) {
+            if (all[i]->isCompressed()) {
+                continue;
+            }
+            if (((fields ^ all[i]->getOpcode())
+                & all[i]->getMask() & fields_mask) == 0) {
+                tlist[cnt++] = all[i];
+            }
+        }
+        tlist[cnt] = 0;
+
+        // The same lists are shared by many indexes:
+        bool found = false;
+        for (unsigned n = 0; n < uniq_total; n++) {
+            RiscvInstruction **p = &decodePool_[uniq[n]];
+            unsigned k = 0;
+            while (p[k] && p[k] == tlist[k]) {
+                k++;
+            }
+            if (p[k] == tlist[k]) {
+                decode32_[idx] = uniq[n];
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            continue;
+        }
+
+        if (pool_sz + cnt + 1 > pool_max) {
+            while (pool_sz + cnt + 1 > pool_max) {
+                pool_max *= 2;
+            }
+            RiscvInstruction **t = new RiscvInstruction *[pool_max];
+            memcpy(t, decodePool_, pool_sz * sizeof(RiscvInstruction *));
+            delete [] decodePool_;
+            decodePool_ = t;
+        }
+        memcpy(&decodePool_[pool_sz], tlist,
+               (cnt + 1) * sizeof(RiscvInstruction *));
+        uniq[uniq_total++] = pool_sz;
+        decode32_[idx] = pool_sz;
+        pool_sz += cnt + 1;
+    }
+
+    decode16_ = new RiscvInstruction *[DECODE16_TABLE_SIZE];
+    for (uint32_t h = 0; h < DECODE16_TABLE_SIZE; h++) {
+        decode16_[h] = 0;
+        if ((h & 0x3) == 0x3) {
+            continue;
+        }
+        for (unsigned i = 0; i < instr_total; i++) {
+            uint32_t payload = h;
+            if (all[i]->isCompressed() && all[i]->parse(&payload)) {
+                decode16_[h] = all[i];
+                break;
+            }
+        }
+    }
+
+    RISCV_debug("Decoder tables: %d instructions, %d unique lists",
+                instr_total, uniq_total);
+    delete [] all;
+    delete [] tlist;
+    delete [] uniq;
+}
+
 /** Check stack protection exceptions: */
 void CpuRiver_Functional::checkStackProtection() {
-    uint64_t mstackovr = readCSR(CSR_mstackovr);
-    uint64_t mstackund = readCSR(CSR_mstackund);
+    uint64_t mstackovr = csr_[CSR_mstackovr];
+    uint64_t mstackund = csr_[CSR_mstackund];
     uint64_t sp = portRegs_.read(Reg_sp).val;
     if (mstackovr != 0 && sp < mstackovr) {
         generateException(EXCEPTION_StackOverflow, getPC());
@@ -111,6 +375,7 @@ void CpuRiver_Functional::handleException(int e) {
         exitProgbufExec();
         return;
     }
+    countHpmEvent(HPM_EVENT_EXCEPTION);
 
     if (estate_ != CORE_ProgbufExec) {
         csr_mcause_type mcause;
@@ -134,45 +399,38 @@ void CpuRiver_Functional::handleException(int e) {
 }
 
 void CpuRiver_Functional::handleInterrupts() {
-    int ctx = 0;
     csr_mcause_type mcause;
-    csr_mstatus_type mstatus;
-    mstatus.value = readCSR(CSR_mstatus);
-    if (mstatus.bits.MIE == 0) {
+    csr_mip_type mip;
+    if (irqEnable_ == 0) {
         return;
     }
-
-    csr_mie_type mie;
-    mie.value = readCSR(CSR_mie);
-
-    // Check software interrupt
-    mcause.value = 0;
-    if (mie.bits.MSIE == 1) {
-        if (iirqloc_->getPendingRequest(2*hartid_.to_int())) {
-            mcause.bits.irq = 1;
-            mcause.bits.code = 3;
-        }
+    if (irqPolling_) {
+        mip.value = irqEnable_ & pollIrqPending();
+    } else {
+        mip.value = irqEnable_ & irqPending_;
     }
-
-    // Check mtimer interrupt
-    if (!mcause.bits.irq && mie.bits.MTIE == 1) {
-        if (iirqloc_->getPendingRequest(2*hartid_.to_int() + 1)) {
-            mcause.bits.irq = 1;
-            mcause.bits.code = 7;
-        }
+    if (mip.value == 0) {
+        return;
     }
 
-    // Check PLIC interrupt request
-    if (!mcause.bits.irq && mie.bits.MEIE == 1) {
-        // external interrupt disabled
-        int irqidx = iirqext_->getPendingRequest(ctx);
-        if (irqidx != IRQ_REQUEST_NONE) {
-            mcause.bits.irq = 1;
-            mcause.bits.code = 11;
-        }
+    // Software, mtimer and then PLIC interrupt request
+    mcause.value = 0;
+    mcause.bits.irq = 1;
+    if (mip.bits.MSIP) {
+        mcause.bits.code = 3;
+    } else if (mip.bits.MTIP) {
+        mcause.bits.code = 7;
+    } else if (mip.bits.MEIP) {
+        mcause.bits.code = 11;
+    } else {
+        mcause.bits.irq = 0;
     }
 
     if (mcause.bits.irq) {
+        countHpmEvent(HPM_EVENT_INTERRUPT);
+        if (isInstrumented(InstrEvent_Trap)) {
+            instrumentTrap(mcause.bits.code, true);
+        }
         writeCSR(CSR_mcause, mcause.value);
 
         switchContext(PRV_M);
@@ -189,6 +447,70 @@ void CpuRiver_Functional::handleInterrupts() {
     }
 }
 
+/**
+ * mstatus.MIE and mie are checked once on CSR write instead of each
+ * instruction.
+ */
+void CpuRiver_Functional::updateIrqEnable() {
+    csr_mstatus_type mstatus;
+    mstatus.value = csr_[CSR_mstatus];
+    RISCV_mutex_lock(&mutex_irq_);
+    irqEnable_ = 0;
+    if (mstatus.bits.MIE) {
+        irqEnable_ = csr_[CSR_mie];
+    }
+    updateIrqAttention();
+    RISCV_mutex_unlock(&mutex_irq_);
+}
+
+/**
+ * handleInterrupts() is called only while an enabled request is pending.
+ * Must be called under mutex_irq_.
+ */
+void CpuRiver_Functional::updateIrqAttention() {
+    uint64_t t = irqEnable_;
+    if (!irqPolling_) {
+        t &= irqPending_;
+    }
+    if (t) {
+        setAttention(ATTN_Irq);
+    } else {
+        clearAttention(ATTN_Irq);
+    }
+}
+
+uint64_t CpuRiver_Functional::pollIrqPending() {
+    int hartid = hartid_.to_int();
+    csr_mip_type mip;
+    mip.value = 0;
+    if (iirqloc_ && iirqext_) {
+        mip.bits.MSIP = iirqloc_->getPendingRequest(2*hartid);
+        mip.bits.MTIP = iirqloc_->getPendingRequest(2*hartid + 1);
+        mip.bits.MEIP = iirqext_->getPendingRequest(hartid) != IRQ_REQUEST_NONE;
+    }
+    return mip.value;
+}
+
+void CpuRiver_Functional::irqLevelChanged(IFace *isrc, int ctxid, int level) {
+    csr_mip_type mip;
+    mip.value = 0;
+    if (isrc == iirqext_) {
+        mip.bits.MEIP = 1;
+    } else if (ctxid & 0x1) {
+        mip.bits.MTIP = 1;
+    } else {
+        mip.bits.MSIP = 1;
+    }
+    RISCV_mutex_lock(&mutex_irq_);
+    if (level) {
+        irqPending_ |= mip.value;
+    } else {
+        irqPending_ &= ~mip.value;
+    }
+    updateIrqAttention();
+    RISCV_mutex_unlock(&mutex_irq_);
+}
+
 void CpuRiver_Functional::switchContext(uint32_t prvnxt) {
     // All traps handle via machine mode while CSR mdelegate
     // doesn't setup other.
@@ -206,49 +528,53 @@ void CpuRiver_Functional::switchContext(uint32_t prvnxt) {
 }
 
 void CpuRiver_Functional::reset(IFace *isource) {
-    CpuGeneric::reset(isource);
-    portRegs_.reset();
     //uint64_t misa = readCSR(CSR_misa);
     //portCSR_.reset();
     // TODO: reset each register separetly!!!
-    writeCSR(CSR_mvendorid, vendorid_.to_uint64());
-    writeCSR(CSR_mimplementationid, implementationid_.to_uint64());
-    writeCSR(CSR_mhartid, hartid_.to_uint64());
+    // Read-only CSRs, writeCSR() ignores them
+    csr_[CSR_mvendorid] = vendorid_.to_uint64();
+    csr_[CSR_mimplementationid] = implementationid_.to_uint64();
+    csr_[CSR_mhartid] = hartid_.to_uint64();
     writeCSR(CSR_mtvec, 0);
     //writeCSR(CSR_misa, misa);
     writeCSR(CSR_dpc, getResetAddress());
 
     cur_prv_level = PRV_M;           // Current privilege level
+    if (vregs_) {
+        memset(vregs_, 0, 32 * vlenb_);
+        csr_[CSR_vlenb] = vlenb_;
+        setVectorConfig(1ull << 63, 0);     // vill
+    }
+    for (uint32_t i = 0; i < 29; i++) {
+        csr_[CSR_mhpmevent3 + i] = 0;
+        csr_[CSR_mhpmcounter3 + i] = 0;
+    }
+    csr_[CSR_mcountinhibit] = 0;
+    hpmEvents_ = 0;
+    timing_.flush();
     mmuReservedAddrWatchdog_ = 0;
+    flushMmu();
+    updateMpuEnable();
+    updateIrqEnable();
+    // Registers are cleared and the hart is woken up the last
+    CpuGeneric::reset(isource);
 }
 
 GenericInstruction *CpuRiver_Functional::decodeInstruction(Reg64Type *cache) {
-    RiscvInstruction *instr = NULL;
-    int hash_idx = hash32(cacheline_[0].buf32[0]);
-    for (unsigned i = 0; i < listInstr_[hash_idx].size(); i++) {
-        instr = static_cast<RiscvInstruction *>(
-                        listInstr_[hash_idx][i].to_iface());
-        if (instr->parse(cacheline_[0].buf32)) {
-            break;
-        }
-        instr = NULL;
+    uint32_t val = cache[0].buf32[0];
+    // Compressed instructions:
+    if ((val & 0x3) != 0x3) {
+        return decode16_[val & 0xFFFF];
     }
-    // Check compressed instructions:
-    if (instr == NULL) {
-        hash_idx = hash16(cacheline_[0].buf16[0]);
-        for (unsigned i = 0; i < listInstr_[hash_idx].size(); i++) {
-            instr = static_cast<RiscvInstruction *>(
-                            listInstr_[hash_idx][i].to_iface());
-            if (instr->parse(cacheline_[0].buf32)) {
-                break;
-            }
-            instr = NULL;
+
+    RiscvInstruction **p = &decodePool_[decode32_[decodeIndex32(val)]];
+    while (*p) {
+        if ((*p)->match(val)) {
+            return *p;
         }
+        p++;
     }
-    if (mmuReservedAddrWatchdog_) {
-        mmuReservedAddrWatchdog_--;
-    }
-    return instr;
+    return NULL;
 }
 
 void CpuRiver_Functional::generateIllegalOpcode() {
@@ -256,13 +582,92 @@ void CpuRiver_Functional::generateIllegalOpcode() {
     RISCV_error("Illegal instruction at 0x%08" RV_PRI64 "x", getPC());
 }
 
+/**
+ * Instruction class events are counted only while any of mhpmevent is
+ * set, the translated code isn't used in this case.
+ */
+void CpuRiver_Functional::trackContextEnd() {
+    CpuGeneric::trackContextEnd();
+    if (hpmEvents_ && instr_) {
+        uint32_t ev = static_cast<RiscvInstruction *>(instr_)->getHpmEvents();
+        if (branch_ && (ev & HPM_EVENT_BRANCH)) {
+            ev |= HPM_EVENT_BRANCH_TAKEN;
+        }
+        countHpmEvent(ev);
+    }
+    if (timingEna_ && instr_ && estate_ == CORE_Normal) {
+        chargeTiming(static_cast<RiscvInstruction *>(instr_)->getHpmEvents());
+    }
+}
+
+/**
+ * Cycle-approximate mode: stalls of the timing model are added to the clock
+ * counter so that mcycle, mtime and all scheduled events see the estimated
+ * cycles while minstret counts instructions only.
+ */
+void CpuRiver_Functional::chargeTiming(uint32_t ev) {
+    uint64_t npc = branch_ ? getNPC() : getPC() + oplen_;
+    uint32_t t = timing_.instruction(getPC(), cacheline_[0].buf32[0], oplen_,
+                                     instr_->name(), ev, npc);
+    if (t) {
+        addStallCycles(t);
+    }
+}
+
+ETransStatus CpuRiver_Functional::dma_memop(Axi4TransactionType *tr,
+                                            int flags) {
+    ETransStatus ret = CpuGeneric::dma_memop(tr, flags);
+    // Instruction fetch and debug port accesses aren't timed
+    if (timingEna_ && flags == 0 && ret == TRANS_OK) {
+        timing_.dataAccess(tr->addr, isCacheableAddress(tr->addr));
+    }
+    return ret;
+}
+
 void CpuRiver_Functional::trackContextStart() {
+    // Called on each instruction even if decoding stage was skipped
+    if (mmuReservedAddrWatchdog_) {
+        mmuReservedAddrWatchdog_--;
+    }
     CpuGeneric::trackContextStart();
     if (trace_file_ == 0) {
         return;
     }
 }
 
+bool CpuRiver_Functional::translateBlock(BlockType *blk) {
+    const char *names[BLOCK_INSTR_MAX];
+    uint32_t payload[BLOCK_INSTR_MAX];
+    for (int i = 0; i < blk->total; i++) {
+        names[i] = blk->op[i].instr->name();
+        payload[i] = blk->op[i].payload.buf32[0];
+    }
+    blk->jitcode = jit_.translate(blk->addr, names, payload, blk->total,
+                                  &blk->jittotal);
+    if (blk->jitcode == 0 && jit_.isFull()) {
+        dropJitCode();
+        jit_.flush();
+        blk->jitcode = jit_.translate(blk->addr, names, payload, blk->total,
+                                      &blk->jittotal);
+    }
+    return blk->jitcode != 0;
+}
+
+int CpuRiver_Functional::executeJit(BlockType *blk) {
+    if (hpmEvents_ || timingEna_) {
+        // Performance-monitor and timing model need each instruction
+        return 0;
+    }
+    int cnt = CpuGeneric::executeJit(blk);
+    // trackContextStart() is skipped for the translated instructions
+    if (mmuReservedAddrWatchdog_ > cnt) {
+        mmuReservedAddrWatchdog_ -= cnt;
+    } else {
+        mmuReservedAddrWatchdog_ = 0;
+    }
+    return cnt;
+}
+
 void CpuRiver_Functional::traceOutput() {
     char tstr[1024];
 
@@ -271,34 +676,20 @@ void CpuRiver_Functional::traceOutput() {
                   &trace_data_.instrbuf,
                   &trace_data_.asmlist);
 
-    RISCV_sprintf(tstr, sizeof(tstr),
-        "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \r\n",
-            trace_data_.step_cnt,
-            trace_data_.pc,
-            trace_data_.asmlist[0u].to_string());
+    bintrace_text_instr(tstr, sizeof(tstr), trace_data_.step_cnt,
+                        trace_data_.pc,
+                        bintrace_mnemonic(&trace_data_.asmlist));
     (*trace_file_) << tstr;
 
 
     for (int i = 0; i < trace_data_.action_cnt; i++) {
         trace_action_type *pa = &trace_data_.action[i];
         if (!pa->memop) {
-            RISCV_sprintf(tstr, sizeof(tstr),
-                "%20s %10s <= %016" RV_PRI64 "x\r\n",
-                    "",
-                    RISCV_IREGS_NAMES[pa->waddr],
-                    pa->wdata);
-        } else if (pa->memop_write) {
-            RISCV_sprintf(tstr, sizeof(tstr),
-                "%20s [%08" RV_PRI64 "x] <= %016" RV_PRI64 "x\r\n",
-                    "",
-                    pa->memop_addr,
-                    pa->memop_data.val);
+            bintrace_text_reg(tstr, sizeof(tstr),
+                              RISCV_IREGS_NAMES[pa->waddr], pa->wdata);
         } else {
-            RISCV_sprintf(tstr, sizeof(tstr),
-                "%20s [%08" RV_PRI64 "x] => %016" RV_PRI64 "x\r\n",
-                    "",
-                    pa->memop_addr,
-                    pa->memop_data.val);
+            bintrace_text_memop(tstr, sizeof(tstr), pa->memop_write != 0,
+                                pa->memop_addr, pa->memop_data.val);
         }
         (*trace_file_) << tstr;
     }
@@ -308,7 +699,7 @@ void CpuRiver_Functional::traceOutput() {
 
 bool CpuRiver_Functional::isStepEnabled() {
     csr_dcsr_type dcsr;
-    dcsr.u64 = static_cast<uint32_t>(readCSR(CSR_dcsr));
+    dcsr.u64 = static_cast<uint32_t>(csr_[CSR_dcsr]);
     return dcsr.bits.step;
 }
 
@@ -360,7 +751,7 @@ int CpuRiver_Functional::dportReadMem(uint64_t addr, uint32_t virt,
     //    tr.addr = va2pa(addr);
     //}
     tr.xsize = sz;
-    if (dma_memop(&tr) != TRANS_OK) {
+    if (dma_memop(&tr, 0x2) != TRANS_OK) {  // debug port thread
         return -1;
     }
     memcpy(payload, tr.rpayload.b8, sz);
@@ -379,94 +770,164 @@ int CpuRiver_Functional::dportWriteMem(uint64_t addr, uint32_t virt,
     tr.xsize = sz;
     tr.wstrb = (1 << sz) - 1;
     tr.wpayload.b64[0] = payload;
-    if (dma_memop(&tr) != TRANS_OK) {
+    if (dma_memop(&tr, 0x2) != TRANS_OK) {  // debug port thread
         return -1;
     }
     return 0;
 }
 
 
-uint64_t CpuRiver_Functional::readCSR(uint32_t regno) {
-    uint64_t ret = 0;
-    uint64_t trigidx;
-    if (regno == CSR_mcycle) {
-        ret = step_cnt_;
-    } else if (regno == CSR_minsret) {
-        ret = step_cnt_;
-    } else if (regno == CSR_cycle) {
-        ret = step_cnt_;
-    } else if (regno == CSR_time) {
-        ret = step_cnt_;
-    } else if (regno == CSR_insret) {
-        ret = step_cnt_;
-    } else if (regno == CSR_dpc) {
-        if (!isHalted()) {
-            ret = getNPC();
-        } else {
-            ret = portCSR_.read(regno).val;
+/**
+ * CSR dispatch description. Registers not listed here are plain storage
+ * with the access rules defined by the CSR address: bits [11:10] = 3 are
+ * read-only, bits [9:8] are the lowest privilege level.
+ */
+const CpuRiver_Functional::CsrListType CpuRiver_Functional::CSR_LIST[] = {
+    // first, last, flags, read hook, write hook
+    {CSR_misa, CSR_misa, CsrFlag_ReadOnly, 0, 0},
+    {CSR_mstatus, CSR_mstatus, 0,
+        0, &CpuRiver_Functional::writeCsrMstatus},
+    {CSR_mie, CSR_mie, 0,
+        0, &CpuRiver_Functional::writeCsrIrqEnable},
+    {CSR_mip, CSR_mip, 0,
+        &CpuRiver_Functional::readCsrMip, 0},
+    {CSR_vcsr, CSR_vcsr, 0,
+        &CpuRiver_Functional::readCsrVcsr,
+        &CpuRiver_Functional::writeCsrVcsr},
+    {CSR_satp, CSR_satp, 0,
+        0, &CpuRiver_Functional::writeCsrSatp},
+    {CSR_pmpcfg0, CSR_pmpcfg15, 0,
+        0, &CpuRiver_Functional::writeCsrPmpcfg},
+    {CSR_pmpaddr0, CSR_pmpaddr63, 0,
+        0, &CpuRiver_Functional::writeCsrPmpaddr},
+    {CSR_tselect, CSR_tselect, 0,
+        0, &CpuRiver_Functional::writeCsrTselect},
+    {CSR_tdata1, CSR_textra, 0,
+        &CpuRiver_Functional::readCsrTrigger,
+        &CpuRiver_Functional::writeCsrTrigger},
+    {CSR_tinfo, CSR_tinfo, 0,
+        &CpuRiver_Functional::readCsrTinfo, 0},
+    {CSR_dcsr, CSR_dcsr, 0,
+        0, &CpuRiver_Functional::writeCsrDcsr},
+    {CSR_dpc, CSR_dpc, 0,
+        &CpuRiver_Functional::readCsrDpc, 0},
+    {CSR_flushi, CSR_flushi, 0,
+        0, &CpuRiver_Functional::writeCsrFlushi},
+    {CSR_mstackovr, CSR_mstackund, 0,
+        0, &CpuRiver_Functional::writeCsrStackProtect},
+    {CSR_mcycle, CSR_mcycle, CsrFlag_ReadOnly,
+        &CpuRiver_Functional::readCsrStepCounter, 0},
+    {CSR_minsret, CSR_minsret, CsrFlag_ReadOnly,
+        &CpuRiver_Functional::readCsrStepCounter, 0},
+    {CSR_cycle, CSR_insret, CsrFlag_ReadOnly,
+        &CpuRiver_Functional::readCsrStepCounter, 0},
+    {CSR_mcountinhibit, CSR_mcountinhibit, 0,
+        0, &CpuRiver_Functional::writeCsrHpmEvent},
+    {CSR_mhpmevent3, CSR_mhpmevent31, 0,
+        0, &CpuRiver_Functional::writeCsrHpmEvent},
+    {CSR_hpmcounter3, CSR_hpmcounter31, CsrFlag_ReadOnly,
+        &CpuRiver_Functional::readCsrHpmCounter, 0},
+};
+
+void CpuRiver_Functional::buildCsrTable() {
+    csr_ = portCSR_.getpR64();
+    for (uint32_t i = 0; i < CSR_TABLE_SIZE; i++) {
+        csrtbl_[i].rd = 0;
+        csrtbl_[i].wr = 0;
+        csrtbl_[i].flags = 0;
+        if (((i >> 10) & 0x3) == 0x3) {
+            csrtbl_[i].flags = CsrFlag_ReadOnly;
         }
-    } else if (regno == CSR_tdata1) {
-        trigidx = readCSR(CSR_tselect);
-        ret = ptriggers_[trigidx].data1.val;
-    } else if (regno == CSR_tdata2) {
-        trigidx = readCSR(CSR_tselect);
-        ret = ptriggers_[trigidx].data2;
-    } else if (regno == CSR_textra) {
-        trigidx = readCSR(CSR_tselect);
-        ret = ptriggers_[trigidx].extra;
-    } else if (regno == CSR_tinfo) {
-        // RO: list of supported triggers
-        ret = (1ull << TriggerType_AddrDataMatch)
-            | (1ull << TriggerType_InstrCountMatch)
-            | (1ull << TriggerType_Inetrrupt)
-            | (1ull << TriggerType_Exception);
-    } else if (regno == CSR_mip) {
-        int hartid = hartid_.to_int();
-        csr_mip_type mip;
-        mip.value = 0;
-        mip.bits.MSIP = iirqloc_->getPendingRequest(2*hartid);
-        mip.bits.MTIP = iirqloc_->getPendingRequest(2*hartid + 1);
-        mip.bits.MEIP = iirqext_->getPendingRequest(hartid) != IRQ_REQUEST_NONE;
-        ret = mip.value;
-    } else {
-        RISCV_mutex_lock(&mutex_csr_);
-        ret = portCSR_.read(regno).val;
-        RISCV_mutex_unlock(&mutex_csr_);
+        csrtbl_[i].prv = (i >> 8) & 0x3;
     }
-    return ret;
+    for (unsigned n = 0; n < sizeof(CSR_LIST)/sizeof(CSR_LIST[0]); n++) {
+        const CsrListType &d = CSR_LIST[n];
+        for (uint32_t i = d.first; i <= d.last; i++) {
+            csrtbl_[i].rd = d.rd;
+            csrtbl_[i].wr = d.wr;
+            csrtbl_[i].flags |= d.flags;
+        }
+    }
+}
+
+uint64_t CpuRiver_Functional::readCSR(uint32_t regno) {
+    regno &= (CSR_TABLE_SIZE - 1);
+    CsrReadHook rd = csrtbl_[regno].rd;
+    if (rd) {
+        return (this->*rd)(regno);
+    }
+    return csr_[regno];
 }
 
 void CpuRiver_Functional::writeCSR(uint32_t regno, uint64_t val) {
-    bool wr_access = true;
-    uint64_t trigidx;
-    // Read-Only registers
-    if (regno == CSR_misa) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mvendorid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_marchid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mimplementationid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mhartid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mcycle) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_minsret) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_cycle) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_time) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_insret) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_tselect) {
-        if (val > triggersTotal_.to_uint64()) {
-            val = triggersTotal_.to_uint64();
-            RISCV_debug("Select trigger %d", static_cast<int>(val));
-        }
-    } else if (regno == CSR_tdata1) {
-        trigidx = readCSR(CSR_tselect);
+    regno &= (CSR_TABLE_SIZE - 1);
+    const CsrType &csr = csrtbl_[regno];
+    if (csr.flags & CsrFlag_ReadOnly) {
+        return;
+    }
+    csr_[regno] = val;
+    if (csr.wr) {
+        (this->*csr.wr)(regno, val);
+    }
+}
+
+uint64_t CpuRiver_Functional::readCsrStepCounter(uint32_t regno) {
+    if (regno == CSR_minsret || regno == CSR_insret) {
+        return step_cnt_;
+    }
+    return getClockCounter();
+}
+
+uint64_t CpuRiver_Functional::readCsrDpc(uint32_t regno) {
+    if (!isHalted()) {
+        return getNPC();
+    }
+    return csr_[regno];
+}
+
+uint64_t CpuRiver_Functional::readCsrTrigger(uint32_t regno) {
+    uint64_t trigidx = csr_[CSR_tselect];
+    if (regno == CSR_tdata1) {
+        return ptriggers_[trigidx].data1.val;
+    } else if (regno == CSR_tdata2) {
+        return ptriggers_[trigidx].data2;
+    }
+    return ptriggers_[trigidx].extra;
+}
+
+uint64_t CpuRiver_Functional::readCsrTinfo(uint32_t regno) {
+    // RO: list of supported triggers
+    return (1ull << TriggerType_AddrDataMatch)
+        | (1ull << TriggerType_InstrCountMatch)
+        | (1ull << TriggerType_Inetrrupt)
+        | (1ull << TriggerType_Exception);
+}
+
+uint64_t CpuRiver_Functional::readCsrVcsr(uint32_t regno) {
+    return (csr_[CSR_vxrm] << 1) | csr_[CSR_vxsat];
+}
+
+uint64_t CpuRiver_Functional::readCsrHpmCounter(uint32_t regno) {
+    return csr_[CSR_mhpmcounter3 + (regno - CSR_hpmcounter3)];
+}
+
+uint64_t CpuRiver_Functional::readCsrMip(uint32_t regno) {
+    if (irqPolling_) {
+        return pollIrqPending();
+    }
+    return irqPending_;
+}
+
+void CpuRiver_Functional::writeCsrTselect(uint32_t regno, uint64_t val) {
+    if (val > triggersTotal_.to_uint64()) {
+        csr_[regno] = triggersTotal_.to_uint64();
+        RISCV_debug("Select trigger %d", static_cast<int>(csr_[regno]));
+    }
+}
+
+void CpuRiver_Functional::writeCsrTrigger(uint32_t regno, uint64_t val) {
+    uint64_t trigidx = csr_[CSR_tselect];
+    if (regno == CSR_tdata1) {
         TriggerData1Type tdata1;
         tdata1.val = val;
         if (tdata1.bitsdef.type == TriggerType_AddrDataMatch) {
@@ -476,82 +937,153 @@ void CpuRiver_Functional::writeCSR(uint32_t regno, uint64_t val) {
         ptriggers_[trigidx].data1.val = val;
         RISCV_info("[tdata1] <= %016" RV_PRI64 "x, type=%d",
             val, static_cast<uint32_t>(tdata1.bitsdef.type));
-        val = tdata1.val;
+        csr_[regno] = tdata1.val;
     } else if (regno == CSR_tdata2) {
-        trigidx = readCSR(CSR_tselect);
         ptriggers_[trigidx].data2 = val;
         RISCV_info("[tdata2] <= %016" RV_PRI64 "x", val);
-    } else if (regno == CSR_textra) {
-        trigidx = readCSR(CSR_tselect);
+    } else {
         ptriggers_[trigidx].extra = val;
         RISCV_info("[textra] <= %016" RV_PRI64 "x", val);
-    } else if (regno == CSR_flushi) {
-        flush(val);
-    } else if (regno >= CSR_pmpcfg0 && regno <= CSR_pmpcfg15) {
-        // Physical memory protection configuration:
-        uint64_t mask54 = (1ull << 54) - 1;
-        unsigned pmpidx = 8 * (regno - (CSR_pmpcfg0 & ~0x1));
-        unsigned pmptot = 8;
-        unsigned pmpcfg;
-        unsigned A, RWX, L;
-        if (CSR_pmpcfg0 & 0x1) {
-            pmptot = 4;
-            pmpidx += 4;
-        }
-        for (unsigned i = 0; i < pmptot; i++) {
-            pmpcfg = static_cast<unsigned>((val >> (8 * i)) & 0xFF);
-            RWX = pmpcfg & 0x7;
-            A = (pmpcfg >> 3) & 0x3;
-            L = (pmpcfg >> 7) & 0x1;
-            uint64_t startaddr = 0;
-            uint64_t endaddr = (mask54 << 2) | 0x3;
-            if (A == 0x0) {
-                disablePmp(pmpidx + i);
-            } else if (A == 1) {
-                // TOR: Top of region
-                endaddr = (portCSR_.read(CSR_pmpaddr0 + pmpidx + i).val & mask54) - 1;
-                if (pmpidx) {
-                    startaddr = portCSR_.read(CSR_pmpaddr0 + pmpidx + i - 1).val & mask54;
-                }
-                enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
-            } else if (A == 2) {
-                startaddr = (portCSR_.read(CSR_pmpaddr0 + pmpidx + i).val & mask54) << 2;
-                endaddr = startaddr + 3;
-                enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
-            } else if (A == 3) {
-                startaddr = portCSR_.read(CSR_pmpaddr0 + pmpidx + i).val & mask54;
-                if (startaddr == mask54) {
-                    // Full memory region
-                    startaddr = 0;
-                    endaddr = ~0ull;
-                } else {
-                    uint64_t bitidx = 0x1ull;
-                    while ((startaddr & bitidx) && bitidx) {
-                        startaddr &= ~bitidx;
-                        bitidx <<= 1;
-                    }
-                    startaddr <<= 2;
-                    endaddr = startaddr + 8 * bitidx - 1;
+    }
+    updateTriggers();
+}
+
+void CpuRiver_Functional::writeCsrFlushi(uint32_t regno, uint64_t val) {
+    flush(val);
+}
+
+void CpuRiver_Functional::writeCsrPmpcfg(uint32_t regno, uint64_t val) {
+    // Physical memory protection configuration:
+    uint64_t mask54 = (1ull << 54) - 1;
+    unsigned pmpidx = 4 * (regno - CSR_pmpcfg0);
+    unsigned pmptot = 8;
+    unsigned pmpcfg;
+    unsigned A, RWX, L;
+    if (regno & 0x1) {
+        pmptot = 4;     // RV32 layout
+    }
+    for (unsigned i = 0; i < pmptot; i++) {
+        pmpcfg = static_cast<unsigned>((val >> (8 * i)) & 0xFF);
+        RWX = pmpcfg & 0x7;
+        A = (pmpcfg >> 3) & 0x3;
+        L = (pmpcfg >> 7) & 0x1;
+        uint64_t startaddr = 0;
+        uint64_t endaddr = (mask54 << 2) | 0x3;
+        if (A == 0x0) {
+            disablePmp(pmpidx + i);
+        } else if (A == 1) {
+            // TOR: Top of region
+            endaddr = ((csr_[CSR_pmpaddr0 + pmpidx + i] & mask54) << 2) - 1;
+            if (pmpidx + i) {
+                startaddr = (csr_[CSR_pmpaddr0 + pmpidx + i - 1] & mask54) << 2;
+            }
+            enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
+        } else if (A == 2) {
+            startaddr = (csr_[CSR_pmpaddr0 + pmpidx + i] & mask54) << 2;
+            endaddr = startaddr + 3;
+            enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
+        } else if (A == 3) {
+            startaddr = csr_[CSR_pmpaddr0 + pmpidx + i] & mask54;
+            if (startaddr == mask54) {
+                // Full memory region
+                startaddr = 0;
+                endaddr = ~0ull;
+            } else {
+                uint64_t bitidx = 0x1ull;
+                while ((startaddr & bitidx) && bitidx) {
+                    startaddr &= ~bitidx;
+                    bitidx <<= 1;
                 }
-                enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
+                startaddr <<= 2;
+                endaddr = startaddr + 8 * bitidx - 1;
             }
+            enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
         }
-    } else if (regno == CSR_satp) {
-        csr_satp_type satp;
-        satp.u64 = val;
-        if (satp.bits.mode != SATP_MODE_OFF
-            && satp.bits.mode != SATP_MODE_SV39
-            && satp.bits.mode != SATP_MODE_SV48) {
-            RISCV_error(
-                "[satp] <= %016" RV_PRI64 "x. Paging mode %x not supported",
-                val, satp.bits.mode);
+    }
+    flushPmpPages();
+}
+
+/**
+ * Region bounds are latched on pmpcfg write, so the configuration of this
+ * entry and of the next one (TOR bottom) is applied again.
+ */
+void CpuRiver_Functional::writeCsrPmpaddr(uint32_t regno, uint64_t val) {
+    uint32_t pmpidx = regno - CSR_pmpaddr0;
+    uint32_t cfgidx = CSR_pmpcfg0 + 2 * (pmpidx / 8);
+    writeCsrPmpcfg(cfgidx, csr_[cfgidx]);
+    if ((pmpidx % 8) == 7 && pmpidx + 1 < PMP_ENTRIES_MAX) {
+        cfgidx += 2;
+        writeCsrPmpcfg(cfgidx, csr_[cfgidx]);
+    }
+}
+
+void CpuRiver_Functional::writeCsrSatp(uint32_t regno, uint64_t val) {
+    csr_satp_type satp;
+    satp.u64 = val;
+    if (satp.bits.mode != SATP_MODE_OFF
+        && satp.bits.mode != SATP_MODE_SV39
+        && satp.bits.mode != SATP_MODE_SV48) {
+        RISCV_error(
+            "[satp] <= %016" RV_PRI64 "x. Paging mode %x not supported",
+            val, satp.bits.mode);
+    }
+}
+
+void CpuRiver_Functional::writeCsrMstatus(uint32_t regno, uint64_t val) {
+    updateMpuEnable();
+    updateIrqEnable();
+}
+
+void CpuRiver_Functional::writeCsrIrqEnable(uint32_t regno, uint64_t val) {
+    updateIrqEnable();
+}
+
+void CpuRiver_Functional::writeCsrDcsr(uint32_t regno, uint64_t val) {
+    csr_dcsr_type dcsr;
+    dcsr.u64 = static_cast<uint32_t>(val);
+    if (dcsr.bits.step) {
+        setAttention(ATTN_Step);
+    } else {
+        clearAttention(ATTN_Step);
+    }
+}
+
+void CpuRiver_Functional::writeCsrStackProtect(uint32_t regno,
+                                               uint64_t val) {
+    if (csr_[CSR_mstackovr] || csr_[CSR_mstackund]) {
+        setAttention(ATTN_StackCheck);
+    } else {
+        clearAttention(ATTN_StackCheck);
+    }
+}
+
+void CpuRiver_Functional::writeCsrVcsr(uint32_t regno, uint64_t val) {
+    csr_[CSR_vxsat] = val & 0x1;
+    csr_[CSR_vxrm] = (val >> 1) & 0x3;
+}
+
+/**
+ * mcountinhibit or mhpmevent3..31 were written: the union of the events
+ * of enabled counters is kept so that the instruction path checks one mask.
+ */
+void CpuRiver_Functional::writeCsrHpmEvent(uint32_t regno, uint64_t val) {
+    uint64_t inhibit = csr_[CSR_mcountinhibit];
+    uint64_t ev = 0;
+    for (uint32_t i = 0; i < 29; i++) {
+        if (!((inhibit >> (i + 3)) & 0x1)) {
+            ev |= csr_[CSR_mhpmevent3 + i];
         }
     }
+    hpmEvents_ = static_cast<uint32_t>(ev & HPM_EVENT_ALL);
+}
 
-    if (wr_access) {
-        RISCV_mutex_lock(&mutex_csr_);
-        portCSR_.write(regno, val);
-        RISCV_mutex_unlock(&mutex_csr_);
+void CpuRiver_Functional::incrHpmCounters(uint32_t ev) {
+    uint64_t inhibit = csr_[CSR_mcountinhibit];
+    for (uint32_t i = 0; i < 29; i++) {
+        if ((csr_[CSR_mhpmevent3 + i] & ev)
+            && !((inhibit >> (i + 3)) & 0x1)) {
+            csr_[CSR_mhpmcounter3 + i]++;
+        }
     }
 }
 
@@ -590,20 +1122,69 @@ void CpuRiver_Functional::enablePmp(uint32_t pmpidx,
 }
 
 // PMP is active for S,U modes or in M-mode when L-bit is set (or MSTATUS.MPRV=1):
-bool CpuRiver_Functional::isMpuEnabled() {
-    uint64_t prv = getPrvLevel();
-    if (prv != PRV_M) {
-        return true;
-    }
+void CpuRiver_Functional::updateMpuEnable() {
     csr_mstatus_type mstatus;
-    mstatus.value = readCSR(CSR_mstatus);
-    if (mstatus.bits.MPRV && (mstatus.bits.MPP != PRV_M)) {
-        return true;
+    mstatus.value = csr_[CSR_mstatus];
+    pmpActive_ = cur_prv_level != PRV_M
+        || (mstatus.bits.MPRV && (mstatus.bits.MPP != PRV_M));
+}
+
+void CpuRiver_Functional::flushPmpPages() {
+    for (int i = 0; i < PMP_PAGES; i++) {
+        pmpPages_[i].pfn = PMP_PAGE_EMPTY;
     }
-    return false;
+}
+
+/** Access rights of the first region that overlaps the page */
+uint32_t CpuRiver_Functional::pmpPageAccess(uint64_t pageadr) {
+    uint64_t pageend = pageadr + 0xFFF;
+    uint32_t access = 0;
+    for (int i = 0; i < pmpTotal_.to_int(); i++) {
+        if ((pmpTable_.ena & (1ull << i)) == 0) {
+            continue;
+        }
+        if (pageend < pmpTable_.startadr[i]
+            || pageadr > pmpTable_.endadr[i]) {
+            continue;
+        }
+        if (pageadr < pmpTable_.startadr[i]
+            || pageend > pmpTable_.endadr[i]) {
+            return PMP_PAGE_MIXED;
+        }
+        if (pmpTable_.R & (1ull << i)) {
+            access |= 0x1;
+        }
+        if (pmpTable_.W & (1ull << i)) {
+            access |= 0x2;
+        }
+        if (pmpTable_.X & (1ull << i)) {
+            access |= 0x4;
+        }
+        break;  // Lower region has higher privilege
+    }
+    return access;
 }
 
 bool CpuRiver_Functional::checkMpu(uint64_t adr, uint32_t size, const char *rwx) {
+    PmpPageType &pg = pmpPages_[(adr >> 12) & (PMP_PAGES - 1)];
+    if (pg.pfn != (adr >> 12)) {
+        pg.pfn = adr >> 12;
+        pg.access = pmpPageAccess(adr & ~0xFFFull);
+    }
+    if (pg.access & PMP_PAGE_MIXED) {
+        return checkPmpRegions(adr, rwx);
+    }
+    switch (rwx[0]) {
+    case 'x':
+        return (pg.access & 0x4) != 0;
+    case 'w':
+        return (pg.access & 0x2) != 0;
+    default:
+        return (pg.access & 0x1) != 0;
+    }
+}
+
+bool CpuRiver_Functional::checkPmpRegions(uint64_t adr, const char *rwx) {
     bool allow = false;
 
     for (int i = 0; i < pmpTotal_.to_int(); i++) {
@@ -630,28 +1211,245 @@ bool CpuRiver_Functional::checkMpu(uint64_t adr, uint32_t size, const char *rwx)
 bool CpuRiver_Functional::isMmuEnabled() {
     csr_satp_type satp;
     uint64_t prv = getPrvLevel();
-    satp.u64 = readCSR(CSR_satp);
+    satp.u64 = csr_[CSR_satp];
     if (prv != PRV_M && satp.bits.mode) {
         return true;
     }
     csr_mstatus_type mstatus;
-    mstatus.value = readCSR(CSR_mstatus);
+    mstatus.value = csr_[CSR_mstatus];
     if (mstatus.bits.MPRV && (mstatus.bits.MPP != PRV_M) && satp.bits.mode) {
         return true;
     }
     return false;
 }
 
-uint64_t CpuRiver_Functional::translateMmu(uint64_t va) {
-    uint64_t pa = va;
-    if ((va >> 48) != 0xFFFF) {
-        // Non-virtual address
-        return pa;
+/**
+ * Translation is cached in TLB, page table is walked only on miss or when
+ * the cached entry doesn't allow the access (also to set D-bit on the first
+ * write). Page fault exception is raised with the virtual address.
+ */
+bool CpuRiver_Functional::translateMmu(uint64_t va, const char *rwx,
+                                       uint64_t *pa) {
+    csr_satp_type satp;
+    csr_mstatus_type mstatus;
+    uint64_t prv = getPrvLevel();
+    satp.u64 = csr_[CSR_satp];
+    mstatus.value = csr_[CSR_mstatus];
+    if (rwx[0] != 'x' && mstatus.bits.MPRV) {
+        prv = mstatus.bits.MPP;
+    }
+    if (prv == PRV_M || satp.bits.mode == SATP_MODE_OFF) {
+        *pa = va;
+        return true;
+    }
+
+    int tlbidx = rwx[0] == 'x' ? TLB_Instr : TLB_Data;
+    TlbType *tlb = &tlb_[tlbidx];
+    uint64_t vpn = va >> 12;
+    TlbEntryType *e = lookupTlb(tlbidx, vpn, satp.bits.asid, rwx, prv);
+    if (e && checkPte(e->pte, rwx, prv)) {
+        *pa = e->pagebase | (va & ((0x1000ull << (9 * e->level)) - 1));
+        tlb->hit++;
+        return true;
+    }
+    tlb->miss++;
+    countHpmEvent(tlbidx == TLB_Instr ? HPM_EVENT_ITLB_MISS
+                                      : HPM_EVENT_DTLB_MISS);
+
+    // The same page with other permissions is removed
+    if (e) {
+        e->vpn = TLB_EMPTY;
+    }
+    TlbEntryType walk;
+    if (!walkPageTable(va, rwx, prv, &walk)) {
+        if (rwx[0] == 'x') {
+            generateException(EXCEPTION_InstrPageFault, va);
+        } else if (rwx[0] == 'w') {
+            generateException(EXCEPTION_StorePageFault, va);
+        } else {
+            generateException(EXCEPTION_LoadPageFault, va);
+        }
+        return false;
+    }
+    uint32_t setidx = static_cast<uint32_t>(
+                        (vpn >> (9 * walk.level)) & (TLB_SETS - 1));
+    e = &tlb->entry[setidx][tlb->next[setidx]];
+    tlb->next[setidx] = (tlb->next[setidx] + 1) & (TLB_WAYS - 1);
+    *e = walk;
+    tlb->levels |= 1u << walk.level;
+    *pa = e->pagebase | (va & ((0x1000ull << (9 * e->level)) - 1));
+    return true;
+}
+
+/**
+ * Entry of the (super)page containing vpn. Superpage entries are placed
+ * into the set selected by the vpn bits above the superpage offset, so
+ * each level stored in the TLB is probed separately.
+ */
+CpuRiver_Functional::TlbEntryType *CpuRiver_Functional::lookupTlb(
+    int tlbidx, uint64_t vpn, uint32_t asid, const char *rwx, uint64_t prv) {
+    TlbType *tlb = &tlb_[tlbidx];
+    for (uint32_t lvl = 0; lvl < TLB_LEVELS; lvl++) {
+        if (!(tlb->levels & (1u << lvl))) {
+            continue;
+        }
+        uint32_t setidx = static_cast<uint32_t>(
+                            (vpn >> (9 * lvl)) & (TLB_SETS - 1));
+        TlbEntryType *e = tlb->entry[setidx];
+        for (int i = 0; i < TLB_WAYS; i++, e++) {
+            if (e->level == lvl
+                && e->vpn == (vpn & e->vpnmask)
+                && (e->asid == asid || (e->pte & PTE_G))) {
+                return e;
+            }
+        }
     }
-    return pa;
+    return 0;
 }
 
-void CpuRiver_Functional::flushMmu() {
+/**
+ * Sv39/Sv48 page table walk. A-bit and, on write, D-bit are set in the
+ * leaf PTE by the walker.
+ */
+bool CpuRiver_Functional::walkPageTable(uint64_t va, const char *rwx,
+                                        uint64_t prv, TlbEntryType *e) {
+    csr_satp_type satp;
+    sv_pte_type pte;
+    satp.u64 = csr_[CSR_satp];
+    int levels = satp.bits.mode == SATP_MODE_SV48 ? 4 : 3;
+    int vabits = 12 + 9 * levels;
+
+    // Upper bits must be equal to the most significant bit of VA
+    if ((static_cast<int64_t>(va << (64 - vabits)) >> (64 - vabits))
+        != static_cast<int64_t>(va)) {
+        return false;
+    }
+
+    uint64_t a = static_cast<uint64_t>(satp.bits.ppn) << 12;
+    uint64_t pteaddr;
+    int i = levels - 1;
+    while (true) {
+        pteaddr = a + 8 * ((va >> (12 + 9 * i)) & 0x1FF);
+        if (!accessPte(pteaddr, &pte.u64, false)) {
+            return false;
+        }
+        if (!pte.bits.V || (!pte.bits.R && pte.bits.W)) {
+            return false;
+        }
+        if (pte.bits.R || pte.bits.X) {
+            break;
+        }
+        if (--i < 0) {
+            return false;
+        }
+        a = static_cast<uint64_t>(pte.bits.ppn) << 12;
+    }
+
+    // Leaf PTE, A and D bits are set below
+    uint64_t vpnmask = (1ull << (9 * i)) - 1;
+    uint32_t flags = static_cast<uint32_t>(pte.u64 & 0xFF) | PTE_A | PTE_D;
+    if (!checkPte(flags, rwx, prv)
+        || (pte.bits.ppn & vpnmask)) {
+        return false;       // no permissions or misaligned superpage
+    }
+    if (!pte.bits.A || (rwx[0] == 'w' && !pte.bits.D)) {
+        pte.bits.A = 1;
+        if (rwx[0] == 'w') {
+            pte.bits.D = 1;
+        }
+        if (!accessPte(pteaddr, &pte.u64, true)) {
+            return false;
+        }
+    }
+
+    e->vpnmask = ~vpnmask;
+    e->vpn = (va >> 12) & e->vpnmask;
+    e->pagebase = (pte.bits.ppn & ~vpnmask) << 12;
+    e->level = static_cast<uint32_t>(i);
+    e->asid = satp.bits.asid;
+    e->pte = static_cast<uint32_t>(pte.u64 & 0xFF);
+    return true;
+}
+
+/**
+ * Leaf PTE permissions for the effective privilege level. Write to the
+ * page without D-bit isn't allowed so that the walker sets it.
+ */
+bool CpuRiver_Functional::checkPte(uint32_t pte, const char *rwx,
+                                   uint64_t prv) {
+    csr_mstatus_type mstatus;
+    mstatus.value = csr_[CSR_mstatus];
+    if (prv == PRV_U && !(pte & PTE_U)) {
+        return false;
+    }
+    // River MMU doesn't check SUM, only S-mode fetch from U-page faults
+    if (prv == PRV_S && (pte & PTE_U) && rwx[0] == 'x') {
+        return false;
+    }
+    if (!(pte & PTE_A)) {
+        return false;
+    }
+    switch (rwx[0]) {
+    case 'x':
+        return (pte & PTE_X) != 0;
+    case 'w':
+        return (pte & PTE_W) && (pte & PTE_D);
+    default:
+        return (pte & PTE_R) || (mstatus.bits.MXR && (pte & PTE_X));
+    }
+}
+
+/** Page table is accessed by physical address without PMP checking */
+bool CpuRiver_Functional::accessPte(uint64_t addr, uint64_t *pte,
+                                    bool write) {
+    Axi4TransactionType tr;
+    tr.source_idx = sysBusMasterID_.to_int();
+    tr.addr = addr;
+    tr.xsize = 8;
+    if (write) {
+        tr.action = MemAction_Write;
+        tr.wstrb = 0xFF;
+        tr.wpayload.b64[0] = *pte;
+    } else {
+        tr.action = MemAction_Read;
+        tr.wstrb = 0;
+    }
+    if (!memoryWindowAccess(&tr) && isysbus_->b_transport(&tr) != TRANS_OK) {
+        return false;
+    }
+    if (!write) {
+        *pte = tr.rpayload.b64[0];
+    }
+    return true;
+}
+
+/**
+ * Global entries are removed only when all ASIDs are flushed. Superpage
+ * entries are matched by any address inside of the superpage.
+ */
+void CpuRiver_Functional::flushTlb(uint64_t va, uint64_t asid) {
+    uint64_t vpn = va >> 12;
+    TlbEntryType *e;
+    for (int n = 0; n < TLB_Total; n++) {
+        if (va == TLB_FLUSH_ALL && asid == TLB_FLUSH_ALL) {
+            tlb_[n].levels = 0;
+        }
+        e = &tlb_[n].entry[0][0];
+        for (int i = 0; i < TLB_SETS * TLB_WAYS; i++, e++) {
+            if (e->vpn == TLB_EMPTY) {
+                continue;
+            }
+            if (va != TLB_FLUSH_ALL
+                && ((e->vpn ^ vpn) & e->vpnmask) != 0) {
+                continue;
+            }
+            if (asid != TLB_FLUSH_ALL
+                && ((e->pte & PTE_G) || e->asid != (asid & 0xFFFF))) {
+                continue;
+            }
+            e->vpn = TLB_EMPTY;
+        }
+    }
 }
 
 }  // namespace debugger
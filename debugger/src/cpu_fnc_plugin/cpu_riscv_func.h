@@ -19,6 +19,8 @@
 
 #include <riscv-isa.h>
 #include "instructions.h"
+#include "jit_x86_64.h"
+#include "timing_model.h"
 #include "generic/cpu_generic.h"
 #include "coreservices/icpuriscv.h"
 #include "coreservices/iirq.h"
@@ -26,7 +28,8 @@
 namespace debugger {
 
 class CpuRiver_Functional : public CpuGeneric,
-                            public ICpuRiscV {
+                            public ICpuRiscV,
+                            public IIrqListener {
  public:
     explicit CpuRiver_Functional(const char *name);
     virtual ~CpuRiver_Functional();
@@ -34,6 +37,15 @@ class CpuRiver_Functional : public CpuGeneric,
     /** IService interface */
     virtual void postinitService();
     virtual void predeleteService();
+    /** Statistic counters are copied into attributes only when read */
+    virtual IAttribute *getAttribute(const char *name) override {
+        exportCounters();
+        return CpuGeneric::getAttribute(name);
+    }
+    virtual AttributeType getConfiguration() override {
+        exportCounters();
+        return CpuGeneric::getConfiguration();
+    }
 
     /** IResetListener interface */
     virtual void reset(IFace *isource);
@@ -48,17 +60,31 @@ class CpuRiver_Functional : public CpuGeneric,
     }
     virtual uint64_t getIrqAddress(int idx) { return readCSR(CSR_mtvec); }
     virtual void generateException(int e, uint64_t arg) override {
+        // Access fault of the failed translation is already a page fault
+        if ((exceptions_ & PAGE_FAULT_MASK) && (e == EXCEPTION_InstrFault
+            || e == EXCEPTION_LoadFault || e == EXCEPTION_StoreFault)) {
+            return;
+        }
         writeCSR(CSR_mtval, arg);
         CpuGeneric::generateException(e, arg);
     }
     virtual void generateExceptionLoadInstruction(uint64_t addr) override {
         generateException(EXCEPTION_InstrFault, addr);
     }
-    virtual bool isMpuEnabled() override;
+    virtual void setPrvLevel(uint64_t lvl) override {
+        cur_prv_level = lvl;
+        updateMpuEnable();
+    }
+    virtual bool isMpuEnabled() override { return pmpActive_; }
     virtual bool checkMpu(uint64_t addr, uint32_t sz, const char *rwx) override;
     virtual bool isMmuEnabled() override;
-    virtual uint64_t translateMmu(uint64_t addr) override;
-    virtual void flushMmu() override;
+    virtual bool translateMmu(uint64_t va, const char *rwx,
+                              uint64_t *pa) override;
+    virtual void flushMmu() override {
+        flushTlb(TLB_FLUSH_ALL, TLB_FLUSH_ALL);
+    }
+    virtual ETransStatus dma_memop(Axi4TransactionType *tr,
+                                   int flags=0) override;
 
 
     /** DPort interface */
@@ -74,19 +100,63 @@ class CpuRiver_Functional : public CpuGeneric,
     virtual void writeGPR(uint32_t regno, uint64_t val) { R[regno] = val; }
     virtual uint64_t readNonStandardReg(uint32_t regno) { return 0; }
     virtual void writeNonStandardReg(uint32_t regno, uint64_t val) {}
-    virtual void mmuAddrReserve(uint64_t addr) override {
+    virtual void mmuAddrReserve(uint64_t addr, uint64_t val) override {
         mmuReservatedAddr_ = addr;
+        mmuReservedValue_ = val;
         mmuReservedAddrWatchdog_ = 64;
     }
-    virtual bool mmuAddrRelease(uint64_t addr) override {
+    virtual bool mmuAddrRelease(uint64_t addr, uint64_t *val) override {
         bool success = 0;
         if (mmuReservedAddrWatchdog_ && mmuReservatedAddr_ == addr) {
             success = true;
+            *val = mmuReservedValue_;
             mmuReservedAddrWatchdog_ = 0;
         }
         return success;
     }
 
+    /** IIrqListener interface */
+    virtual void irqLevelChanged(IFace *isrc, int ctxid, int level);
+
+    /** CSR instruction wrote register, internal updates aren't reported */
+    void notifyCsrWrite(uint32_t regno, uint64_t val) {
+        if (isInstrumented(InstrEvent_CsrWrite)) {
+            instrumentCsrWrite(regno, val);
+        }
+    }
+
+    /** SFENCE.VMA: TLB_FLUSH_ALL removes entries of any address or ASID */
+    static const uint64_t TLB_FLUSH_ALL = ~0ull;
+    void flushTlb(uint64_t va, uint64_t asid);
+
+    /** D-extension arithmetic on the host FPU instead of the River model */
+    bool isHostFpu() { return hostFpu_; }
+    bool isHostFpuCheck() { return hostFpuCheck_; }
+    void reportHostFpuMismatch(const char *instr, uint64_t a, uint64_t b,
+                               uint64_t host, uint64_t model,
+                               uint32_t hostflags, uint32_t modelflags);
+
+    /** V-extension register file, group is placed in consecutive regs */
+    uint32_t getVlenb() { return vlenb_; }
+    uint8_t *getVecReg(uint32_t idx) { return &vregs_[idx * vlenb_]; }
+    /** vsetvl instructions modify read-only CSRs */
+    void setVectorConfig(uint64_t vtype, uint64_t vl) {
+        csr_[CSR_vtype] = vtype;
+        csr_[CSR_vl] = vl;
+    }
+
+    /** Performance-monitor event, mhpmcounter3..31 selecting it count */
+    void countHpmEvent(uint32_t ev) {
+        if (hpmEvents_ & ev) {
+            incrHpmCounters(ev);
+        }
+    }
+
+    /** CSR instructions: lower privilege level can't access the CSR */
+    bool isCsrAccessible(uint32_t regno) {
+        return getPrvLevel() >= csrtbl_[regno & (CSR_TABLE_SIZE - 1)].prv;
+    }
+
  protected:
     /** CpuGeneric common methods */
     virtual EEndianessType endianess() { return LittleEndian; }
@@ -96,34 +166,81 @@ class CpuRiver_Functional : public CpuGeneric,
     virtual void handleInterrupts();
     /** Tack Registers changes during execution */
     virtual void trackContextStart();
+    virtual void trackContextEnd() override;
     /** // Stop tracking and write trace file */
     virtual void traceOutput() override;
     virtual bool isStepEnabled() override;
     virtual void checkStackProtection() override;
+    virtual bool translateBlock(BlockType *blk) override;
+    virtual int executeJit(BlockType *blk) override;
 
     void addIsaUserRV64I();
     void addIsaPrivilegedRV64I();
     void addIsaExtensionA();
+    void addIsaExtensionB();
     void addIsaExtensionC();
     void addIsaExtensionD();
     void addIsaExtensionF();
     void addIsaExtensionM();
+    void addIsaExtensionV();
+    void addIsaExtensionZba();
+    void addIsaExtensionZbb();
+    void addIsaExtensionZbs();
     unsigned addSupportedInstruction(RiscvInstruction *instr);
-    uint32_t hash32(uint32_t val) { return (val >> 2) & 0x1f; }
-    /** Compressed instruction */
-    uint32_t hash16(uint16_t val) {
-        uint32_t t1 = val & 0x3;
-        return 0x20 | ((val >> 13) << 2) | t1;
+    void buildDecodeTables();
+    /** Index of 32-bits instruction: opcode[6:2], funct3 and funct7 */
+    uint32_t decodeIndex32(uint32_t val) {
+        return ((val >> 2) & 0x1f) | (((val >> 12) & 0x7) << 5)
+                | ((val >> 25) << 8);
     }
 
  private:
     void switchContext(uint32_t prvnxt);
+    void updateIrqEnable();
+    void updateIrqAttention();
+    uint64_t pollIrqPending();
+    void buildCsrTable();
+    void exportCounters();
+    struct TlbEntryType;
+    TlbEntryType *lookupTlb(int tlbidx, uint64_t vpn, uint32_t asid,
+                            const char *rwx, uint64_t prv);
+    bool walkPageTable(uint64_t va, const char *rwx, uint64_t prv,
+                       TlbEntryType *e);
+    bool checkPte(uint32_t pte, const char *rwx, uint64_t prv);
+    bool accessPte(uint64_t addr, uint64_t *pte, bool write);
+
+    /** CSR side effects: */
+    uint64_t readCsrStepCounter(uint32_t regno);
+    uint64_t readCsrDpc(uint32_t regno);
+    uint64_t readCsrTrigger(uint32_t regno);
+    uint64_t readCsrTinfo(uint32_t regno);
+    uint64_t readCsrMip(uint32_t regno);
+    uint64_t readCsrVcsr(uint32_t regno);
+    uint64_t readCsrHpmCounter(uint32_t regno);
+    void writeCsrTselect(uint32_t regno, uint64_t val);
+    void writeCsrTrigger(uint32_t regno, uint64_t val);
+    void writeCsrFlushi(uint32_t regno, uint64_t val);
+    void writeCsrPmpcfg(uint32_t regno, uint64_t val);
+    void writeCsrPmpaddr(uint32_t regno, uint64_t val);
+    void writeCsrSatp(uint32_t regno, uint64_t val);
+    void writeCsrMstatus(uint32_t regno, uint64_t val);
+    void writeCsrIrqEnable(uint32_t regno, uint64_t val);
+    void writeCsrDcsr(uint32_t regno, uint64_t val);
+    void writeCsrStackProtect(uint32_t regno, uint64_t val);
+    void writeCsrVcsr(uint32_t regno, uint64_t val);
+    void writeCsrHpmEvent(uint32_t regno, uint64_t val);
+    void incrHpmCounters(uint32_t ev);
+    void chargeTiming(uint32_t ev);
     void disablePmp(uint32_t pmpidx);
     void enablePmp(uint32_t pmpidx,
                     uint64_t startadr,
                     uint64_t endadr,
                     uint32_t rwx,
                     uint32_t lock);
+    void updateMpuEnable();
+    void flushPmpPages();
+    uint32_t pmpPageAccess(uint64_t pageadr);
+    bool checkPmpRegions(uint64_t adr, const char *rwx);
 
  private:
     AttributeType vendorid_;
@@ -134,14 +251,116 @@ class CpuRiver_Functional : public CpuGeneric,
     AttributeType clint_;       // Core-local interruptor
     AttributeType plic_;        // External interrupt controller
     AttributeType pmpTotal_;    // Total number of enabled PMP regions < 64
+    AttributeType jitEnable_;       // translate blocks into host code
+    AttributeType jitThreshold_;    // block replays before translation
+    AttributeType jitCodeSize_;     // bytes of host code buffer
+    AttributeType jitVerify_;       // replay translated code by interpreter
+    AttributeType tlbCounters_;     // ITLB hit/miss, DTLB hit/miss
+    AttributeType fpuHostNative_;   // FPU instructions on host FPU
+    AttributeType fpuSelfTest_;     // compare host FPU with the model
+    AttributeType vlen_;            // bits in a vector register
+    AttributeType timingEnable_;    // cycle-approximate mcycle
+    AttributeType timingICache_;    // [KBytes, ways]
+    AttributeType timingDCache_;
+    AttributeType timingL2Cache_;
+    AttributeType timingBtbSize_;
+    AttributeType timingRasDepth_;
+    AttributeType timingL2Latency_;
+    AttributeType timingMemLatency_;
+    AttributeType timingBranchPenalty_;
+    AttributeType timingMulLatency_;
+    AttributeType timingDivLatency_;
+    AttributeType timingFpuLatency_;
+    AttributeType timingCounters_;  // ETimingCounters
 
-    static const int INSTR_HASH_TABLE_SIZE = 1 << 6;
-    AttributeType listInstr_[INSTR_HASH_TABLE_SIZE];
+    AttributeType listInstr_;       // all instructions in registration order
+
+    // Decoder tables built from the instructions mask/opcode:
+    //   32-bits: index -> null-terminated list of candidates in the pool
+    //   16-bits: direct instruction pointer for each possible halfword
+    static const int DECODE32_TABLE_SIZE = 1 << 15;
+    static const int DECODE16_TABLE_SIZE = 1 << 16;
+    uint32_t *decode32_;
+    RiscvInstruction **decodePool_;
+    RiscvInstruction **decode16_;
+
+    // CSR dispatch table. Value is always kept in portCSR_ storage, hooks
+    // override the read value or make side effects after write.
+    typedef uint64_t (CpuRiver_Functional::*CsrReadHook)(uint32_t regno);
+    typedef void (CpuRiver_Functional::*CsrWriteHook)(uint32_t regno,
+                                                      uint64_t val);
+    enum ECsrFlags {
+        CsrFlag_ReadOnly = 0x1,     // writes are silently ignored
+    };
+    struct CsrType {
+        CsrReadHook rd;
+        CsrWriteHook wr;
+        uint32_t flags;
+        uint32_t prv;               // minimal privilege level
+    };
+    struct CsrListType {
+        uint16_t first;
+        uint16_t last;
+        uint32_t flags;
+        CsrReadHook rd;
+        CsrWriteHook wr;
+    };
+    static const CsrListType CSR_LIST[];
+    static const int CSR_TABLE_SIZE = 1 << 12;
+    CsrType csrtbl_[CSR_TABLE_SIZE];
+    uint64_t *csr_;                 // storage of portCSR_
 
     IIrqController *iirqloc_;
     IIrqController *iirqext_;
+    bool irqPolling_;               // controllers without notifications
+    volatile uint64_t irqPending_;  // mip levels pushed by controllers
+    uint64_t irqEnable_;            // mie if mstatus.MIE is set, 0 otherwise
+    mutex_def mutex_irq_;
+
+    RiscvJitX86_64 jit_;
+    bool hostFpu_;
+    bool hostFpuCheck_;
+    uint32_t vlenb_;
+    uint8_t *vregs_;                // 32 vector registers of vlenb_ bytes
+    uint32_t hpmEvents_;            // events of the not inhibited counters
+    RiverTimingModel timing_;
+    bool timingEna_;
+
+    static const uint64_t PAGE_FAULT_MASK =
+        (1ull << EXCEPTION_InstrPageFault) | (1ull << EXCEPTION_LoadPageFault)
+        | (1ull << EXCEPTION_StorePageFault);
+
+    // Software TLB, separate for instruction fetch and data accesses. One
+    // entry maps the whole (super)page of its level, the set is indexed by
+    // the vpn bits above the page offset so that lookup probes one set per
+    // level present in the TLB.
+    static const int TLB_SETS = 64;
+    static const int TLB_WAYS = 4;
+    static const int TLB_LEVELS = 4;    // Sv48 4 KB, 2 MB, 1 GB, 512 GB
+    enum ETlbType {
+        TLB_Instr,
+        TLB_Data,
+        TLB_Total
+    };
+    struct TlbEntryType {
+        uint64_t vpn;           // va[63:12] & vpnmask, TLB_EMPTY if not used
+        uint64_t pagebase;      // physical address of the (super)page
+        uint64_t vpnmask;       // vpn bits of the (super)page
+        uint32_t level;         // 0 = 4 KB page
+        uint32_t asid;
+        uint32_t pte;           // PTE flags [7:0]
+    };
+    static const uint64_t TLB_EMPTY = ~0ull;
+    struct TlbType {
+        TlbEntryType entry[TLB_SETS][TLB_WAYS];
+        uint32_t next[TLB_SETS];    // round-robin replacement
+        uint32_t levels;            // bit per level of the stored entries
+        uint64_t hit;
+        uint64_t miss;
+    } tlb_[TLB_Total];
 
     uint64_t mmuReservatedAddr_;
+    uint64_t mmuReservedValue_;     // SC swaps only if memory still holds it
     int mmuReservedAddrWatchdog_;   // not exceed 64 instructions between LR/SC
 
     static const int PMP_ENTRIES_MAX = 64;  // limited by RISC-V specification
@@ -154,6 +373,18 @@ class CpuRiver_Functional : public CpuGeneric,
         uint64_t X;
         uint64_t L;
     } pmpTable_;
+    bool pmpActive_;        // PMP checks apply to the current privilege
+
+    // Access rights of the recently checked 4 KB pages in pmpcfg RWX
+    // format. Page partially covered by a region is marked as mixed and
+    // checked by regions on each access.
+    static const int PMP_PAGES = 256;
+    static const uint32_t PMP_PAGE_MIXED = 0x8;
+    static const uint64_t PMP_PAGE_EMPTY = ~0ull;
+    struct PmpPageType {
+        uint64_t pfn;       // adr[63:12], PMP_PAGE_EMPTY if not used
+        uint32_t access;
+    } pmpPages_[PMP_PAGES];
 };
 
 DECLARE_CLASS(CpuRiver_Functional)
@@ -14,6 +14,7 @@
  *  limitations under the License.
  */
 
+#include <string.h>
 #include "api_core.h"
 #include "riscv-isa.h"
 #include "instructions.h"
@@ -21,6 +22,54 @@
 
 namespace debugger {
 
+/** Performance-monitor events generated by each execution */
+static uint32_t hpmInstrEvents(const char *name, uint32_t opcode) {
+    uint32_t funct3 = (opcode >> 12) & 0x7;
+    if ((opcode & 0x3) != 0x3) {
+        funct3 = (opcode >> 13) & 0x7;
+        if (strcmp(name, "C_J") == 0 || strcmp(name, "C_JAL") == 0
+            || strcmp(name, "C_JR") == 0 || strcmp(name, "C_JALR") == 0) {
+            return HPM_EVENT_JUMP;
+        } else if ((opcode & 0x3) == 0x1) {
+            return funct3 >= 6 ? HPM_EVENT_BRANCH : 0;
+        } else if (funct3 >= 1 && funct3 <= 3) {
+            return HPM_EVENT_LOAD;
+        } else if (funct3 >= 5) {
+            return HPM_EVENT_STORE;
+        }
+        return 0;
+    }
+
+    switch (opcode & 0x7F) {
+    case 0x03:  // LOAD
+    case 0x07:  // LOAD-FP, vector loads
+        return HPM_EVENT_LOAD;
+    case 0x23:  // STORE
+    case 0x27:  // STORE-FP, vector stores
+        return HPM_EVENT_STORE;
+    case 0x2F:
+        return HPM_EVENT_AMO;
+    case 0x63:
+        return HPM_EVENT_BRANCH;
+    case 0x67:
+    case 0x6F:
+        return HPM_EVENT_JUMP;
+    case 0x33:  // OP
+    case 0x3B:  // OP-32
+        return (opcode >> 25) == 0x1 ? HPM_EVENT_MULDIV : 0;
+    case 0x43:  // FMADD
+    case 0x47:
+    case 0x4B:
+    case 0x4F:
+    case 0x53:  // OP-FP
+        return HPM_EVENT_FPU;
+    case 0x57:
+        return funct3 == 0x7 ? 0 : HPM_EVENT_VECTOR;
+    default:;
+    }
+    return 0;
+}
+
 RiscvInstruction::RiscvInstruction(CpuRiver_Functional *icpu, const char *name,
                                     const char *bits) {
     icpu_ = icpu;
@@ -43,6 +92,7 @@ RiscvInstruction::RiscvInstruction(CpuRiver_Functional *icpu, const char *name,
         }
     }
     mask_ ^= ~0;
+    hpmevents_ = hpmInstrEvents(name, opcode_);
 }
 
 }  // namespace debugger
@@ -36,20 +36,22 @@ public:
         return ((payload[0] & mask_) == opcode_);
     }
 
-    virtual uint32_t hash() {
-        return (opcode_ >> 2) & 0x1F;
+    /** Non-virtual mask/opcode check used by decoder tables */
+    bool match(uint32_t payload) {
+        return ((payload & mask_) == opcode_);
     }
 
-    uint16_t hash16() {
-        uint16_t t1 = static_cast<uint16_t>(opcode_) & 0x3;
-        return 0x20 | ((static_cast<uint16_t>(opcode_) >> 13) << 2) | t1;
-    }
+    bool isCompressed() { return (opcode_ & 0x3) != 0x3; }
+    uint32_t getMask() { return mask_; }
+    uint32_t getOpcode() { return opcode_; }
+    uint32_t getHpmEvents() { return hpmevents_; }
 
 protected:
     AttributeType name_;
     CpuRiver_Functional *icpu_;
     uint32_t mask_;
     uint32_t opcode_;
+    uint32_t hpmevents_;    // HPM_EVENT_* of each execution
     uint64_t *R;
     uint64_t *RF;
 };
@@ -58,12 +60,6 @@ class RiscvInstruction16 : public RiscvInstruction {
 public:
     RiscvInstruction16(CpuRiver_Functional *icpu, const char *name,
                     const char *bits) : RiscvInstruction(icpu, name, bits) {}
-
-    // IInstruction interface:
-    virtual uint32_t hash() {
-        uint16_t t1 = static_cast<uint16_t>(opcode_) & 0x3;
-        return 0x20 | ((static_cast<uint16_t>(opcode_) >> 13) << 2) | t1;
-    }
 };
 
 
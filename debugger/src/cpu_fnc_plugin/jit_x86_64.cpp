@@ -0,0 +1,752 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <string.h>
+#include "coreservices/icpuriscv.h"
+#include "jit_x86_64.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_X86_64_HOST
+#endif
+
+namespace debugger {
+
+// Host registers
+static const int RAX = 0;
+static const int RCX = 1;
+
+// x86 condition codes
+static const int CC_B  = 0x2;
+static const int CC_AE = 0x3;
+static const int CC_E  = 0x4;
+static const int CC_NE = 0x5;
+static const int CC_L  = 0xC;
+static const int CC_GE = 0xD;
+
+// Group 1 (0x81) and group 2 (0xC1/0xD3) extension codes
+static const int ALU_ADD = 0;
+static const int ALU_OR  = 1;
+static const int ALU_AND = 4;
+static const int ALU_XOR = 6;
+static const int ALU_CMP = 7;
+static const int SHIFT_SHL = 4;
+static const int SHIFT_SHR = 5;
+static const int SHIFT_SAR = 7;
+
+// Register-register ALU opcodes 'op r/m, r'
+static const uint8_t OPC_ADD = 0x01;
+static const uint8_t OPC_OR  = 0x09;
+static const uint8_t OPC_AND = 0x21;
+static const uint8_t OPC_SUB = 0x29;
+static const uint8_t OPC_XOR = 0x31;
+
+// Worst case code size of one instruction and of the prologue with exit
+static const uint64_t JIT_INSTR_MAX = 128;
+static const uint64_t JIT_BLOCK_MAX = 64;
+
+enum EJitOp {
+    Op_ADD, Op_SUB, Op_AND, Op_OR, Op_XOR, Op_SLL, Op_SRL, Op_SRA,
+    Op_SLT, Op_SLTU, Op_ADDW, Op_SUBW, Op_SLLW, Op_SRLW, Op_SRAW,
+    Op_MUL, Op_MULW,
+    Op_ADDI, Op_ANDI, Op_ORI, Op_XORI, Op_SLTI, Op_SLTIU, Op_SLLI,
+    Op_SRLI, Op_SRAI, Op_ADDIW, Op_SLLIW, Op_SRLIW, Op_SRAIW,
+    Op_LUI, Op_AUIPC,
+    Op_BEQ, Op_BNE, Op_BLT, Op_BGE, Op_BLTU, Op_BGEU, Op_JAL, Op_JALR,
+    Op_C_ADD, Op_C_ADDI, Op_C_ADDI16SP, Op_C_ADDI4SPN, Op_C_ADDIW,
+    Op_C_ADDW, Op_C_AND, Op_C_ANDI, Op_C_LI, Op_C_LUI, Op_C_MV, Op_C_NOP,
+    Op_C_OR, Op_C_SLLI, Op_C_SRAI, Op_C_SRLI, Op_C_SUB, Op_C_SUBW,
+    Op_C_XOR, Op_C_BEQZ, Op_C_BNEZ, Op_C_J, Op_C_JR,
+    Op_Total
+};
+
+static const char *const JIT_OP_NAMES[Op_Total] = {
+    "ADD", "SUB", "AND", "OR", "XOR", "SLL", "SRL", "SRA",
+    "SLT", "SLTU", "ADDW", "SUBW", "SLLW", "SRLW", "SRAW",
+    "MUL", "MULW",
+    "ADDI", "ANDI", "ORI", "XORI", "SLTI", "SLTIU", "SLLI",
+    "SRLI", "SRAI", "ADDIW", "SLLIW", "SRLIW", "SRAIW",
+    "LUI", "AUIPC",
+    "BEQ", "BNE", "BLT", "BGE", "BLTU", "BGEU", "JAL", "JALR",
+    "C_ADD", "C_ADDI", "C_ADDI16SP", "C_ADDI4SPN", "C_ADDIW",
+    "C_ADDW", "C_AND", "C_ANDI", "C_LI", "C_LUI", "C_MV", "C_NOP",
+    "C_OR", "C_SLLI", "C_SRAI", "C_SRLI", "C_SUB", "C_SUBW",
+    "C_XOR", "C_BEQZ", "C_BNEZ", "C_J", "C_JR"
+};
+
+static int findJitOp(const char *name) {
+    for (int i = 0; i < Op_Total; i++) {
+        if (strcmp(name, JIT_OP_NAMES[i]) == 0) {
+            return i;
+        }
+    }
+    return Op_Total;
+}
+
+static int64_t sext(uint64_t v, int bits) {
+    return static_cast<int64_t>(v << (64 - bits)) >> (64 - bits);
+}
+
+static bool isInt32(int64_t v) {
+    return v == static_cast<int64_t>(static_cast<int32_t>(v));
+}
+
+RiscvJitX86_64::RiscvJitX86_64() {
+    code_ = 0;
+    size_ = 0;
+    pos_ = 0;
+    full_ = false;
+}
+
+RiscvJitX86_64::~RiscvJitX86_64() {
+    if (code_) {
+        RISCV_exec_free(code_, size_);
+    }
+}
+
+bool RiscvJitX86_64::init(uint64_t sz) {
+#ifdef JIT_X86_64_HOST
+    if (code_) {
+        RISCV_exec_free(code_, size_);
+    }
+    code_ = static_cast<uint8_t *>(RISCV_exec_malloc(sz));
+    size_ = code_ ? sz : 0;
+    flush();
+    if (code_ && RISCV_exec_protect(code_, size_, 1) != 0) {
+        RISCV_exec_free(code_, size_);
+        code_ = 0;
+        size_ = 0;
+    }
+    return code_ != 0;
+#else
+    return false;
+#endif
+}
+
+JitBlockFunc RiscvJitX86_64::translate(uint64_t addr,
+                                       const char *const *names,
+                                       const uint32_t *payload, int total,
+                                       int *translated) {
+    ETranslateResult res = Translate_None;
+    uint64_t start = pos_;
+    uint64_t pc = addr;
+    uint64_t lastpc = addr;
+    int cnt;
+
+    *translated = 0;
+    if (code_ == 0) {
+        return 0;
+    }
+    if (pos_ + static_cast<uint64_t>(total) * JIT_INSTR_MAX
+        + JIT_BLOCK_MAX > size_) {
+        full_ = true;
+        return 0;
+    }
+
+    // Code buffer is writable only while the block is being emitted
+    if (RISCV_exec_protect(code_, size_, 0) != 0) {
+        return 0;
+    }
+    emitPrologue();
+    for (cnt = 0; cnt < total; cnt++) {
+        res = translateInstr(names[cnt], payload[cnt], pc, cnt);
+        if (res == Translate_None) {
+            break;
+        }
+        lastpc = pc;
+        pc += (payload[cnt] & 0x3) == 0x3 ? 4 : 2;
+        if (res == Translate_Exit) {
+            cnt++;
+            break;
+        }
+    }
+    if (cnt == 0) {
+        pos_ = start;
+    } else if (res != Translate_Exit) {
+        // Continue from the first not translated instruction
+        emitMovImm(RAX, pc);
+        emitExit(lastpc, cnt);
+    }
+    if (RISCV_exec_protect(code_, size_, 1) != 0 || cnt == 0) {
+        pos_ = start;
+        return 0;
+    }
+    *translated = cnt;
+    return reinterpret_cast<JitBlockFunc>(&code_[start]);
+}
+
+/**
+ * Host code of each instruction must match the interpreter exactly. Stack
+ * trace is updated by calls and returns so they are never translated.
+ */
+RiscvJitX86_64::ETranslateResult
+RiscvJitX86_64::translateInstr(const char *name, uint32_t op, uint64_t pc,
+                               int cnt) {
+    int rd = (op >> 7) & 0x1F;
+    int rs1 = (op >> 15) & 0x1F;
+    int rs2 = (op >> 20) & 0x1F;
+    int64_t imm = sext(op >> 20, 12);
+    // Compressed formats
+    int crd = (op >> 7) & 0x1F;                 // rd/rs1 [11:7]
+    int crs2 = (op >> 2) & 0x1F;                // rs2 [6:2]
+    int cprs1 = 8 + ((op >> 7) & 0x7);          // rs1'/rd' [9:7]
+    int cprs2 = 8 + ((op >> 2) & 0x7);          // rs2'/rd' [4:2]
+    int64_t cimm = sext(((op >> 7) & 0x20) | ((op >> 2) & 0x1F), 6);
+    int cshamt = static_cast<int>(((op >> 7) & 0x20) | ((op >> 2) & 0x1F));
+    uint64_t off;
+
+    switch (findJitOp(name)) {
+    case Op_ADD:
+        emitAluRR(OPC_ADD, rd, rs1, rs2, false);
+        break;
+    case Op_SUB:
+        emitAluRR(OPC_SUB, rd, rs1, rs2, false);
+        break;
+    case Op_AND:
+        emitAluRR(OPC_AND, rd, rs1, rs2, false);
+        break;
+    case Op_OR:
+        emitAluRR(OPC_OR, rd, rs1, rs2, false);
+        break;
+    case Op_XOR:
+        emitAluRR(OPC_XOR, rd, rs1, rs2, false);
+        break;
+    case Op_SLL:
+        emitShiftRR(SHIFT_SHL, rd, rs1, rs2, false);
+        break;
+    case Op_SRL:
+        emitShiftRR(SHIFT_SHR, rd, rs1, rs2, false);
+        break;
+    case Op_SRA:
+        emitShiftRR(SHIFT_SAR, rd, rs1, rs2, false);
+        break;
+    case Op_SLT:
+        emitSetRR(CC_L, rd, rs1, rs2);
+        break;
+    case Op_SLTU:
+        emitSetRR(CC_B, rd, rs1, rs2);
+        break;
+    case Op_ADDW:
+        emitAluRR(OPC_ADD, rd, rs1, rs2, true);
+        break;
+    case Op_SUBW:
+        emitAluRR(OPC_SUB, rd, rs1, rs2, true);
+        break;
+    case Op_SLLW:
+        emitShiftRR(SHIFT_SHL, rd, rs1, rs2, true);
+        break;
+    case Op_SRLW:
+        emitShiftRR(SHIFT_SHR, rd, rs1, rs2, true);
+        break;
+    case Op_SRAW:
+        emitShiftRR(SHIFT_SAR, rd, rs1, rs2, true);
+        break;
+    case Op_MUL:
+        emitMulRR(rd, rs1, rs2, false);
+        break;
+    case Op_MULW:
+        emitMulRR(rd, rs1, rs2, true);
+        break;
+    case Op_ADDI:
+        emitAluRI(ALU_ADD, rd, rs1, imm, false);
+        break;
+    case Op_ANDI:
+        emitAluRI(ALU_AND, rd, rs1, imm, false);
+        break;
+    case Op_ORI:
+        emitAluRI(ALU_OR, rd, rs1, imm, false);
+        break;
+    case Op_XORI:
+        emitAluRI(ALU_XOR, rd, rs1, imm, false);
+        break;
+    case Op_SLTI:
+        emitSetRI(CC_L, rd, rs1, imm);
+        break;
+    case Op_SLTIU:
+        emitSetRI(CC_B, rd, rs1, imm);
+        break;
+    case Op_SLLI:
+        emitShiftRI(SHIFT_SHL, rd, rs1, rs2 | ((op >> 20) & 0x20), false);
+        break;
+    case Op_SRLI:
+        emitShiftRI(SHIFT_SHR, rd, rs1, rs2 | ((op >> 20) & 0x20), false);
+        break;
+    case Op_SRAI:
+        emitShiftRI(SHIFT_SAR, rd, rs1, rs2 | ((op >> 20) & 0x20), false);
+        break;
+    case Op_ADDIW:
+        emitAluRI(ALU_ADD, rd, rs1, imm, true);
+        break;
+    case Op_SLLIW:
+        emitShiftRI(SHIFT_SHL, rd, rs1, rs2, true);
+        break;
+    case Op_SRLIW:
+        emitShiftRI(SHIFT_SHR, rd, rs1, rs2, true);
+        break;
+    case Op_SRAIW:
+        emitShiftRI(SHIFT_SAR, rd, rs1, rs2, true);
+        break;
+    case Op_LUI:
+        emitLoadConst(rd, sext(op & 0xFFFFF000, 32));
+        break;
+    case Op_AUIPC:
+        emitLoadConst(rd, pc + sext(op & 0xFFFFF000, 32));
+        break;
+
+    case Op_BEQ:
+    case Op_BNE:
+    case Op_BLT:
+    case Op_BGE:
+    case Op_BLTU:
+    case Op_BGEU:
+        off = sext(((op >> 19) & 0x1000) | ((op << 4) & 0x800)
+                 | ((op >> 20) & 0x7E0) | ((op >> 7) & 0x1E), 13);
+        if (off == 0) {
+            // Self-loop stays interpreted for the idle skipping
+            return Translate_None;
+        }
+        switch (findJitOp(name)) {
+        case Op_BEQ:
+            emitBranch(CC_E, rs1, rs2, pc, pc + off, cnt);
+            break;
+        case Op_BNE:
+            emitBranch(CC_NE, rs1, rs2, pc, pc + off, cnt);
+            break;
+        case Op_BLT:
+            emitBranch(CC_L, rs1, rs2, pc, pc + off, cnt);
+            break;
+        case Op_BGE:
+            emitBranch(CC_GE, rs1, rs2, pc, pc + off, cnt);
+            break;
+        case Op_BLTU:
+            emitBranch(CC_B, rs1, rs2, pc, pc + off, cnt);
+            break;
+        default:
+            emitBranch(CC_AE, rs1, rs2, pc, pc + off, cnt);
+        }
+        break;
+    case Op_JAL:
+        if (rd == ICpuRiscV::Reg_ra) {
+            return Translate_None;
+        }
+        off = sext(((op >> 11) & 0x100000) | (op & 0xFF000)
+                 | ((op >> 9) & 0x800) | ((op >> 20) & 0x7FE), 21);
+        if (off == 0) {
+            return Translate_None;
+        }
+        emitLoadConst(rd, pc + 4);
+        emitMovImm(RAX, pc + off);
+        emitExit(pc, cnt + 1);
+        return Translate_Exit;
+    case Op_JALR:
+        if (rd == ICpuRiscV::Reg_ra
+            || (imm == 0 && rs1 == ICpuRiscV::Reg_ra)) {
+            return Translate_None;
+        }
+        emitLoadReg(RAX, rs1);
+        if (imm) {
+            emitAluRI(ALU_ADD, -1, -1, imm, false);
+        }
+        emit8(0x48);            // and rax, ~1
+        emit8(0x83);
+        emit8(0xE0);
+        emit8(0xFE);
+        if (rd) {
+            emitMovImm(RCX, pc + 4);
+            emitStoreReg(rd, RCX);
+        }
+        emitExit(pc, cnt + 1);
+        return Translate_Exit;
+
+    case Op_C_ADD:
+        emitAluRR(OPC_ADD, crd, crd, crs2, false);
+        break;
+    case Op_C_ADDI:
+        emitAluRI(ALU_ADD, crd, crd, cimm, false);
+        break;
+    case Op_C_ADDI16SP:
+        off = sext(((op >> 3) & 0x200) | ((op >> 2) & 0x10)
+                 | ((op << 1) & 0x40) | ((op << 4) & 0x180)
+                 | ((op << 3) & 0x20), 10);
+        emitAluRI(ALU_ADD, ICpuRiscV::Reg_sp, ICpuRiscV::Reg_sp, off, false);
+        break;
+    case Op_C_ADDI4SPN:
+        off = ((op >> 7) & 0x30) | ((op >> 1) & 0x3C0)
+            | ((op >> 4) & 0x4) | ((op >> 2) & 0x8);
+        emitAluRI(ALU_ADD, cprs2, ICpuRiscV::Reg_sp, off, false);
+        break;
+    case Op_C_ADDIW:
+        emitAluRI(ALU_ADD, crd, crd, cimm, true);
+        break;
+    case Op_C_ADDW:
+        emitAluRR(OPC_ADD, cprs1, cprs1, cprs2, true);
+        break;
+    case Op_C_AND:
+        emitAluRR(OPC_AND, cprs1, cprs1, cprs2, false);
+        break;
+    case Op_C_ANDI:
+        emitAluRI(ALU_AND, cprs1, cprs1, cimm, false);
+        break;
+    case Op_C_LI:
+        emitLoadConst(crd, cimm);
+        break;
+    case Op_C_LUI:
+        emitLoadConst(crd, static_cast<uint64_t>(cimm) << 12);
+        break;
+    case Op_C_MV:
+        emitLoadReg(RAX, crs2);
+        emitStoreReg(crd, RAX);
+        break;
+    case Op_C_NOP:
+        break;
+    case Op_C_OR:
+        emitAluRR(OPC_OR, cprs1, cprs1, cprs2, false);
+        break;
+    case Op_C_SLLI:
+        emitShiftRI(SHIFT_SHL, crd, crd, cshamt, false);
+        break;
+    case Op_C_SRAI:
+        emitShiftRI(SHIFT_SAR, cprs1, cprs1, cshamt, false);
+        break;
+    case Op_C_SRLI:
+        emitShiftRI(SHIFT_SHR, cprs1, cprs1, cshamt, false);
+        break;
+    case Op_C_SUB:
+        emitAluRR(OPC_SUB, cprs1, cprs1, cprs2, false);
+        break;
+    case Op_C_SUBW:
+        emitAluRR(OPC_SUB, cprs1, cprs1, cprs2, true);
+        break;
+    case Op_C_XOR:
+        emitAluRR(OPC_XOR, cprs1, cprs1, cprs2, false);
+        break;
+    case Op_C_BEQZ:
+    case Op_C_BNEZ:
+        off = sext(((op >> 4) & 0x100) | ((op << 1) & 0xC0)
+                 | ((op << 3) & 0x20) | ((op >> 7) & 0x18)
+                 | ((op >> 2) & 0x6), 9);
+        if (off == 0) {
+            return Translate_None;
+        }
+        emitBranch(findJitOp(name) == Op_C_BEQZ ? CC_E : CC_NE,
+                   cprs1, 0, pc, pc + off, cnt);
+        break;
+    case Op_C_J:
+        off = sext(((op >> 1) & 0x800) | ((op >> 7) & 0x10)
+                 | ((op >> 1) & 0x300) | ((op << 2) & 0x400)
+                 | ((op >> 1) & 0x40) | ((op << 1) & 0x80)
+                 | ((op >> 2) & 0xE) | ((op << 3) & 0x20), 12);
+        if (off == 0) {
+            return Translate_None;
+        }
+        emitMovImm(RAX, pc + off);
+        emitExit(pc, cnt + 1);
+        return Translate_Exit;
+    case Op_C_JR:
+        if (crd == ICpuRiscV::Reg_ra) {
+            return Translate_None;
+        }
+        emitLoadReg(RAX, crd);
+        emitExit(pc, cnt + 1);
+        return Translate_Exit;
+    default:
+        return Translate_None;
+    }
+    return Translate_Next;
+}
+
+void RiscvJitX86_64::emit32(uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        emit8(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+void RiscvJitX86_64::emit64(uint64_t v) {
+    emit32(static_cast<uint32_t>(v));
+    emit32(static_cast<uint32_t>(v >> 32));
+}
+
+/**
+ * Generated function is called with the register bank pointer in rdi and
+ * the output pc pair pointer in rsi (rcx and rdx on Windows).
+ */
+void RiscvJitX86_64::emitPrologue() {
+#if defined(_WIN32)
+    emit8(0x57);                // push rdi
+    emit8(0x56);                // push rsi
+    emit8(0x48);                // mov rdi, rcx
+    emit8(0x89);
+    emit8(0xCF);
+    emit8(0x48);                // mov rsi, rdx
+    emit8(0x89);
+    emit8(0xD6);
+#endif
+}
+
+void RiscvJitX86_64::emitEpilogue() {
+#if defined(_WIN32)
+    emit8(0x5E);                // pop rsi
+    emit8(0x5F);                // pop rdi
+#endif
+    emit8(0xC3);                // ret
+}
+
+/** mov hreg, [rdi + 8*r] */
+void RiscvJitX86_64::emitLoadReg(int hreg, int r) {
+    if (r == 0) {
+        emit8(0x31);            // xor hreg32, hreg32
+        emit8(static_cast<uint8_t>(0xC0 | (hreg << 3) | hreg));
+        return;
+    }
+    emit8(0x48);
+    emit8(0x8B);
+    if (r < 16) {
+        emit8(static_cast<uint8_t>(0x47 | (hreg << 3)));
+        emit8(static_cast<uint8_t>(8 * r));
+    } else {
+        emit8(static_cast<uint8_t>(0x87 | (hreg << 3)));
+        emit32(static_cast<uint32_t>(8 * r));
+    }
+}
+
+/** mov [rdi + 8*r], hreg. Writes into x0 are ignored */
+void RiscvJitX86_64::emitStoreReg(int r, int hreg) {
+    if (r == 0) {
+        return;
+    }
+    emit8(0x48);
+    emit8(0x89);
+    if (r < 16) {
+        emit8(static_cast<uint8_t>(0x47 | (hreg << 3)));
+        emit8(static_cast<uint8_t>(8 * r));
+    } else {
+        emit8(static_cast<uint8_t>(0x87 | (hreg << 3)));
+        emit32(static_cast<uint32_t>(8 * r));
+    }
+}
+
+void RiscvJitX86_64::emitMovImm(int hreg, uint64_t v) {
+    if (isInt32(static_cast<int64_t>(v))) {
+        emit8(0x48);            // mov r64, simm32
+        emit8(0xC7);
+        emit8(static_cast<uint8_t>(0xC0 | hreg));
+        emit32(static_cast<uint32_t>(v));
+    } else if ((v >> 32) == 0) {
+        emit8(static_cast<uint8_t>(0xB8 | hreg));   // mov r32, imm32
+        emit32(static_cast<uint32_t>(v));
+    } else {
+        emit8(0x48);            // mov r64, imm64
+        emit8(static_cast<uint8_t>(0xB8 | hreg));
+        emit64(v);
+    }
+}
+
+void RiscvJitX86_64::emitLoadConst(int rd, uint64_t v) {
+    if (rd == 0) {
+        return;
+    }
+    emitMovImm(RAX, v);
+    emitStoreReg(rd, RAX);
+}
+
+/** 32-bit forms sign extend the result into 64-bit register */
+static const uint8_t MOVSXD_RAX_EAX[] = {0x48, 0x63, 0xC0};
+
+void RiscvJitX86_64::emitAluRR(uint8_t opcode, int rd, int rs1, int rs2,
+                               bool w) {
+    if (rd == 0) {
+        return;
+    }
+    emitLoadReg(RAX, rs1);
+    emitLoadReg(RCX, rs2);
+    if (!w) {
+        emit8(0x48);
+    }
+    emit8(opcode);              // op rax, rcx
+    emit8(0xC8);
+    if (w) {
+        for (unsigned i = 0; i < sizeof(MOVSXD_RAX_EAX); i++) {
+            emit8(MOVSXD_RAX_EAX[i]);
+        }
+    }
+    emitStoreReg(rd, RAX);
+}
+
+/**
+ * Immediate is sign extended. Negative rd and rs1 operate on rax without
+ * register bank access.
+ */
+void RiscvJitX86_64::emitAluRI(int ext, int rd, int rs1, int64_t imm,
+                               bool w) {
+    if (rd == 0) {
+        return;
+    }
+    if (rs1 >= 0) {
+        emitLoadReg(RAX, rs1);
+    }
+    if (!w) {
+        emit8(0x48);
+    }
+    emit8(0x81);                // op rax, simm32
+    emit8(static_cast<uint8_t>(0xC0 | (ext << 3)));
+    emit32(static_cast<uint32_t>(imm));
+    if (w) {
+        for (unsigned i = 0; i < sizeof(MOVSXD_RAX_EAX); i++) {
+            emit8(MOVSXD_RAX_EAX[i]);
+        }
+    }
+    if (rd > 0) {
+        emitStoreReg(rd, RAX);
+    }
+}
+
+/** Host masks shift amount to 6 bits (5 bits in 32-bit form) as RISC-V */
+void RiscvJitX86_64::emitShiftRR(int ext, int rd, int rs1, int rs2,
+                                 bool w) {
+    if (rd == 0) {
+        return;
+    }
+    emitLoadReg(RAX, rs1);
+    emitLoadReg(RCX, rs2);
+    if (!w) {
+        emit8(0x48);
+    }
+    emit8(0xD3);                // shift rax, cl
+    emit8(static_cast<uint8_t>(0xC0 | (ext << 3)));
+    if (w) {
+        for (unsigned i = 0; i < sizeof(MOVSXD_RAX_EAX); i++) {
+            emit8(MOVSXD_RAX_EAX[i]);
+        }
+    }
+    emitStoreReg(rd, RAX);
+}
+
+void RiscvJitX86_64::emitShiftRI(int ext, int rd, int rs1, int shamt,
+                                 bool w) {
+    if (rd == 0) {
+        return;
+    }
+    emitLoadReg(RAX, rs1);
+    if (!w) {
+        emit8(0x48);
+    }
+    emit8(0xC1);                // shift rax, imm8
+    emit8(static_cast<uint8_t>(0xC0 | (ext << 3)));
+    emit8(static_cast<uint8_t>(shamt & (w ? 0x1F : 0x3F)));
+    if (w) {
+        for (unsigned i = 0; i < sizeof(MOVSXD_RAX_EAX); i++) {
+            emit8(MOVSXD_RAX_EAX[i]);
+        }
+    }
+    emitStoreReg(rd, RAX);
+}
+
+void RiscvJitX86_64::emitMulRR(int rd, int rs1, int rs2, bool w) {
+    if (rd == 0) {
+        return;
+    }
+    emitLoadReg(RAX, rs1);
+    emitLoadReg(RCX, rs2);
+    if (!w) {
+        emit8(0x48);
+    }
+    emit8(0x0F);                // imul rax, rcx
+    emit8(0xAF);
+    emit8(0xC1);
+    if (w) {
+        for (unsigned i = 0; i < sizeof(MOVSXD_RAX_EAX); i++) {
+            emit8(MOVSXD_RAX_EAX[i]);
+        }
+    }
+    emitStoreReg(rd, RAX);
+}
+
+void RiscvJitX86_64::emitSetRR(int cc, int rd, int rs1, int rs2) {
+    if (rd == 0) {
+        return;
+    }
+    emitLoadReg(RAX, rs1);
+    emitLoadReg(RCX, rs2);
+    emit8(0x48);                // cmp rax, rcx
+    emit8(0x39);
+    emit8(0xC8);
+    emit8(0x0F);                // setcc al
+    emit8(static_cast<uint8_t>(0x90 | cc));
+    emit8(0xC0);
+    emit8(0x0F);                // movzx eax, al
+    emit8(0xB6);
+    emit8(0xC0);
+    emitStoreReg(rd, RAX);
+}
+
+void RiscvJitX86_64::emitSetRI(int cc, int rd, int rs1, int64_t imm) {
+    if (rd == 0) {
+        return;
+    }
+    emitLoadReg(RAX, rs1);
+    emit8(0x48);                // cmp rax, simm32
+    emit8(0x81);
+    emit8(static_cast<uint8_t>(0xC0 | (ALU_CMP << 3)));
+    emit32(static_cast<uint32_t>(imm));
+    emit8(0x0F);                // setcc al
+    emit8(static_cast<uint8_t>(0x90 | cc));
+    emit8(0xC0);
+    emit8(0x0F);                // movzx eax, al
+    emit8(0xB6);
+    emit8(0xC0);
+    emitStoreReg(rd, RAX);
+}
+
+/** Exit with npc when taken, otherwise continue with the next instruction */
+void RiscvJitX86_64::emitBranch(int cc, int rs1, int rs2, uint64_t pc,
+                                uint64_t npc, int cnt) {
+    uint64_t rel;
+    emitLoadReg(RAX, rs1);
+    emitLoadReg(RCX, rs2);
+    emit8(0x48);                // cmp rax, rcx
+    emit8(0x39);
+    emit8(0xC8);
+    emit8(0x0F);                // jncc rel32
+    emit8(static_cast<uint8_t>(0x80 | (cc ^ 0x1)));
+    rel = pos_;
+    emit32(0);
+    emitMovImm(RAX, npc);
+    emitExit(pc, cnt + 1);
+    uint32_t dist = static_cast<uint32_t>(pos_ - (rel + 4));
+    for (int i = 0; i < 4; i++) {
+        code_[rel + i] = static_cast<uint8_t>(dist >> (8 * i));
+    }
+}
+
+/**
+ * Return number of executed instructions, pc of the last one and npc
+ * (already in rax).
+ */
+void RiscvJitX86_64::emitExit(uint64_t pc, int cnt) {
+    emitMovImm(RCX, pc);
+    emit8(0x48);                // mov [rsi], rcx
+    emit8(0x89);
+    emit8(0x0E);
+    emit8(0x48);                // mov [rsi + 8], rax
+    emit8(0x89);
+    emit8(0x46);
+    emit8(0x08);
+    emit8(0xB8);                // mov eax, cnt
+    emit32(static_cast<uint32_t>(cnt));
+    emitEpilogue();
+}
+
+}  // namespace debugger
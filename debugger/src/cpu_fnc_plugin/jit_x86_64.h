@@ -0,0 +1,104 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_CPU_FNC_PLUGIN_JIT_X86_64_H__
+#define __DEBUGGER_SRC_CPU_FNC_PLUGIN_JIT_X86_64_H__
+
+#include <inttypes.h>
+#include "generic/cpu_generic.h"
+
+namespace debugger {
+
+/**
+ * Translator of the predecoded RISC-V blocks into x86-64 host code.
+ *
+ * Only integer register-to-register instructions, constants and control
+ * transfers are translated. Translation stops on the first instruction
+ * that accesses memory, CSR or FPU so that the rest of the block is
+ * interpreted. Translated blocks aren't chained with each other, each
+ * block returns into the block dispatcher. Generated code is placed into
+ * the single buffer which is dropped entirely when full. The buffer is
+ * executable or writable but never both.
+ */
+class RiscvJitX86_64 {
+ public:
+    RiscvJitX86_64();
+    ~RiscvJitX86_64();
+
+    /** Allocate code buffer, false if host isn't supported */
+    bool init(uint64_t sz);
+
+    /**
+     * Translate the longest supported prefix of the block.
+     *
+     * @param[in] addr Address of the first instruction
+     * @param[in] names Names of the decoded instructions
+     * @param[in] payload Instructions opcodes
+     * @param[in] total Number of instructions in the block
+     * @param[out] translated Number of translated instructions
+     * @return Entry point or 0 if nothing was translated
+     */
+    JitBlockFunc translate(uint64_t addr, const char *const *names,
+                           const uint32_t *payload, int total,
+                           int *translated);
+
+    /** Not enough space for the next block, all code should be dropped */
+    bool isFull() { return full_; }
+    void flush() {
+        pos_ = 0;
+        full_ = false;
+    }
+
+ private:
+    enum ETranslateResult {
+        Translate_None,     // unsupported instruction
+        Translate_Next,     // continue with the next instruction
+        Translate_Exit      // unconditional control transfer
+    };
+
+    ETranslateResult translateInstr(const char *name, uint32_t op,
+                                    uint64_t pc, int cnt);
+
+    void emit8(uint8_t v) { code_[pos_++] = v; }
+    void emit32(uint32_t v);
+    void emit64(uint64_t v);
+    void emitPrologue();
+    void emitEpilogue();
+    void emitLoadReg(int hreg, int r);
+    void emitStoreReg(int r, int hreg);
+    void emitMovImm(int hreg, uint64_t v);
+    void emitAluRR(uint8_t opcode, int rd, int rs1, int rs2, bool w);
+    void emitAluRI(int ext, int rd, int rs1, int64_t imm, bool w);
+    void emitShiftRR(int ext, int rd, int rs1, int rs2, bool w);
+    void emitShiftRI(int ext, int rd, int rs1, int shamt, bool w);
+    void emitMulRR(int rd, int rs1, int rs2, bool w);
+    void emitSetRR(int cc, int rd, int rs1, int rs2);
+    void emitSetRI(int cc, int rd, int rs1, int64_t imm);
+    void emitLoadConst(int rd, uint64_t v);
+    void emitBranch(int cc, int rs1, int rs2, uint64_t pc, uint64_t npc,
+                    int cnt);
+    void emitExit(uint64_t pc, int cnt);
+
+ private:
+    uint8_t *code_;
+    uint64_t size_;
+    uint64_t pos_;
+    bool full_;
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_CPU_FNC_PLUGIN_JIT_X86_64_H__
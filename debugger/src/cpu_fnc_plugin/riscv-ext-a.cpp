@@ -44,37 +44,43 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_R_type u;
+        uint64_t addr, mem, expected, t;
         u.value = payload->buf32[0];
+        addr = R[u.bits.rs1];
+        if (addr & (rvbytes_ - 1)) {
+            // AMO always should generate Store exceptions (spike)
+            icpu_->generateException(ICpuRiscV::EXCEPTION_StoreMisalign, icpu_->getPC());
+            return 4;
+        }
         trans.action = MemAction_Read;
-        trans.addr = R[u.bits.rs1];
+        trans.addr = addr;
         trans.xsize = rvbytes_;
-        if (trans.addr & (rvbytes_ - 1)) {
-            trans.rpayload.b64[0] = 0;
+        if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
             // AMO always should generate Store exceptions (spike)
-            icpu_->generateException(ICpuRiscV::EXCEPTION_StoreMisalign, icpu_->getPC());
-        } else {
-            if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
-                // AMO always should generate Store exceptions (spike)
+            icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
+            return 4;
+        }
+        mem = trans.rpayload.b64[0];
+        if (rvbytes_ == 4) {
+            mem &= 0xFFFFFFFFull;
+        }
+        // Swap fails if another hart has modified the word after it was
+        // read: repeat with the value returned by the swap.
+        do {
+            expected = mem;
+            t = expected;
+            if (rvbytes_ == 4 && (t & 0x80000000ull)) {
+                t |= EXT_SIGN_32;
+            }
+            trans.addr = addr;
+            trans.wpayload.b64[0] = amo_op(R[u.bits.rs2], t);
+            if (icpu_->dma_memop_cas(&trans, expected) == TRANS_ERROR) {
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
-            } else {
-                uint64_t t;
-                trans.action = MemAction_Write;
-                trans.wstrb = (1 << trans.xsize) - 1;
-                if (rvbytes_ == 4) {
-                    t = trans.rpayload.b32[0];
-                    if (t & 0x80000000ull) {
-                        t |= EXT_SIGN_32;
-                    }
-                } else {
-                    t = trans.rpayload.b64[0];
-                }
-                trans.wpayload.b64[0] = amo_op(R[u.bits.rs2], t);
-                if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
-                    icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
-                }
-                icpu_->setReg(u.bits.rd, t);
+                return 4;
             }
-        }
+            mem = trans.rpayload.b64[0];
+        } while (mem != expected);
+        icpu_->setReg(u.bits.rd, t);
         return 4;
     }
  protected:
@@ -323,10 +329,10 @@ public:
             } else {
                 uint64_t t;
                 t = trans.rpayload.b32[0];
+                icpu_->mmuAddrReserve(R[u.bits.rs1], t);
                 if (t & 0x80000000ull) {
                     t |= EXT_SIGN_32;
                 }
-                icpu_->mmuAddrReserve(trans.addr);
                 icpu_->setReg(u.bits.rd, t);
             }
         }
@@ -353,8 +359,8 @@ public:
             if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
                 icpu_->generateException(ICpuRiscV::EXCEPTION_LoadFault, trans.addr);
             } else {
-                icpu_->mmuAddrReserve(trans.addr);
-                icpu_->setReg(u.bits.rd, trans.rpayload.b32[0]);
+                icpu_->mmuAddrReserve(R[u.bits.rs1], trans.rpayload.b64[0]);
+                icpu_->setReg(u.bits.rd, trans.rpayload.b64[0]);
             }
         }
         return 4;
@@ -370,19 +376,19 @@ public:
         Axi4TransactionType trans;
         ISA_R_type u;
         u.value = payload->buf32[0];
+        uint64_t expected;
         bool error = 1;
-        if (icpu_->mmuAddrRelease(R[u.bits.rs1])) {
-            trans.action = MemAction_Write;
+        if (icpu_->mmuAddrRelease(R[u.bits.rs1], &expected)) {
             trans.addr = R[u.bits.rs1];
             trans.xsize = 4;
-            trans.wstrb = (1 << trans.xsize) - 1;
             trans.wpayload.b64[0] = R[u.bits.rs2];
             if (trans.addr & (trans.xsize - 1)) {
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreMisalign, icpu_->getPC());
             } else {
-                if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
+                // Fails if the reserved word was changed by another hart
+                if (icpu_->dma_memop_cas(&trans, expected) == TRANS_ERROR) {
                     icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
-                } else {
+                } else if (trans.rpayload.b64[0] == expected) {
                     error = 0;
                 }
             }
@@ -401,19 +407,19 @@ public:
         Axi4TransactionType trans;
         ISA_R_type u;
         u.value = payload->buf32[0];
+        uint64_t expected;
         bool error = 1;
-        if (icpu_->mmuAddrRelease(R[u.bits.rs1])) {
-            trans.action = MemAction_Write;
+        if (icpu_->mmuAddrRelease(R[u.bits.rs1], &expected)) {
             trans.addr = R[u.bits.rs1];
             trans.xsize = 8;
-            trans.wstrb = (1 << trans.xsize) - 1;
             trans.wpayload.b64[0] = R[u.bits.rs2];
             if (trans.addr & (trans.xsize - 1)) {
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreMisalign, icpu_->getPC());
             } else {
-                if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
+                // Fails if the reserved word was changed by another hart
+                if (icpu_->dma_memop_cas(&trans, expected) == TRANS_ERROR) {
                     icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
-                } else {
+                } else if (trans.rpayload.b64[0] == expected) {
                     error = 0;
                 }
             }
@@ -0,0 +1,883 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * @brief      RISC-V bit-manipulation extensions Zba, Zbb and Zbs.
+ */
+
+#include "api_core.h"
+#include "riscv-isa.h"
+#include "cpu_riscv_func.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace debugger {
+
+/** Host bit instructions (lzcnt/tzcnt/popcnt/bswap) where available */
+static inline uint64_t bitClz64(uint64_t v) {
+    if (v == 0) {
+        return 64;
+    }
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return 63 - idx;
+#else
+    return static_cast<uint64_t>(__builtin_clzll(v));
+#endif
+}
+
+static inline uint64_t bitCtz64(uint64_t v) {
+    if (v == 0) {
+        return 64;
+    }
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return idx;
+#else
+    return static_cast<uint64_t>(__builtin_ctzll(v));
+#endif
+}
+
+static inline uint64_t bitCpop64(uint64_t v) {
+#if defined(_MSC_VER)
+    return __popcnt64(v);
+#else
+    return static_cast<uint64_t>(__builtin_popcountll(v));
+#endif
+}
+
+static inline uint64_t bitRev8(uint64_t v) {
+#if defined(_MSC_VER)
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
+static inline uint64_t bitRol64(uint64_t v, uint32_t sh) {
+    sh &= 0x3F;
+    return sh ? (v << sh) | (v >> (64 - sh)) : v;
+}
+
+static inline uint32_t bitRol32(uint32_t v, uint32_t sh) {
+    sh &= 0x1F;
+    return sh ? (v << sh) | (v >> (32 - sh)) : v;
+}
+
+static inline uint64_t sext32(uint32_t v) {
+    return static_cast<uint64_t>(static_cast<int64_t>(
+                                 static_cast<int32_t>(v)));
+}
+
+/**
+ * @brief Add unsigned word (Zba)
+ */
+class ADD_UW : public RiscvInstruction {
+ public:
+    ADD_UW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ADD_UW",
+                           "0000100??????????000?????0111011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs2 + (rs1 & 0xFFFFFFFFull));
+        return 4;
+    }
+};
+
+/**
+ * @brief Shift left by 1 and add (Zba)
+ */
+class SH1ADD : public RiscvInstruction {
+ public:
+    SH1ADD(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SH1ADD",
+                           "0010000??????????010?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs2 + (rs1 << 1));
+        return 4;
+    }
+};
+
+/**
+ * @brief Shift left by 2 and add (Zba)
+ */
+class SH2ADD : public RiscvInstruction {
+ public:
+    SH2ADD(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SH2ADD",
+                           "0010000??????????100?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs2 + (rs1 << 2));
+        return 4;
+    }
+};
+
+/**
+ * @brief Shift left by 3 and add (Zba)
+ */
+class SH3ADD : public RiscvInstruction {
+ public:
+    SH3ADD(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SH3ADD",
+                           "0010000??????????110?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs2 + (rs1 << 3));
+        return 4;
+    }
+};
+
+/**
+ * @brief Shift unsigned word left by 1 and add (Zba)
+ */
+class SH1ADD_UW : public RiscvInstruction {
+ public:
+    SH1ADD_UW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SH1ADD_UW",
+                           "0010000??????????010?????0111011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs2 + ((rs1 & 0xFFFFFFFFull) << 1));
+        return 4;
+    }
+};
+
+/**
+ * @brief Shift unsigned word left by 2 and add (Zba)
+ */
+class SH2ADD_UW : public RiscvInstruction {
+ public:
+    SH2ADD_UW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SH2ADD_UW",
+                           "0010000??????????100?????0111011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs2 + ((rs1 & 0xFFFFFFFFull) << 2));
+        return 4;
+    }
+};
+
+/**
+ * @brief Shift unsigned word left by 3 and add (Zba)
+ */
+class SH3ADD_UW : public RiscvInstruction {
+ public:
+    SH3ADD_UW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SH3ADD_UW",
+                           "0010000??????????110?????0111011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs2 + ((rs1 & 0xFFFFFFFFull) << 3));
+        return 4;
+    }
+};
+
+/**
+ * @brief Shift left unsigned word immediate (Zba)
+ */
+class SLLI_UW : public RiscvInstruction {
+ public:
+    SLLI_UW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SLLI_UW",
+                           "000010???????????001?????0011011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint32_t sh = u.bits.imm & 0x3F;
+        icpu_->setReg(u.bits.rd, (rs1 & 0xFFFFFFFFull) << sh);
+        return 4;
+    }
+};
+
+/**
+ * @brief AND with inverted operand (Zbb)
+ */
+class ANDN : public RiscvInstruction {
+ public:
+    ANDN(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ANDN", "0100000??????????111?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs1 & ~rs2);
+        return 4;
+    }
+};
+
+/**
+ * @brief OR with inverted operand (Zbb)
+ */
+class ORN : public RiscvInstruction {
+ public:
+    ORN(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ORN", "0100000??????????110?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs1 | ~rs2);
+        return 4;
+    }
+};
+
+/**
+ * @brief Exclusive NOR (Zbb)
+ */
+class XNOR : public RiscvInstruction {
+ public:
+    XNOR(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "XNOR", "0100000??????????100?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, ~(rs1 ^ rs2));
+        return 4;
+    }
+};
+
+/**
+ * @brief Count leading zero bits (Zbb)
+ */
+class CLZ : public RiscvInstruction {
+ public:
+    CLZ(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "CLZ", "011000000000?????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, bitClz64(rs1));
+        return 4;
+    }
+};
+
+/**
+ * @brief Count leading zero bits in word (Zbb)
+ */
+class CLZW : public RiscvInstruction {
+ public:
+    CLZW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "CLZW", "011000000000?????001?????0011011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, bitClz64(rs1 << 32 | 0xFFFFFFFFull));
+        return 4;
+    }
+};
+
+/**
+ * @brief Count trailing zero bits (Zbb)
+ */
+class CTZ : public RiscvInstruction {
+ public:
+    CTZ(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "CTZ", "011000000001?????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, bitCtz64(rs1));
+        return 4;
+    }
+};
+
+/**
+ * @brief Count trailing zero bits in word (Zbb)
+ */
+class CTZW : public RiscvInstruction {
+ public:
+    CTZW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "CTZW", "011000000001?????001?????0011011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, bitCtz64(rs1 | (1ull << 32)));
+        return 4;
+    }
+};
+
+/**
+ * @brief Count set bits (Zbb)
+ */
+class CPOP : public RiscvInstruction {
+ public:
+    CPOP(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "CPOP", "011000000010?????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, bitCpop64(rs1));
+        return 4;
+    }
+};
+
+/**
+ * @brief Count set bits in word (Zbb)
+ */
+class CPOPW : public RiscvInstruction {
+ public:
+    CPOPW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "CPOPW", "011000000010?????001?????0011011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, bitCpop64(rs1 & 0xFFFFFFFFull));
+        return 4;
+    }
+};
+
+/**
+ * @brief Maximum (Zbb)
+ */
+class MAX : public RiscvInstruction {
+ public:
+    MAX(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "MAX", "0000101??????????110?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        uint64_t res =
+            static_cast<int64_t>(rs1) < static_cast<int64_t>(rs2) ? rs2 : rs1;
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Unsigned maximum (Zbb)
+ */
+class MAXU : public RiscvInstruction {
+ public:
+    MAXU(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "MAXU", "0000101??????????111?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs1 < rs2 ? rs2 : rs1);
+        return 4;
+    }
+};
+
+/**
+ * @brief Minimum (Zbb)
+ */
+class MIN : public RiscvInstruction {
+ public:
+    MIN(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "MIN", "0000101??????????100?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        uint64_t res =
+            static_cast<int64_t>(rs1) < static_cast<int64_t>(rs2) ? rs1 : rs2;
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Unsigned minimum (Zbb)
+ */
+class MINU : public RiscvInstruction {
+ public:
+    MINU(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "MINU", "0000101??????????101?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs1 < rs2 ? rs1 : rs2);
+        return 4;
+    }
+};
+
+/**
+ * @brief Sign-extend byte (Zbb)
+ */
+class SEXT_B : public RiscvInstruction {
+ public:
+    SEXT_B(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SEXT_B",
+                           "011000000100?????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        int8_t b = static_cast<int8_t>(rs1);
+        uint64_t res = static_cast<uint64_t>(static_cast<int64_t>(b));
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Sign-extend halfword (Zbb)
+ */
+class SEXT_H : public RiscvInstruction {
+ public:
+    SEXT_H(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "SEXT_H",
+                           "011000000101?????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        int16_t h = static_cast<int16_t>(rs1);
+        uint64_t res = static_cast<uint64_t>(static_cast<int64_t>(h));
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Zero-extend halfword (Zbb)
+ */
+class ZEXT_H : public RiscvInstruction {
+ public:
+    ZEXT_H(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ZEXT_H",
+                           "000010000000?????100?????0111011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, rs1 & 0xFFFFull);
+        return 4;
+    }
+};
+
+/**
+ * @brief Rotate left (Zbb)
+ */
+class ROL : public RiscvInstruction {
+ public:
+    ROL(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ROL", "0110000??????????001?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, bitRol64(rs1, static_cast<uint32_t>(rs2)));
+        return 4;
+    }
+};
+
+/**
+ * @brief Rotate left word (Zbb)
+ */
+class ROLW : public RiscvInstruction {
+ public:
+    ROLW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ROLW", "0110000??????????001?????0111011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        uint64_t res = sext32(bitRol32(static_cast<uint32_t>(rs1),
+                                       static_cast<uint32_t>(rs2)));
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Rotate right (Zbb)
+ */
+class ROR : public RiscvInstruction {
+ public:
+    ROR(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ROR", "0110000??????????101?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        uint64_t res = bitRol64(rs1, 64 - (static_cast<uint32_t>(rs2) & 0x3F));
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Rotate right immediate (Zbb)
+ */
+class RORI : public RiscvInstruction {
+ public:
+    RORI(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "RORI", "011000???????????101?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint32_t sh = u.bits.imm & 0x3F;
+        icpu_->setReg(u.bits.rd, bitRol64(rs1, 64 - sh));
+        return 4;
+    }
+};
+
+/**
+ * @brief Rotate right word immediate (Zbb)
+ */
+class RORIW : public RiscvInstruction {
+ public:
+    RORIW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "RORIW", "0110000??????????101?????0011011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint32_t sh = u.bits.imm & 0x1F;
+        uint64_t res = sext32(bitRol32(static_cast<uint32_t>(rs1), 32 - sh));
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Rotate right word (Zbb)
+ */
+class RORW : public RiscvInstruction {
+ public:
+    RORW(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "RORW", "0110000??????????101?????0111011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        uint32_t sh = 32 - (static_cast<uint32_t>(rs2) & 0x1F);
+        icpu_->setReg(u.bits.rd,
+                      sext32(bitRol32(static_cast<uint32_t>(rs1), sh)));
+        return 4;
+    }
+};
+
+/**
+ * @brief Bitwise OR-combine of bytes (Zbb)
+ */
+class ORC_B : public RiscvInstruction {
+ public:
+    ORC_B(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "ORC_B", "001010000111?????101?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t res = 0;
+        for (int i = 0; i < 8; i++) {
+            if ((rs1 >> (8 * i)) & 0xFF) {
+                res |= 0xFFull << (8 * i);
+            }
+        }
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+};
+
+/**
+ * @brief Byte-reverse register (Zbb)
+ */
+class REV8 : public RiscvInstruction {
+ public:
+    REV8(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "REV8", "011010111000?????101?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        icpu_->setReg(u.bits.rd, bitRev8(rs1));
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit clear (Zbs)
+ */
+class BCLR : public RiscvInstruction {
+ public:
+    BCLR(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BCLR", "0100100??????????001?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs1 & ~(1ull << (rs2 & 0x3F)));
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit clear immediate (Zbs)
+ */
+class BCLRI : public RiscvInstruction {
+ public:
+    BCLRI(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BCLRI", "010010???????????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint32_t sh = u.bits.imm & 0x3F;
+        icpu_->setReg(u.bits.rd, rs1 & ~(1ull << sh));
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit extract (Zbs)
+ */
+class BEXT : public RiscvInstruction {
+ public:
+    BEXT(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BEXT", "0100100??????????101?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, (rs1 >> (rs2 & 0x3F)) & 0x1);
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit extract immediate (Zbs)
+ */
+class BEXTI : public RiscvInstruction {
+ public:
+    BEXTI(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BEXTI", "010010???????????101?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint32_t sh = u.bits.imm & 0x3F;
+        icpu_->setReg(u.bits.rd, (rs1 >> sh) & 0x1);
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit invert (Zbs)
+ */
+class BINV : public RiscvInstruction {
+ public:
+    BINV(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BINV", "0110100??????????001?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs1 ^ (1ull << (rs2 & 0x3F)));
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit invert immediate (Zbs)
+ */
+class BINVI : public RiscvInstruction {
+ public:
+    BINVI(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BINVI", "011010???????????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint32_t sh = u.bits.imm & 0x3F;
+        icpu_->setReg(u.bits.rd, rs1 ^ (1ull << sh));
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit set (Zbs)
+ */
+class BSET : public RiscvInstruction {
+ public:
+    BSET(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BSET", "0010100??????????001?????0110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint64_t rs2 = R[u.bits.rs2];
+        icpu_->setReg(u.bits.rd, rs1 | (1ull << (rs2 & 0x3F)));
+        return 4;
+    }
+};
+
+/**
+ * @brief Single-bit set immediate (Zbs)
+ */
+class BSETI : public RiscvInstruction {
+ public:
+    BSETI(CpuRiver_Functional *icpu)
+        : RiscvInstruction(icpu, "BSETI", "001010???????????001?????0010011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_I_type u;
+        u.value = payload->buf32[0];
+        uint64_t rs1 = R[u.bits.rs1];
+        uint32_t sh = u.bits.imm & 0x3F;
+        icpu_->setReg(u.bits.rd, rs1 | (1ull << sh));
+        return 4;
+    }
+};
+
+void CpuRiver_Functional::addIsaExtensionZba() {
+    addSupportedInstruction(new ADD_UW(this));
+    addSupportedInstruction(new SH1ADD(this));
+    addSupportedInstruction(new SH2ADD(this));
+    addSupportedInstruction(new SH3ADD(this));
+    addSupportedInstruction(new SH1ADD_UW(this));
+    addSupportedInstruction(new SH2ADD_UW(this));
+    addSupportedInstruction(new SH3ADD_UW(this));
+    addSupportedInstruction(new SLLI_UW(this));
+}
+
+void CpuRiver_Functional::addIsaExtensionZbb() {
+    addSupportedInstruction(new ANDN(this));
+    addSupportedInstruction(new ORN(this));
+    addSupportedInstruction(new XNOR(this));
+    addSupportedInstruction(new CLZ(this));
+    addSupportedInstruction(new CLZW(this));
+    addSupportedInstruction(new CTZ(this));
+    addSupportedInstruction(new CTZW(this));
+    addSupportedInstruction(new CPOP(this));
+    addSupportedInstruction(new CPOPW(this));
+    addSupportedInstruction(new MAX(this));
+    addSupportedInstruction(new MAXU(this));
+    addSupportedInstruction(new MIN(this));
+    addSupportedInstruction(new MINU(this));
+    addSupportedInstruction(new SEXT_B(this));
+    addSupportedInstruction(new SEXT_H(this));
+    addSupportedInstruction(new ZEXT_H(this));
+    addSupportedInstruction(new ROL(this));
+    addSupportedInstruction(new ROLW(this));
+    addSupportedInstruction(new ROR(this));
+    addSupportedInstruction(new RORI(this));
+    addSupportedInstruction(new RORIW(this));
+    addSupportedInstruction(new RORW(this));
+    addSupportedInstruction(new ORC_B(this));
+    addSupportedInstruction(new REV8(this));
+}
+
+void CpuRiver_Functional::addIsaExtensionZbs() {
+    addSupportedInstruction(new BCLR(this));
+    addSupportedInstruction(new BCLRI(this));
+    addSupportedInstruction(new BEXT(this));
+    addSupportedInstruction(new BEXTI(this));
+    addSupportedInstruction(new BINV(this));
+    addSupportedInstruction(new BINVI(this));
+    addSupportedInstruction(new BSET(this));
+    addSupportedInstruction(new BSETI(this));
+}
+
+/** B is the union of Zba, Zbb and Zbs */
+void CpuRiver_Functional::addIsaExtensionB() {
+    addIsaExtensionZba();
+    addIsaExtensionZbb();
+    addIsaExtensionZbs();
+    portCSR_.write(CSR_misa, portCSR_.read(CSR_misa).val | (1LL << ('B' - 'A')));
+}
+
+}  // namespace debugger
@@ -16,6 +16,8 @@
  * @brief      RISC-V extension-F (Floating-point Instructions).
  */
 
+#include <cfenv>
+#include <cmath>
 #include "api_core.h"
 #include "riscv-isa.h"
 #include "cpu_riscv_func.h"
@@ -31,6 +33,158 @@ class FpuInstruction : public RiscvInstruction {
     }
 
  protected:
+    static const uint64_t CANONICAL_NAN = 0x7FF8000000000000ull;
+
+    static const uint32_t FFLAG_NX = 0x01;
+    static const uint32_t FFLAG_UF = 0x02;
+    static const uint32_t FFLAG_OF = 0x04;
+    static const uint32_t FFLAG_DZ = 0x08;
+    static const uint32_t FFLAG_NV = 0x10;
+
+    /**
+     * River FPU model of the operation. It implements round to nearest,
+     * ties to even only and sets the fflags bits of modelFlags().
+     */
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        return 0;
+    }
+
+    /** fflags bits computed by the model, others aren't compared */
+    virtual uint32_t modelFlags() { return 0; }
+
+    /** The same operation on the host FPU, current rounding mode is set */
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        uint32_t fflags = 0;
+        return model(a, b, &fflags);
+    }
+
+    /** Accumulate exception flags in fcsr */
+    void raiseFlags(uint32_t fflags) {
+        if (!fflags) {
+            return;
+        }
+        csr_fcsr_type fcsr;
+        fcsr.value = icpu_->readCSR(ICpuRiscV::CSR_fcsr);
+        fcsr.value |= fflags;
+        icpu_->writeCSR(ICpuRiscV::CSR_fcsr, fcsr.value);
+    }
+
+    /**
+     * Host FPU is used when enabled and the rounding mode has host
+     * equivalent (RMM hasn't), exception flags are accumulated in fcsr.
+     * In self-test mode the model result and flags are computed as a
+     * reference for the round to nearest mode, the only one of the model.
+     */
+    uint64_t compute(uint32_t rm, uint64_t a, uint64_t b) {
+        uint32_t fflags = 0;
+        uint64_t res;
+        if (!icpu_->isHostFpu()) {
+            res = model(a, b, &fflags);
+            raiseFlags(fflags);
+            return res;
+        }
+        if (rm == 7) {
+            csr_fcsr_type fcsr;
+            fcsr.value = icpu_->readCSR(ICpuRiscV::CSR_fcsr);
+            rm = static_cast<uint32_t>(fcsr.bits.FRM);
+        }
+        int round;
+        switch (rm) {
+        case 0: round = FE_TONEAREST; break;
+        case 1: round = FE_TOWARDZERO; break;
+        case 2: round = FE_DOWNWARD; break;
+        case 3: round = FE_UPWARD; break;
+        default:
+            res = model(a, b, &fflags);
+            raiseFlags(fflags);
+            return res;
+        }
+
+        int hostround = fegetround();
+        if (round != hostround) {
+            fesetround(round);
+        }
+        feclearexcept(FE_ALL_EXCEPT);
+        res = host(a, b);
+        int except = fetestexcept(FE_ALL_EXCEPT);
+        if (round != hostround) {
+            fesetround(hostround);
+        }
+
+        fflags |= (except & FE_INEXACT) ? FFLAG_NX : 0;
+        fflags |= (except & FE_UNDERFLOW) ? FFLAG_UF : 0;
+        fflags |= (except & FE_OVERFLOW) ? FFLAG_OF : 0;
+        fflags |= (except & FE_DIVBYZERO) ? FFLAG_DZ : 0;
+        fflags |= (except & FE_INVALID) ? FFLAG_NV : 0;
+        raiseFlags(fflags);
+
+        if (icpu_->isHostFpuCheck() && rm == 0) {
+            uint32_t refflags = 0;
+            uint64_t ref = model(a, b, &refflags);
+            uint32_t mask = modelFlags();
+            if (ref != res || (refflags & mask) != (fflags & mask)) {
+                icpu_->reportHostFpuMismatch(name(), a, b, res, ref,
+                                             fflags & mask, refflags & mask);
+            }
+        }
+        return res;
+    }
+
+    /** Host NaN keeps the operand payload, RISC-V returns canonical NaN */
+    uint64_t hostResult(double v) {
+        Reg64Type t;
+        if (std::isnan(v)) {
+            return CANONICAL_NAN;
+        }
+        t.f64 = v;
+        return t.val;
+    }
+
+    /**
+     * Host conversion is undefined out of range, so that the value is
+     * rounded with the current mode and saturated as RISC-V requires.
+     */
+    uint64_t hostDouble2Int(uint64_t a, int signEna, int w32) {
+        Reg64Type A;
+        A.val = a;
+        double lo, hi;      // valid range is [lo, hi)
+        uint64_t minval, maxval;
+        if (w32) {
+            lo = signEna ? -2147483648.0 : 0.0;
+            hi = signEna ? 2147483648.0 : 4294967296.0;
+            minval = signEna ? 0xFFFFFFFF80000000ull : 0;
+            maxval = signEna ? 0x7FFFFFFFull : 0xFFFFFFFFFFFFFFFFull;
+        } else {
+            lo = signEna ? -9223372036854775808.0 : 0.0;
+            hi = signEna ? 9223372036854775808.0 : 18446744073709551616.0;
+            minval = signEna ? 0x8000000000000000ull : 0;
+            maxval = signEna ? 0x7FFFFFFFFFFFFFFFull : ~0ull;
+        }
+        if (std::isnan(A.f64)) {
+            feraiseexcept(FE_INVALID);
+            return maxval;
+        }
+        double r = std::nearbyint(A.f64);
+        if (r < lo) {
+            feraiseexcept(FE_INVALID);
+            return minval;
+        }
+        if (r >= hi) {
+            feraiseexcept(FE_INVALID);
+            return maxval;
+        }
+        if (r != A.f64) {
+            feraiseexcept(FE_INEXACT);
+        }
+        uint64_t res = signEna ? static_cast<uint64_t>(static_cast<int64_t>(r))
+                               : static_cast<uint64_t>(r);
+        if (w32) {
+            res = static_cast<uint64_t>(static_cast<int64_t>(
+                    static_cast<int32_t>(res)));
+        }
+        return res;
+    }
+
     const int64_t BIT62 = 0x2000000000000000;
     const int64_t MSK61 = 0x1FFFFFFFFFFFFFFF;
 
@@ -918,16 +1072,28 @@ class FADD_D : public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1, src2;
         u.value = payload->buf32[0];
-        src1.val = RF[u.bits.rs1];
-        src2.val = RF[u.bits.rs2];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], RF[u.bits.rs2]);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1, src2;
+        src1.val = a;
+        src2.val = b;
         int except = 0;
         AddSubCompare(1, 0, 0, 0, 0, 0,
                        src1, src2, &dest, except);
-        //dest.f64 = src1.f64 + src2.f64;
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        Reg64Type src1, src2;
+        src1.val = a;
+        src2.val = b;
+        return hostResult(src1.f64 + src2.f64);
     }
 };
 
@@ -941,14 +1107,23 @@ class FCVT_D_L: public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = R[u.bits.rs1];
-        Int2Double(1, 0, src1, &dest);
-        //dest.f64 = static_cast<double>(src1.ival);
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
+        uint64_t res = compute(u.bits.funct3, R[u.bits.rs1], 0);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
         return 4;
     }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
+        Int2Double(1, 0, src1, &dest);
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostResult(static_cast<double>(static_cast<int64_t>(a)));
+    }
 };
 
 /**
@@ -961,14 +1136,23 @@ class FCVT_D_LU: public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = R[u.bits.rs1];
-        Int2Double(0, 0, src1, &dest);
-        //dest.f64 = static_cast<double>(src1.val);
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
+        uint64_t res = compute(u.bits.funct3, R[u.bits.rs1], 0);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
         return 4;
     }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
+        Int2Double(0, 0, src1, &dest);
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostResult(static_cast<double>(a));
+    }
 };
 
 /**
@@ -981,14 +1165,23 @@ class FCVT_D_W: public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = R[u.bits.rs1];
-        Int2Double(1, 1, src1, &dest);
-        //dest.f64 = static_cast<double>(static_cast<int>(src1.buf32[0]));
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
+        uint64_t res = compute(u.bits.funct3, R[u.bits.rs1], 0);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
         return 4;
     }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
+        Int2Double(1, 1, src1, &dest);
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostResult(static_cast<double>(static_cast<int32_t>(a)));
+    }
 };
 
 /**
@@ -1001,14 +1194,23 @@ class FCVT_D_WU: public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = R[u.bits.rs1];
-        Int2Double(0, 1, src1, &dest);
-        //dest.f64 = static_cast<double>(src1.buf32[0]);
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
+        uint64_t res = compute(u.bits.funct3, R[u.bits.rs1], 0);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
         return 4;
     }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
+        Int2Double(0, 1, src1, &dest);
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostResult(static_cast<double>(static_cast<uint32_t>(a)));
+    }
 };
 
 /**
@@ -1021,14 +1223,23 @@ class FCVT_L_D: public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = RF[u.bits.rs1];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], 0);
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
         int ovr, und;
         Double2Int(1, 0, src1, &dest, ovr, und);
-        //dest.ival = static_cast<int64_t>(src1.f64);
-        icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostDouble2Int(a, 1, 0);
     }
 };
 
@@ -1042,14 +1253,23 @@ class FCVT_LU_D : public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = RF[u.bits.rs1];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], 0);
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
         int ovr, und;
         Double2Int(0, 0, src1, &dest, ovr, und);
-        //dest.val = static_cast<uint64_t>(src1.f64);
-        icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostDouble2Int(a, 0, 0);
     }
 };
 
@@ -1063,14 +1283,23 @@ class FCVT_W_D : public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = RF[u.bits.rs1];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], 0);
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
         int ovr, und;
         Double2Int(1, 1, src1, &dest, ovr, und);
-        //dest.ival = static_cast<int32_t>(src1.f64);
-        icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostDouble2Int(a, 1, 1);
     }
 };
 
@@ -1084,14 +1313,23 @@ class FCVT_WU_D : public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, src1;
         u.value = payload->buf32[0];
-        src1.val = RF[u.bits.rs1];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], 0);
+        icpu_->setReg(u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, src1;
+        src1.val = a;
         int ovr, und;
         Double2Int(0, 1, src1, &dest, ovr, und);
-        //dest.val = static_cast<uint32_t>(src1.f64);
-        icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        return hostDouble2Int(a, 0, 1);
     }
 };
 
@@ -1105,10 +1343,24 @@ class FDIV_D : public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, A, B;
         u.value = payload->buf32[0];
-        A.val = RF[u.bits.rs1];
-        B.val = RF[u.bits.rs2];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], RF[u.bits.rs2]);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        Reg64Type A, B;
+        A.val = a;
+        B.val = b;
+        return hostResult(A.f64 / B.f64);
+    }
+
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, A, B;
+        A.val = a;
+        B.val = b;
 
         uint64_t zeroA = !A.f64bits.exp && !A.f64bits.mant ? 1: 0;
         uint64_t zeroB = !B.f64bits.exp && !B.f64bits.mant ? 1: 0;
@@ -1237,15 +1489,13 @@ class FDIV_D : public FpuInstruction {
             dest.f64bits.mant = mantShort + rndBit;
         }
 
-        if (RF[u.bits.rs2] == 0) {
-            csr_fcsr_type fcsr;
-            fcsr.value = icpu_->readCSR(ICpuRiscV::CSR_fcsr);
-            fcsr.bits.DZ = 1;
-            icpu_->writeCSR(ICpuRiscV::CSR_fcsr, fcsr.value);
+        if (b == 0) {
+            *fflags |= FFLAG_DZ;
         }
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
     }
+
+    virtual uint32_t modelFlags() { return FFLAG_DZ; }
 };
 
 /**
@@ -1468,10 +1718,24 @@ class FMUL_D : public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        Reg64Type dest, A, B;
         u.value = payload->buf32[0];
-        A.val = RF[u.bits.rs1];
-        B.val = RF[u.bits.rs2];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], RF[u.bits.rs2]);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        Reg64Type A, B;
+        A.val = a;
+        B.val = b;
+        return hostResult(A.f64 * B.f64);
+    }
+
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
+        Reg64Type dest, A, B;
+        A.val = a;
+        B.val = b;
 
         uint64_t zeroA = !A.f64bits.exp && !A.f64bits.mant ? 1: 0;
         uint64_t zeroB = !B.f64bits.exp && !B.f64bits.mant ? 1: 0;
@@ -1594,8 +1858,7 @@ class FMUL_D : public FpuInstruction {
 
         //except = nanA | nanB | overflow;
         //dest.f64 = src1.f64 * src2.f64;
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
     }
 };
 
@@ -1641,15 +1904,27 @@ class FSUB_D : public FpuInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t res = compute(u.bits.funct3, RF[u.bits.rs1], RF[u.bits.rs2]);
+        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, res);
+        return 4;
+    }
+
+ protected:
+    virtual uint64_t model(uint64_t a, uint64_t b, uint32_t *fflags) {
         Reg64Type dest, src1, src2;
+        src1.val = a;
+        src2.val = b;
         int except = 0;
-        u.value = payload->buf32[0];
-        src1.val = RF[u.bits.rs1];
-        src2.val = RF[u.bits.rs2];
         AddSubCompare(0, 1, 0, 0, 0, 0, src1, src2, &dest, except);
-        //dest.f64 = src1.f64 - src2.f64;
-        icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return dest.val;
+    }
+
+    virtual uint64_t host(uint64_t a, uint64_t b) {
+        Reg64Type src1, src2;
+        src1.val = a;
+        src2.val = b;
+        return hostResult(src1.f64 - src2.f64);
     }
 };
 
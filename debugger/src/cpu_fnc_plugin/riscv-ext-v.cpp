@@ -0,0 +1,1498 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ * @brief      RISC-V extension-V (Vector Instructions, RVV 1.0 subset).
+ */
+
+#include <cfenv>
+#include <cmath>
+#include <cstring>
+#include "api_core.h"
+#include "riscv-isa.h"
+#include "cpu_riscv_func.h"
+#include "vector_kernels.h"
+
+namespace debugger {
+
+/** Second operand of the arithmetic instructions */
+enum EVectorOperand {
+    VOperand_VV,    // vs1 register group
+    VOperand_VX,    // x[rs1] or f[rs1]
+    VOperand_VI,    // imm5
+};
+
+/**
+ * Common part of the vector instructions: current vtype/vl, element
+ * access and v0.t mask. Element i of a register group is located at
+ * offset i * EEW of the first register because the group registers are
+ * consecutive in the register file. Tail and inactive elements are always
+ * left undisturbed which is allowed for the agnostic policy too.
+ */
+class VectorInstruction : public RiscvInstruction {
+ public:
+    VectorInstruction(CpuRiver_Functional *icpu, const char *name,
+                      const char *bits, EVectorOperand opd)
+        : RiscvInstruction(icpu, name, bits), opd_(opd) {}
+
+ protected:
+    /** Decode instruction and configuration, false if vill is set */
+    bool setup(Reg64Type *payload) {
+        csr_vtype_type vtype;
+        u_.value = payload->buf32[0];
+        vtype.value = icpu_->readCSR(ICpuRiscV::CSR_vtype);
+        if (vtype.bits.vill) {
+            illegal();
+            return false;
+        }
+        sew_ = 1u << vtype.bits.vsew;
+        lmul_ = (vtype.bits.vlmul & 0x4) ? 1 : 1u << vtype.bits.vlmul;
+        vl_ = static_cast<uint32_t>(icpu_->readCSR(ICpuRiscV::CSR_vl));
+        vstart_ = static_cast<uint32_t>(
+                    icpu_->readCSR(ICpuRiscV::CSR_vstart));
+        return true;
+    }
+
+    void illegal() {
+        icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal,
+                                 icpu_->getPC());
+    }
+
+    /** Register group of n registers must be aligned to n */
+    bool isGroup(uint32_t r, uint32_t n) {
+        return n <= 8 && (r & (n - 1)) == 0;
+    }
+
+    /** Destination of the masked instruction can't overlap v0 */
+    bool isMaskOverlap(uint32_t vd) {
+        return !u_.bits.vm && vd == 0;
+    }
+
+    void done() {
+        if (vstart_) {
+            icpu_->writeCSR(ICpuRiscV::CSR_vstart, 0);
+        }
+    }
+
+    uint8_t *vreg(uint32_t idx) { return icpu_->getVecReg(idx); }
+
+    bool isActive(uint32_t i) {
+        return u_.bits.vm || ((vreg(0)[i >> 3] >> (i & 0x7)) & 0x1);
+    }
+
+    /** Scalar operand: x[rs1] or imm5, signed if not a shift amount */
+    uint64_t scalarOperand(bool uimm) {
+        if (opd_ != VOperand_VI) {
+            return R[u_.bits.vs1];
+        }
+        uint64_t imm = u_.bits.vs1;
+        if (!uimm && (imm & 0x10)) {
+            imm |= ~0x1Full;
+        }
+        return imm;
+    }
+
+    /** f[rs1] with NaN-boxing check for single precision */
+    uint64_t fpuScalarOperand() {
+        uint64_t v = RF[u_.bits.vs1];
+        if (sew_ == 4 && (v >> 32) != 0xFFFFFFFFull) {
+            return 0x7FC00000ull;
+        }
+        return v;
+    }
+
+    static uint64_t getElem(const uint8_t *g, uint32_t i, uint32_t eew) {
+        switch (eew) {
+        case 1:
+            return g[i];
+        case 2:
+            return reinterpret_cast<const uint16_t *>(g)[i];
+        case 4:
+            return reinterpret_cast<const uint32_t *>(g)[i];
+        default:
+            return reinterpret_cast<const uint64_t *>(g)[i];
+        }
+    }
+
+    static void setElem(uint8_t *g, uint32_t i, uint32_t eew, uint64_t v) {
+        switch (eew) {
+        case 1:
+            g[i] = static_cast<uint8_t>(v);
+            break;
+        case 2:
+            reinterpret_cast<uint16_t *>(g)[i] = static_cast<uint16_t>(v);
+            break;
+        case 4:
+            reinterpret_cast<uint32_t *>(g)[i] = static_cast<uint32_t>(v);
+            break;
+        default:
+            reinterpret_cast<uint64_t *>(g)[i] = v;
+        }
+    }
+
+    static int64_t sext(uint64_t v, uint32_t eew) {
+        int sh = 64 - 8 * eew;
+        return static_cast<int64_t>(v << sh) >> sh;
+    }
+
+    static uint64_t zext(uint64_t v, uint32_t eew) {
+        return eew == 8 ? v : v & ((1ull << (8 * eew)) - 1);
+    }
+
+    static bool getMaskBit(const uint8_t *g, uint32_t i) {
+        return (g[i >> 3] >> (i & 0x7)) & 0x1;
+    }
+
+    static void setMaskBit(uint8_t *g, uint32_t i, bool v) {
+        if (v) {
+            g[i >> 3] |= static_cast<uint8_t>(1u << (i & 0x7));
+        } else {
+            g[i >> 3] &= static_cast<uint8_t>(~(1u << (i & 0x7)));
+        }
+    }
+
+    /**
+     * Host FPU environment: dynamic rounding mode from fcsr.frm and accrued
+     * exception flags. RMM has no host equivalent, so that it raises
+     * illegal instruction as the reserved modes do.
+     */
+    bool fpuBegin() {
+        csr_fcsr_type fcsr;
+        int round;
+        fcsr.value = icpu_->readCSR(ICpuRiscV::CSR_fcsr);
+        switch (fcsr.bits.FRM) {
+        case 0: round = FE_TONEAREST; break;
+        case 1: round = FE_TOWARDZERO; break;
+        case 2: round = FE_DOWNWARD; break;
+        case 3: round = FE_UPWARD; break;
+        default:
+            illegal();
+            return false;
+        }
+        hostround_ = fegetround();
+        if (round != hostround_) {
+            fesetround(round);
+        }
+        fpuround_ = round;
+        feclearexcept(FE_ALL_EXCEPT);
+        return true;
+    }
+
+    void fpuEnd() {
+        int except = fetestexcept(FE_ALL_EXCEPT);
+        if (fpuround_ != hostround_) {
+            fesetround(hostround_);
+        }
+        if (except & (FE_INEXACT | FE_UNDERFLOW | FE_OVERFLOW
+                    | FE_DIVBYZERO | FE_INVALID)) {
+            csr_fcsr_type fcsr;
+            fcsr.value = icpu_->readCSR(ICpuRiscV::CSR_fcsr);
+            fcsr.bits.NX |= (except & FE_INEXACT) ? 1 : 0;
+            fcsr.bits.UF |= (except & FE_UNDERFLOW) ? 1 : 0;
+            fcsr.bits.OF |= (except & FE_OVERFLOW) ? 1 : 0;
+            fcsr.bits.DZ |= (except & FE_DIVBYZERO) ? 1 : 0;
+            fcsr.bits.NV |= (except & FE_INVALID) ? 1 : 0;
+            icpu_->writeCSR(ICpuRiscV::CSR_fcsr, fcsr.value);
+        }
+    }
+
+    /** NaN result of the host FPU into RISC-V canonical NaN */
+    static uint64_t canonical(uint64_t v, uint32_t eew) {
+        if (eew == 4) {
+            if ((v & 0x7F800000ull) == 0x7F800000ull && (v & 0x007FFFFFull)) {
+                return 0x7FC00000ull;
+            }
+        } else if ((v & 0x7FF0000000000000ull) == 0x7FF0000000000000ull
+                && (v & 0x000FFFFFFFFFFFFFull)) {
+            return 0x7FF8000000000000ull;
+        }
+        return v;
+    }
+
+ protected:
+    EVectorOperand opd_;
+    ISA_V_type u_;
+    uint32_t sew_;      // bytes
+    uint32_t lmul_;     // registers in a group, 1 for fractional LMUL
+    uint32_t vl_;
+    uint32_t vstart_;
+    int hostround_;
+    int fpuround_;
+};
+
+/**
+ * @brief VSETVLI, VSETIVLI and VSETVL configuration instructions.
+ */
+class VSETVL : public VectorInstruction {
+ public:
+    enum EForm {
+        Form_VLI,       // AVL = x[rs1], vtype = zimm11
+        Form_IVLI,      // AVL = uimm5, vtype = zimm10
+        Form_VL,        // AVL = x[rs1], vtype = x[rs2]
+    };
+    VSETVL(CpuRiver_Functional *icpu, const char *name, const char *bits,
+           EForm form)
+        : VectorInstruction(icpu, name, bits, VOperand_VX), form_(form) {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_V_type u;
+        csr_vtype_type vtype;
+        uint64_t avl;
+        u.value = payload->buf32[0];
+        if (form_ == Form_VL) {
+            vtype.value = R[u.bits.vs2];
+        } else if (form_ == Form_VLI) {
+            vtype.value = (payload->buf32[0] >> 20) & 0x7FF;
+        } else {
+            vtype.value = (payload->buf32[0] >> 20) & 0x3FF;
+        }
+
+        if (form_ == Form_IVLI) {
+            avl = u.bits.vs1;
+        } else if (u.bits.vs1) {
+            avl = R[u.bits.vs1];
+        } else if (u.bits.vd) {
+            avl = ~0ull;            // VLMAX
+        } else {
+            avl = icpu_->readCSR(ICpuRiscV::CSR_vl);  // keep vl
+        }
+
+        // SEW <= LMUL * ELEN, ELEN = 64
+        uint64_t vlmax = 0;
+        uint32_t vsew = static_cast<uint32_t>(vtype.bits.vsew);
+        uint32_t vlmul = static_cast<uint32_t>(vtype.bits.vlmul);
+        uint32_t vlenbits = 8 * icpu_->getVlenb();
+        if (!vtype.bits.vill && !vtype.bits.rsrv && vsew <= 3
+            && vlmul != 4) {
+            if (vlmul & 0x4) {
+                uint32_t frac = 8 - vlmul;      // 1/2, 1/4, 1/8
+                if (vsew + frac <= 3) {
+                    vlmax = (vlenbits >> (3 + vsew)) >> frac;
+                }
+            } else {
+                vlmax = (vlenbits >> (3 + vsew)) << vlmul;
+            }
+        }
+
+        uint64_t vl = 0;
+        if (vlmax == 0) {
+            vtype.value = 1ull << 63;
+        } else {
+            vl = avl < vlmax ? avl : vlmax;
+        }
+        icpu_->setVectorConfig(vtype.value, vl);
+        icpu_->writeCSR(ICpuRiscV::CSR_vstart, 0);
+        icpu_->setReg(u.bits.vd, vl);
+        return 4;
+    }
+
+ private:
+    EForm form_;
+};
+
+/**
+ * @brief Unit-stride, strided and indexed loads and stores.
+ *
+ * Segment loads/stores (nf != 0) aren't supported and decoded as illegal.
+ */
+class VMemOp : public VectorInstruction {
+ public:
+    enum EMode {
+        Mode_Unit,
+        Mode_Strided,
+        Mode_Indexed,       // eew_ is the width of the index elements
+    };
+    VMemOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+           uint32_t eew, EMode mode, bool store)
+        : VectorInstruction(icpu, name, bits, VOperand_VX),
+        eew_(eew), mode_(mode), store_(store) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        uint32_t eew = mode_ == Mode_Indexed ? sew_ : eew_;
+        uint32_t emul = (eew * lmul_) / sew_;
+        uint32_t vd = u_.bits.vd;
+        if (emul == 0) {
+            emul = 1;
+        }
+        if (!isGroup(vd, emul) || (!store_ && isMaskOverlap(vd))) {
+            illegal();
+            return 4;
+        }
+        if (mode_ == Mode_Indexed) {
+            uint32_t imul = (eew_ * lmul_) / sew_;
+            if (!isGroup(u_.bits.vs2, imul ? imul : 1)) {
+                illegal();
+                return 4;
+            }
+        }
+
+        uint8_t *data = vreg(vd);
+        uint64_t base = R[u_.bits.vs1];
+        uint64_t stride = mode_ == Mode_Strided ? R[u_.bits.vs2] : eew;
+        Axi4TransactionType tr;
+        uint32_t i = vstart_;
+        while (i < vl_) {
+            if (!isActive(i)) {
+                i++;
+                continue;
+            }
+            tr.addr = base + i * stride;
+            if (mode_ == Mode_Indexed) {
+                tr.addr = base + getElem(vreg(u_.bits.vs2), i, eew_);
+            }
+            // Elements of the unmasked unit-stride access are packed into
+            // 8-bytes transactions
+            uint32_t cnt = 1;
+            if (mode_ == Mode_Unit && u_.bits.vm && eew < 8
+                && (tr.addr & 0x7) == 0 && (vl_ - i) * eew >= 8) {
+                cnt = 8 / eew;
+            }
+            tr.xsize = cnt * eew;
+            if (tr.addr & (eew - 1)) {
+                icpu_->writeCSR(ICpuRiscV::CSR_vstart, i);
+                icpu_->generateException(store_
+                        ? ICpuRiscV::EXCEPTION_StoreMisalign
+                        : ICpuRiscV::EXCEPTION_LoadMisalign, tr.addr);
+                return 4;
+            }
+            if (store_) {
+                tr.action = MemAction_Write;
+                tr.wstrb = (1 << tr.xsize) - 1;
+                memcpy(tr.wpayload.b8, &data[i * eew], tr.xsize);
+            } else {
+                tr.action = MemAction_Read;
+                tr.wstrb = 0;
+            }
+            if (icpu_->dma_memop(&tr) == TRANS_ERROR) {
+                icpu_->writeCSR(ICpuRiscV::CSR_vstart, i);
+                icpu_->generateException(store_
+                        ? ICpuRiscV::EXCEPTION_StoreFault
+                        : ICpuRiscV::EXCEPTION_LoadFault, tr.addr);
+                return 4;
+            }
+            if (!store_) {
+                memcpy(&data[i * eew], tr.rpayload.b8, tr.xsize);
+            }
+            i += cnt;
+        }
+        done();
+        return 4;
+    }
+
+ private:
+    uint32_t eew_;
+    EMode mode_;
+    bool store_;
+};
+
+/**
+ * @brief Single-width integer arithmetic: vd[i] = vs2[i] op vs1[i]/rs1/imm
+ */
+class VIntOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_Add, Op_Sub, Op_RSub, Op_MinU, Op_Min, Op_MaxU, Op_Max,
+        Op_And, Op_Or, Op_Xor, Op_Sll, Op_Srl, Op_Sra,
+        Op_Mul, Op_MulH, Op_MulHU, Op_Macc, Op_Nmsac, Op_Madd,
+    };
+    VIntOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+           EVectorOperand opd, EOp op)
+        : VectorInstruction(icpu, name, bits, opd), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        uint32_t vd = u_.bits.vd;
+        if (!isGroup(vd, lmul_) || !isGroup(u_.bits.vs2, lmul_)
+            || (opd_ == VOperand_VV && !isGroup(u_.bits.vs1, lmul_))
+            || isMaskOverlap(vd)) {
+            illegal();
+            return 4;
+        }
+        uint8_t *d = vreg(vd);
+        const uint8_t *a = vreg(u_.bits.vs2);
+        const uint8_t *b = opd_ == VOperand_VV ? vreg(u_.bits.vs1) : 0;
+        uint64_t x = scalarOperand(op_ >= Op_Sll && op_ <= Op_Sra);
+
+        int kernel = hostKernel();
+        if (kernel >= 0 && u_.bits.vm && vstart_ == 0
+            && vectorKernel(static_cast<EVectorKernel>(kernel), sew_,
+                            d, a, b, x, vl_)) {
+            return 4;
+        }
+        for (uint32_t i = vstart_; i < vl_; i++) {
+            if (isActive(i)) {
+                uint64_t res = compute(getElem(a, i, sew_),
+                                       b ? getElem(b, i, sew_) : x,
+                                       getElem(d, i, sew_));
+                setElem(d, i, sew_, res);
+            }
+        }
+        done();
+        return 4;
+    }
+
+ protected:
+    int hostKernel() {
+        switch (op_) {
+        case Op_Add: return VK_Add;
+        case Op_Sub: return VK_Sub;
+        case Op_And: return VK_And;
+        case Op_Or: return VK_Or;
+        case Op_Xor: return VK_Xor;
+        case Op_Mul: return VK_Mul;
+        case Op_Macc: return VK_Macc;
+        default: return -1;
+        }
+    }
+
+    /** Upper half of the 128-bits product */
+    static uint64_t mulhu64(uint64_t a, uint64_t b) {
+        uint64_t a0 = a & 0xFFFFFFFFull, a1 = a >> 32;
+        uint64_t b0 = b & 0xFFFFFFFFull, b1 = b >> 32;
+        uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0;
+        uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFFull)
+                     + (p10 & 0xFFFFFFFFull);
+        return a1 * b1 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    }
+
+    uint64_t mulh(uint64_t a, uint64_t b, bool sign) {
+        if (sew_ < 8) {
+            if (sign) {
+                return static_cast<uint64_t>(
+                    (sext(a, sew_) * sext(b, sew_)) >> (8 * sew_));
+            }
+            return (zext(a, sew_) * zext(b, sew_)) >> (8 * sew_);
+        }
+        uint64_t res = mulhu64(a, b);
+        if (sign) {
+            res -= (a >> 63) ? b : 0;
+            res -= (b >> 63) ? a : 0;
+        }
+        return res;
+    }
+
+    /** a = vs2[i], b = vs1[i] or scalar, d = vd[i] */
+    uint64_t compute(uint64_t a, uint64_t b, uint64_t d) {
+        uint32_t shmsk = 8 * sew_ - 1;
+        switch (op_) {
+        case Op_Add: return a + b;
+        case Op_Sub: return a - b;
+        case Op_RSub: return b - a;
+        case Op_MinU:
+            return zext(a, sew_) < zext(b, sew_) ? a : b;
+        case Op_Min:
+            return sext(a, sew_) < sext(b, sew_) ? a : b;
+        case Op_MaxU:
+            return zext(a, sew_) > zext(b, sew_) ? a : b;
+        case Op_Max:
+            return sext(a, sew_) > sext(b, sew_) ? a : b;
+        case Op_And: return a & b;
+        case Op_Or: return a | b;
+        case Op_Xor: return a ^ b;
+        case Op_Sll: return a << (b & shmsk);
+        case Op_Srl: return zext(a, sew_) >> (b & shmsk);
+        case Op_Sra: return static_cast<uint64_t>(sext(a, sew_) >> (b & shmsk));
+        case Op_Mul: return a * b;
+        case Op_MulH: return mulh(a, b, true);
+        case Op_MulHU: return mulh(a, b, false);
+        case Op_Macc: return b * a + d;
+        case Op_Nmsac: return d - b * a;
+        case Op_Madd: return b * d + a;
+        default: return d;
+        }
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief vmv.v.* copies the operand, vmerge.v*m selects it by v0.t
+ */
+class VMergeOp : public VectorInstruction {
+ public:
+    VMergeOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+             EVectorOperand opd, bool fpu)
+        : VectorInstruction(icpu, name, bits, opd), fpu_(fpu) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        uint32_t vd = u_.bits.vd;
+        if (!isGroup(vd, lmul_) || !isGroup(u_.bits.vs2, lmul_)
+            || (opd_ == VOperand_VV && !isGroup(u_.bits.vs1, lmul_))
+            || isMaskOverlap(vd) || (fpu_ && sew_ < 4)) {
+            illegal();
+            return 4;
+        }
+        uint8_t *d = vreg(vd);
+        const uint8_t *a = vreg(u_.bits.vs2);
+        const uint8_t *b = opd_ == VOperand_VV ? vreg(u_.bits.vs1) : 0;
+        uint64_t x = fpu_ ? fpuScalarOperand() : scalarOperand(false);
+        for (uint32_t i = vstart_; i < vl_; i++) {
+            if (isActive(i)) {
+                setElem(d, i, sew_, b ? getElem(b, i, sew_) : x);
+            } else {
+                setElem(d, i, sew_, getElem(a, i, sew_));
+            }
+        }
+        done();
+        return 4;
+    }
+
+ private:
+    bool fpu_;
+};
+
+/**
+ * @brief Whole register move vmv<nr>r.v, doesn't depend on vtype and vl
+ */
+class VMVNR_V : public VectorInstruction {
+ public:
+    VMVNR_V(CpuRiver_Functional *icpu)
+        : VectorInstruction(icpu, "VMVNR_V",
+                            "1001111?????00???011?????1010111", VOperand_VI) {}
+
+    virtual int exec(Reg64Type *payload) {
+        ISA_V_type u;
+        u.value = payload->buf32[0];
+        uint32_t nr = u.bits.vs1 + 1;
+        if ((nr & (nr - 1)) || !isGroup(u.bits.vd, nr)
+            || !isGroup(u.bits.vs2, nr)) {
+            illegal();
+            return 4;
+        }
+        memmove(vreg(u.bits.vd), vreg(u.bits.vs2), nr * icpu_->getVlenb());
+        icpu_->writeCSR(ICpuRiscV::CSR_vstart, 0);
+        return 4;
+    }
+};
+
+/**
+ * @brief Integer compare, result is written into mask register vd
+ */
+class VCmpOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_Eq, Op_Ne, Op_LtU, Op_Lt, Op_LeU, Op_Le, Op_GtU, Op_Gt,
+    };
+    VCmpOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+           EVectorOperand opd, EOp op)
+        : VectorInstruction(icpu, name, bits, opd), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        if (!isGroup(u_.bits.vs2, lmul_)
+            || (opd_ == VOperand_VV && !isGroup(u_.bits.vs1, lmul_))) {
+            illegal();
+            return 4;
+        }
+        uint8_t *d = vreg(u_.bits.vd);
+        const uint8_t *a = vreg(u_.bits.vs2);
+        const uint8_t *b = opd_ == VOperand_VV ? vreg(u_.bits.vs1) : 0;
+        uint64_t x = scalarOperand(false);
+        for (uint32_t i = vstart_; i < vl_; i++) {
+            if (!isActive(i)) {
+                continue;
+            }
+            uint64_t ua = zext(getElem(a, i, sew_), sew_);
+            uint64_t ub = zext(b ? getElem(b, i, sew_) : x, sew_);
+            int64_t sa = sext(ua, sew_);
+            int64_t sb = sext(ub, sew_);
+            bool res;
+            switch (op_) {
+            case Op_Eq: res = ua == ub; break;
+            case Op_Ne: res = ua != ub; break;
+            case Op_LtU: res = ua < ub; break;
+            case Op_Lt: res = sa < sb; break;
+            case Op_LeU: res = ua <= ub; break;
+            case Op_Le: res = sa <= sb; break;
+            case Op_GtU: res = ua > ub; break;
+            default: res = sa > sb;
+            }
+            setMaskBit(d, i, res);
+        }
+        done();
+        return 4;
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief Widening multiply and multiply-add: vd is 2*SEW wide
+ */
+class VWideOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_WMulU, Op_WMul, Op_WMaccU, Op_WMacc,
+    };
+    VWideOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+            EVectorOperand opd, EOp op)
+        : VectorInstruction(icpu, name, bits, opd), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        uint32_t vd = u_.bits.vd;
+        if (sew_ == 8 || !isGroup(vd, 2 * lmul_)
+            || !isGroup(u_.bits.vs2, lmul_)
+            || (opd_ == VOperand_VV && !isGroup(u_.bits.vs1, lmul_))
+            || isMaskOverlap(vd)) {
+            illegal();
+            return 4;
+        }
+        uint8_t *d = vreg(vd);
+        const uint8_t *a = vreg(u_.bits.vs2);
+        const uint8_t *b = opd_ == VOperand_VV ? vreg(u_.bits.vs1) : 0;
+        uint64_t x = scalarOperand(false);
+        bool sign = op_ == Op_WMul || op_ == Op_WMacc;
+        for (uint32_t i = vstart_; i < vl_; i++) {
+            if (!isActive(i)) {
+                continue;
+            }
+            uint64_t ea = getElem(a, i, sew_);
+            uint64_t eb = b ? getElem(b, i, sew_) : x;
+            uint64_t res;
+            if (sign) {
+                res = static_cast<uint64_t>(sext(ea, sew_) * sext(eb, sew_));
+            } else {
+                res = zext(ea, sew_) * zext(eb, sew_);
+            }
+            if (op_ == Op_WMaccU || op_ == Op_WMacc) {
+                res += getElem(d, i, 2 * sew_);
+            }
+            setElem(d, i, 2 * sew_, res);
+        }
+        done();
+        return 4;
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief Integer reductions: vd[0] = vs1[0] op active vs2[*]
+ */
+class VRedOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_Sum, Op_And, Op_Or, Op_Xor, Op_MinU, Op_Min, Op_MaxU, Op_Max,
+        Op_WSumU, Op_WSum,
+    };
+    VRedOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+           EOp op)
+        : VectorInstruction(icpu, name, bits, VOperand_VV), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        bool wide = op_ == Op_WSumU || op_ == Op_WSum;
+        uint32_t dew = wide ? 2 * sew_ : sew_;
+        if (vstart_ || dew > 8 || !isGroup(u_.bits.vs2, lmul_)) {
+            illegal();
+            return 4;
+        }
+        if (vl_ == 0) {
+            return 4;
+        }
+        const uint8_t *a = vreg(u_.bits.vs2);
+        uint64_t acc = getElem(vreg(u_.bits.vs1), 0, dew);
+        for (uint32_t i = 0; i < vl_; i++) {
+            if (!isActive(i)) {
+                continue;
+            }
+            uint64_t e = getElem(a, i, sew_);
+            switch (op_) {
+            case Op_Sum: acc += e; break;
+            case Op_And: acc &= e; break;
+            case Op_Or: acc |= e; break;
+            case Op_Xor: acc ^= e; break;
+            case Op_MinU:
+                acc = zext(e, sew_) < zext(acc, sew_) ? e : acc;
+                break;
+            case Op_Min:
+                acc = sext(e, sew_) < sext(acc, sew_) ? e : acc;
+                break;
+            case Op_MaxU:
+                acc = zext(e, sew_) > zext(acc, sew_) ? e : acc;
+                break;
+            case Op_Max:
+                acc = sext(e, sew_) > sext(acc, sew_) ? e : acc;
+                break;
+            case Op_WSumU: acc += e; break;
+            default: acc += static_cast<uint64_t>(sext(e, sew_));
+            }
+        }
+        setElem(vreg(u_.bits.vd), 0, dew, acc);
+        return 4;
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief Mask-register logical instructions, vd.mask = vs2.mask op vs1.mask
+ */
+class VMaskOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_AndN, Op_And, Op_Or, Op_Xor,
+    };
+    VMaskOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+            EOp op)
+        : VectorInstruction(icpu, name, bits, VOperand_VV), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        uint8_t *d = vreg(u_.bits.vd);
+        const uint8_t *a = vreg(u_.bits.vs2);
+        const uint8_t *b = vreg(u_.bits.vs1);
+        for (uint32_t i = vstart_; i < vl_; i++) {
+            bool ma = getMaskBit(a, i);
+            bool mb = getMaskBit(b, i);
+            switch (op_) {
+            case Op_AndN: setMaskBit(d, i, ma && !mb); break;
+            case Op_And: setMaskBit(d, i, ma && mb); break;
+            case Op_Or: setMaskBit(d, i, ma || mb); break;
+            default: setMaskBit(d, i, ma != mb);
+            }
+        }
+        done();
+        return 4;
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief Scalar moves and mask to scalar: vmv.x.s, vmv.s.x, vfmv.f.s,
+ *        vfmv.s.f, vcpop.m, vfirst.m
+ */
+class VScalarOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_MvXS, Op_MvSX, Op_FMvFS, Op_FMvSF, Op_CPop, Op_First,
+    };
+    VScalarOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+              EOp op)
+        : VectorInstruction(icpu, name, bits, VOperand_VX), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        uint32_t rd = u_.bits.vd;
+        const uint8_t *a = vreg(u_.bits.vs2);
+        switch (op_) {
+        case Op_MvXS:
+            icpu_->setReg(rd, static_cast<uint64_t>(
+                                sext(getElem(a, 0, sew_), sew_)));
+            return 4;
+        case Op_FMvFS:
+            if (sew_ < 4) {
+                illegal();
+                return 4;
+            }
+            icpu_->setReg(ICpuRiscV::RegFpu_Offset + rd, sew_ == 4
+                    ? 0xFFFFFFFF00000000ull | getElem(a, 0, 4)
+                    : getElem(a, 0, 8));
+            return 4;
+        case Op_MvSX:
+        case Op_FMvSF:
+            if (op_ == Op_FMvSF && sew_ < 4) {
+                illegal();
+                return 4;
+            }
+            if (vstart_ < vl_) {
+                setElem(vreg(rd), 0, sew_, op_ == Op_MvSX
+                        ? R[u_.bits.vs1] : fpuScalarOperand());
+            }
+            done();
+            return 4;
+        default:;
+        }
+
+        // vcpop.m, vfirst.m
+        if (vstart_) {
+            illegal();
+            return 4;
+        }
+        int64_t res = op_ == Op_CPop ? 0 : -1;
+        for (uint32_t i = 0; i < vl_; i++) {
+            if (isActive(i) && getMaskBit(a, i)) {
+                if (op_ == Op_First) {
+                    res = i;
+                    break;
+                }
+                res++;
+            }
+        }
+        icpu_->setReg(rd, static_cast<uint64_t>(res));
+        return 4;
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief Single-width floating-point arithmetic on the host FPU
+ */
+class VFpuOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_Add, Op_Sub, Op_RSub, Op_Mul, Op_Div, Op_RDiv, Op_Min, Op_Max,
+        Op_Macc, Op_Nmsac, Op_Madd,
+    };
+    VFpuOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+           EVectorOperand opd, EOp op)
+        : VectorInstruction(icpu, name, bits, opd), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        uint32_t vd = u_.bits.vd;
+        if (sew_ < 4 || !isGroup(vd, lmul_) || !isGroup(u_.bits.vs2, lmul_)
+            || (opd_ == VOperand_VV && !isGroup(u_.bits.vs1, lmul_))
+            || isMaskOverlap(vd)) {
+            illegal();
+            return 4;
+        }
+        uint8_t *d = vreg(vd);
+        const uint8_t *a = vreg(u_.bits.vs2);
+        const uint8_t *b = opd_ == VOperand_VV ? vreg(u_.bits.vs1) : 0;
+        uint64_t x = fpuScalarOperand();
+
+        if (!fpuBegin()) {
+            return 4;
+        }
+        int kernel = hostKernel();
+        if (kernel >= 0 && u_.bits.vm && vstart_ == 0
+            && vectorKernel(static_cast<EVectorKernel>(kernel), sew_,
+                            d, a, b, x, vl_)) {
+            for (uint32_t i = 0; i < vl_; i++) {
+                setElem(d, i, sew_, canonical(getElem(d, i, sew_), sew_));
+            }
+        } else if (sew_ == 4) {
+            loop<float>(reinterpret_cast<float *>(d),
+                        reinterpret_cast<const float *>(a),
+                        reinterpret_cast<const float *>(b),
+                        fromBits<float>(x));
+        } else {
+            loop<double>(reinterpret_cast<double *>(d),
+                         reinterpret_cast<const double *>(a),
+                         reinterpret_cast<const double *>(b),
+                         fromBits<double>(x));
+        }
+        fpuEnd();
+        done();
+        return 4;
+    }
+
+ protected:
+    int hostKernel() {
+        switch (op_) {
+        case Op_Add: return VK_FAdd;
+        case Op_Sub: return VK_FSub;
+        case Op_Mul: return VK_FMul;
+        case Op_Macc: return VK_FMacc;
+        default: return -1;
+        }
+    }
+
+    template <typename T>
+    static T fromBits(uint64_t v) {
+        union {
+            uint64_t u64;
+            T f;
+        } t;
+        t.u64 = v;
+        return t.f;
+    }
+
+    /** RISC-V fmin/fmax: NaN operand is ignored, -0.0 < +0.0 */
+    template <typename T>
+    T minmax(T a, T b, bool max) {
+        if (std::isnan(a)) {
+            return b;
+        }
+        if (std::isnan(b)) {
+            return a;
+        }
+        if (a == b) {
+            return std::signbit(a) != max ? a : b;
+        }
+        return (a < b) != max ? a : b;
+    }
+
+    template <typename T>
+    void loop(T *d, const T *a, const T *b, T x) {
+        for (uint32_t i = vstart_; i < vl_; i++) {
+            if (!isActive(i)) {
+                continue;
+            }
+            T eb = b ? b[i] : x;
+            T res;
+            switch (op_) {
+            case Op_Add: res = a[i] + eb; break;
+            case Op_Sub: res = a[i] - eb; break;
+            case Op_RSub: res = eb - a[i]; break;
+            case Op_Mul: res = a[i] * eb; break;
+            case Op_Div: res = a[i] / eb; break;
+            case Op_RDiv: res = eb / a[i]; break;
+            case Op_Min: res = minmax(a[i], eb, false); break;
+            case Op_Max: res = minmax(a[i], eb, true); break;
+            case Op_Macc: res = std::fma(eb, a[i], d[i]); break;
+            case Op_Nmsac: res = std::fma(-eb, a[i], d[i]); break;
+            default: res = std::fma(eb, d[i], a[i]);
+            }
+            d[i] = res;
+            setElem(reinterpret_cast<uint8_t *>(d), i, sizeof(T),
+                    canonical(getElem(reinterpret_cast<uint8_t *>(d), i,
+                                      sizeof(T)), sizeof(T)));
+        }
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief Floating-point compare into mask register
+ */
+class VFCmpOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_Eq, Op_Ne, Op_Lt, Op_Le, Op_Gt, Op_Ge,
+    };
+    VFCmpOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+            EVectorOperand opd, EOp op)
+        : VectorInstruction(icpu, name, bits, opd), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        if (sew_ < 4 || !isGroup(u_.bits.vs2, lmul_)
+            || (opd_ == VOperand_VV && !isGroup(u_.bits.vs1, lmul_))) {
+            illegal();
+            return 4;
+        }
+        uint8_t *d = vreg(u_.bits.vd);
+        const uint8_t *a = vreg(u_.bits.vs2);
+        const uint8_t *b = opd_ == VOperand_VV ? vreg(u_.bits.vs1) : 0;
+        uint64_t x = fpuScalarOperand();
+        if (!fpuBegin()) {
+            return 4;
+        }
+        for (uint32_t i = vstart_; i < vl_; i++) {
+            if (!isActive(i)) {
+                continue;
+            }
+            uint64_t ea = getElem(a, i, sew_);
+            uint64_t eb = b ? getElem(b, i, sew_) : x;
+            bool res;
+            if (sew_ == 4) {
+                res = compare(fromBits<float>(ea), fromBits<float>(eb));
+            } else {
+                res = compare(fromBits<double>(ea), fromBits<double>(eb));
+            }
+            setMaskBit(d, i, res);
+        }
+        fpuEnd();
+        done();
+        return 4;
+    }
+
+ protected:
+    template <typename T>
+    static T fromBits(uint64_t v) {
+        union {
+            uint64_t u64;
+            T f;
+        } t;
+        t.u64 = v;
+        return t.f;
+    }
+
+    /** Host ordered compare raises invalid on NaN as RISC-V flt/fle */
+    template <typename T>
+    bool compare(T a, T b) {
+        switch (op_) {
+        case Op_Eq: return a == b;
+        case Op_Ne: return a != b;
+        case Op_Lt: return a < b;
+        case Op_Le: return a <= b;
+        case Op_Gt: return a > b;
+        default: return a >= b;
+        }
+    }
+
+ private:
+    EOp op_;
+};
+
+/**
+ * @brief Floating-point reductions: vd[0] = vs1[0] op active vs2[*].
+ *
+ * Unordered sum is computed in the element order as the ordered one.
+ */
+class VFRedOp : public VectorInstruction {
+ public:
+    enum EOp {
+        Op_Sum, Op_Min, Op_Max,
+    };
+    VFRedOp(CpuRiver_Functional *icpu, const char *name, const char *bits,
+            EOp op)
+        : VectorInstruction(icpu, name, bits, VOperand_VV), op_(op) {}
+
+    virtual int exec(Reg64Type *payload) {
+        if (!setup(payload)) {
+            return 4;
+        }
+        if (sew_ < 4 || vstart_ || !isGroup(u_.bits.vs2, lmul_)) {
+            illegal();
+            return 4;
+        }
+        if (vl_ == 0) {
+            return 4;
+        }
+        if (!fpuBegin()) {
+            return 4;
+        }
+        uint64_t res;
+        if (sew_ == 4) {
+            res = reduce<float>();
+        } else {
+            res = reduce<double>();
+        }
+        fpuEnd();
+        setElem(vreg(u_.bits.vd), 0, sew_, canonical(res, sew_));
+        return 4;
+    }
+
+ protected:
+    template <typename T>
+    uint64_t reduce() {
+        const T *a = reinterpret_cast<const T *>(vreg(u_.bits.vs2));
+        union {
+            uint64_t u64;
+            T f;
+        } acc;
+        acc.u64 = getElem(vreg(u_.bits.vs1), 0, sizeof(T));
+        for (uint32_t i = 0; i < vl_; i++) {
+            if (!isActive(i)) {
+                continue;
+            }
+            if (op_ == Op_Sum) {
+                acc.f += a[i];
+            } else if (std::isnan(acc.f)
+                || (!std::isnan(a[i])
+                    && ((op_ == Op_Min) == (a[i] < acc.f)))) {
+                acc.f = a[i];
+            }
+        }
+        return zext(acc.u64, sizeof(T));
+    }
+
+ private:
+    EOp op_;
+};
+
+void CpuRiver_Functional::addIsaExtensionV() {
+    uint64_t vlen = vlen_.to_uint64();
+    if (vlen < 64 || vlen > 65536 || (vlen & (vlen - 1))) {
+        RISCV_error("Wrong VLEN=%" RV_PRI64 "d, use 128", vlen);
+        vlen = 128;
+    }
+    vlenb_ = static_cast<uint32_t>(vlen / 8);
+    vregs_ = new uint8_t[32 * vlenb_];
+
+    // Configuration-setting
+    addSupportedInstruction(new VSETVL(this, "VSETVLI",
+        "0??????????????????111?????1010111", VSETVL::Form_VLI));
+    addSupportedInstruction(new VSETVL(this, "VSETIVLI",
+        "11?????????????????111?????1010111", VSETVL::Form_IVLI));
+    addSupportedInstruction(new VSETVL(this, "VSETVL",
+        "1000000??????????111?????1010111", VSETVL::Form_VL));
+
+    // Loads and stores
+    addSupportedInstruction(new VMemOp(this, "VLE8_V",
+        "000000?00000?????000?????0000111", 1, VMemOp::Mode_Unit, false));
+    addSupportedInstruction(new VMemOp(this, "VLSE8_V",
+        "000010???????????000?????0000111", 1, VMemOp::Mode_Strided, false));
+    addSupportedInstruction(new VMemOp(this, "VLUXEI8_V",
+        "000001???????????000?????0000111", 1, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VLOXEI8_V",
+        "000011???????????000?????0000111", 1, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VLE16_V",
+        "000000?00000?????101?????0000111", 2, VMemOp::Mode_Unit, false));
+    addSupportedInstruction(new VMemOp(this, "VLSE16_V",
+        "000010???????????101?????0000111", 2, VMemOp::Mode_Strided, false));
+    addSupportedInstruction(new VMemOp(this, "VLUXEI16_V",
+        "000001???????????101?????0000111", 2, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VLOXEI16_V",
+        "000011???????????101?????0000111", 2, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VLE32_V",
+        "000000?00000?????110?????0000111", 4, VMemOp::Mode_Unit, false));
+    addSupportedInstruction(new VMemOp(this, "VLSE32_V",
+        "000010???????????110?????0000111", 4, VMemOp::Mode_Strided, false));
+    addSupportedInstruction(new VMemOp(this, "VLUXEI32_V",
+        "000001???????????110?????0000111", 4, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VLOXEI32_V",
+        "000011???????????110?????0000111", 4, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VLE64_V",
+        "000000?00000?????111?????0000111", 8, VMemOp::Mode_Unit, false));
+    addSupportedInstruction(new VMemOp(this, "VLSE64_V",
+        "000010???????????111?????0000111", 8, VMemOp::Mode_Strided, false));
+    addSupportedInstruction(new VMemOp(this, "VLUXEI64_V",
+        "000001???????????111?????0000111", 8, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VLOXEI64_V",
+        "000011???????????111?????0000111", 8, VMemOp::Mode_Indexed, false));
+    addSupportedInstruction(new VMemOp(this, "VSE8_V",
+        "000000?00000?????000?????0100111", 1, VMemOp::Mode_Unit, true));
+    addSupportedInstruction(new VMemOp(this, "VSSE8_V",
+        "000010???????????000?????0100111", 1, VMemOp::Mode_Strided, true));
+    addSupportedInstruction(new VMemOp(this, "VSUXEI8_V",
+        "000001???????????000?????0100111", 1, VMemOp::Mode_Indexed, true));
+    addSupportedInstruction(new VMemOp(this, "VSOXEI8_V",
+        "000011???????????000?????0100111", 1, VMemOp::Mode_Indexed, true));
+    addSupportedInstruction(new VMemOp(this, "VSE16_V",
+        "000000?00000?????101?????0100111", 2, VMemOp::Mode_Unit, true));
+    addSupportedInstruction(new VMemOp(this, "VSSE16_V",
+        "000010???????????101?????0100111", 2, VMemOp::Mode_Strided, true));
+    addSupportedInstruction(new VMemOp(this, "VSUXEI16_V",
+        "000001???????????101?????0100111", 2, VMemOp::Mode_Indexed, true));
+    addSupportedInstruction(new VMemOp(this, "VSOXEI16_V",
+        "000011???????????101?????0100111", 2, VMemOp::Mode_Indexed, true));
+    addSupportedInstruction(new VMemOp(this, "VSE32_V",
+        "000000?00000?????110?????0100111", 4, VMemOp::Mode_Unit, true));
+    addSupportedInstruction(new VMemOp(this, "VSSE32_V",
+        "000010???????????110?????0100111", 4, VMemOp::Mode_Strided, true));
+    addSupportedInstruction(new VMemOp(this, "VSUXEI32_V",
+        "000001???????????110?????0100111", 4, VMemOp::Mode_Indexed, true));
+    addSupportedInstruction(new VMemOp(this, "VSOXEI32_V",
+        "000011???????????110?????0100111", 4, VMemOp::Mode_Indexed, true));
+    addSupportedInstruction(new VMemOp(this, "VSE64_V",
+        "000000?00000?????111?????0100111", 8, VMemOp::Mode_Unit, true));
+    addSupportedInstruction(new VMemOp(this, "VSSE64_V",
+        "000010???????????111?????0100111", 8, VMemOp::Mode_Strided, true));
+    addSupportedInstruction(new VMemOp(this, "VSUXEI64_V",
+        "000001???????????111?????0100111", 8, VMemOp::Mode_Indexed, true));
+    addSupportedInstruction(new VMemOp(this, "VSOXEI64_V",
+        "000011???????????111?????0100111", 8, VMemOp::Mode_Indexed, true));
+
+    // Integer arithmetic
+    addSupportedInstruction(new VIntOp(this, "VADD_VV",
+        "000000???????????000?????1010111", VOperand_VV, VIntOp::Op_Add));
+    addSupportedInstruction(new VIntOp(this, "VADD_VX",
+        "000000???????????100?????1010111", VOperand_VX, VIntOp::Op_Add));
+    addSupportedInstruction(new VIntOp(this, "VADD_VI",
+        "000000???????????011?????1010111", VOperand_VI, VIntOp::Op_Add));
+    addSupportedInstruction(new VIntOp(this, "VSUB_VV",
+        "000010???????????000?????1010111", VOperand_VV, VIntOp::Op_Sub));
+    addSupportedInstruction(new VIntOp(this, "VSUB_VX",
+        "000010???????????100?????1010111", VOperand_VX, VIntOp::Op_Sub));
+    addSupportedInstruction(new VIntOp(this, "VRSUB_VX",
+        "000011???????????100?????1010111", VOperand_VX, VIntOp::Op_RSub));
+    addSupportedInstruction(new VIntOp(this, "VRSUB_VI",
+        "000011???????????011?????1010111", VOperand_VI, VIntOp::Op_RSub));
+    addSupportedInstruction(new VIntOp(this, "VMINU_VV",
+        "000100???????????000?????1010111", VOperand_VV, VIntOp::Op_MinU));
+    addSupportedInstruction(new VIntOp(this, "VMINU_VX",
+        "000100???????????100?????1010111", VOperand_VX, VIntOp::Op_MinU));
+    addSupportedInstruction(new VIntOp(this, "VMIN_VV",
+        "000101???????????000?????1010111", VOperand_VV, VIntOp::Op_Min));
+    addSupportedInstruction(new VIntOp(this, "VMIN_VX",
+        "000101???????????100?????1010111", VOperand_VX, VIntOp::Op_Min));
+    addSupportedInstruction(new VIntOp(this, "VMAXU_VV",
+        "000110???????????000?????1010111", VOperand_VV, VIntOp::Op_MaxU));
+    addSupportedInstruction(new VIntOp(this, "VMAXU_VX",
+        "000110???????????100?????1010111", VOperand_VX, VIntOp::Op_MaxU));
+    addSupportedInstruction(new VIntOp(this, "VMAX_VV",
+        "000111???????????000?????1010111", VOperand_VV, VIntOp::Op_Max));
+    addSupportedInstruction(new VIntOp(this, "VMAX_VX",
+        "000111???????????100?????1010111", VOperand_VX, VIntOp::Op_Max));
+    addSupportedInstruction(new VIntOp(this, "VAND_VV",
+        "001001???????????000?????1010111", VOperand_VV, VIntOp::Op_And));
+    addSupportedInstruction(new VIntOp(this, "VAND_VX",
+        "001001???????????100?????1010111", VOperand_VX, VIntOp::Op_And));
+    addSupportedInstruction(new VIntOp(this, "VAND_VI",
+        "001001???????????011?????1010111", VOperand_VI, VIntOp::Op_And));
+    addSupportedInstruction(new VIntOp(this, "VOR_VV",
+        "001010???????????000?????1010111", VOperand_VV, VIntOp::Op_Or));
+    addSupportedInstruction(new VIntOp(this, "VOR_VX",
+        "001010???????????100?????1010111", VOperand_VX, VIntOp::Op_Or));
+    addSupportedInstruction(new VIntOp(this, "VOR_VI",
+        "001010???????????011?????1010111", VOperand_VI, VIntOp::Op_Or));
+    addSupportedInstruction(new VIntOp(this, "VXOR_VV",
+        "001011???????????000?????1010111", VOperand_VV, VIntOp::Op_Xor));
+    addSupportedInstruction(new VIntOp(this, "VXOR_VX",
+        "001011???????????100?????1010111", VOperand_VX, VIntOp::Op_Xor));
+    addSupportedInstruction(new VIntOp(this, "VXOR_VI",
+        "001011???????????011?????1010111", VOperand_VI, VIntOp::Op_Xor));
+    addSupportedInstruction(new VIntOp(this, "VSLL_VV",
+        "100101???????????000?????1010111", VOperand_VV, VIntOp::Op_Sll));
+    addSupportedInstruction(new VIntOp(this, "VSLL_VX",
+        "100101???????????100?????1010111", VOperand_VX, VIntOp::Op_Sll));
+    addSupportedInstruction(new VIntOp(this, "VSLL_VI",
+        "100101???????????011?????1010111", VOperand_VI, VIntOp::Op_Sll));
+    addSupportedInstruction(new VIntOp(this, "VSRL_VV",
+        "101000???????????000?????1010111", VOperand_VV, VIntOp::Op_Srl));
+    addSupportedInstruction(new VIntOp(this, "VSRL_VX",
+        "101000???????????100?????1010111", VOperand_VX, VIntOp::Op_Srl));
+    addSupportedInstruction(new VIntOp(this, "VSRL_VI",
+        "101000???????????011?????1010111", VOperand_VI, VIntOp::Op_Srl));
+    addSupportedInstruction(new VIntOp(this, "VSRA_VV",
+        "101001???????????000?????1010111", VOperand_VV, VIntOp::Op_Sra));
+    addSupportedInstruction(new VIntOp(this, "VSRA_VX",
+        "101001???????????100?????1010111", VOperand_VX, VIntOp::Op_Sra));
+    addSupportedInstruction(new VIntOp(this, "VSRA_VI",
+        "101001???????????011?????1010111", VOperand_VI, VIntOp::Op_Sra));
+    addSupportedInstruction(new VIntOp(this, "VMUL_VV",
+        "100101???????????010?????1010111", VOperand_VV, VIntOp::Op_Mul));
+    addSupportedInstruction(new VIntOp(this, "VMUL_VX",
+        "100101???????????110?????1010111", VOperand_VX, VIntOp::Op_Mul));
+    addSupportedInstruction(new VIntOp(this, "VMULH_VV",
+        "100111???????????010?????1010111", VOperand_VV, VIntOp::Op_MulH));
+    addSupportedInstruction(new VIntOp(this, "VMULH_VX",
+        "100111???????????110?????1010111", VOperand_VX, VIntOp::Op_MulH));
+    addSupportedInstruction(new VIntOp(this, "VMULHU_VV",
+        "100100???????????010?????1010111", VOperand_VV, VIntOp::Op_MulHU));
+    addSupportedInstruction(new VIntOp(this, "VMULHU_VX",
+        "100100???????????110?????1010111", VOperand_VX, VIntOp::Op_MulHU));
+    addSupportedInstruction(new VIntOp(this, "VMACC_VV",
+        "101101???????????010?????1010111", VOperand_VV, VIntOp::Op_Macc));
+    addSupportedInstruction(new VIntOp(this, "VMACC_VX",
+        "101101???????????110?????1010111", VOperand_VX, VIntOp::Op_Macc));
+    addSupportedInstruction(new VIntOp(this, "VNMSAC_VV",
+        "101111???????????010?????1010111", VOperand_VV, VIntOp::Op_Nmsac));
+    addSupportedInstruction(new VIntOp(this, "VNMSAC_VX",
+        "101111???????????110?????1010111", VOperand_VX, VIntOp::Op_Nmsac));
+    addSupportedInstruction(new VIntOp(this, "VMADD_VV",
+        "101001???????????010?????1010111", VOperand_VV, VIntOp::Op_Madd));
+    addSupportedInstruction(new VIntOp(this, "VMADD_VX",
+        "101001???????????110?????1010111", VOperand_VX, VIntOp::Op_Madd));
+    addSupportedInstruction(new VWideOp(this, "VWMULU_VV",
+        "111000???????????010?????1010111", VOperand_VV, VWideOp::Op_WMulU));
+    addSupportedInstruction(new VWideOp(this, "VWMULU_VX",
+        "111000???????????110?????1010111", VOperand_VX, VWideOp::Op_WMulU));
+    addSupportedInstruction(new VWideOp(this, "VWMUL_VV",
+        "111011???????????010?????1010111", VOperand_VV, VWideOp::Op_WMul));
+    addSupportedInstruction(new VWideOp(this, "VWMUL_VX",
+        "111011???????????110?????1010111", VOperand_VX, VWideOp::Op_WMul));
+    addSupportedInstruction(new VWideOp(this, "VWMACCU_VV",
+        "111100???????????010?????1010111", VOperand_VV, VWideOp::Op_WMaccU));
+    addSupportedInstruction(new VWideOp(this, "VWMACCU_VX",
+        "111100???????????110?????1010111", VOperand_VX, VWideOp::Op_WMaccU));
+    addSupportedInstruction(new VWideOp(this, "VWMACC_VV",
+        "111101???????????010?????1010111", VOperand_VV, VWideOp::Op_WMacc));
+    addSupportedInstruction(new VWideOp(this, "VWMACC_VX",
+        "111101???????????110?????1010111", VOperand_VX, VWideOp::Op_WMacc));
+
+    // Integer compare
+    addSupportedInstruction(new VCmpOp(this, "VMSEQ_VV",
+        "011000???????????000?????1010111", VOperand_VV, VCmpOp::Op_Eq));
+    addSupportedInstruction(new VCmpOp(this, "VMSEQ_VX",
+        "011000???????????100?????1010111", VOperand_VX, VCmpOp::Op_Eq));
+    addSupportedInstruction(new VCmpOp(this, "VMSEQ_VI",
+        "011000???????????011?????1010111", VOperand_VI, VCmpOp::Op_Eq));
+    addSupportedInstruction(new VCmpOp(this, "VMSNE_VV",
+        "011001???????????000?????1010111", VOperand_VV, VCmpOp::Op_Ne));
+    addSupportedInstruction(new VCmpOp(this, "VMSNE_VX",
+        "011001???????????100?????1010111", VOperand_VX, VCmpOp::Op_Ne));
+    addSupportedInstruction(new VCmpOp(this, "VMSNE_VI",
+        "011001???????????011?????1010111", VOperand_VI, VCmpOp::Op_Ne));
+    addSupportedInstruction(new VCmpOp(this, "VMSLTU_VV",
+        "011010???????????000?????1010111", VOperand_VV, VCmpOp::Op_LtU));
+    addSupportedInstruction(new VCmpOp(this, "VMSLTU_VX",
+        "011010???????????100?????1010111", VOperand_VX, VCmpOp::Op_LtU));
+    addSupportedInstruction(new VCmpOp(this, "VMSLT_VV",
+        "011011???????????000?????1010111", VOperand_VV, VCmpOp::Op_Lt));
+    addSupportedInstruction(new VCmpOp(this, "VMSLT_VX",
+        "011011???????????100?????1010111", VOperand_VX, VCmpOp::Op_Lt));
+    addSupportedInstruction(new VCmpOp(this, "VMSLEU_VV",
+        "011100???????????000?????1010111", VOperand_VV, VCmpOp::Op_LeU));
+    addSupportedInstruction(new VCmpOp(this, "VMSLEU_VX",
+        "011100???????????100?????1010111", VOperand_VX, VCmpOp::Op_LeU));
+    addSupportedInstruction(new VCmpOp(this, "VMSLEU_VI",
+        "011100???????????011?????1010111", VOperand_VI, VCmpOp::Op_LeU));
+    addSupportedInstruction(new VCmpOp(this, "VMSLE_VV",
+        "011101???????????000?????1010111", VOperand_VV, VCmpOp::Op_Le));
+    addSupportedInstruction(new VCmpOp(this, "VMSLE_VX",
+        "011101???????????100?????1010111", VOperand_VX, VCmpOp::Op_Le));
+    addSupportedInstruction(new VCmpOp(this, "VMSLE_VI",
+        "011101???????????011?????1010111", VOperand_VI, VCmpOp::Op_Le));
+    addSupportedInstruction(new VCmpOp(this, "VMSGTU_VX",
+        "011110???????????100?????1010111", VOperand_VX, VCmpOp::Op_GtU));
+    addSupportedInstruction(new VCmpOp(this, "VMSGTU_VI",
+        "011110???????????011?????1010111", VOperand_VI, VCmpOp::Op_GtU));
+    addSupportedInstruction(new VCmpOp(this, "VMSGT_VX",
+        "011111???????????100?????1010111", VOperand_VX, VCmpOp::Op_Gt));
+    addSupportedInstruction(new VCmpOp(this, "VMSGT_VI",
+        "011111???????????011?????1010111", VOperand_VI, VCmpOp::Op_Gt));
+
+    // Integer reductions
+    addSupportedInstruction(new VRedOp(this, "VREDSUM_VS",
+        "000000???????????010?????1010111", VRedOp::Op_Sum));
+    addSupportedInstruction(new VRedOp(this, "VREDAND_VS",
+        "000001???????????010?????1010111", VRedOp::Op_And));
+    addSupportedInstruction(new VRedOp(this, "VREDOR_VS",
+        "000010???????????010?????1010111", VRedOp::Op_Or));
+    addSupportedInstruction(new VRedOp(this, "VREDXOR_VS",
+        "000011???????????010?????1010111", VRedOp::Op_Xor));
+    addSupportedInstruction(new VRedOp(this, "VREDMINU_VS",
+        "000100???????????010?????1010111", VRedOp::Op_MinU));
+    addSupportedInstruction(new VRedOp(this, "VREDMIN_VS",
+        "000101???????????010?????1010111", VRedOp::Op_Min));
+    addSupportedInstruction(new VRedOp(this, "VREDMAXU_VS",
+        "000110???????????010?????1010111", VRedOp::Op_MaxU));
+    addSupportedInstruction(new VRedOp(this, "VREDMAX_VS",
+        "000111???????????010?????1010111", VRedOp::Op_Max));
+    addSupportedInstruction(new VRedOp(this, "VWREDSUMU_VS",
+        "110000???????????000?????1010111", VRedOp::Op_WSumU));
+    addSupportedInstruction(new VRedOp(this, "VWREDSUM_VS",
+        "110001???????????000?????1010111", VRedOp::Op_WSum));
+
+    // Moves, merges and mask instructions
+    addSupportedInstruction(new VMergeOp(this, "VMV_V_V",
+        "010111100000?????000?????1010111", VOperand_VV, false));
+    addSupportedInstruction(new VMergeOp(this, "VMERGE_VVM",
+        "0101110??????????000?????1010111", VOperand_VV, false));
+    addSupportedInstruction(new VMergeOp(this, "VMV_V_X",
+        "010111100000?????100?????1010111", VOperand_VX, false));
+    addSupportedInstruction(new VMergeOp(this, "VMERGE_VXM",
+        "0101110??????????100?????1010111", VOperand_VX, false));
+    addSupportedInstruction(new VMergeOp(this, "VMV_V_I",
+        "010111100000?????011?????1010111", VOperand_VI, false));
+    addSupportedInstruction(new VMergeOp(this, "VMERGE_VIM",
+        "0101110??????????011?????1010111", VOperand_VI, false));
+    addSupportedInstruction(new VScalarOp(this, "VMV_X_S",
+        "0100001?????00000010?????1010111", VScalarOp::Op_MvXS));
+    addSupportedInstruction(new VScalarOp(this, "VMV_S_X",
+        "010000100000?????110?????1010111", VScalarOp::Op_MvSX));
+    addSupportedInstruction(new VScalarOp(this, "VCPOP_M",
+        "010000??????10000010?????1010111", VScalarOp::Op_CPop));
+    addSupportedInstruction(new VScalarOp(this, "VFIRST_M",
+        "010000??????10001010?????1010111", VScalarOp::Op_First));
+    addSupportedInstruction(new VMaskOp(this, "VMANDN_MM",
+        "0110001??????????010?????1010111", VMaskOp::Op_AndN));
+    addSupportedInstruction(new VMaskOp(this, "VMAND_MM",
+        "0110011??????????010?????1010111", VMaskOp::Op_And));
+    addSupportedInstruction(new VMaskOp(this, "VMOR_MM",
+        "0110101??????????010?????1010111", VMaskOp::Op_Or));
+    addSupportedInstruction(new VMaskOp(this, "VMXOR_MM",
+        "0110111??????????010?????1010111", VMaskOp::Op_Xor));
+
+    // Floating-point
+    addSupportedInstruction(new VFpuOp(this, "VFADD_VV",
+        "000000???????????001?????1010111", VOperand_VV, VFpuOp::Op_Add));
+    addSupportedInstruction(new VFpuOp(this, "VFADD_VF",
+        "000000???????????101?????1010111", VOperand_VX, VFpuOp::Op_Add));
+    addSupportedInstruction(new VFpuOp(this, "VFSUB_VV",
+        "000010???????????001?????1010111", VOperand_VV, VFpuOp::Op_Sub));
+    addSupportedInstruction(new VFpuOp(this, "VFSUB_VF",
+        "000010???????????101?????1010111", VOperand_VX, VFpuOp::Op_Sub));
+    addSupportedInstruction(new VFpuOp(this, "VFMIN_VV",
+        "000100???????????001?????1010111", VOperand_VV, VFpuOp::Op_Min));
+    addSupportedInstruction(new VFpuOp(this, "VFMIN_VF",
+        "000100???????????101?????1010111", VOperand_VX, VFpuOp::Op_Min));
+    addSupportedInstruction(new VFpuOp(this, "VFMAX_VV",
+        "000110???????????001?????1010111", VOperand_VV, VFpuOp::Op_Max));
+    addSupportedInstruction(new VFpuOp(this, "VFMAX_VF",
+        "000110???????????101?????1010111", VOperand_VX, VFpuOp::Op_Max));
+    addSupportedInstruction(new VFpuOp(this, "VFDIV_VV",
+        "100000???????????001?????1010111", VOperand_VV, VFpuOp::Op_Div));
+    addSupportedInstruction(new VFpuOp(this, "VFDIV_VF",
+        "100000???????????101?????1010111", VOperand_VX, VFpuOp::Op_Div));
+    addSupportedInstruction(new VFpuOp(this, "VFRDIV_VF",
+        "100001???????????101?????1010111", VOperand_VX, VFpuOp::Op_RDiv));
+    addSupportedInstruction(new VFpuOp(this, "VFMUL_VV",
+        "100100???????????001?????1010111", VOperand_VV, VFpuOp::Op_Mul));
+    addSupportedInstruction(new VFpuOp(this, "VFMUL_VF",
+        "100100???????????101?????1010111", VOperand_VX, VFpuOp::Op_Mul));
+    addSupportedInstruction(new VFpuOp(this, "VFRSUB_VF",
+        "100111???????????101?????1010111", VOperand_VX, VFpuOp::Op_RSub));
+    addSupportedInstruction(new VFpuOp(this, "VFMADD_VV",
+        "101000???????????001?????1010111", VOperand_VV, VFpuOp::Op_Madd));
+    addSupportedInstruction(new VFpuOp(this, "VFMADD_VF",
+        "101000???????????101?????1010111", VOperand_VX, VFpuOp::Op_Madd));
+    addSupportedInstruction(new VFpuOp(this, "VFMACC_VV",
+        "101100???????????001?????1010111", VOperand_VV, VFpuOp::Op_Macc));
+    addSupportedInstruction(new VFpuOp(this, "VFMACC_VF",
+        "101100???????????101?????1010111", VOperand_VX, VFpuOp::Op_Macc));
+    addSupportedInstruction(new VFpuOp(this, "VFNMSAC_VV",
+        "101111???????????001?????1010111", VOperand_VV, VFpuOp::Op_Nmsac));
+    addSupportedInstruction(new VFpuOp(this, "VFNMSAC_VF",
+        "101111???????????101?????1010111", VOperand_VX, VFpuOp::Op_Nmsac));
+    addSupportedInstruction(new VFCmpOp(this, "VMFEQ_VV",
+        "011000???????????001?????1010111", VOperand_VV, VFCmpOp::Op_Eq));
+    addSupportedInstruction(new VFCmpOp(this, "VMFEQ_VF",
+        "011000???????????101?????1010111", VOperand_VX, VFCmpOp::Op_Eq));
+    addSupportedInstruction(new VFCmpOp(this, "VMFLE_VV",
+        "011001???????????001?????1010111", VOperand_VV, VFCmpOp::Op_Le));
+    addSupportedInstruction(new VFCmpOp(this, "VMFLE_VF",
+        "011001???????????101?????1010111", VOperand_VX, VFCmpOp::Op_Le));
+    addSupportedInstruction(new VFCmpOp(this, "VMFLT_VV",
+        "011011???????????001?????1010111", VOperand_VV, VFCmpOp::Op_Lt));
+    addSupportedInstruction(new VFCmpOp(this, "VMFLT_VF",
+        "011011???????????101?????1010111", VOperand_VX, VFCmpOp::Op_Lt));
+    addSupportedInstruction(new VFCmpOp(this, "VMFNE_VV",
+        "011100???????????001?????1010111", VOperand_VV, VFCmpOp::Op_Ne));
+    addSupportedInstruction(new VFCmpOp(this, "VMFNE_VF",
+        "011100???????????101?????1010111", VOperand_VX, VFCmpOp::Op_Ne));
+    addSupportedInstruction(new VFCmpOp(this, "VMFGT_VF",
+        "011101???????????101?????1010111", VOperand_VX, VFCmpOp::Op_Gt));
+    addSupportedInstruction(new VFCmpOp(this, "VMFGE_VF",
+        "011111???????????101?????1010111", VOperand_VX, VFCmpOp::Op_Ge));
+    addSupportedInstruction(new VFRedOp(this, "VFREDUSUM_VS",
+        "000001???????????001?????1010111", VFRedOp::Op_Sum));
+    addSupportedInstruction(new VFRedOp(this, "VFREDOSUM_VS",
+        "000011???????????001?????1010111", VFRedOp::Op_Sum));
+    addSupportedInstruction(new VFRedOp(this, "VFREDMIN_VS",
+        "000101???????????001?????1010111", VFRedOp::Op_Min));
+    addSupportedInstruction(new VFRedOp(this, "VFREDMAX_VS",
+        "000111???????????001?????1010111", VFRedOp::Op_Max));
+    addSupportedInstruction(new VScalarOp(this, "VFMV_F_S",
+        "0100001?????00000001?????1010111", VScalarOp::Op_FMvFS));
+    addSupportedInstruction(new VScalarOp(this, "VFMV_S_F",
+        "010000100000?????101?????1010111", VScalarOp::Op_FMvSF));
+    addSupportedInstruction(new VMergeOp(this, "VFMV_V_F",
+        "010111100000?????101?????1010111", VOperand_VX, true));
+    addSupportedInstruction(new VMergeOp(this, "VFMERGE_VFM",
+        "0101110??????????101?????1010111", VOperand_VX, true));
+    addSupportedInstruction(new VMVNR_V(this));
+
+    portCSR_.write(CSR_misa, portCSR_.read(CSR_misa).val | (1LL << ('V' - 'A')));
+}
+
+}  // namespace debugger
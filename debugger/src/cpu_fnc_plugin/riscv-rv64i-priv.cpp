@@ -39,6 +39,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (!icpu_->isCsrAccessible(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t clr_mask = ~R[u.bits.rs1];
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -46,6 +50,9 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr & clr_mask));
+        if (u.bits.rs1) {
+            icpu_->notifyCsrWrite(u.bits.imm, (csr & clr_mask));
+        }
         return 4;
     }
 };
@@ -65,6 +72,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (!icpu_->isCsrAccessible(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t clr_mask = ~static_cast<uint64_t>((u.bits.rs1));
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -72,6 +83,9 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr & clr_mask));
+        if (u.bits.rs1) {
+            icpu_->notifyCsrWrite(u.bits.imm, (csr & clr_mask));
+        }
         return 4;
     }
 };
@@ -95,6 +109,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (!icpu_->isCsrAccessible(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t set_mask = R[u.bits.rs1];
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -102,6 +120,9 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr | set_mask));
+        if (u.bits.rs1) {
+            icpu_->notifyCsrWrite(u.bits.imm, (csr | set_mask));
+        }
         return 4;
     }
 };
@@ -121,6 +142,10 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (!icpu_->isCsrAccessible(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t set_mask = u.bits.rs1;
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -128,6 +153,9 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr | set_mask));
+        if (u.bits.rs1) {
+            icpu_->notifyCsrWrite(u.bits.imm, (csr | set_mask));
+        }
         return 4;
     }
 };
@@ -149,12 +177,17 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (!icpu_->isCsrAccessible(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t wr_value = R[u.bits.rs1];
         if (u.bits.rd) {
             icpu_->setReg(u.bits.rd, icpu_->readCSR(u.bits.imm));
         }
         icpu_->writeCSR(u.bits.imm, wr_value);
+        icpu_->notifyCsrWrite(u.bits.imm, wr_value);
         return 4;
     }
 };
@@ -174,12 +207,17 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         u.value = payload->buf32[0];
+        if (!icpu_->isCsrAccessible(u.bits.imm)) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
 
         uint64_t wr_value = u.bits.rs1;
         if (u.bits.rd) {
             icpu_->setReg(u.bits.rd, icpu_->readCSR(u.bits.imm));
         }
         icpu_->writeCSR(u.bits.imm, wr_value);
+        icpu_->notifyCsrWrite(u.bits.imm, wr_value);
         return 4;
     }
 };
@@ -213,6 +251,7 @@ public:
 
         uint64_t xepc = (ICpuRiscV::PRV_U << 8) + 0x41;
         icpu_->setBranch(icpu_->readCSR(static_cast<uint32_t>(xepc)));
+        icpu_->returnFromTrap();
 
         icpu_->setPrvLevel(ICpuRiscV::PRV_U);
         icpu_->writeCSR(ICpuRiscV::CSR_mstatus, mstatus.value);
@@ -238,6 +277,7 @@ public:
 
         uint64_t xepc = (ICpuRiscV::PRV_S << 8) + 0x41;
         icpu_->setBranch(icpu_->readCSR(static_cast<uint32_t>(xepc)));
+        icpu_->returnFromTrap();
 
         mstatus.bits.SIE = mstatus.bits.SPIE;
         mstatus.bits.SPIE = 1;
@@ -281,6 +321,7 @@ public:
 
         uint64_t xepc = (ICpuRiscV::PRV_M << 8) + 0x41;
         icpu_->setBranch(icpu_->readCSR(static_cast<uint32_t>(xepc)));
+        icpu_->returnFromTrap();
 
         mstatus.bits.MIE = mstatus.bits.MPIE;
         mstatus.bits.MPIE = 1;
@@ -292,6 +333,33 @@ public:
     }
 };
 
+/**
+ * @brief WFI wait for interrupt
+ *
+ * Instruction is repeated while no enabled interrupt is pending (mip & mie
+ * regardless of mstatus.MIE), with IdleSkip the step counter jumps to the
+ * next step callback. It is a NOP when no interrupt is enabled at all.
+ */
+class WFI : public RiscvInstruction {
+public:
+    WFI(CpuRiver_Functional *icpu) :
+        RiscvInstruction(icpu, "WFI", "00010000010100000000000001110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        csr_mstatus_type mstatus;
+        mstatus.value = icpu_->readCSR(ICpuRiscV::CSR_mstatus);
+        if (mstatus.bits.TW && icpu_->getPrvLevel() != ICpuRiscV::PRV_M) {
+            icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
+            return 4;
+        }
+        uint64_t mie = icpu_->readCSR(ICpuRiscV::CSR_mie);
+        if (mie && (icpu_->readCSR(ICpuRiscV::CSR_mip) & mie) == 0) {
+            icpu_->setBranch(icpu_->getPC());
+        }
+        return 4;
+    }
+};
+
 
 /** 
  * @brief FENCE (memory barrier)
@@ -311,7 +379,8 @@ public:
 /** 
  * @brief FENCE_I (memory barrier)
  *
- * Not used in functional model so that cache is not modeling.
+ * Cache is not modeling in functional model but predecoded instructions
+ * should be dropped to see modified code.
  */
 class FENCE_I : public RiscvInstruction {
 public:
@@ -319,6 +388,7 @@ public:
         RiscvInstruction(icpu, "FENCE_I", "?????????????????001?????0001111") {}
 
     virtual int exec(Reg64Type *payload) {
+        icpu_->flush(~0ull);
         return 4;
     }
 };
@@ -333,7 +403,17 @@ public:
         RiscvInstruction(icpu, "SFENCE_VMA", "0001001??????????000000001110011") {}
 
     virtual int exec(Reg64Type *payload) {
-        icpu_->flushMmu();
+        ISA_R_type u;
+        u.value = payload->buf32[0];
+        uint64_t va = CpuRiver_Functional::TLB_FLUSH_ALL;
+        uint64_t asid = CpuRiver_Functional::TLB_FLUSH_ALL;
+        if (u.bits.rs1) {
+            va = R[u.bits.rs1];
+        }
+        if (u.bits.rs2) {
+            asid = R[u.bits.rs2];
+        }
+        icpu_->flushTlb(va, asid);
         return 4;
     }
 };
@@ -400,11 +480,11 @@ void CpuRiver_Functional::addIsaPrivilegedRV64I() {
     addSupportedInstruction(new SFENCE_VMA(this));
     addSupportedInstruction(new ECALL(this));
     addSupportedInstruction(new EBREAK(this));
+    addSupportedInstruction(new WFI(this));
 
     // TODO:
     /*
   def DRET               = BitPat("b01111011001000000000000001110011")
-  def WFI                = BitPat("b00010000010100000000000001110011")  // wait for interrupt
 
     def RDCYCLE            = BitPat("b11000000000000000010?????1110011")
     def RDTIME             = BitPat("b11000000000100000010?????1110011")
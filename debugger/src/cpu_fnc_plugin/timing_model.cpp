@@ -0,0 +1,265 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include <riscv-isa.h>
+#include "timing_model.h"
+
+namespace debugger {
+
+// CFG_LOG2_L1CACHE_BYTES_PER_LINE and CFG_L2_LOG2_BYTES_PER_LINE of River
+static const int TIMING_LINE_BITS = 5;
+static const uint64_t TIMING_LINE_EMPTY = ~0ull;
+
+CacheTimingModel::CacheTimingModel() {
+    tags_ = 0;
+    ways_ = 0;
+    setmask_ = 0;
+}
+
+CacheTimingModel::~CacheTimingModel() {
+    if (tags_) {
+        delete [] tags_;
+    }
+}
+
+bool CacheTimingModel::init(uint32_t kbytes, uint32_t ways) {
+    if (ways == 0) {
+        return false;
+    }
+    uint64_t lines = (1024ull * kbytes) >> TIMING_LINE_BITS;
+    uint64_t sets = lines / ways;
+    if (sets == 0 || (sets & (sets - 1)) || sets * ways != lines) {
+        return false;
+    }
+    if (tags_) {
+        delete [] tags_;
+    }
+    tags_ = new uint64_t[lines];
+    ways_ = ways;
+    setmask_ = sets - 1;
+    flush();
+    return true;
+}
+
+void CacheTimingModel::flush() {
+    if (!tags_) {
+        return;
+    }
+    for (uint64_t i = 0; i < (setmask_ + 1) * ways_; i++) {
+        tags_[i] = TIMING_LINE_EMPTY;
+    }
+}
+
+bool CacheTimingModel::access(uint64_t addr) {
+    uint64_t line = addr >> TIMING_LINE_BITS;
+    uint64_t *set = &tags_[(line & setmask_) * ways_];
+    uint32_t i = 0;
+    while (i < ways_ && set[i] != line) {
+        i++;
+    }
+    bool hit = i < ways_;
+    if (!hit) {
+        i = ways_ - 1;      // evict the least recently used
+    }
+    memmove(&set[1], &set[0], i * sizeof(uint64_t));
+    set[0] = line;
+    return hit;
+}
+
+BranchTimingModel::BranchTimingModel() {
+    btbsize_ = 0;
+    rasdepth_ = 0;
+    flush();
+}
+
+void BranchTimingModel::init(uint32_t btbsize, uint32_t rasdepth) {
+    btbsize_ = btbsize < BTB_SIZE_MAX ? btbsize : BTB_SIZE_MAX;
+    rasdepth_ = rasdepth < RAS_DEPTH_MAX ? rasdepth : RAS_DEPTH_MAX;
+    flush();
+}
+
+void BranchTimingModel::flush() {
+    for (int i = 0; i < BTB_SIZE_MAX; i++) {
+        btb_[i].pc = ~0ull;
+        btb_[i].npc = 0;
+    }
+    rastop_ = 0;
+    rascnt_ = 0;
+}
+
+bool BranchTimingModel::predict(uint64_t pc, uint32_t payload, int oplen,
+                                uint64_t npc) {
+    enum EPredecode {
+        Predec_None,        // sequential fetch
+        Predec_Taken,       // direct jump, target is known by predecoder
+        Predec_Return
+    } predec = Predec_None;
+    bool taken = npc != pc + static_cast<uint64_t>(oplen);
+    bool call = false;
+    bool hit;
+
+    if (oplen == 4) {
+        uint32_t rd = (payload >> 7) & 0x1F;
+        switch (payload & 0x7F) {
+        case 0x6F:      // jal
+            predec = Predec_Taken;
+            call = rd == 1 || rd == 5;
+            break;
+        case 0x63:      // only backward branches are predicted
+            predec = (payload >> 31) ? Predec_Taken : Predec_None;
+            break;
+        case 0x67:      // jalr
+            predec = payload == 0x00008067 ? Predec_Return : Predec_None;
+            call = rd == 1 || rd == 5;
+            break;
+        default:;
+        }
+    } else if ((payload & 0xE003) == 0xA001) {     // c.j
+        predec = Predec_Taken;
+    } else if ((payload & 0xFFFF) == 0x8082) {     // c.ret
+        predec = Predec_Return;
+    } else if ((payload & 0xF07F) == 0x9002 && (payload & 0x0F80)) {
+        call = true;                                // c.jalr
+    }
+
+    uint32_t idx = 0;
+    while (idx < btbsize_ && btb_[idx].pc != pc) {
+        idx++;
+    }
+
+    if (idx < btbsize_) {
+        hit = btb_[idx].npc == npc;
+    } else if (predec == Predec_Taken) {
+        hit = taken;
+    } else if (predec == Predec_Return) {
+        hit = rascnt_ != 0 && ras_[rastop_] == npc;
+    } else {
+        hit = !taken;
+    }
+
+    if (predec == Predec_Return && rascnt_) {
+        rastop_ = (rastop_ + rasdepth_ - 1) % rasdepth_;
+        rascnt_--;
+    }
+    if (call && rasdepth_) {
+        rastop_ = (rastop_ + 1) % rasdepth_;
+        ras_[rastop_] = pc + static_cast<uint64_t>(oplen);
+        if (rascnt_ < rasdepth_) {
+            rascnt_++;
+        }
+    }
+
+    // Executed jump is written into the first entry, others are shifted
+    if (taken && btbsize_) {
+        if (idx == btbsize_) {
+            idx = btbsize_ - 1;
+        }
+        memmove(&btb_[1], &btb_[0], idx * sizeof(BtbEntryType));
+        btb_[0].pc = pc;
+        btb_[0].npc = npc;
+    }
+    return hit;
+}
+
+RiverTimingModel::RiverTimingModel() {
+    memset(&cfg_, 0, sizeof(cfg_));
+    memset(counters_, 0, sizeof(counters_));
+    iline_ = TIMING_LINE_EMPTY;
+    pending_ = 0;
+}
+
+bool RiverTimingModel::init(const TimingConfigType &cfg) {
+    cfg_ = cfg;
+    memset(counters_, 0, sizeof(counters_));
+    bp_.init(cfg.btbSize, cfg.rasDepth);
+    return icache_.init(cfg.icacheKBytes, cfg.icacheWays)
+        && dcache_.init(cfg.dcacheKBytes, cfg.dcacheWays)
+        && l2cache_.init(cfg.l2KBytes, cfg.l2Ways);
+}
+
+void RiverTimingModel::flush() {
+    icache_.flush();
+    dcache_.flush();
+    l2cache_.flush();
+    bp_.flush();
+    iline_ = TIMING_LINE_EMPTY;
+    pending_ = 0;
+}
+
+uint32_t RiverTimingModel::l2Access(uint64_t addr) {
+    if (l2cache_.access(addr)) {
+        count(TimingCnt_L2Hit);
+        return cfg_.l2Latency;
+    }
+    count(TimingCnt_L2Miss);
+    return cfg_.memLatency;
+}
+
+void RiverTimingModel::dataAccess(uint64_t addr, bool cacheable) {
+    if (!cacheable) {
+        count(TimingCnt_Uncached);
+        pending_ += cfg_.memLatency;
+    } else if (dcache_.access(addr)) {
+        count(TimingCnt_DCacheHit);
+    } else {
+        count(TimingCnt_DCacheMiss);
+        pending_ += l2Access(addr);
+    }
+}
+
+uint32_t RiverTimingModel::instruction(uint64_t pc, uint32_t payload,
+                                       int oplen, const char *name,
+                                       uint32_t ev, uint64_t npc) {
+    uint32_t t = pending_;
+    pending_ = 0;
+
+    // Sequential fetch inside of the line is always hit
+    if ((pc >> TIMING_LINE_BITS) != iline_) {
+        iline_ = pc >> TIMING_LINE_BITS;
+        if (icache_.access(pc)) {
+            count(TimingCnt_ICacheHit);
+        } else {
+            count(TimingCnt_ICacheMiss);
+            t += l2Access(pc);
+        }
+    }
+
+    if (ev & (HPM_EVENT_BRANCH | HPM_EVENT_JUMP)) {
+        count(TimingCnt_Branch);
+        if (!bp_.predict(pc, payload, oplen, npc)) {
+            count(TimingCnt_Mispredict);
+            t += cfg_.branchPenalty;
+        }
+    } else if (ev & HPM_EVENT_MULDIV) {
+        // div, divu, divw, divuw, rem, remu, remw, remuw
+        t += (name[0] == 'D' || name[0] == 'R') ? cfg_.divLatency
+                                                : cfg_.mulLatency;
+    } else if (ev & HPM_EVENT_FPU) {
+        if (strncmp(name, "FDIV", 4) == 0 || strncmp(name, "FSQRT", 5) == 0) {
+            t += cfg_.divLatency;
+        } else {
+            t += cfg_.fpuLatency;
+        }
+    }
+
+    if (t) {
+        count(TimingCnt_Stalls, t);
+    }
+    return t;
+}
+
+}  // namespace debugger
@@ -0,0 +1,170 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_CPU_FNC_PLUGIN_TIMING_MODEL_H__
+#define __DEBUGGER_SRC_CPU_FNC_PLUGIN_TIMING_MODEL_H__
+
+#include <inttypes.h>
+
+namespace debugger {
+
+/**
+ * Tags of the set-associative cache with LRU replacement, the same
+ * geometry as icache_lru, dcache_lru and l2cache_lru of River. Data isn't
+ * stored, only hit or miss of the line is tracked.
+ */
+class CacheTimingModel {
+ public:
+    CacheTimingModel();
+    ~CacheTimingModel();
+
+    /** Allocate tags, false if size isn't power of 2 lines per way */
+    bool init(uint32_t kbytes, uint32_t ways);
+    void flush();
+    /** Access the line and make it the most recently used, true on hit */
+    bool access(uint64_t addr);
+
+ private:
+    uint64_t *tags_;            // each set is ordered from MRU to LRU
+    uint32_t ways_;
+    uint64_t setmask_;
+};
+
+/**
+ * Branch predictor of River: bp_btb table of the executed jumps with the
+ * most recently written entry first and bp_predec static prediction of
+ * the jal, c.j and backward branches. Return address stack replaces the
+ * 'ra' register value used by the predecoder for c.ret.
+ */
+class BranchTimingModel {
+ public:
+    BranchTimingModel();
+
+    void init(uint32_t btbsize, uint32_t rasdepth);
+    void flush();
+
+    /**
+     * Predict the control transfer instruction and learn its result.
+     *
+     * @param[in] pc Instruction address
+     * @param[in] payload Instruction opcode
+     * @param[in] oplen Instruction length in bytes
+     * @param[in] npc Address of the next executed instruction
+     * @return true if the next instruction address was predicted
+     */
+    bool predict(uint64_t pc, uint32_t payload, int oplen, uint64_t npc);
+
+ private:
+    static const int BTB_SIZE_MAX = 64;
+    static const int RAS_DEPTH_MAX = 16;
+
+    struct BtbEntryType {
+        uint64_t pc;
+        uint64_t npc;
+    };
+    BtbEntryType btb_[BTB_SIZE_MAX];
+    uint32_t btbsize_;
+    uint64_t ras_[RAS_DEPTH_MAX];
+    uint32_t rasdepth_;
+    uint32_t rastop_;
+    uint32_t rascnt_;
+};
+
+enum ETimingCounters {
+    TimingCnt_ICacheHit,        // fetch of the next cache line
+    TimingCnt_ICacheMiss,
+    TimingCnt_DCacheHit,
+    TimingCnt_DCacheMiss,
+    TimingCnt_L2Hit,
+    TimingCnt_L2Miss,
+    TimingCnt_Uncached,         // data access of I/O region
+    TimingCnt_Branch,           // control transfer instructions
+    TimingCnt_Mispredict,
+    TimingCnt_Stalls,           // cycles above one per instruction
+    TimingCnt_Total
+};
+
+struct TimingConfigType {
+    uint32_t icacheKBytes;
+    uint32_t icacheWays;
+    uint32_t dcacheKBytes;
+    uint32_t dcacheWays;
+    uint32_t l2KBytes;
+    uint32_t l2Ways;
+    uint32_t btbSize;
+    uint32_t rasDepth;
+    uint32_t l2Latency;         // L1 miss, L2 hit
+    uint32_t memLatency;        // L2 miss or uncached access
+    uint32_t branchPenalty;     // pipeline flush on misprediction
+    uint32_t mulLatency;
+    uint32_t divLatency;        // integer and FPU division, square root
+    uint32_t fpuLatency;
+};
+
+/**
+ * Cycle-approximate timing of the River pipeline charged on top of one
+ * cycle per instruction of the functional model.
+ */
+class RiverTimingModel {
+ public:
+    RiverTimingModel();
+
+    /**
+     * Allocate the models.
+     *
+     * @param[in] cfg Geometry and latencies
+     * @return false if the cache geometry is not supported
+     */
+    bool init(const TimingConfigType &cfg);
+    /** Invalidate caches and predictor */
+    void flush();
+    /** ETimingCounters value */
+    uint64_t counter(int idx) const { return counters_[idx]; }
+
+    /** Load, store or AMO of the executing instruction */
+    void dataAccess(uint64_t addr, bool cacheable);
+
+    /**
+     * Stall cycles of the executed instruction including its data accesses.
+     *
+     * @param[in] pc Instruction address
+     * @param[in] payload Instruction opcode
+     * @param[in] oplen Instruction length in bytes
+     * @param[in] name Instruction name
+     * @param[in] ev HPM_EVENT_* class of the instruction
+     * @param[in] npc Address of the next executed instruction
+     */
+    uint32_t instruction(uint64_t pc, uint32_t payload, int oplen,
+                         const char *name, uint32_t ev, uint64_t npc);
+
+ private:
+    uint32_t l2Access(uint64_t addr);
+    void count(int idx, uint64_t v = 1) { counters_[idx] += v; }
+
+ private:
+    TimingConfigType cfg_;
+    uint64_t counters_[TimingCnt_Total];
+    CacheTimingModel icache_;
+    CacheTimingModel dcache_;
+    CacheTimingModel l2cache_;
+    BranchTimingModel bp_;
+    uint64_t iline_;            // line of the previous fetch
+    uint32_t pending_;          // data stalls of the executing instruction
+};
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_CPU_FNC_PLUGIN_TIMING_MODEL_H__
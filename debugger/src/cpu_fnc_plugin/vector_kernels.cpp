@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <cmath>
+#include "vector_kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+    #define VK_X86_64
+#endif
+
+namespace debugger {
+
+#if defined(VK_X86_64)
+
+// SSE2 is the baseline of x86-64, SSE4.1 and FMA only when built for them
+namespace vk_sse2 {
+#define VK_SIMD_BYTES 16
+#define VK_TARGET
+#include "vector_kernels_simd.h"
+#undef VK_TARGET
+#undef VK_SIMD_BYTES
+}  // namespace vk_sse2
+
+// AVX2 and FMA are compiled in and selected at run-time
+namespace vk_avx2 {
+#define VK_SIMD_BYTES 32
+#if defined(_MSC_VER)
+    #define VK_TARGET
+#else
+    #define VK_TARGET __attribute__((target("avx2,fma")))
+#endif
+#include "vector_kernels_simd.h"
+#undef VK_TARGET
+#undef VK_SIMD_BYTES
+}  // namespace vk_avx2
+
+/** AVX2, FMA and the OS support of the YMM state */
+static bool isHostAvx2() {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) {
+        return false;
+    }
+    __cpuid(r, 1);
+    const int fma = 1 << 12, osxsave = 1 << 27, avx = 1 << 28;
+    if ((r[2] & (fma | osxsave | avx)) != (fma | osxsave | avx)
+        || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+bool vectorKernel(EVectorKernel op, uint32_t sew, uint8_t *vd,
+                  const uint8_t *vs2, const uint8_t *vs1, uint64_t x,
+                  uint32_t vl) {
+    static const bool avx2 = isHostAvx2();
+    if (avx2) {
+        return vk_avx2::run(op, sew, vd, vs2, vs1, x, vl);
+    }
+    return vk_sse2::run(op, sew, vd, vs2, vs1, x, vl);
+}
+
+#else   // VK_X86_64
+
+bool vectorKernel(EVectorKernel op, uint32_t sew, uint8_t *vd,
+                  const uint8_t *vs2, const uint8_t *vs1, uint64_t x,
+                  uint32_t vl) {
+    return false;
+}
+
+#endif  // VK_X86_64
+
+}  // namespace debugger
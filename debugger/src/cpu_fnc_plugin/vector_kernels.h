@@ -0,0 +1,57 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __DEBUGGER_SRC_CPU_FNC_PLUGIN_VECTOR_KERNELS_H__
+#define __DEBUGGER_SRC_CPU_FNC_PLUGIN_VECTOR_KERNELS_H__
+
+#include <inttypes.h>
+
+namespace debugger {
+
+enum EVectorKernel {
+    VK_Add,         // vd = vs2 + vs1
+    VK_Sub,         // vd = vs2 - vs1
+    VK_And,
+    VK_Or,
+    VK_Xor,
+    VK_Mul,         // vd = vs2 * vs1, low half
+    VK_Macc,        // vd = vs1 * vs2 + vd
+    VK_FAdd,
+    VK_FSub,
+    VK_FMul,
+    VK_FMacc,       // fused, vd = vs1 * vs2 + vd
+};
+
+/**
+ * Unmasked element loop on the host SIMD unit: SSE2 on any x86-64 host,
+ * AVX2 and FMA when the host CPU supports them.
+ *
+ * @param[in] op Operation
+ * @param[in] sew Element width in bytes
+ * @param[in,out] vd Destination register group
+ * @param[in] vs2 Register group of the first operand
+ * @param[in] vs1 Register group of the second operand, 0 to use scalar x
+ * @param[in] x Scalar operand
+ * @param[in] vl Number of elements
+ * @return false if there's no host kernel for this operation and SEW
+ */
+bool vectorKernel(EVectorKernel op, uint32_t sew, uint8_t *vd,
+                  const uint8_t *vs2, const uint8_t *vs1, uint64_t x,
+                  uint32_t vl);
+
+}  // namespace debugger
+
+#endif  // __DEBUGGER_SRC_CPU_FNC_PLUGIN_VECTOR_KERNELS_H__
@@ -0,0 +1,415 @@
+/*
+ *  Copyright 2021 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * Vector kernels for one host instruction set. The file is included by
+ * vector_kernels.cpp into its own namespace once per set with
+ * VK_SIMD_BYTES and VK_TARGET defined, so it has no include guard.
+ */
+
+// Host vector of the instruction set and its operations
+#if VK_SIMD_BYTES == 32
+typedef __m256i VkInt;
+typedef __m256 VkFlt;
+typedef __m256d VkDbl;
+
+static inline VK_TARGET VkInt vkLoad(const void *p) {
+    return _mm256_loadu_si256(static_cast<const __m256i *>(p));
+}
+static inline VK_TARGET void vkStore(void *p, VkInt v) {
+    _mm256_storeu_si256(static_cast<__m256i *>(p), v);
+}
+static inline VK_TARGET VkInt vkSet(uint8_t x) { return _mm256_set1_epi8(x); }
+static inline VK_TARGET VkInt vkSet(uint16_t x) { return _mm256_set1_epi16(x); }
+static inline VK_TARGET VkInt vkSet(uint32_t x) { return _mm256_set1_epi32(x); }
+static inline VK_TARGET VkInt vkSet(uint64_t x) {
+    return _mm256_set1_epi64x(x);
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint8_t) {
+    return _mm256_add_epi8(a, b);
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint16_t) {
+    return _mm256_add_epi16(a, b);
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint32_t) {
+    return _mm256_add_epi32(a, b);
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint64_t) {
+    return _mm256_add_epi64(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint8_t) {
+    return _mm256_sub_epi8(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint16_t) {
+    return _mm256_sub_epi16(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint32_t) {
+    return _mm256_sub_epi32(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint64_t) {
+    return _mm256_sub_epi64(a, b);
+}
+static inline VK_TARGET VkInt vkAnd(VkInt a, VkInt b) {
+    return _mm256_and_si256(a, b);
+}
+static inline VK_TARGET VkInt vkOr(VkInt a, VkInt b) {
+    return _mm256_or_si256(a, b);
+}
+static inline VK_TARGET VkInt vkXor(VkInt a, VkInt b) {
+    return _mm256_xor_si256(a, b);
+}
+static inline VK_TARGET VkInt vkMul(VkInt a, VkInt b, uint16_t) {
+    return _mm256_mullo_epi16(a, b);
+}
+#define VK_MUL32
+static inline VK_TARGET VkInt vkMul(VkInt a, VkInt b, uint32_t) {
+    return _mm256_mullo_epi32(a, b);
+}
+
+static inline VK_TARGET VkFlt vkLoad(const float *p) {
+    return _mm256_loadu_ps(p);
+}
+static inline VK_TARGET VkDbl vkLoad(const double *p) {
+    return _mm256_loadu_pd(p);
+}
+static inline VK_TARGET void vkStore(float *p, VkFlt v) {
+    _mm256_storeu_ps(p, v);
+}
+static inline VK_TARGET void vkStore(double *p, VkDbl v) {
+    _mm256_storeu_pd(p, v);
+}
+static inline VK_TARGET VkFlt vkSet(float x) { return _mm256_set1_ps(x); }
+static inline VK_TARGET VkDbl vkSet(double x) { return _mm256_set1_pd(x); }
+static inline VK_TARGET VkFlt vkAdd(VkFlt a, VkFlt b) {
+    return _mm256_add_ps(a, b);
+}
+static inline VK_TARGET VkDbl vkAdd(VkDbl a, VkDbl b) {
+    return _mm256_add_pd(a, b);
+}
+static inline VK_TARGET VkFlt vkSub(VkFlt a, VkFlt b) {
+    return _mm256_sub_ps(a, b);
+}
+static inline VK_TARGET VkDbl vkSub(VkDbl a, VkDbl b) {
+    return _mm256_sub_pd(a, b);
+}
+static inline VK_TARGET VkFlt vkMul(VkFlt a, VkFlt b) {
+    return _mm256_mul_ps(a, b);
+}
+static inline VK_TARGET VkDbl vkMul(VkDbl a, VkDbl b) {
+    return _mm256_mul_pd(a, b);
+}
+#define VK_FMA
+static inline VK_TARGET VkFlt vkFma(VkFlt a, VkFlt b, VkFlt c) {
+    return _mm256_fmadd_ps(a, b, c);
+}
+static inline VK_TARGET VkDbl vkFma(VkDbl a, VkDbl b, VkDbl c) {
+    return _mm256_fmadd_pd(a, b, c);
+}
+
+#else   // VK_SIMD_BYTES == 16
+typedef __m128i VkInt;
+typedef __m128 VkFlt;
+typedef __m128d VkDbl;
+
+static inline VK_TARGET VkInt vkLoad(const void *p) {
+    return _mm_loadu_si128(static_cast<const __m128i *>(p));
+}
+static inline VK_TARGET void vkStore(void *p, VkInt v) {
+    _mm_storeu_si128(static_cast<__m128i *>(p), v);
+}
+static inline VK_TARGET VkInt vkSet(uint8_t x) {
+    return _mm_set1_epi8(static_cast<char>(x));
+}
+static inline VK_TARGET VkInt vkSet(uint16_t x) {
+    return _mm_set1_epi16(static_cast<short>(x));
+}
+static inline VK_TARGET VkInt vkSet(uint32_t x) {
+    return _mm_set1_epi32(static_cast<int>(x));
+}
+static inline VK_TARGET VkInt vkSet(uint64_t x) {
+    return _mm_set1_epi64x(static_cast<int64_t>(x));
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint8_t) {
+    return _mm_add_epi8(a, b);
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint16_t) {
+    return _mm_add_epi16(a, b);
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint32_t) {
+    return _mm_add_epi32(a, b);
+}
+static inline VK_TARGET VkInt vkAdd(VkInt a, VkInt b, uint64_t) {
+    return _mm_add_epi64(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint8_t) {
+    return _mm_sub_epi8(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint16_t) {
+    return _mm_sub_epi16(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint32_t) {
+    return _mm_sub_epi32(a, b);
+}
+static inline VK_TARGET VkInt vkSub(VkInt a, VkInt b, uint64_t) {
+    return _mm_sub_epi64(a, b);
+}
+static inline VK_TARGET VkInt vkAnd(VkInt a, VkInt b) {
+    return _mm_and_si128(a, b);
+}
+static inline VK_TARGET VkInt vkOr(VkInt a, VkInt b) {
+    return _mm_or_si128(a, b);
+}
+static inline VK_TARGET VkInt vkXor(VkInt a, VkInt b) {
+    return _mm_xor_si128(a, b);
+}
+static inline VK_TARGET VkInt vkMul(VkInt a, VkInt b, uint16_t) {
+    return _mm_mullo_epi16(a, b);
+}
+#if defined(__SSE4_1__)
+#define VK_MUL32
+static inline VK_TARGET VkInt vkMul(VkInt a, VkInt b, uint32_t) {
+    return _mm_mullo_epi32(a, b);
+}
+#endif
+
+static inline VK_TARGET VkFlt vkLoad(const float *p) { return _mm_loadu_ps(p); }
+static inline VK_TARGET VkDbl vkLoad(const double *p) {
+    return _mm_loadu_pd(p);
+}
+static inline VK_TARGET void vkStore(float *p, VkFlt v) { _mm_storeu_ps(p, v); }
+static inline VK_TARGET void vkStore(double *p, VkDbl v) {
+    _mm_storeu_pd(p, v);
+}
+static inline VK_TARGET VkFlt vkSet(float x) { return _mm_set1_ps(x); }
+static inline VK_TARGET VkDbl vkSet(double x) { return _mm_set1_pd(x); }
+static inline VK_TARGET VkFlt vkAdd(VkFlt a, VkFlt b) {
+    return _mm_add_ps(a, b);
+}
+static inline VK_TARGET VkDbl vkAdd(VkDbl a, VkDbl b) {
+    return _mm_add_pd(a, b);
+}
+static inline VK_TARGET VkFlt vkSub(VkFlt a, VkFlt b) {
+    return _mm_sub_ps(a, b);
+}
+static inline VK_TARGET VkDbl vkSub(VkDbl a, VkDbl b) {
+    return _mm_sub_pd(a, b);
+}
+static inline VK_TARGET VkFlt vkMul(VkFlt a, VkFlt b) {
+    return _mm_mul_ps(a, b);
+}
+static inline VK_TARGET VkDbl vkMul(VkDbl a, VkDbl b) {
+    return _mm_mul_pd(a, b);
+}
+#if defined(__FMA__)
+#define VK_FMA
+static inline VK_TARGET VkFlt vkFma(VkFlt a, VkFlt b, VkFlt c) {
+    return _mm_fmadd_ps(a, b, c);
+}
+static inline VK_TARGET VkDbl vkFma(VkDbl a, VkDbl b, VkDbl c) {
+    return _mm_fmadd_pd(a, b, c);
+}
+#endif
+#endif  // VK_SIMD_BYTES
+
+/**
+ * Integer kernels. Elements are unsigned so that the scalar tail wraps
+ * the same way as the host vector instructions.
+ */
+template <typename T>
+static VK_TARGET bool kernelInt(EVectorKernel op, T *d, const T *a, const T *b,
+                      T x, uint32_t n) {
+    const uint32_t step = VK_SIMD_BYTES / sizeof(T);
+    VkInt vx = vkSet(x);
+    uint32_t i = 0;
+    switch (op) {
+    case VK_Add:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkAdd(vkLoad(&a[i]), b ? vkLoad(&b[i]) : vx, x));
+        }
+        for (; i < n; i++) {
+            d[i] = static_cast<T>(a[i] + (b ? b[i] : x));
+        }
+        return true;
+    case VK_Sub:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkSub(vkLoad(&a[i]), b ? vkLoad(&b[i]) : vx, x));
+        }
+        for (; i < n; i++) {
+            d[i] = static_cast<T>(a[i] - (b ? b[i] : x));
+        }
+        return true;
+    case VK_And:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkAnd(vkLoad(&a[i]), b ? vkLoad(&b[i]) : vx));
+        }
+        for (; i < n; i++) {
+            d[i] = a[i] & (b ? b[i] : x);
+        }
+        return true;
+    case VK_Or:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkOr(vkLoad(&a[i]), b ? vkLoad(&b[i]) : vx));
+        }
+        for (; i < n; i++) {
+            d[i] = a[i] | (b ? b[i] : x);
+        }
+        return true;
+    case VK_Xor:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkXor(vkLoad(&a[i]), b ? vkLoad(&b[i]) : vx));
+        }
+        for (; i < n; i++) {
+            d[i] = a[i] ^ (b ? b[i] : x);
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+/** Low half of the product, only for SEW with host instruction */
+template <typename T>
+static VK_TARGET bool kernelMul(EVectorKernel op, T *d, const T *a, const T *b,
+                      T x, uint32_t n) {
+    const uint32_t step = VK_SIMD_BYTES / sizeof(T);
+    VkInt vx = vkSet(x);
+    uint32_t i = 0;
+    uint64_t t;
+    if (op == VK_Mul) {
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkMul(vkLoad(&a[i]), b ? vkLoad(&b[i]) : vx, x));
+        }
+        for (; i < n; i++) {
+            t = static_cast<uint64_t>(a[i]) * (b ? b[i] : x);
+            d[i] = static_cast<T>(t);
+        }
+    } else {
+        for (; i + step <= n; i += step) {
+            VkInt m = vkMul(vkLoad(&a[i]), b ? vkLoad(&b[i]) : vx, x);
+            vkStore(&d[i], vkAdd(m, vkLoad(&d[i]), x));
+        }
+        for (; i < n; i++) {
+            t = static_cast<uint64_t>(a[i]) * (b ? b[i] : x) + d[i];
+            d[i] = static_cast<T>(t);
+        }
+    }
+    return true;
+}
+
+/** IEEE 754 kernels, rounding mode and flags are the host FPU state */
+template <typename T>
+static VK_TARGET bool kernelFpu(EVectorKernel op, T *d, const T *a, const T *b,
+                      T x, uint32_t n) {
+    const uint32_t step = VK_SIMD_BYTES / sizeof(T);
+    uint32_t i = 0;
+    switch (op) {
+    case VK_FAdd:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkAdd(vkLoad(&a[i]),
+                                 b ? vkLoad(&b[i]) : vkSet(x)));
+        }
+        for (; i < n; i++) {
+            d[i] = a[i] + (b ? b[i] : x);
+        }
+        return true;
+    case VK_FSub:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkSub(vkLoad(&a[i]),
+                                 b ? vkLoad(&b[i]) : vkSet(x)));
+        }
+        for (; i < n; i++) {
+            d[i] = a[i] - (b ? b[i] : x);
+        }
+        return true;
+    case VK_FMul:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkMul(vkLoad(&a[i]),
+                                 b ? vkLoad(&b[i]) : vkSet(x)));
+        }
+        for (; i < n; i++) {
+            d[i] = a[i] * (b ? b[i] : x);
+        }
+        return true;
+#if defined(VK_FMA)
+    case VK_FMacc:
+        for (; i + step <= n; i += step) {
+            vkStore(&d[i], vkFma(b ? vkLoad(&b[i]) : vkSet(x),
+                                 vkLoad(&a[i]), vkLoad(&d[i])));
+        }
+        for (; i < n; i++) {
+            d[i] = std::fma(b ? b[i] : x, a[i], d[i]);
+        }
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+template <typename T>
+static VK_TARGET T fromBits(uint64_t x) {
+    union {
+        uint64_t u64;
+        T v;
+    } t;
+    t.u64 = x;
+    return t.v;
+}
+
+static VK_TARGET bool run(EVectorKernel op, uint32_t sew, uint8_t *vd,
+                          const uint8_t *vs2, const uint8_t *vs1, uint64_t x,
+                          uint32_t vl) {
+#define VK_ARGS(T) reinterpret_cast<T *>(vd), \
+                   reinterpret_cast<const T *>(vs2), \
+                   reinterpret_cast<const T *>(vs1)
+    if (op >= VK_FAdd) {
+        if (sew == 4) {
+            return kernelFpu(op, VK_ARGS(float), fromBits<float>(x), vl);
+        } else if (sew == 8) {
+            return kernelFpu(op, VK_ARGS(double), fromBits<double>(x), vl);
+        }
+        return false;
+    }
+    if (op == VK_Mul || op == VK_Macc) {
+        if (sew == 2) {
+            return kernelMul(op, VK_ARGS(uint16_t),
+                             static_cast<uint16_t>(x), vl);
+        }
+#if defined(VK_MUL32)
+        if (sew == 4) {
+            return kernelMul(op, VK_ARGS(uint32_t),
+                             static_cast<uint32_t>(x), vl);
+        }
+#endif
+        return false;
+    }
+    switch (sew) {
+    case 1:
+        return kernelInt(op, VK_ARGS(uint8_t), static_cast<uint8_t>(x), vl);
+    case 2:
+        return kernelInt(op, VK_ARGS(uint16_t), static_cast<uint16_t>(x), vl);
+    case 4:
+        return kernelInt(op, VK_ARGS(uint32_t), static_cast<uint32_t>(x), vl);
+    case 8:
+        return kernelInt(op, VK_ARGS(uint64_t), x, vl);
+    default:
+        return false;
+    }
+#undef VK_ARGS
+}
+
+#undef VK_FMA
+#undef VK_MUL32
@@ -291,7 +291,6 @@ void RtlWrapper::sys_bus_proc() {
     uint8_t strob;
     uint64_t offset;
 
-    step_queue_.initProc();
     step_queue_.pushPreQueued();
     uint64_t step_cnt = r.clk_cnt.read();
     while ((cb = step_queue_.getNext(step_cnt)) != 0) {
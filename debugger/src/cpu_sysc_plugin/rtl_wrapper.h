@@ -123,8 +123,8 @@ class RtlWrapper : public sc_module,
     virtual void writeGPR(uint32_t regno, uint64_t val) {}
     virtual uint64_t readNonStandardReg(uint32_t regno) { return 0; }
     virtual void writeNonStandardReg(uint32_t regno, uint64_t val) {}
-    virtual void mmuAddrReserve(uint64_t addr) { }
-    virtual bool mmuAddrRelease(uint64_t addr) { return true; }
+    virtual void mmuAddrReserve(uint64_t addr, uint64_t val) { }
+    virtual bool mmuAddrRelease(uint64_t addr, uint64_t *val) { return true; }
 
     /** IClock */
     virtual uint64_t getClockCounter() { return r.clk_cnt.read(); }
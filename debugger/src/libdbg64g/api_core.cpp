@@ -18,8 +18,13 @@
 #include "coreservices/ithread.h"
 #include "coreservices/iclock.h"
 #include "generic/bus_generic.h"
+#include "generic/smp_generic.h"
 #include "services/debug/cpumonitor.h"
+#include "services/debug/callgraph.h"
 #include "services/debug/codecov_generic.h"
+#include "services/debug/instrmix.h"
+#include "services/debug/memfootprint.h"
+#include "services/debug/pcprofiler.h"
 #include "services/debug/openocdwrap.h"
 #include "services/elfloader/elfreader.h"
 #include "services/exec/cmdexec.h"
@@ -81,6 +86,11 @@ extern "C" int RISCV_init() {
     REGISTER_CLASS_IDX(TcpServerJtagBitBang, 13);
     REGISTER_CLASS_IDX(OpenOcdWrapper, 14);
     REGISTER_CLASS_IDX(DpiClient, 15);
+    REGISTER_CLASS_IDX(SmpGeneric, 16);
+    REGISTER_CLASS_IDX(InstructionMixCounter, 17);
+    REGISTER_CLASS_IDX(MemoryFootprint, 18);
+    REGISTER_CLASS_IDX(PcSamplingProfiler, 19);
+    REGISTER_CLASS_IDX(CallGraphProfiler, 20);
 
     pcore_->load_plugins();
     return 0;
@@ -457,6 +467,51 @@ extern "C" void RISCV_memory_barrier() {
 #endif
 }
 
+extern "C" void *RISCV_atomic_cas_ptr(void *volatile *dst, void *cmp,
+                                      void *xchg) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return InterlockedCompareExchangePointer(dst, xchg, cmp);
+#else
+    return __sync_val_compare_and_swap(dst, cmp, xchg);
+#endif
+}
+
+extern "C" uint32_t RISCV_atomic_cas32(volatile uint32_t *dst, uint32_t cmp,
+                                       uint32_t xchg) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return static_cast<uint32_t>(InterlockedCompareExchange(
+        reinterpret_cast<volatile LONG *>(dst), xchg, cmp));
+#else
+    return __sync_val_compare_and_swap(dst, cmp, xchg);
+#endif
+}
+
+extern "C" uint64_t RISCV_atomic_cas64(volatile uint64_t *dst, uint64_t cmp,
+                                       uint64_t xchg) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return static_cast<uint64_t>(InterlockedCompareExchange64(
+        reinterpret_cast<volatile LONGLONG *>(dst), xchg, cmp));
+#else
+    return __sync_val_compare_and_swap(dst, cmp, xchg);
+#endif
+}
+
+extern "C" void RISCV_atomic_or32(volatile uint32_t *dst, uint32_t v) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    InterlockedOr(reinterpret_cast<volatile LONG *>(dst), v);
+#else
+    __sync_fetch_and_or(dst, v);
+#endif
+}
+
+extern "C" void RISCV_atomic_and32(volatile uint32_t *dst, uint32_t v) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    InterlockedAnd(reinterpret_cast<volatile LONG *>(dst), v);
+#else
+    __sync_fetch_and_and(dst, v);
+#endif
+}
+
 extern "C" void RISCV_thread_create(void *data) {
     LibThreadType *p = (LibThreadType *)data;
 #if defined(_WIN32) || defined(__CYGWIN__)
@@ -702,6 +757,56 @@ extern "C" void RISCV_free(void *p) {
     }
 }
 
+extern "C" void *RISCV_exec_malloc(uint64_t sz) {
+    void *ret;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    ret = VirtualAlloc(NULL, (SIZE_T)sz, MEM_COMMIT | MEM_RESERVE,
+                       PAGE_READWRITE);
+#else
+    ret = mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ret == MAP_FAILED) {
+        ret = 0;
+    }
+#endif
+    if (ret == 0) {
+        RISCV_error("Couldn't allocate %" RV_PRI64 "d bytes of code memory",
+                    sz);
+    }
+    return ret;
+}
+
+extern "C" void RISCV_exec_free(void *p, uint64_t sz) {
+    if (!p) {
+        return;
+    }
+#if defined(_WIN32) || defined(__CYGWIN__)
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, (size_t)sz);
+#endif
+}
+
+extern "C" int RISCV_exec_protect(void *p, uint64_t sz, int exec) {
+    int err;
+#if defined(_WIN32) || defined(__CYGWIN__)
+    DWORD old;
+    err = VirtualProtect(p, (SIZE_T)sz,
+                         exec ? PAGE_EXECUTE_READ : PAGE_READWRITE,
+                         &old) ? 0 : -1;
+    if (exec && !err) {
+        FlushInstructionCache(GetCurrentProcess(), p, (SIZE_T)sz);
+    }
+#else
+    err = mprotect(p, (size_t)sz,
+                   exec ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE);
+#endif
+    if (err) {
+        RISCV_error("Couldn't change protection of the code memory", NULL);
+    }
+    return err;
+}
+
 extern "C" int RISCV_get_core_folder(char *out, int sz) {
 #if defined(_WIN32) || defined(__CYGWIN__)
     HMODULE hm = NULL;
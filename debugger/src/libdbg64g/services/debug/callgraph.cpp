@@ -0,0 +1,445 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "callgraph.h"
+#include <algorithm>
+
+namespace debugger {
+
+static const size_t CALLGRAPH_SAVED_MAX = 256;
+
+/** Trap nodes use odd keys that can't be the address of a function */
+static uint64_t trapKey(uint64_t cause, bool irq) {
+    return (cause << 2) | (irq ? 0x2 : 0) | 0x1;
+}
+
+CallGraphProfiler::CallGraphProfiler(const char *name)
+    : GenericInstrumentPlugin(name, (1u << InstrEvent_Call)
+                                    | (1u << InstrEvent_Return)
+                                    | (1u << InstrEvent_Trap)
+                                    | (1u << InstrEvent_TrapReturn)) {
+    registerAttribute("SourceCode", &src_);
+    isrc_ = 0;
+    briefDescr_.make_string("Call graph profile of the program.");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Steps spent in each call path collected by the\n"
+        "    instrumentation interface of the CPUs listed in the 'Cpu'\n"
+        "    attribute. Returns list of [name, calls, inclusive,\n"
+        "    exclusive] or writes folded stacks (flame graph) or\n"
+        "    callgrind file.\n"
+        "Usage:\n"
+        "    callgraph\n"
+        "    callgraph clear\n"
+        "    callgraph export <filepath> [folded|callgrind]\n"
+        "Example:\n"
+        "    callgraph export fw.folded\n"
+        "    callgraph export callgrind.out.fw callgrind\n");
+}
+
+CallGraphProfiler::~CallGraphProfiler() {
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        RISCV_mutex_destroy(&harts_[i]->mutex);
+        delete harts_[i];
+    }
+}
+
+void CallGraphProfiler::postinitService() {
+    isrc_ = static_cast<ISourceCode *>(
+        RISCV_get_service_iface(src_.to_string(), IFACE_SOURCE_CODE));
+    if (!isrc_) {
+        RISCV_error("Can't get ISourceCode interface %s", src_.to_string());
+    }
+    GenericInstrumentPlugin::postinitService();
+}
+
+int CallGraphProfiler::isValid(AttributeType *args) {
+    if (cmdName_.is_equal((*args)[0u].to_string())
+        && (args->size() == 3 || args->size() == 4)
+        && (*args)[1].is_equal("export") && (*args)[2].is_string()) {
+        return CMD_VALID;
+    }
+    return GenericInstrumentPlugin::isValid(args);
+}
+
+void CallGraphProfiler::exec(AttributeType *args, AttributeType *res) {
+    if (args->size() < 3) {
+        GenericInstrumentPlugin::exec(args, res);
+        return;
+    }
+    res->attr_free();
+    res->make_nil();
+
+    const char *filename = (*args)[2].to_string();
+    bool callgrind = strstr(filename, "callgrind") != 0;
+    if (args->size() == 4) {
+        callgrind = (*args)[3].is_equal("callgrind");
+    }
+    FILE *fd = fopen(filename, "wb");
+    if (fd == NULL) {
+        char tst[256];
+        RISCV_sprintf(tst, sizeof(tst), "Can't open '%s' file", filename);
+        generateError(res, tst);
+        return;
+    }
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        RISCV_mutex_lock(&harts_[i]->mutex);
+        updateTotals(harts_[i]);
+    }
+    if (callgrind) {
+        exportCallgrind(fd);
+    } else {
+        exportFolded(fd);
+    }
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        RISCV_mutex_unlock(&harts_[i]->mutex);
+    }
+    fclose(fd);
+}
+
+void CallGraphProfiler::instrumentEvent(int event,
+                                        const InstrumentEventType *ev) {
+    HartGraphType *h = harts_[ev->tag];
+    RISCV_mutex_lock(&h->mutex);
+    charge(h, ev->step);
+    switch (event) {
+    case InstrEvent_Call:
+        pushFrame(h, ev->addr, ev->pc, Frame_Call);
+        break;
+    case InstrEvent_Return:
+        // return address wasn't pushed by a call (profiling was started
+        // inside of the function), stay in the current frame
+        unwindTo(h, ev->addr);
+        break;
+    case InstrEvent_Trap:
+        pushFrame(h, trapKey(ev->addr, ev->write), ev->pc, Frame_Trap);
+        break;
+    case InstrEvent_TrapReturn:
+        switchStack(h, ev->addr);
+        break;
+    default:;
+    }
+    RISCV_mutex_unlock(&h->mutex);
+}
+
+void CallGraphProfiler::allocHarts(unsigned total) {
+    for (unsigned i = 0; i < total; i++) {
+        HartGraphType *h = new HartGraphType;
+        RISCV_mutex_init(&h->mutex);
+        clearHart(h);
+        harts_.push_back(h);
+    }
+}
+
+void CallGraphProfiler::clear() {
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        RISCV_mutex_lock(&harts_[i]->mutex);
+        clearHart(harts_[i]);
+        RISCV_mutex_unlock(&harts_[i]->mutex);
+    }
+}
+
+void CallGraphProfiler::clearHart(HartGraphType *h) {
+    CallNodeType root;
+    root.key = 0;
+    root.parent = -1;
+    root.calls = 0;
+    root.self = 0;
+    root.total = 0;
+    h->nodes.clear();
+    h->nodes.push_back(root);   // steps outside of the known functions
+    h->stack.clear();
+    h->saved.clear();
+    h->step = 0;
+    h->started = false;
+}
+
+/** Steps since the previous event belong to the top of the stack */
+void CallGraphProfiler::charge(HartGraphType *h, uint64_t step) {
+    if (h->started) {
+        int node = h->stack.size() ? h->stack.back().node : 0;
+        h->nodes[node].self += step - h->step;
+    }
+    h->step = step;
+    h->started = true;
+}
+
+int CallGraphProfiler::childNode(HartGraphType *h, int parent,
+                                 uint64_t key) {
+    std::map<uint64_t, int>::iterator it = h->nodes[parent].children.find(key);
+    if (it != h->nodes[parent].children.end()) {
+        return it->second;
+    }
+    CallNodeType node;
+    node.key = key;
+    node.parent = parent;
+    node.calls = 0;
+    node.self = 0;
+    node.total = 0;
+    int idx = static_cast<int>(h->nodes.size());
+    h->nodes.push_back(node);
+    h->nodes[parent].children[key] = idx;
+    return idx;
+}
+
+void CallGraphProfiler::pushFrame(HartGraphType *h, uint64_t key,
+                                  uint64_t pc, EFrameKind kind) {
+    FrameType frame;
+    frame.node = childNode(h, h->stack.size() ? h->stack.back().node : 0,
+                           key);
+    frame.pc = pc;
+    frame.kind = kind;
+    h->nodes[frame.node].calls++;
+    h->stack.push_back(frame);
+}
+
+/**
+ * Pop frames down to the call which return address is target. Search
+ * doesn't cross the trap frame: the handler can't return into the
+ * interrupted code with the return instruction.
+ */
+bool CallGraphProfiler::unwindTo(HartGraphType *h, uint64_t target) {
+    for (size_t i = h->stack.size(); i > 0; i--) {
+        const FrameType &f = h->stack[i - 1];
+        if (f.kind == Frame_Trap) {
+            return false;
+        }
+        if (f.kind == Frame_Call
+            && (target == f.pc + 2 || target == f.pc + 4)) {
+            h->stack.resize(i - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Return from trap into the interrupted instruction (or the next one for
+ * ecall) pops the trap frame. Otherwise the interrupted stack is saved
+ * until some trap returns to its address and the stack of the target is
+ * restored if it was saved earlier.
+ */
+void CallGraphProfiler::switchStack(HartGraphType *h, uint64_t target) {
+    std::map<uint64_t, std::vector<FrameType>>::iterator it;
+    size_t t = h->stack.size();
+    while (t > 0 && h->stack[t - 1].kind != Frame_Trap) {
+        t--;
+    }
+    if (t > 0) {
+        const FrameType &f = h->stack[t - 1];
+        if (target == f.pc || target == f.pc + 2 || target == f.pc + 4) {
+            h->stack.resize(t - 1);
+            return;
+        }
+        if (h->saved.size() >= CALLGRAPH_SAVED_MAX) {
+            h->saved.clear();
+        }
+        uint64_t pc = f.pc;
+        h->stack.resize(t - 1);
+        h->saved[pc] = h->stack;
+    }
+
+    const uint64_t off[3] = {0, 4, 2};
+    for (int i = 0; i < 3; i++) {
+        it = h->saved.find(target - off[i]);
+        if (it != h->saved.end()) {
+            h->stack.swap(it->second);
+            h->saved.erase(it);
+            return;
+        }
+    }
+    // The first entry into the task, return address is unknown
+    h->stack.clear();
+    pushFrame(h, target, 0, Frame_Entry);
+}
+
+std::string CallGraphProfiler::nodeName(uint64_t key) {
+    std::map<uint64_t, std::string>::iterator it = names_.find(key);
+    if (it != names_.end()) {
+        return it->second;
+    }
+    char tstr[256];
+    if (key & 0x1) {
+        RISCV_sprintf(tstr, sizeof(tstr), "[%s %d]",
+                      (key & 0x2) ? "irq" : "exception",
+                      static_cast<int>(key >> 2));
+    } else {
+        AttributeType symbol;
+        if (isrc_) {
+            isrc_->addressToSymbol(key, &symbol);
+        }
+        if (!symbol.is_list() || symbol[0u].size() == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "0x%" RV_PRI64 "x", key);
+        } else if (symbol[1].to_uint64() == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "%s", symbol[0u].to_string());
+        } else {
+            RISCV_sprintf(tstr, sizeof(tstr), "%s+0x%" RV_PRI64 "x",
+                          symbol[0u].to_string(), symbol[1].to_uint64());
+        }
+    }
+    names_[key] = tstr;
+    return names_[key];
+}
+
+void CallGraphProfiler::pathName(HartGraphType *h, int node,
+                                 std::string *path) {
+    if (node == 0) {
+        *path = "[unknown]";
+        return;
+    }
+    *path = nodeName(h->nodes[node].key);
+    node = h->nodes[node].parent;
+    while (node > 0) {
+        *path = nodeName(h->nodes[node].key) + ";" + *path;
+        node = h->nodes[node].parent;
+    }
+}
+
+/** Children are always allocated after the parent */
+void CallGraphProfiler::updateTotals(HartGraphType *h) {
+    for (size_t i = 0; i < h->nodes.size(); i++) {
+        h->nodes[i].total = h->nodes[i].self;
+    }
+    for (size_t i = h->nodes.size() - 1; i > 0; i--) {
+        h->nodes[h->nodes[i].parent].total += h->nodes[i].total;
+    }
+}
+
+void CallGraphProfiler::report(AttributeType *res) {
+    struct FuncStatType {
+        uint64_t calls;
+        uint64_t inclusive;
+        uint64_t exclusive;
+    };
+    std::map<std::string, FuncStatType> func;
+    std::map<std::string, FuncStatType>::iterator it;
+
+    for (unsigned n = 0; n < harts_.size(); n++) {
+        HartGraphType *h = harts_[n];
+        RISCV_mutex_lock(&h->mutex);
+        updateTotals(h);
+        for (size_t i = 0; i < h->nodes.size(); i++) {
+            const CallNodeType &node = h->nodes[i];
+            std::string name = i ? nodeName(node.key) : "[unknown]";
+            FuncStatType &st = func[name];
+            st.calls += node.calls;
+            st.exclusive += node.self;
+            // recursive call is already included into the outer one
+            int p = node.parent;
+            while (p > 0 && h->nodes[p].key != node.key) {
+                p = h->nodes[p].parent;
+            }
+            if (p <= 0) {
+                st.inclusive += i ? node.total : node.self;
+            }
+        }
+        RISCV_mutex_unlock(&h->mutex);
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> sorted;
+    for (it = func.begin(); it != func.end(); it++) {
+        sorted.push_back(std::make_pair(it->second.inclusive, it->first));
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<uint64_t, std::string> &a,
+                 const std::pair<uint64_t, std::string> &b) {
+                  return a.first > b.first;
+              });
+
+    res->make_list(static_cast<unsigned>(sorted.size()));
+    for (unsigned i = 0; i < sorted.size(); i++) {
+        const FuncStatType &st = func[sorted[i].second];
+        AttributeType &item = (*res)[i];
+        item.make_list(4);
+        item[0u].make_string(sorted[i].second.c_str());
+        item[1].make_uint64(st.calls);
+        item[2].make_uint64(st.inclusive);
+        item[3].make_uint64(st.exclusive);
+    }
+}
+
+/** Brendan Gregg's folded stacks: 'root;child;leaf steps' per line */
+void CallGraphProfiler::exportFolded(FILE *fd) {
+    std::map<std::string, uint64_t> folded;
+    std::map<std::string, uint64_t>::iterator it;
+    std::string path;
+
+    for (unsigned n = 0; n < harts_.size(); n++) {
+        HartGraphType *h = harts_[n];
+        for (size_t i = 0; i < h->nodes.size(); i++) {
+            if (h->nodes[i].self == 0) {
+                continue;
+            }
+            pathName(h, static_cast<int>(i), &path);
+            folded[path] += h->nodes[i].self;
+        }
+    }
+    for (it = folded.begin(); it != folded.end(); it++) {
+        fprintf(fd, "%s %" RV_PRI64 "u\n", it->first.c_str(), it->second);
+    }
+}
+
+/** Call paths are merged into the caller-callee pairs of functions */
+void CallGraphProfiler::exportCallgrind(FILE *fd) {
+    struct CallEdgeType {
+        uint64_t calls;
+        uint64_t inclusive;
+    };
+    struct CgFuncType {
+        uint64_t self;
+        std::map<std::string, CallEdgeType> callees;
+    };
+    std::map<std::string, CgFuncType> func;
+    std::map<std::string, CgFuncType>::iterator it;
+    std::map<std::string, CallEdgeType>::iterator e;
+
+    for (unsigned n = 0; n < harts_.size(); n++) {
+        HartGraphType *h = harts_[n];
+        for (size_t i = 0; i < h->nodes.size(); i++) {
+            const CallNodeType &node = h->nodes[i];
+            std::string name = i ? nodeName(node.key) : "[unknown]";
+            func[name].self += node.self;
+            if (i == 0) {
+                continue;
+            }
+            int p = node.parent;
+            std::string caller = p ? nodeName(h->nodes[p].key) : "[unknown]";
+            CallEdgeType &edge = func[caller].callees[name];
+            edge.calls += node.calls;
+            edge.inclusive += node.total;
+        }
+    }
+
+    fprintf(fd, "# callgrind format\n");
+    fprintf(fd, "version: 1\n");
+    fprintf(fd, "creator: riscv_vhdl debugger\n");
+    fprintf(fd, "positions: line\n");
+    fprintf(fd, "events: Steps\n\n");
+    for (it = func.begin(); it != func.end(); it++) {
+        fprintf(fd, "fn=%s\n", it->first.c_str());
+        fprintf(fd, "0 %" RV_PRI64 "u\n", it->second.self);
+        for (e = it->second.callees.begin();
+             e != it->second.callees.end(); e++) {
+            fprintf(fd, "cfn=%s\n", e->first.c_str());
+            fprintf(fd, "calls=%" RV_PRI64 "u 0\n", e->second.calls);
+            fprintf(fd, "0 %" RV_PRI64 "u\n", e->second.inclusive);
+        }
+        fprintf(fd, "\n");
+    }
+}
+
+}  // namespace debugger
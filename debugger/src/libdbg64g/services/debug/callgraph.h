@@ -0,0 +1,119 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include "instrument_generic.h"
+#include "coreservices/isrccode.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace debugger {
+
+/**
+ * Exact call graph: shadow call stack of each hart is built from the call,
+ * return and trap events and the steps between events are charged to the
+ * current call path. Command 'callgraph' returns the list of functions
+ * [name, calls, inclusive, exclusive], 'callgraph export' writes folded
+ * stacks for flame graphs or callgrind profile.
+ *
+ * Return unwinds to the frame matching its target, so that tail calls
+ * and longjmp keep the stack consistent. Trap handler is the nested frame
+ * of the interrupted path. When the trap returns to another place (context
+ * switch of RTOS) the interrupted stack is saved and the stack saved with
+ * the return address is restored.
+ *
+ * Attributes (additionally to GenericInstrumentPlugin):
+ *     SourceCode   Symbol table service
+ */
+class CallGraphProfiler : public GenericInstrumentPlugin {
+ public:
+    explicit CallGraphProfiler(const char *name);
+    virtual ~CallGraphProfiler();
+
+    /** IService interface */
+    virtual void postinitService() override;
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args) override;
+    virtual void exec(AttributeType *args, AttributeType *res) override;
+
+    /** IInstrumentListener */
+    virtual void instrumentEvent(int event,
+                                 const InstrumentEventType *ev) override;
+
+ protected:
+    virtual void allocHarts(unsigned total) override;
+    virtual void clear() override;
+    virtual void report(AttributeType *res) override;
+
+ private:
+    struct CallNodeType {
+        uint64_t key;           // call target or trap key
+        int parent;
+        uint64_t calls;
+        uint64_t self;          // steps in the function itself
+        uint64_t total;         // including children, updated on report
+        std::map<uint64_t, int> children;
+    };
+
+    enum EFrameKind {
+        Frame_Call,             // returns to the next instruction of pc
+        Frame_Trap,             // returns to pc or the next instruction
+        Frame_Entry             // unknown return address
+    };
+
+    struct FrameType {
+        int node;
+        uint64_t pc;
+        EFrameKind kind;
+    };
+
+    struct HartGraphType {
+        mutex_def mutex;        // report from another thread
+        std::vector<CallNodeType> nodes;
+        std::vector<FrameType> stack;
+        std::map<uint64_t, std::vector<FrameType>> saved;
+        uint64_t step;          // step of the previous event
+        bool started;
+    };
+
+    void charge(HartGraphType *h, uint64_t step);
+    int childNode(HartGraphType *h, int parent, uint64_t key);
+    void pushFrame(HartGraphType *h, uint64_t key, uint64_t pc,
+                   EFrameKind kind);
+    bool unwindTo(HartGraphType *h, uint64_t target);
+    void switchStack(HartGraphType *h, uint64_t target);
+    void clearHart(HartGraphType *h);
+
+    std::string nodeName(uint64_t key);
+    void pathName(HartGraphType *h, int node, std::string *path);
+    void updateTotals(HartGraphType *h);
+    void exportFolded(FILE *fd);
+    void exportCallgrind(FILE *fd);
+
+ private:
+    AttributeType src_;
+
+    ISourceCode *isrc_;
+    std::vector<HartGraphType *> harts_;
+    std::map<uint64_t, std::string> names_;
+};
+
+DECLARE_CLASS(CallGraphProfiler)
+
+}  // namespace debugger
@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "instrmix.h"
+
+namespace debugger {
+
+InstructionMixCounter::InstructionMixCounter(const char *name)
+    : GenericInstrumentPlugin(name, 1u << InstrEvent_Retire) {
+    briefDescr_.make_string("Number of executed instructions by name.");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Instruction mix collected by the instrumentation interface\n"
+        "    of the CPUs listed in the 'Cpu' attribute.\n"
+        "Usage:\n"
+        "    instrmix\n"
+        "    instrmix clear\n");
+}
+
+InstructionMixCounter::~InstructionMixCounter() {
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        RISCV_mutex_destroy(&harts_[i]->mutex);
+        delete harts_[i];
+    }
+}
+
+void InstructionMixCounter::instrumentEvent(int event,
+                                            const InstrumentEventType *ev) {
+    HartMixType *h = harts_[ev->tag];
+    RISCV_mutex_lock(&h->mutex);
+    h->mix[ev->instr]++;
+    RISCV_mutex_unlock(&h->mutex);
+}
+
+void InstructionMixCounter::allocHarts(unsigned total) {
+    for (unsigned i = 0; i < total; i++) {
+        HartMixType *h = new HartMixType;
+        RISCV_mutex_init(&h->mutex);
+        harts_.push_back(h);
+    }
+}
+
+void InstructionMixCounter::clear() {
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        RISCV_mutex_lock(&harts_[i]->mutex);
+        harts_[i]->mix.clear();
+        RISCV_mutex_unlock(&harts_[i]->mutex);
+    }
+}
+
+void InstructionMixCounter::report(AttributeType *res) {
+    res->make_dict();
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        MixTableType::iterator it;
+        RISCV_mutex_lock(&harts_[i]->mutex);
+        for (it = harts_[i]->mix.begin(); it != harts_[i]->mix.end(); it++) {
+            // Illegal opcodes have no decoded instruction
+            const char *name = it->first ? it->first->name() : "unknown";
+            AttributeType &cnt = (*res)[name];
+            if (!cnt.is_integer()) {
+                cnt.make_uint64(0);
+            }
+            cnt.make_uint64(cnt.to_uint64() + it->second);
+        }
+        RISCV_mutex_unlock(&harts_[i]->mutex);
+    }
+}
+
+}  // namespace debugger
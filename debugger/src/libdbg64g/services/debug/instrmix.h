@@ -0,0 +1,55 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include "instrument_generic.h"
+#include <unordered_map>
+#include <vector>
+
+namespace debugger {
+
+/**
+ * Instruction mix: number of retired instructions of each name. Command
+ * 'instrmix' returns dictionary {name: count} summed over all harts.
+ */
+class InstructionMixCounter : public GenericInstrumentPlugin {
+ public:
+    explicit InstructionMixCounter(const char *name);
+    virtual ~InstructionMixCounter();
+
+    /** IInstrumentListener */
+    virtual void instrumentEvent(int event,
+                                 const InstrumentEventType *ev) override;
+
+ protected:
+    virtual void allocHarts(unsigned total) override;
+    virtual void clear() override;
+    virtual void report(AttributeType *res) override;
+
+ private:
+    // Decoded instruction object is unique per name
+    typedef std::unordered_map<IInstruction *, uint64_t> MixTableType;
+    struct HartMixType {
+        mutex_def mutex;        // report from another thread
+        MixTableType mix;
+    };
+    std::vector<HartMixType *> harts_;
+};
+
+DECLARE_CLASS(InstructionMixCounter)
+
+}  // namespace debugger
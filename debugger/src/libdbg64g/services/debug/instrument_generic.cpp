@@ -0,0 +1,110 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "instrument_generic.h"
+
+namespace debugger {
+
+GenericInstrumentPlugin::GenericInstrumentPlugin(const char *name,
+                                                 uint32_t events)
+    : IService(name), ICommand(this, name) {
+    registerInterface(static_cast<IInstrumentListener *>(this));
+    registerAttribute("Cpu", &cpuList_);
+    registerAttribute("AddressRange", &addressRange_);
+    registerAttribute("PrvMask", &prvMask_);
+    registerAttribute("CmdExecutor", &cmdexec_);
+
+    cpuList_.make_list(0);
+    addressRange_.make_list(0);
+    prvMask_.make_uint64(0xF);
+    icmdexec_ = 0;
+    events_ = events;
+}
+
+void GenericInstrumentPlugin::postinitService() {
+    InstrumentFilterType filter;
+    filter.events = events_;
+    filter.addrmin = 0;
+    filter.addrmax = ~0ull;
+    if (addressRange_.size() == 2) {
+        filter.addrmin = addressRange_[0u].to_uint64();
+        filter.addrmax = addressRange_[1].to_uint64();
+    }
+    filter.prvmask = prvMask_.to_uint32();
+    filter.hartmask = ~0ull;
+
+    allocHarts(cpuList_.size());
+    for (unsigned i = 0; i < cpuList_.size(); i++) {
+        IInstrumentation *icpu = static_cast<IInstrumentation *>(
+            RISCV_get_service_iface(cpuList_[i].to_string(),
+                                    IFACE_INSTRUMENTATION));
+        if (!icpu) {
+            RISCV_error("IInstrumentation interface '%s' not found",
+                        cpuList_[i].to_string());
+            continue;
+        }
+        filter.tag = static_cast<int>(i);
+        if (!icpu->subscribeInstrument(
+                static_cast<IInstrumentListener *>(this), &filter)) {
+            RISCV_error("Too many instrumentation subscribers of '%s'",
+                        cpuList_[i].to_string());
+        }
+    }
+
+    icmdexec_ = static_cast<ICmdExecutor *>(
+        RISCV_get_service_iface(cmdexec_.to_string(), IFACE_CMD_EXECUTOR));
+    if (icmdexec_) {
+        icmdexec_->registerCommand(static_cast<ICommand *>(this));
+    }
+}
+
+void GenericInstrumentPlugin::predeleteService() {
+    if (icmdexec_) {
+        icmdexec_->unregisterCommand(static_cast<ICommand *>(this));
+    }
+    for (unsigned i = 0; i < cpuList_.size(); i++) {
+        IInstrumentation *icpu = static_cast<IInstrumentation *>(
+            RISCV_get_service_iface(cpuList_[i].to_string(),
+                                    IFACE_INSTRUMENTATION));
+        if (icpu) {
+            icpu->unsubscribeInstrument(
+                static_cast<IInstrumentListener *>(this));
+        }
+    }
+}
+
+int GenericInstrumentPlugin::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 1
+        || (args->size() == 2 && (*args)[1].is_equal("clear"))) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void GenericInstrumentPlugin::exec(AttributeType *args, AttributeType *res) {
+    if (args->size() == 2) {
+        clear();
+        res->attr_free();
+        return;
+    }
+    report(res);
+}
+
+}  // namespace debugger
@@ -0,0 +1,68 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/icmdexec.h"
+#include "coreservices/iinstrument.h"
+
+namespace debugger {
+
+/**
+ * Common part of the instrumentation consumers: subscription to the CPUs
+ * of the 'Cpu' list and the console command with the consumer name.
+ * Index of the CPU in the list is used as the event tag: each hart
+ * updates its own statistic under its own lock, so that harts never block
+ * each other.
+ *
+ * Attributes:
+ *     Cpu          List of CPU service names
+ *     AddressRange [min, max] of pc or data address, empty = any
+ *     PrvMask      Bit per privilege level, default all
+ *     CmdExecutor  Console command executor
+ */
+class GenericInstrumentPlugin : public IService,
+                                public IInstrumentListener,
+                                public ICommand {
+ public:
+    GenericInstrumentPlugin(const char *name, uint32_t events);
+
+    /** IService interface */
+    virtual void postinitService() override;
+    virtual void predeleteService() override;
+
+    /** ICommand: '<name>' prints the statistic, '<name> clear' resets */
+    virtual int isValid(AttributeType *args) override;
+    virtual void exec(AttributeType *args, AttributeType *res) override;
+
+ protected:
+    virtual void allocHarts(unsigned total) = 0;
+    virtual void clear() = 0;
+    virtual void report(AttributeType *res) = 0;
+
+ protected:
+    AttributeType cpuList_;
+    AttributeType addressRange_;
+    AttributeType prvMask_;
+    AttributeType cmdexec_;
+
+    ICmdExecutor *icmdexec_;
+    uint32_t events_;
+};
+
+}  // namespace debugger
@@ -0,0 +1,130 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "memfootprint.h"
+
+namespace debugger {
+
+MemoryFootprint::MemoryFootprint(const char *name)
+    : GenericInstrumentPlugin(name, 1u << InstrEvent_MemAccess) {
+    registerAttribute("LineBytes", &lineBytes_);
+    lineBytes_.make_uint64(64);
+    lineShift_ = 6;
+    briefDescr_.make_string("Distinct memory lines and pages accessed.");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Loads and stores footprint collected by the instrumentation\n"
+        "    interface of the CPUs listed in the 'Cpu' attribute.\n"
+        "Usage:\n"
+        "    memfootprint\n"
+        "    memfootprint clear\n");
+}
+
+MemoryFootprint::~MemoryFootprint() {
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        RISCV_mutex_destroy(&harts_[i]->mutex);
+        delete harts_[i];
+    }
+}
+
+void MemoryFootprint::postinitService() {
+    lineShift_ = 0;
+    while ((2ull << lineShift_) <= lineBytes_.to_uint64()
+           && lineShift_ < 12) {
+        lineShift_++;
+    }
+    GenericInstrumentPlugin::postinitService();
+}
+
+void MemoryFootprint::instrumentEvent(int event,
+                                      const InstrumentEventType *ev) {
+    HartFootprintType *h = harts_[ev->tag];
+    RISCV_mutex_lock(&h->mutex);
+    if (ev->write) {
+        h->writes++;
+        h->wbytes += ev->size;
+        h->wlines.insert(ev->addr >> lineShift_);
+    } else {
+        h->reads++;
+        h->rbytes += ev->size;
+        h->rlines.insert(ev->addr >> lineShift_);
+    }
+    RISCV_mutex_unlock(&h->mutex);
+}
+
+void MemoryFootprint::allocHarts(unsigned total) {
+    for (unsigned i = 0; i < total; i++) {
+        HartFootprintType *h = new HartFootprintType;
+        RISCV_mutex_init(&h->mutex);
+        harts_.push_back(h);
+    }
+    clear();
+}
+
+void MemoryFootprint::clear() {
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        HartFootprintType *h = harts_[i];
+        RISCV_mutex_lock(&h->mutex);
+        h->reads = 0;
+        h->writes = 0;
+        h->rbytes = 0;
+        h->wbytes = 0;
+        h->rlines.clear();
+        h->wlines.clear();
+        RISCV_mutex_unlock(&h->mutex);
+    }
+}
+
+void MemoryFootprint::report(AttributeType *res) {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t rbytes = 0;
+    uint64_t wbytes = 0;
+    std::unordered_set<uint64_t> lines;
+    std::unordered_set<uint64_t> wlines;
+    std::unordered_set<uint64_t> pages;
+    std::unordered_set<uint64_t>::iterator it;
+    int pageShift = 12 - lineShift_;
+
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        HartFootprintType *h = harts_[i];
+        RISCV_mutex_lock(&h->mutex);
+        reads += h->reads;
+        writes += h->writes;
+        rbytes += h->rbytes;
+        wbytes += h->wbytes;
+        lines.insert(h->rlines.begin(), h->rlines.end());
+        lines.insert(h->wlines.begin(), h->wlines.end());
+        wlines.insert(h->wlines.begin(), h->wlines.end());
+        RISCV_mutex_unlock(&h->mutex);
+    }
+    for (it = lines.begin(); it != lines.end(); it++) {
+        pages.insert(*it >> pageShift);
+    }
+
+    res->make_dict();
+    (*res)["Reads"].make_uint64(reads);
+    (*res)["Writes"].make_uint64(writes);
+    (*res)["ReadBytes"].make_uint64(rbytes);
+    (*res)["WriteBytes"].make_uint64(wbytes);
+    (*res)["Lines"].make_uint64(lines.size());
+    (*res)["WrittenLines"].make_uint64(wlines.size());
+    (*res)["Pages"].make_uint64(pages.size());
+    (*res)["FootprintBytes"].make_uint64(lines.size() << lineShift_);
+}
+
+}  // namespace debugger
@@ -0,0 +1,68 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include "instrument_generic.h"
+#include <unordered_set>
+#include <vector>
+
+namespace debugger {
+
+/**
+ * Memory footprint: number of distinct lines and 4 KB pages accessed by
+ * loads and stores. Command 'memfootprint' returns the dictionary with
+ * access counters and footprint of all harts.
+ *
+ * Attributes (additionally to GenericInstrumentPlugin):
+ *     LineBytes    Footprint granularity, power of 2, default 64
+ */
+class MemoryFootprint : public GenericInstrumentPlugin {
+ public:
+    explicit MemoryFootprint(const char *name);
+    virtual ~MemoryFootprint();
+
+    /** IService interface */
+    virtual void postinitService() override;
+
+    /** IInstrumentListener */
+    virtual void instrumentEvent(int event,
+                                 const InstrumentEventType *ev) override;
+
+ protected:
+    virtual void allocHarts(unsigned total) override;
+    virtual void clear() override;
+    virtual void report(AttributeType *res) override;
+
+ private:
+    AttributeType lineBytes_;
+
+    struct HartFootprintType {
+        mutex_def mutex;        // report from another thread
+        uint64_t reads;
+        uint64_t writes;
+        uint64_t rbytes;
+        uint64_t wbytes;
+        std::unordered_set<uint64_t> rlines;
+        std::unordered_set<uint64_t> wlines;
+    };
+    std::vector<HartFootprintType *> harts_;
+    int lineShift_;
+};
+
+DECLARE_CLASS(MemoryFootprint)
+
+}  // namespace debugger
@@ -0,0 +1,369 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "pcprofiler.h"
+#include <algorithm>
+#include <map>
+#include <string>
+
+namespace debugger {
+
+static const uint64_t PROFILE_PC_EMPTY = ~0ull;
+static const unsigned PROFILE_PROBE_MAX = 16;
+
+/** Quoted string with doubled quotes (RFC 4180) */
+static void writeCsvString(FILE *fd, const char *s) {
+    fputc('"', fd);
+    for (; *s; s++) {
+        if (*s == '"') {
+            fputc('"', fd);
+        }
+        fputc(*s, fd);
+    }
+    fputc('"', fd);
+}
+
+/** Quoted JSON string, control characters are written as \u00XX */
+static void writeJsonString(FILE *fd, const char *s) {
+    fputc('"', fd);
+    for (; *s; s++) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') {
+            fputc('\\', fd);
+            fputc(c, fd);
+        } else if (c < 0x20) {
+            fprintf(fd, "\\u%04x", c);
+        } else {
+            fputc(c, fd);
+        }
+    }
+    fputc('"', fd);
+}
+
+PcSamplingProfiler::HartSampler::HartSampler(PcSamplingProfiler *parent,
+                                             ICpuFunctional *icpu,
+                                             IClock *iclk,
+                                             unsigned size) {
+    p_ = parent;
+    icpu_ = icpu;
+    iclk_ = iclk;
+    size_ = size;
+    hist_ = new HistItemType[size_];
+    armed_ = false;
+    RISCV_mutex_init(&mutex_);
+    clear();
+}
+
+PcSamplingProfiler::HartSampler::~HartSampler() {
+    RISCV_mutex_destroy(&mutex_);
+    delete [] hist_;
+}
+
+void PcSamplingProfiler::HartSampler::clear() {
+    lock();
+    for (unsigned i = 0; i < size_; i++) {
+        hist_[i].pc = PROFILE_PC_EMPTY;
+        hist_[i].cnt = 0;
+    }
+    dropped_ = 0;
+    unlock();
+}
+
+void PcSamplingProfiler::HartSampler::arm() {
+    if (armed_.exchange(true)) {
+        // previous callback is still queued and continues sampling
+        return;
+    }
+    iclk_->registerStepCallback(static_cast<IClockListener *>(this),
+                    iclk_->getStepCounter() + p_->period_.to_uint64());
+}
+
+void PcSamplingProfiler::HartSampler::stepCallback(uint64_t t) {
+    if (!p_->running_) {
+        armed_ = false;
+        return;
+    }
+    sample(icpu_->getPC());
+    iclk_->registerStepCallback(static_cast<IClockListener *>(this),
+                                t + p_->period_.to_uint64());
+}
+
+/**
+ * Open addressing with linear probing. The single writer is the hart
+ * thread, the lock is taken once per period.
+ */
+void PcSamplingProfiler::HartSampler::sample(uint64_t pc) {
+    unsigned mask = size_ - 1;
+    unsigned idx = static_cast<unsigned>(
+        ((pc >> 1) * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    lock();
+    for (unsigned i = 0; i < PROFILE_PROBE_MAX; i++) {
+        HistItemType &item = hist_[(idx + i) & mask];
+        if (item.pc == pc) {
+            item.cnt++;
+            unlock();
+            return;
+        }
+        if (item.pc == PROFILE_PC_EMPTY) {
+            item.pc = pc;
+            item.cnt = 1;
+            unlock();
+            return;
+        }
+    }
+    dropped_++;
+    unlock();
+}
+
+
+PcSamplingProfiler::PcSamplingProfiler(const char *name)
+    : IService(name), ICommand(this, "profile") {
+    registerAttribute("Cpu", &cpuList_);
+    registerAttribute("Period", &period_);
+    registerAttribute("HistogramSize", &histSize_);
+    registerAttribute("SourceCode", &src_);
+    registerAttribute("CmdExecutor", &cmdexec_);
+
+    cpuList_.make_list(0);
+    period_.make_uint64(10000);
+    histSize_.make_uint64(16384);
+    icmdexec_ = 0;
+    isrc_ = 0;
+    running_ = false;
+
+    briefDescr_.make_string("Statistical pc-sampling profiler.");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Sample pc of each hart every 'Period' steps and report the\n"
+        "    number of samples per function.\n"
+        "Usage:\n"
+        "    profile start\n"
+        "    profile stop\n"
+        "    profile report [top <N>]\n"
+        "    profile export <filepath> [csv|json]\n"
+        "Example:\n"
+        "    profile start\n"
+        "    profile report top 10\n"
+        "    profile export profile.csv csv\n");
+}
+
+PcSamplingProfiler::~PcSamplingProfiler() {
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        delete harts_[i];
+    }
+}
+
+void PcSamplingProfiler::postinitService() {
+    unsigned size = 1;
+    while (size < histSize_.to_uint32()) {
+        size <<= 1;
+    }
+    if (period_.to_uint64() == 0) {
+        period_.make_uint64(1);
+    }
+
+    for (unsigned i = 0; i < cpuList_.size(); i++) {
+        const char *cpuname = cpuList_[i].to_string();
+        ICpuFunctional *icpu = static_cast<ICpuFunctional *>(
+            RISCV_get_service_iface(cpuname, IFACE_CPU_FUNCTIONAL));
+        IClock *iclk = static_cast<IClock *>(
+            RISCV_get_service_iface(cpuname, IFACE_CLOCK));
+        if (!icpu || !iclk) {
+            RISCV_error("Can't get ICpuFunctional or IClock of '%s'",
+                        cpuname);
+            continue;
+        }
+        harts_.push_back(new HartSampler(this, icpu, iclk, size));
+    }
+
+    isrc_ = static_cast<ISourceCode *>(
+        RISCV_get_service_iface(src_.to_string(), IFACE_SOURCE_CODE));
+    if (!isrc_) {
+        RISCV_error("Can't get ISourceCode interface %s", src_.to_string());
+    }
+
+    icmdexec_ = static_cast<ICmdExecutor *>(
+        RISCV_get_service_iface(cmdexec_.to_string(), IFACE_CMD_EXECUTOR));
+    if (icmdexec_) {
+        icmdexec_->registerCommand(static_cast<ICommand *>(this));
+    }
+}
+
+void PcSamplingProfiler::predeleteService() {
+    running_ = false;
+    if (icmdexec_) {
+        icmdexec_->unregisterCommand(static_cast<ICommand *>(this));
+    }
+}
+
+int PcSamplingProfiler::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 2 && ((*args)[1].is_equal("start")
+                           || (*args)[1].is_equal("stop")
+                           || (*args)[1].is_equal("report"))) {
+        return CMD_VALID;
+    }
+    if (args->size() == 4 && (*args)[1].is_equal("report")
+        && (*args)[2].is_equal("top") && (*args)[3].is_integer()) {
+        return CMD_VALID;
+    }
+    if ((args->size() == 3 || args->size() == 4)
+        && (*args)[1].is_equal("export") && (*args)[2].is_string()) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void PcSamplingProfiler::exec(AttributeType *args, AttributeType *res) {
+    res->attr_free();
+    res->make_nil();
+    if ((*args)[1].is_equal("start")) {
+        start();
+    } else if ((*args)[1].is_equal("stop")) {
+        stop();
+    } else if ((*args)[1].is_equal("report")) {
+        uint64_t top = args->size() == 4 ? (*args)[3].to_uint64() : 0;
+        report(top, res);
+    } else {
+        const char *filename = (*args)[2].to_string();
+        bool csv = false;
+        if (args->size() == 4) {
+            csv = (*args)[3].is_equal("csv");
+        } else {
+            size_t len = strlen(filename);
+            csv = len > 4 && strcmp(&filename[len - 4], ".csv") == 0;
+        }
+        exportFile(filename, csv, res);
+    }
+}
+
+void PcSamplingProfiler::start() {
+    if (running_) {
+        return;
+    }
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        harts_[i]->clear();
+    }
+    running_ = true;
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        harts_[i]->arm();
+    }
+}
+
+void PcSamplingProfiler::stop() {
+    running_ = false;
+}
+
+/**
+ * Result is the list of [function, samples, percent] sorted by samples.
+ * Samples dropped because of the full histogram are reported as the
+ * '<dropped>' item, addresses without symbol as '<unknown>'.
+ */
+void PcSamplingProfiler::report(uint64_t top, AttributeType *res) {
+    std::map<std::string, uint64_t> func;
+    std::map<std::string, uint64_t>::iterator it;
+    AttributeType symbol;
+    uint64_t total = 0;
+    uint64_t dropped = 0;
+
+    for (unsigned n = 0; n < harts_.size(); n++) {
+        HartSampler *h = harts_[n];
+        h->lock();
+        for (unsigned i = 0; i < h->size(); i++) {
+            uint64_t pc = h->pc(i);
+            uint64_t cnt = h->cnt(i);
+            if (pc == PROFILE_PC_EMPTY || cnt == 0) {
+                continue;
+            }
+            symbol.make_nil();
+            if (isrc_) {
+                isrc_->addressToSymbol(pc, &symbol);
+            }
+            if (symbol.size() && symbol[0u].size()) {
+                func[symbol[0u].to_string()] += cnt;
+            } else {
+                func["<unknown>"] += cnt;
+            }
+            total += cnt;
+        }
+        dropped += h->dropped();
+        h->unlock();
+    }
+    if (dropped) {
+        func["<dropped>"] += dropped;
+        total += dropped;
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> sorted;
+    for (it = func.begin(); it != func.end(); it++) {
+        sorted.push_back(std::make_pair(it->second, it->first));
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<uint64_t, std::string> &a,
+                 const std::pair<uint64_t, std::string> &b) {
+                  return a.first > b.first;
+              });
+    if (top == 0 || top > sorted.size()) {
+        top = sorted.size();
+    }
+
+    res->make_list(static_cast<unsigned>(top));
+    for (unsigned i = 0; i < top; i++) {
+        AttributeType &item = (*res)[i];
+        item.make_list(3);
+        item[0u].make_string(sorted[i].second.c_str());
+        item[1].make_uint64(sorted[i].first);
+        item[2].make_floating(100.0 * static_cast<double>(sorted[i].first)
+                              / static_cast<double>(total));
+    }
+}
+
+void PcSamplingProfiler::exportFile(const char *filename, bool csv,
+                                    AttributeType *res) {
+    FILE *fd = fopen(filename, "wb");
+    if (fd == NULL) {
+        char tst[256];
+        RISCV_sprintf(tst, sizeof(tst), "Can't open '%s' file", filename);
+        generateError(res, tst);
+        return;
+    }
+    AttributeType prof;
+    report(0, &prof);
+    if (csv) {
+        fprintf(fd, "function,samples,percent\n");
+        for (unsigned i = 0; i < prof.size(); i++) {
+            writeCsvString(fd, prof[i][0u].to_string());
+            fprintf(fd, ",%" RV_PRI64 "u,%.3f\n",
+                    prof[i][1].to_uint64(), prof[i][2].to_float());
+        }
+    } else {
+        fprintf(fd, "[\n");
+        for (unsigned i = 0; i < prof.size(); i++) {
+            fprintf(fd, "  {\"function\": ");
+            writeJsonString(fd, prof[i][0u].to_string());
+            fprintf(fd, ", \"samples\": %" RV_PRI64 "u, \"percent\": %.3f}%s\n",
+                    prof[i][1].to_uint64(), prof[i][2].to_float(),
+                    i + 1 < prof.size() ? "," : "");
+        }
+        fprintf(fd, "]\n");
+    }
+    fclose(fd);
+}
+
+}  // namespace debugger
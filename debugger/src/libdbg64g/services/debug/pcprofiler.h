@@ -0,0 +1,115 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/icmdexec.h"
+#include "coreservices/iclock.h"
+#include "coreservices/icpufunctional.h"
+#include "coreservices/isrccode.h"
+#include <atomic>
+#include <vector>
+
+namespace debugger {
+
+/**
+ * Statistical profiler: pc of each hart is sampled every 'Period' steps
+ * using the step callback of the hart. Samples are accumulated in the
+ * per hart hash table written only by the hart thread; its lock is shared
+ * only with the console commands. Addresses are resolved into function
+ * names only on report.
+ *
+ * Attributes:
+ *     Cpu              List of CPU service names
+ *     Period           Steps between samples
+ *     HistogramSize    Distinct pc per hart, power of 2
+ *     SourceCode       Symbol table service
+ *     CmdExecutor      Console command executor
+ */
+class PcSamplingProfiler : public IService,
+                           public ICommand {
+ public:
+    explicit PcSamplingProfiler(const char *name);
+    virtual ~PcSamplingProfiler();
+
+    /** IService interface */
+    virtual void postinitService() override;
+    virtual void predeleteService() override;
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args) override;
+    virtual void exec(AttributeType *args, AttributeType *res) override;
+
+ private:
+    void start();
+    void stop();
+    void report(uint64_t top, AttributeType *res);
+    void exportFile(const char *filename, bool csv, AttributeType *res);
+
+ private:
+    class HartSampler : public IClockListener {
+     public:
+        HartSampler(PcSamplingProfiler *parent, ICpuFunctional *icpu,
+                    IClock *iclk, unsigned size);
+        virtual ~HartSampler();
+
+        /** IClockListener */
+        virtual void stepCallback(uint64_t t) override;
+
+        void arm();
+        void clear();
+        void lock() { RISCV_mutex_lock(&mutex_); }
+        void unlock() { RISCV_mutex_unlock(&mutex_); }
+        unsigned size() { return size_; }
+        uint64_t pc(unsigned idx) { return hist_[idx].pc; }
+        uint64_t cnt(unsigned idx) { return hist_[idx].cnt; }
+        uint64_t dropped() { return dropped_; }
+
+     private:
+        void sample(uint64_t pc);
+
+     private:
+        struct HistItemType {
+            uint64_t pc;
+            uint64_t cnt;
+        };
+        PcSamplingProfiler *p_;
+        ICpuFunctional *icpu_;
+        IClock *iclk_;
+        mutex_def mutex_;               // report and clear from console
+        HistItemType *hist_;
+        unsigned size_;
+        uint64_t dropped_;              // samples of the full table
+        std::atomic<bool> armed_;       // step callback is queued
+    };
+
+    AttributeType cpuList_;
+    AttributeType period_;
+    AttributeType histSize_;
+    AttributeType src_;
+    AttributeType cmdexec_;
+
+    ICmdExecutor *icmdexec_;
+    ISourceCode *isrc_;
+    std::vector<HartSampler *> harts_;
+    std::atomic<bool> running_;
+};
+
+DECLARE_CLASS(PcSamplingProfiler)
+
+}  // namespace debugger
@@ -324,8 +324,34 @@ int opcode_0x04(uint64_t pc, uint32_t code,
         }
         break;
     case 1:
-        RISCV_sprintf(tstr, sizeof(tstr), "slli    %s,%s,%d",
-            RN[i.bits.rd], RN[i.bits.rs1], imm);
+        if ((code >> 26) == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "slli    %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm);
+        } else if (i.bits.imm == 0x600) {
+            RISCV_sprintf(tstr, sizeof(tstr), "clz     %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if (i.bits.imm == 0x601) {
+            RISCV_sprintf(tstr, sizeof(tstr), "ctz     %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if (i.bits.imm == 0x602) {
+            RISCV_sprintf(tstr, sizeof(tstr), "cpop    %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if (i.bits.imm == 0x604) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sext.b  %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if (i.bits.imm == 0x605) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sext.h  %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if ((code >> 26) == 0x12) {
+            RISCV_sprintf(tstr, sizeof(tstr), "bclri   %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x3F);
+        } else if ((code >> 26) == 0x1A) {
+            RISCV_sprintf(tstr, sizeof(tstr), "binvi   %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x3F);
+        } else if ((code >> 26) == 0x0A) {
+            RISCV_sprintf(tstr, sizeof(tstr), "bseti   %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x3F);
+        }
         break;
     case 2:
         RISCV_sprintf(tstr, sizeof(tstr), "slti    %s,%s,%d",
@@ -343,9 +369,21 @@ int opcode_0x04(uint64_t pc, uint32_t code,
         if ((code >> 26) == 0) {
             RISCV_sprintf(tstr, sizeof(tstr), "srli    %s,%s,%d",
                 RN[i.bits.rd], RN[i.bits.rs1], imm);
-        } else if ((code >> 26) == 0x20) {
+        } else if ((code >> 26) == 0x10) {
             RISCV_sprintf(tstr, sizeof(tstr), "srai    %s,%s,%d",
-                RN[i.bits.rd], RN[i.bits.rs1], imm);
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x3F);
+        } else if ((code >> 26) == 0x18) {
+            RISCV_sprintf(tstr, sizeof(tstr), "rori    %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x3F);
+        } else if ((code >> 26) == 0x12) {
+            RISCV_sprintf(tstr, sizeof(tstr), "bexti   %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x3F);
+        } else if (i.bits.imm == 0x287) {
+            RISCV_sprintf(tstr, sizeof(tstr), "orc.b   %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if (i.bits.imm == 0x6B8) {
+            RISCV_sprintf(tstr, sizeof(tstr), "rev8    %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
         }
         break;
     case 6:
@@ -397,8 +435,22 @@ int opcode_0x06(uint64_t pc, uint32_t code,
             RN[i.bits.rd], RN[i.bits.rs1], imm);
         break;
     case 1:
-        RISCV_sprintf(tstr, sizeof(tstr), "slliw   %s,%s,%d",
-            RN[i.bits.rd], RN[i.bits.rs1], imm);
+        if ((code >> 25) == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "slliw   %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm);
+        } else if ((code >> 26) == 0x02) {
+            RISCV_sprintf(tstr, sizeof(tstr), "slli.uw %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x3F);
+        } else if (i.bits.imm == 0x600) {
+            RISCV_sprintf(tstr, sizeof(tstr), "clzw    %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if (i.bits.imm == 0x601) {
+            RISCV_sprintf(tstr, sizeof(tstr), "ctzw    %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        } else if (i.bits.imm == 0x602) {
+            RISCV_sprintf(tstr, sizeof(tstr), "cpopw   %s,%s",
+                RN[i.bits.rd], RN[i.bits.rs1]);
+        }
         break;
     case 5:
         if ((code >> 25) == 0) {
@@ -407,6 +459,9 @@ int opcode_0x06(uint64_t pc, uint32_t code,
         } else if ((code >> 25) == 0x20) {
             RISCV_sprintf(tstr, sizeof(tstr), "sraiw   %s,%s,%d",
                 RN[i.bits.rd], RN[i.bits.rs1], imm);
+        } else if ((code >> 25) == 0x30) {
+            RISCV_sprintf(tstr, sizeof(tstr), "roriw   %s,%s,%d",
+                RN[i.bits.rd], RN[i.bits.rs1], imm & 0x1F);
         }
         break;
     default:;
@@ -598,12 +653,31 @@ int opcode_0x0C(uint64_t pc, uint32_t code,
         }
         break;
     case 1:
-        RISCV_sprintf(tstr, sizeof(tstr), "sll     %s,%s,%s",
-            RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        if (r.bits.funct7 == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sll     %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x30) {
+            RISCV_sprintf(tstr, sizeof(tstr), "rol     %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x24) {
+            RISCV_sprintf(tstr, sizeof(tstr), "bclr    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x34) {
+            RISCV_sprintf(tstr, sizeof(tstr), "binv    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x14) {
+            RISCV_sprintf(tstr, sizeof(tstr), "bset    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        }
         break;
     case 2:
-        RISCV_sprintf(tstr, sizeof(tstr), "slt     %s,%s,%s",
-            RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        if (r.bits.funct7 == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "slt     %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x10) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sh1add  %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        }
         break;
     case 3:
         RISCV_sprintf(tstr, sizeof(tstr), "sltu     %s,%s,%s",
@@ -616,6 +690,15 @@ int opcode_0x0C(uint64_t pc, uint32_t code,
         } else if (r.bits.funct7 == 1) {
             RISCV_sprintf(tstr, sizeof(tstr), "div     %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x10) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sh2add  %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x20) {
+            RISCV_sprintf(tstr, sizeof(tstr), "xnor    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x05) {
+            RISCV_sprintf(tstr, sizeof(tstr), "min     %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
         }
         break;
     case 5:
@@ -628,6 +711,15 @@ int opcode_0x0C(uint64_t pc, uint32_t code,
         } else if (r.bits.funct7 == 0x20) {
             RISCV_sprintf(tstr, sizeof(tstr), "sra     %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x05) {
+            RISCV_sprintf(tstr, sizeof(tstr), "minu    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x30) {
+            RISCV_sprintf(tstr, sizeof(tstr), "ror     %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x24) {
+            RISCV_sprintf(tstr, sizeof(tstr), "bext    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
         }
         break;
     case 6:
@@ -637,6 +729,15 @@ int opcode_0x0C(uint64_t pc, uint32_t code,
         } else if (r.bits.funct7 == 1) {
             RISCV_sprintf(tstr, sizeof(tstr), "rem     %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x10) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sh3add  %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x20) {
+            RISCV_sprintf(tstr, sizeof(tstr), "orn     %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x05) {
+            RISCV_sprintf(tstr, sizeof(tstr), "max     %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
         }
         break;
     case 7:
@@ -646,6 +747,12 @@ int opcode_0x0C(uint64_t pc, uint32_t code,
         } else if (r.bits.funct7 == 1) {
             RISCV_sprintf(tstr, sizeof(tstr), "remu    %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x20) {
+            RISCV_sprintf(tstr, sizeof(tstr), "andn    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x05) {
+            RISCV_sprintf(tstr, sizeof(tstr), "maxu    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
         }
         break;
     default:;
@@ -686,16 +793,36 @@ int opcode_0x0E(uint64_t pc, uint32_t code,
         } else if (r.bits.funct7 == 0x20) {
             RISCV_sprintf(tstr, sizeof(tstr), "subw    %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x04) {
+            RISCV_sprintf(tstr, sizeof(tstr), "add.uw  %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
         }
         break;
     case 1:
-        RISCV_sprintf(tstr, sizeof(tstr), "sllw    %s,%s,%s",
-            RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        if (r.bits.funct7 == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sllw    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x30) {
+            RISCV_sprintf(tstr, sizeof(tstr), "rolw    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        }
+        break;
+    case 2:
+        if (r.bits.funct7 == 0x10) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sh1add.uw %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        }
         break;
     case 4:
         if (r.bits.funct7 == 1) {
             RISCV_sprintf(tstr, sizeof(tstr), "divw    %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x10) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sh2add.uw %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x04 && r.bits.rs2 == 0) {
+            RISCV_sprintf(tstr, sizeof(tstr), "zext.h  %s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1]);
         }
         break;
     case 5:
@@ -708,12 +835,18 @@ int opcode_0x0E(uint64_t pc, uint32_t code,
         } else if (r.bits.funct7 == 0x20) {
             RISCV_sprintf(tstr, sizeof(tstr), "sraw    %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x30) {
+            RISCV_sprintf(tstr, sizeof(tstr), "rorw    %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
         }
         break;
     case 6:
         if (r.bits.funct7 == 1) {
             RISCV_sprintf(tstr, sizeof(tstr), "remw    %s,%s,%s",
                 RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
+        } else if (r.bits.funct7 == 0x10) {
+            RISCV_sprintf(tstr, sizeof(tstr), "sh3add.uw %s,%s,%s",
+                RN[r.bits.rd], RN[r.bits.rs1], RN[r.bits.rs2]);
         }
         break;
     case 7:
@@ -26,8 +26,16 @@ CLINT::CLINT(const char *name) : RegMemBankGeneric(name),
     mtimecmp(static_cast<IService *>(this), "mtimecmp", 0x004000),
     mtime(static_cast<IService *>(this), "mtime", 0x00bff8) {
     registerInterface(static_cast<IIrqController *>(this));
+    registerInterface(static_cast<IClockListener *>(this));
     registerAttribute("Clock", &clock_);
+    irqListeners_.make_list(0);
+    iclk_ = 0;
     update_time_ = 0;
+    RISCV_mutex_init(&mutexIrq_);
+}
+
+CLINT::~CLINT() {
+    RISCV_mutex_destroy(&mutexIrq_);
 }
 
 void CLINT::postinitService() {
@@ -40,20 +48,25 @@ void CLINT::postinitService() {
         RISCV_error("Can't get IClock interface %s",
                     clock_.to_string());
     }
+    updateIrqLevels();
 }
 
 void CLINT::setTimer(uint64_t v) {
+    RISCV_mutex_lock(&mutexIrq_);
     update_time_ = iclk_->getStepCounter();
     mtime.setValue(v);
+    RISCV_mutex_unlock(&mutexIrq_);
 }
 
 void CLINT::updateTimer() {
+    RISCV_mutex_lock(&mutexIrq_);
     uint64_t cur_time = iclk_->getStepCounter();
     uint64_t dt = cur_time - update_time_;
     uint64_t t = mtime.getValue().val;
 
     update_time_ = cur_time;
     mtime.setValue(t + dt);
+    RISCV_mutex_unlock(&mutexIrq_);
 }
 
 int CLINT::getPendingRequest(int ctxid) {
@@ -80,6 +93,80 @@ int CLINT::getPendingRequest(int ctxid) {
     return ret;
 }
 
+bool CLINT::registerIrqListener(int ctxid, IFace *listener) {
+    AttributeType item;
+    item.make_list(IrqListener_Total);
+    item[IrqListener_CtxId].make_int64(ctxid);
+    item[IrqListener_Iface].make_iface(listener);
+    item[IrqListener_Level].make_int64(-1);
+    RISCV_mutex_lock(&mutexIrq_);
+    irqListeners_.add_to_list(&item);
+    RISCV_mutex_unlock(&mutexIrq_);
+    updateIrqLevels();
+    return true;
+}
+
+void CLINT::stepCallback(uint64_t t) {
+    updateIrqLevels();
+}
+
+/**
+ * Report changed levels to the listeners and schedule the step callback
+ * on the nearest mtimecmp crossing instead of polling on each step.
+ * Called from the threads of all harts, the mutex is recursive so the
+ * listener may read the pending request.
+ */
+void CLINT::updateIrqLevels() {
+    uint64_t tnext = ~0ull;
+    uint64_t t, cmp;
+    uint32_t hartid;
+    int ctxid, level;
+    if (!iclk_) {
+        return;
+    }
+    RISCV_mutex_lock(&mutexIrq_);
+    updateTimer();
+    t = mtime.getValue().val;
+    for (unsigned i = 0; i < irqListeners_.size(); i++) {
+        AttributeType &item = irqListeners_[i];
+        ctxid = item[IrqListener_CtxId].to_int();
+        hartid = static_cast<uint32_t>(ctxid) / 2;
+        if (ctxid & 0x1) {
+            cmp = mtimecmp.getp()[hartid].val;
+            level = t >= cmp ? 1 : 0;
+            if (!level && (cmp - t) < tnext) {
+                tnext = cmp - t;
+            }
+        } else {
+            level = msip.getp()[hartid].bits.b0;
+        }
+        if (level == item[IrqListener_Level].to_int()) {
+            continue;
+        }
+        item[IrqListener_Level].make_int64(level);
+        static_cast<IIrqListener *>(item[IrqListener_Iface].to_iface())->
+            irqLevelChanged(static_cast<IIrqController *>(this), ctxid, level);
+    }
+
+    if (tnext < ~0ull - update_time_) {
+        iclk_->moveStepCallback(static_cast<IClockListener *>(this),
+                                update_time_ + tnext);
+    }
+    RISCV_mutex_unlock(&mutexIrq_);
+}
+
+void CLINT::CLINT_MSIP_TYPE::write(int idx, uint32_t val) {
+    CLINT *p = static_cast<CLINT *>(parent_);
+    GenericReg32Bank::write(idx, val);
+    p->updateIrqLevels();
+}
+
+void CLINT::CLINT_MTIMECMP_TYPE::write(int idx, uint64_t val) {
+    CLINT *p = static_cast<CLINT *>(parent_);
+    GenericReg64Bank::write(idx, val);
+    p->updateIrqLevels();
+}
+
 uint64_t CLINT::CLINT_MTIME_TYPE::aboutToRead(uint64_t cur_val) {
     CLINT *p = static_cast<CLINT *>(parent_);
     p->updateTimer();
@@ -90,6 +177,7 @@ uint64_t CLINT::CLINT_MTIME_TYPE::aboutToRead(uint64_t cur_val) {
 uint64_t CLINT::CLINT_MTIME_TYPE::aboutToWrite(uint64_t new_val) {
     CLINT *p = static_cast<CLINT *>(parent_);
     p->setTimer(new_val);
+    p->updateIrqLevels();
     return new_val;
 }
 
@@ -29,9 +29,11 @@ namespace debugger {
 static const int CLINT_HART_MAX = 4096;
 
 class CLINT : public RegMemBankGeneric,
-              public IIrqController {
+              public IIrqController,
+              public IClockListener {
  public:
     explicit CLINT(const char *name);
+    virtual ~CLINT();
 
     /** IService interface */
     virtual void postinitService() override;
@@ -39,10 +41,15 @@ class CLINT : public RegMemBankGeneric,
     /** IIrqController */
     virtual int requestInterrupt(IFace *isrc, int idx) { return 0; }
     virtual int getPendingRequest(int ctxid);
+    virtual bool registerIrqListener(int ctxid, IFace *listener);
+
+    /** IClockListener */
+    virtual void stepCallback(uint64_t t);
 
  private:
     void setTimer(uint64_t v);
     void updateTimer();
+    void updateIrqLevels();
 
  private:
 
@@ -50,6 +57,8 @@ class CLINT : public RegMemBankGeneric,
      public:
         CLINT_MSIP_TYPE(IService *parent, const char *name, uint64_t addr)
             : GenericReg32Bank(parent, name, addr, CLINT_HART_MAX) {}
+
+        virtual void write(int idx, uint32_t val) override;
     };
 
     class CLINT_MTIMECMP_TYPE : public GenericReg64Bank {
@@ -58,6 +67,9 @@ class CLINT : public RegMemBankGeneric,
             : GenericReg64Bank(parent, name, addr, CLINT_HART_MAX - 1) {
             // shouldn't be reset on reset signal
         }
+
+        using GenericReg64Bank::write;
+        virtual void write(int idx, uint64_t val) override;
     };
 
     class CLINT_MTIME_TYPE : public MappedReg64Type {
@@ -70,7 +82,15 @@ class CLINT : public RegMemBankGeneric,
         virtual uint64_t aboutToWrite(uint64_t new_val) override;
     };
 
+    enum EIrqListenerItem {
+        IrqListener_CtxId,
+        IrqListener_Iface,
+        IrqListener_Level,      // last reported level, -1 = not reported
+        IrqListener_Total
+    };
+
     AttributeType clock_;
+    AttributeType irqListeners_;    // [[ctxid, iface, level], ...]
 
     IClock *iclk_;
 
@@ -79,6 +99,7 @@ class CLINT : public RegMemBankGeneric,
     CLINT_MTIME_TYPE mtime;          // [00bff8] 1 register for all hart
 
     uint64_t update_time_;          // Last time when mtime was updated
+    mutex_def mutexIrq_;            // harts access registers in parallel
 };
 
 DECLARE_CLASS(CLINT)
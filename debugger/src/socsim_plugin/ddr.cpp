@@ -51,6 +51,23 @@ ETransStatus DDR::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+/** Window is one allocated block (1 KB) */
+bool DDR::getMemoryWindow(uint64_t addr, MemoryWindowType *w) {
+    uint64_t off = addr - getBaseAddress();
+    if (off >= getLength()) {
+        return false;
+    }
+    uint8_t *data = getpMem(off);
+    uint64_t blkoff = off & 0x3FF;
+    uint64_t sz = 0x400;
+    if (off - blkoff + sz > getLength()) {
+        sz = getLength() - (off - blkoff);
+    }
+    makeMemoryWindow(w, addr - blkoff, sz, data - blkoff,
+                     MemWindow_Read | MemWindow_Write);
+    return true;
+}
+
 uint8_t *DDR::getpMem(uint64_t addr) {
     MemBlockType *b = &mem_;
     uint64_t bid = addr >> 10;
@@ -33,6 +33,7 @@ class DDR : public IService,
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
+    virtual bool getMemoryWindow(uint64_t addr, MemoryWindowType *w);
 
  private:
     virtual uint8_t *getpMem(uint64_t addr);
@@ -29,6 +29,7 @@ PLIC::PLIC(const char *name) : RegMemBankGeneric(name),
 
     contextList_.make_list(0);
     pendingList_.make_list(0);
+    irqListeners_.make_list(0);
     ctx_enable = 0;
     ctx_priority_th = 0;
     ctx_claim = 0;
@@ -83,6 +84,7 @@ void PLIC::postinitService() {
     }
 
     RegMemBankGeneric::postinitService();
+    updateIrqLevels();
 }
 
 int PLIC::requestInterrupt(IFace *isrc, int idx) {
@@ -137,6 +139,43 @@ int PLIC::getPendingRequest(int ctxid) {
     return irqidx;
 }
 
+bool PLIC::registerIrqListener(int ctxid, IFace *listener) {
+    AttributeType item;
+    item.make_list(IrqListener_Total);
+    item[IrqListener_CtxId].make_int64(ctxid);
+    item[IrqListener_Iface].make_iface(listener);
+    item[IrqListener_Level].make_int64(-1);
+    irqListeners_.add_to_list(&item);
+    updateIrqLevels();
+    return true;
+}
+
+/**
+ * Re-evaluate request of each subscribed context. Called on any change
+ * of pending bits, enables or priorities.
+ */
+void PLIC::updateIrqLevels() {
+    int ctxid, level;
+    if (ctx_enable == 0) {
+        // contexts aren't created yet
+        return;
+    }
+    for (unsigned i = 0; i < irqListeners_.size(); i++) {
+        AttributeType &item = irqListeners_[i];
+        ctxid = item[IrqListener_CtxId].to_int();
+        if (static_cast<unsigned>(ctxid) >= contextList_.size()) {
+            continue;
+        }
+        level = getPendingRequest(ctxid) != IRQ_REQUEST_NONE ? 1 : 0;
+        if (level == item[IrqListener_Level].to_int()) {
+            continue;
+        }
+        item[IrqListener_Level].make_int64(level);
+        static_cast<IIrqListener *>(item[IrqListener_Iface].to_iface())->
+            irqLevelChanged(static_cast<IIrqController *>(this), ctxid, level);
+    }
+}
+
 bool PLIC::isEnabled(uint32_t irqidx) {
     // Check bits [2:0]
     // A priority value of 0 is
@@ -183,6 +222,7 @@ void PLIC::setPendingBit(int idx) {
         pendingList_.new_list_item().make_int64(idx);
     }
     RISCV_info("request Interrupt %d", idx);
+    updateIrqLevels();
 }
 
 void PLIC::clearPendingBit(int idx) {
@@ -196,6 +236,7 @@ void PLIC::clearPendingBit(int idx) {
             break;
         }
     }
+    updateIrqLevels();
 }
 
 void PLIC::enableInterrupt(uint32_t ctxid, int idx) {
@@ -230,6 +271,20 @@ void PLIC::PLIC_ENABLE_TYPE::write(int idx, uint32_t val) {
             p->enableInterrupt(contextid_, 32*idx + i);
         }
     }
+    p->updateIrqLevels();
+}
+
+void PLIC::PLIC_SRC_PRIORITY_TYPE::write(int idx, uint32_t val) {
+    PLIC *p = static_cast<PLIC *>(parent_);
+    GenericReg32Bank::write(idx, val & 0x7);
+    p->updateIrqLevels();
+}
+
+uint32_t PLIC::PLIC_CONTEXT_PRIOIRTY_TYPE::aboutToWrite(uint32_t nxt_val) {
+    PLIC *p = static_cast<PLIC *>(parent_);
+    setValue(nxt_val);
+    p->updateIrqLevels();
+    return nxt_val;
 }
 
 uint32_t PLIC::PLIC_CLAIM_COMPLETE_TYPE::aboutToRead(uint32_t prv_val) {
@@ -39,6 +39,7 @@ class PLIC : public RegMemBankGeneric,
     /** IIrqController */
     virtual int requestInterrupt(IFace *isrc, int idx);
     virtual int getPendingRequest(int ctxid);
+    virtual bool registerIrqListener(int ctxid, IFace *listener);
 
     /** Controller specific methods visible for ports */
     void enableInterrupt(uint32_t ctxid, int idx);
@@ -51,6 +52,7 @@ class PLIC : public RegMemBankGeneric,
  private:
     bool isEnabled(uint32_t irqidx);
     bool isUnmasked(uint32_t ctxid, uint32_t irqidx);
+    void updateIrqLevels();
 
  private:
 
@@ -70,9 +72,7 @@ class PLIC : public RegMemBankGeneric,
         PLIC_SRC_PRIORITY_TYPE(IService *parent, const char *name, uint64_t addr, int len)
             : GenericReg32Bank(parent, name, addr, len) {}
 
-        virtual void write(int idx, uint32_t val) override {
-            GenericReg32Bank::write(idx, val & 0x7);
-        }
+        virtual void write(int idx, uint32_t val) override;
     };
 
     class PLIC_CONTEXT_PRIOIRTY_TYPE : public MappedReg32Type {
@@ -83,6 +83,8 @@ class PLIC : public RegMemBankGeneric,
         }
 
         uint32_t getContextPrioiry() { return getValue().val & 0x7; }
+     protected:
+        virtual uint32_t aboutToWrite(uint32_t nxt_val) override;
      protected:
         unsigned contextid_;
     };
@@ -101,8 +103,16 @@ class PLIC : public RegMemBankGeneric,
         unsigned contextid_;
     };
 
+    enum EIrqListenerItem {
+        IrqListener_CtxId,
+        IrqListener_Iface,
+        IrqListener_Level,      // last reported level, -1 = not reported
+        IrqListener_Total
+    };
+
     AttributeType contextList_;     // List of context names: [MCore0, MCore1, SCore1, MCore2, ...]
     AttributeType pendingList_;     // requested interrupt packed into attribute for better performance
+    AttributeType irqListeners_;    // [[ctxid, iface, level], ...]
 
     PLIC_SRC_PRIORITY_TYPE src_priority;            // [000000..000FFC] 0 doens't exists, 1..1023
     GenericReg32Bank pending;                       // [001000..00107C] 0..1023 1 bit per interrupt
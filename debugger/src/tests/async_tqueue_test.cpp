@@ -0,0 +1,206 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <async_tqueue.h>
+#include "unittest.h"
+
+using namespace debugger;
+
+/** Ordering of the step callbacks queue (ClockAsyncTQueueType) */
+
+class TestCallback : public IFace {
+ public:
+    TestCallback() : IFace("IClockListener") {}
+};
+
+static const int CB_TOTAL = 64;
+static TestCallback cb_[CB_TOTAL];
+
+static int cbIndex(IFace *cb) {
+    for (int i = 0; i < CB_TOTAL; i++) {
+        if (cb == &cb_[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void test_time_order() {
+    ClockAsyncTQueueType q;
+    const uint64_t t[] = {50, 10, 40, 20, 30, 0, 60};
+    for (int i = 0; i < 7; i++) {
+        q.put(t[i], &cb_[i]);
+    }
+    UT_CHECK(q.getNextDeadline() == 0);
+    q.pushPreQueued();
+    UT_CHECK(q.getNextDeadline() == 0);
+    UT_CHECK(q.getNext(0) == &cb_[5]);
+    UT_CHECK(q.getNextDeadline() == 10);
+
+    // Nothing before its time
+    UT_CHECK(q.getNext(9) == 0);
+    UT_CHECK(q.getNext(35) == &cb_[1]);
+    UT_CHECK(q.getNext(35) == &cb_[3]);
+    UT_CHECK(q.getNext(35) == &cb_[4]);
+    UT_CHECK(q.getNext(35) == 0);
+    UT_CHECK(q.getNextDeadline() == 40);
+    UT_CHECK(q.getNext(100) == &cb_[2]);
+    UT_CHECK(q.getNext(100) == &cb_[0]);
+    UT_CHECK(q.getNext(100) == &cb_[6]);
+    UT_CHECK(q.getNext(100) == 0);
+    UT_CHECK(q.getNextDeadline() == ~0ull);
+}
+
+static void test_same_time_fifo() {
+    ClockAsyncTQueueType q;
+    // Registration order is kept for equal times, across heap growth
+    for (int i = 0; i < CB_TOTAL; i++) {
+        q.put(i & 1 ? 100 : 200, &cb_[i]);
+    }
+    q.pushPreQueued();
+    for (int i = 1; i < CB_TOTAL; i += 2) {
+        UT_CHECK(q.getNext(1000) == &cb_[i]);
+    }
+    for (int i = 0; i < CB_TOTAL; i += 2) {
+        UT_CHECK(q.getNext(1000) == &cb_[i]);
+    }
+    UT_CHECK(q.getNext(1000) == 0);
+
+    // Requests queued after a push follow the already queued ones
+    q.put(5, &cb_[0]);
+    q.pushPreQueued();
+    q.put(5, &cb_[1]);
+    q.put(5, &cb_[2]);
+    q.pushPreQueued();
+    UT_CHECK(q.getNext(5) == &cb_[0]);
+    UT_CHECK(q.getNext(5) == &cb_[1]);
+    UT_CHECK(q.getNext(5) == &cb_[2]);
+}
+
+static void test_move() {
+    ClockAsyncTQueueType q;
+    for (int i = 0; i < 8; i++) {
+        q.put(10 * (i + 1), &cb_[i]);
+    }
+    q.pushPreQueued();
+
+    // Earlier, later and the same time as another callback
+    q.move(&cb_[7], 5);
+    q.move(&cb_[0], 75);
+    q.move(&cb_[3], 20);
+    UT_CHECK(q.getNextDeadline() == 0);
+    q.pushPreQueued();
+    UT_CHECK(q.getNextDeadline() == 5);
+
+    // Not registered callback is added
+    q.move(&cb_[10], 35);
+    q.pushPreQueued();
+
+    const int order[] = {7, 1, 3, 2, 10, 4, 5, 6, 0};
+    for (int i = 0; i < 9; i++) {
+        UT_CHECK(cbIndex(q.getNext(100)) == order[i]);
+    }
+    UT_CHECK(q.getNext(~0ull) == 0);
+
+    // move() re-schedules the only entry instead of adding one more
+    q.put(10, &cb_[0]);
+    q.move(&cb_[0], 20);
+    q.move(&cb_[0], 30);
+    q.pushPreQueued();
+    UT_CHECK(q.getNextDeadline() == 30);
+    UT_CHECK(q.getNext(100) == &cb_[0]);
+    UT_CHECK(q.getNext(100) == 0);
+}
+
+static void test_hard_reset() {
+    ClockAsyncTQueueType q;
+    q.put(1, &cb_[0]);
+    q.pushPreQueued();
+    q.put(2, &cb_[1]);
+    q.hardReset();
+    UT_CHECK(q.getNextDeadline() == ~0ull);
+    q.pushPreQueued();
+    UT_CHECK(q.getNext(~0ull) == 0);
+}
+
+/** Registration from the several threads while the owner drains */
+static const int PUT_THREADS = 4;
+static const int PUT_PER_THREAD = 10000;
+
+struct PutThreadArgs {
+    ClockAsyncTQueueType *q;
+    int idx;
+};
+
+static thread_return_t putThread(void *args) {
+    PutThreadArgs *p = reinterpret_cast<PutThreadArgs *>(args);
+    for (int i = 0; i < PUT_PER_THREAD; i++) {
+        p->q->put(static_cast<uint64_t>(i), &cb_[p->idx]);
+    }
+    return 0;
+}
+
+static void test_concurrent_put() {
+    ClockAsyncTQueueType q;
+    LibThreadType th[PUT_THREADS];
+    PutThreadArgs args[PUT_THREADS];
+    int cnt[PUT_THREADS] = {0};
+    uint64_t last = 0;
+    bool sorted = true;
+    int total = 0;
+
+    for (int i = 0; i < PUT_THREADS; i++) {
+        args[i].q = &q;
+        args[i].idx = i;
+        th[i].func = reinterpret_cast<lib_thread_func>(putThread);
+        th[i].args = &args[i];
+        RISCV_thread_create(&th[i]);
+    }
+    for (int i = 0; i < PUT_THREADS; i++) {
+        RISCV_thread_join(th[i].Handle, 10000);
+    }
+    q.pushPreQueued();
+
+    IFace *cb;
+    while (q.getNextDeadline() != ~0ull) {
+        uint64_t t = q.getNextDeadline();
+        sorted = sorted && t >= last;
+        last = t;
+        cb = q.getNext(t);
+        int idx = cbIndex(cb);
+        if (idx < 0 || idx >= PUT_THREADS) {
+            sorted = false;
+            break;
+        }
+        cnt[idx]++;
+        total++;
+    }
+    UT_CHECK(sorted);
+    UT_CHECK(total == PUT_THREADS * PUT_PER_THREAD);
+    for (int i = 0; i < PUT_THREADS; i++) {
+        UT_CHECK(cnt[i] == PUT_PER_THREAD);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    UT_RUN(test_time_order);
+    UT_RUN(test_same_time_fifo);
+    UT_RUN(test_move);
+    UT_RUN(test_hard_reset);
+    UT_RUN(test_concurrent_put);
+    return unittest_failures;
+}
@@ -0,0 +1,262 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "generic/bintrace.h"
+#include "unittest.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace debugger;
+
+/**
+ * Binary trace round trip: records stored by BinaryTraceWriter are read
+ * back with the bintrace.h helpers the same way as tracedec does it.
+ */
+
+static const char *TRACE_FILE = "bintrace_test.bin";
+
+struct ActionType {
+    bool memop;
+    bool write;
+    int idx;            // register index or access size
+    uint64_t addr;
+    uint64_t value;
+};
+
+struct RecordType {
+    uint64_t step;
+    uint64_t pc;
+    uint32_t instr;
+    int oplen;
+    std::vector<ActionType> actions;
+};
+
+static void test_varint() {
+    const uint64_t uv[] = {0, 1, 0x7f, 0x80, 0x3fff, 0x4000,
+                           0xffffffffull, 0x8000000000000000ull, ~0ull};
+    const int64_t sv[] = {0, 1, -1, 63, -64, 64, -65,
+                          0x7fffffffffffffffll, -0x7fffffffffffffffll - 1};
+    uint8_t buf[16];
+    uint64_t u;
+    int64_t s;
+    int cnt;
+
+    for (unsigned i = 0; i < sizeof(uv) / sizeof(uv[0]); i++) {
+        cnt = bintrace_put_varint(buf, uv[i]);
+        UT_CHECK(bintrace_get_varint(buf, cnt, &u) == cnt);
+        UT_CHECK(u == uv[i]);
+        // Truncated value is not decoded
+        UT_CHECK(bintrace_get_varint(buf, cnt - 1, &u) == 0);
+    }
+    UT_CHECK(bintrace_put_varint(buf, 0x7f) == 1);
+    UT_CHECK(bintrace_put_varint(buf, ~0ull) == 10);
+
+    for (unsigned i = 0; i < sizeof(sv) / sizeof(sv[0]); i++) {
+        cnt = bintrace_put_svarint(buf, sv[i]);
+        UT_CHECK(bintrace_get_svarint(buf, cnt, &s) == cnt);
+        UT_CHECK(s == sv[i]);
+    }
+    // Small deltas of both signs take one byte
+    UT_CHECK(bintrace_put_svarint(buf, -64) == 1);
+    UT_CHECK(bintrace_put_svarint(buf, 63) == 1);
+}
+
+/** Sequential code, jumps of both directions, RVC and all action kinds */
+static void generateRecords(std::vector<RecordType> &recs) {
+    RecordType r;
+    ActionType a;
+    uint64_t pc = 0x10000;
+    uint64_t step = 0;
+    uint64_t addr = 0x80000000;
+    uint32_t rnd = 1;
+
+    for (int i = 0; i < 600000; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        r.actions.clear();
+        r.oplen = (rnd >> 8) & 1 ? 2 : 4;
+        r.instr = r.oplen == 2 ? (rnd >> 16) & 0xFFFF : rnd | 0x3;
+        step += (rnd >> 9) & 0x7 ? 1 : 1 + ((rnd >> 12) & 0xFFF);
+        switch ((rnd >> 20) & 0xF) {
+        case 0:
+            pc -= 0x1000 + ((rnd >> 4) & 0xFFC);
+            break;
+        case 1:
+            pc = pc == 0x10000 ? 0xFFFFFFFF80000000ull : 0x10000;
+            break;
+        default:;
+        }
+        r.step = step;
+        r.pc = pc;
+
+        int actions = (rnd >> 24) & 0x3;
+        if (i % 1000 == 0) {
+            actions = 40;       // more than fits into the flags field
+        }
+        for (int n = 0; n < actions; n++) {
+            rnd = rnd * 1103515245 + 12345;
+            a.memop = (rnd >> 7) & 1;
+            if (a.memop) {
+                a.write = (rnd >> 8) & 1;
+                a.idx = 1 << ((rnd >> 9) & 0x3);
+                addr += static_cast<int64_t>(static_cast<int16_t>(rnd >> 16));
+                a.addr = addr;
+                a.value = static_cast<uint64_t>(rnd) * 0x9E3779B97F4A7C15ull;
+            } else {
+                a.write = true;
+                a.idx = (rnd >> 9) & 0x3F;
+                a.addr = 0;
+                a.value = (rnd >> 15) & 1 ? ~static_cast<uint64_t>(rnd)
+                                          : rnd >> 20;
+            }
+            r.actions.push_back(a);
+        }
+        recs.push_back(r);
+        pc += r.oplen;
+    }
+}
+
+static bool readFile(std::vector<uint8_t> &data) {
+    FILE *f = fopen(TRACE_FILE, "rb");
+    if (!f) {
+        return false;
+    }
+    uint8_t tbuf[4096];
+    size_t sz;
+    while ((sz = fread(tbuf, 1, sizeof(tbuf), f)) > 0) {
+        data.insert(data.end(), tbuf, tbuf + sz);
+    }
+    fclose(f);
+    return true;
+}
+
+/** Return number of decoded records that match to the reference */
+static int decodeAndCompare(const std::vector<uint8_t> &data,
+                            const std::vector<RecordType> &recs) {
+    size_t off = 8;
+    uint64_t pc = 0;
+    uint64_t oplen = 0;
+    uint64_t step = 0;
+    uint64_t memaddr = 0;
+    int64_t sv;
+    uint64_t v;
+    int cnt;
+    const uint8_t *buf = data.data();
+    size_t sz = data.size();
+
+    for (size_t i = 0; i < recs.size(); i++) {
+        const RecordType &r = recs[i];
+        if (off >= sz) {
+            return static_cast<int>(i);
+        }
+        uint8_t flags = buf[off++];
+        pc += oplen;
+        step += 1;
+        if (!(flags & BINTRACE_PC_SEQ)) {
+            cnt = bintrace_get_svarint(&buf[off], sz - off, &sv);
+            off += cnt;
+            pc += static_cast<uint64_t>(sv) - oplen;
+        }
+        if (!(flags & BINTRACE_STEP_SEQ)) {
+            cnt = bintrace_get_svarint(&buf[off], sz - off, &sv);
+            off += cnt;
+            step += static_cast<uint64_t>(sv);
+        }
+        oplen = (flags & BINTRACE_RVC) ? 2 : 4;
+        uint32_t instr = 0;
+        memcpy(&instr, &buf[off], static_cast<size_t>(oplen));
+        off += static_cast<size_t>(oplen);
+        int actions = flags >> BINTRACE_ACTIONS_SHIFT;
+        if (actions == BINTRACE_ACTIONS_EXT) {
+            off += bintrace_get_varint(&buf[off], sz - off, &v);
+            actions = static_cast<int>(v);
+        }
+        if (pc != r.pc || step != r.step || instr != r.instr
+            || static_cast<int>(oplen) != r.oplen
+            || actions != static_cast<int>(r.actions.size())) {
+            return static_cast<int>(i);
+        }
+        for (int n = 0; n < actions; n++) {
+            const ActionType &a = r.actions[n];
+            uint8_t act = buf[off++];
+            if (!(act & BINTRACE_ACT_MEMOP)) {
+                off += bintrace_get_svarint(&buf[off], sz - off, &sv);
+                if (a.memop || (act >> 1) != a.idx
+                    || static_cast<uint64_t>(sv) != a.value) {
+                    return static_cast<int>(i);
+                }
+            } else {
+                off += bintrace_get_svarint(&buf[off], sz - off, &sv);
+                memaddr += static_cast<uint64_t>(sv);
+                off += bintrace_get_varint(&buf[off], sz - off, &v);
+                bool write = (act & BINTRACE_ACT_WRITE) != 0;
+                if (!a.memop || write != a.write || (act >> 2) != a.idx
+                    || memaddr != a.addr || v != a.value) {
+                    return static_cast<int>(i);
+                }
+            }
+        }
+    }
+    return off == sz ? static_cast<int>(recs.size()) : -1;
+}
+
+static void test_round_trip() {
+    std::vector<RecordType> recs;
+    std::vector<uint8_t> data;
+    BinaryTraceWriter *wr = new BinaryTraceWriter();
+
+    generateRecords(recs);
+    UT_CHECK(wr->open(TRACE_FILE));
+    for (size_t i = 0; i < recs.size(); i++) {
+        const RecordType &r = recs[i];
+        wr->instruction(r.step, r.pc, r.instr, r.oplen,
+                        static_cast<int>(r.actions.size()));
+        for (size_t n = 0; n < r.actions.size(); n++) {
+            const ActionType &a = r.actions[n];
+            if (a.memop) {
+                wr->memop(a.write, a.addr, a.value, a.idx);
+            } else {
+                wr->regWrite(a.idx, a.value);
+            }
+        }
+    }
+    wr->close();
+    delete wr;
+
+    UT_CHECK(readFile(data));
+    remove(TRACE_FILE);
+
+    // Writer buffers were swapped
+    UT_CHECK(data.size() > (4u << 20));
+    uint32_t hdr[2] = {0};
+    memcpy(hdr, data.data(), sizeof(hdr));
+    UT_CHECK(hdr[0] == BINTRACE_MAGIC);
+    UT_CHECK(hdr[1] == BINTRACE_VERSION);
+
+    int matched = decodeAndCompare(data, recs);
+    if (matched != static_cast<int>(recs.size())) {
+        printf("first mismatch at record %d of %d\n",
+               matched, static_cast<int>(recs.size()));
+    }
+    UT_CHECK(matched == static_cast<int>(recs.size()));
+}
+
+int main(int argc, char *argv[]) {
+    UT_RUN(test_varint);
+    UT_RUN(test_round_trip);
+    return unittest_failures;
+}
@@ -0,0 +1,44 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __SRC_TESTS_UNITTEST_H__
+#define __SRC_TESTS_UNITTEST_H__
+
+#include <stdio.h>
+
+/**
+ * Minimal checks for the host tests run by ctest: the failed condition
+ * is printed and counted, main() returns the number of failures.
+ */
+static int unittest_failures = 0;
+
+#define UT_CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            unittest_failures++; \
+        } \
+    } while (0)
+
+#define UT_RUN(test) \
+    do { \
+        int failures = unittest_failures; \
+        test(); \
+        printf("%s %s\n", \
+               failures == unittest_failures ? "[ OK ]" : "[FAIL]", #test); \
+    } while (0)
+
+#endif  // __SRC_TESTS_UNITTEST_H__
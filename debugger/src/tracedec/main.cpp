@@ -0,0 +1,268 @@
+/*
+ *  Copyright 2019 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include <iclass.h>
+#include <iservice.h>
+#include <riscv-isa.h>
+#include "generic/bintrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace debugger;
+
+/**
+ * Offline decoder of the binary execution trace: regenerates the text
+ * trace of the functional RISC-V model.
+ *
+ *     tracedec <trace.bin> [-o <trace.log>] [-pc <min> <max>]
+ *              [-from <step>] [-to <step>]
+ *
+ * -pc selects instructions in the inclusive address range, -from and -to
+ * select the window of steps. Register and memory actions are printed
+ * with their instruction.
+ */
+
+static const size_t READ_BUFFER_SIZE = 4 << 20;
+
+struct DecoderStateType {
+    uint64_t pc;
+    uint64_t oplen;
+    uint64_t step;
+    uint64_t memaddr;
+};
+
+struct FilterType {
+    uint64_t pcmin;
+    uint64_t pcmax;
+    uint64_t stepmin;
+    uint64_t stepmax;
+};
+
+static void printUsage() {
+    printf("Usage: tracedec <trace.bin> [-o <trace.log>] "
+           "[-pc <min> <max>] [-from <step>] [-to <step>]\n");
+}
+
+/** Decode one record from buf. Return 0 if the record is truncated */
+static int decodeRecord(const uint8_t *buf, size_t sz, DecoderStateType *st,
+                        const FilterType &flt, ISourceCode *isrc,
+                        AttributeType *instrbuf, AttributeType *asmlist,
+                        FILE *fout) {
+    char tstr[1024];
+    size_t off = 1;
+    int cnt;
+    int64_t sv;
+    uint64_t v;
+    uint32_t instr = 0;
+
+    if (sz < 1) {
+        return 0;
+    }
+    uint8_t flags = buf[0];
+    uint64_t pc = st->pc + st->oplen;
+    uint64_t step = st->step + 1;
+    if (!(flags & BINTRACE_PC_SEQ)) {
+        if ((cnt = bintrace_get_svarint(&buf[off], sz - off, &sv)) == 0) {
+            return 0;
+        }
+        off += cnt;
+        pc = st->pc + static_cast<uint64_t>(sv);
+    }
+    if (!(flags & BINTRACE_STEP_SEQ)) {
+        if ((cnt = bintrace_get_svarint(&buf[off], sz - off, &sv)) == 0) {
+            return 0;
+        }
+        off += cnt;
+        step += static_cast<uint64_t>(sv);
+    }
+    int oplen = (flags & BINTRACE_RVC) ? 2 : 4;
+    if (off + oplen > sz) {
+        return 0;
+    }
+    memcpy(&instr, &buf[off], oplen);
+    off += oplen;
+    int actions = flags >> BINTRACE_ACTIONS_SHIFT;
+    if (actions == BINTRACE_ACTIONS_EXT) {
+        if ((cnt = bintrace_get_varint(&buf[off], sz - off, &v)) == 0) {
+            return 0;
+        }
+        off += cnt;
+        actions = static_cast<int>(v);
+    }
+
+    bool ena = pc >= flt.pcmin && pc <= flt.pcmax
+            && step >= flt.stepmin && step <= flt.stepmax;
+    if (ena) {
+        memset(instrbuf->data(), 0, instrbuf->size());
+        memcpy(instrbuf->data(), &instr, sizeof(instr));
+        isrc->disasm(0, pc, instrbuf, asmlist);
+        bintrace_text_instr(tstr, sizeof(tstr), step, pc,
+                            bintrace_mnemonic(asmlist));
+        fputs(tstr, fout);
+    }
+
+    for (int i = 0; i < actions; i++) {
+        if (off >= sz) {
+            return 0;
+        }
+        uint8_t act = buf[off++];
+        if (!(act & BINTRACE_ACT_MEMOP)) {
+            if ((cnt = bintrace_get_svarint(&buf[off], sz - off, &sv)) == 0) {
+                return 0;
+            }
+            off += cnt;
+            unsigned idx = act >> 1;
+            if (!ena) {
+                continue;
+            }
+            if (idx < sizeof(RISCV_IREGS_NAMES) / sizeof(const char *)) {
+                bintrace_text_reg(tstr, sizeof(tstr), RISCV_IREGS_NAMES[idx],
+                                  static_cast<uint64_t>(sv));
+            } else {
+                char rname[16];
+                RISCV_sprintf(rname, sizeof(rname), "r%d", idx);
+                bintrace_text_reg(tstr, sizeof(tstr), rname,
+                                  static_cast<uint64_t>(sv));
+            }
+        } else {
+            if ((cnt = bintrace_get_svarint(&buf[off], sz - off, &sv)) == 0) {
+                return 0;
+            }
+            off += cnt;
+            if ((cnt = bintrace_get_varint(&buf[off], sz - off, &v)) == 0) {
+                return 0;
+            }
+            off += cnt;
+            st->memaddr += static_cast<uint64_t>(sv);
+            if (!ena) {
+                continue;
+            }
+            bintrace_text_memop(tstr, sizeof(tstr),
+                                (act & BINTRACE_ACT_WRITE) != 0,
+                                st->memaddr, v);
+        }
+        fputs(tstr, fout);
+    }
+
+    st->pc = pc;
+    st->oplen = static_cast<uint64_t>(oplen);
+    st->step = step;
+    return static_cast<int>(off);
+}
+
+int main(int argc, char* argv[]) {
+    const char *inname = 0;
+    const char *outname = 0;
+    FilterType flt = {0, ~0ull, 0, ~0ull};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outname = argv[++i];
+        } else if (strcmp(argv[i], "-pc") == 0 && i + 2 < argc) {
+            flt.pcmin = strtoull(argv[++i], 0, 0);
+            flt.pcmax = strtoull(argv[++i], 0, 0);
+        } else if (strcmp(argv[i], "-from") == 0 && i + 1 < argc) {
+            flt.stepmin = strtoull(argv[++i], 0, 0);
+        } else if (strcmp(argv[i], "-to") == 0 && i + 1 < argc) {
+            flt.stepmax = strtoull(argv[++i], 0, 0);
+        } else if (argv[i][0] != '-' && inname == 0) {
+            inname = argv[i];
+        } else {
+            printUsage();
+            return -1;
+        }
+    }
+    if (inname == 0) {
+        printUsage();
+        return -1;
+    }
+
+    FILE *fin = fopen(inname, "rb");
+    if (!fin) {
+        fprintf(stderr, "Error: can't open %s\n", inname);
+        return -1;
+    }
+    uint32_t hdr[2];
+    if (fread(hdr, sizeof(hdr), 1, fin) != 1 || hdr[0] != BINTRACE_MAGIC
+        || hdr[1] != BINTRACE_VERSION) {
+        fprintf(stderr, "Error: %s isn't binary trace of version %d\n",
+                inname, BINTRACE_VERSION);
+        fclose(fin);
+        return -1;
+    }
+    FILE *fout = stdout;
+    if (outname) {
+        fout = fopen(outname, "wb");
+        if (!fout) {
+            fprintf(stderr, "Error: can't open %s\n", outname);
+            fclose(fin);
+            return -1;
+        }
+    }
+
+    RISCV_init();
+    IClass *icls = static_cast<IClass *>(
+        RISCV_get_class("RiscvSourceServiceClass"));
+    IService *isrv = icls->createService("tracedec_src0");
+    ISourceCode *isrc = static_cast<ISourceCode *>(
+        isrv->getInterface(IFACE_SOURCE_CODE));
+
+    AttributeType instrbuf;
+    AttributeType asmlist;
+    DecoderStateType st = {0, 0, 0, 0};
+    uint8_t *buf = new uint8_t[READ_BUFFER_SIZE];
+    size_t cnt = 0;
+    size_t pos = 0;
+    bool eof = false;
+    int ret = 0;
+    instrbuf.make_data(8);
+
+    while (true) {
+        if (!eof && cnt - pos < BINTRACE_RECORD_MAX) {
+            memmove(buf, &buf[pos], cnt - pos);
+            cnt -= pos;
+            pos = 0;
+            size_t rd = fread(&buf[cnt], 1, READ_BUFFER_SIZE - cnt, fin);
+            cnt += rd;
+            eof = rd == 0;
+        }
+        if (pos == cnt) {
+            break;
+        }
+        int sz = decodeRecord(&buf[pos], cnt - pos, &st, flt, isrc,
+                              &instrbuf, &asmlist, fout);
+        if (sz <= 0) {
+            fprintf(stderr, "Error: truncated record at step %"
+                    RV_PRI64 "d\n", st.step + 1);
+            ret = -1;
+            break;
+        }
+        pos += sz;
+        if (st.step > flt.stepmax) {
+            break;
+        }
+    }
+
+    delete [] buf;
+    fclose(fin);
+    if (fout != stdout) {
+        fclose(fout);
+    }
+    RISCV_cleanup();
+    return ret;
+}
@@ -0,0 +1,162 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * Scalar vs RVV versions of the Q15 FIR filter and the double precision
+ * correlator. Requires GCC 13 or newer with the RVV intrinsics and 'V'
+ * in the ListExtISA attribute of the functional CPU model.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <stdio.h>
+#include <riscv_vector.h>
+#include <axi_maps.h>
+#include <utils.h>
+
+#define FIR_TAPS 32
+#define FIR_SAMPLES 512
+#define CORR_LAGS 16
+#define CORR_SAMPLES 256
+
+static int16_t fir_x[FIR_SAMPLES + FIR_TAPS];
+static int16_t fir_h[FIR_TAPS];
+static int32_t fir_y_scalar[FIR_SAMPLES];
+static int32_t fir_y_vector[FIR_SAMPLES];
+
+static double corr_a[CORR_SAMPLES];
+static double corr_b[CORR_SAMPLES + CORR_LAGS];
+static double corr_r_scalar[CORR_LAGS];
+static double corr_r_vector[CORR_LAGS];
+
+static void print_str(const char *s) {
+    while (*s) {
+        utils_uart_putc(*s++);
+    }
+}
+
+static void init_data() {
+    uint32_t seed = 0x12345678;
+    for (int i = 0; i < FIR_SAMPLES + FIR_TAPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        fir_x[i] = (int16_t)(seed >> 16);
+    }
+    for (int i = 0; i < FIR_TAPS; i++) {
+        fir_h[i] = (int16_t)(0x7FFF / (i + 2));
+    }
+    for (int i = 0; i < CORR_SAMPLES + CORR_LAGS; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (i < CORR_SAMPLES) {
+            corr_a[i] = (double)(int32_t)seed / 65536.0;
+        }
+        corr_b[i] = (double)(int32_t)(seed ^ 0x5A5A5A5A) / 65536.0;
+    }
+}
+
+static void fir_scalar(int32_t *y) {
+    for (int n = 0; n < FIR_SAMPLES; n++) {
+        int32_t acc = 0;
+        for (int k = 0; k < FIR_TAPS; k++) {
+            acc += (int32_t)fir_h[k] * fir_x[n + k];
+        }
+        y[n] = acc >> 15;
+    }
+}
+
+static void fir_vector(int32_t *y) {
+    size_t vl;
+    for (int n = 0; n < FIR_SAMPLES; n += vl) {
+        vl = __riscv_vsetvl_e16m1(FIR_SAMPLES - n);
+        vint32m2_t acc = __riscv_vmv_v_x_i32m2(0, vl);
+        for (int k = 0; k < FIR_TAPS; k++) {
+            vint16m1_t x = __riscv_vle16_v_i16m1(&fir_x[n + k], vl);
+            acc = __riscv_vwmacc_vx_i32m2(acc, fir_h[k], x, vl);
+        }
+        acc = __riscv_vsra_vx_i32m2(acc, 15, vl);
+        __riscv_vse32_v_i32m2(&y[n], acc, vl);
+    }
+}
+
+static void corr_scalar(double *r) {
+    for (int lag = 0; lag < CORR_LAGS; lag++) {
+        double acc = 0;
+        for (int n = 0; n < CORR_SAMPLES; n++) {
+            acc += corr_a[n] * corr_b[n + lag];
+        }
+        r[lag] = acc;
+    }
+}
+
+static void corr_vector(double *r) {
+    size_t vlmax = __riscv_vsetvlmax_e64m1();
+    vfloat64m1_t zero = __riscv_vfmv_s_f_f64m1(0.0, 1);
+    size_t vl;
+    for (int lag = 0; lag < CORR_LAGS; lag++) {
+        vfloat64m1_t acc = __riscv_vfmv_v_f_f64m1(0.0, vlmax);
+        for (int n = 0; n < CORR_SAMPLES; n += vl) {
+            vl = __riscv_vsetvl_e64m1(CORR_SAMPLES - n);
+            vfloat64m1_t a = __riscv_vle64_v_f64m1(&corr_a[n], vl);
+            vfloat64m1_t b = __riscv_vle64_v_f64m1(&corr_b[n + lag], vl);
+            acc = __riscv_vfmacc_vv_f64m1_tu(acc, a, b, vl);
+        }
+        acc = __riscv_vfredusum_vs_f64m1_f64m1(acc, zero, vlmax);
+        r[lag] = __riscv_vfmv_f_s_f64m1_f64(acc);
+    }
+}
+
+static void report(const char *name, uint64_t t_scalar, uint64_t t_vector,
+                   int errors) {
+    char ss[256];
+    sprintf(ss, "%s: scalar %d clk, vector %d clk, x%d.%02d, errors %d\n",
+            name, (int)t_scalar, (int)t_vector,
+            (int)(t_scalar / t_vector),
+            (int)((100 * t_scalar / t_vector) % 100), errors);
+    print_str(ss);
+}
+
+int main() {
+    uint64_t t0, t1, t2;
+    int errors;
+
+    init_data();
+
+    t0 = rdcycle();
+    fir_scalar(fir_y_scalar);
+    t1 = rdcycle();
+    fir_vector(fir_y_vector);
+    t2 = rdcycle();
+    errors = 0;
+    for (int i = 0; i < FIR_SAMPLES; i++) {
+        errors += fir_y_scalar[i] != fir_y_vector[i];
+    }
+    report("FIR Q15", t1 - t0, t2 - t1, errors);
+
+    t0 = rdcycle();
+    corr_scalar(corr_r_scalar);
+    t1 = rdcycle();
+    corr_vector(corr_r_vector);
+    t2 = rdcycle();
+    errors = 0;
+    // Vector sum is computed in the different order and fused
+    for (int i = 0; i < CORR_LAGS; i++) {
+        double d = corr_r_scalar[i] - corr_r_vector[i];
+        double tol = 1e-9 * (corr_r_scalar[i] < 0 ? -corr_r_scalar[i]
+                                                   : corr_r_scalar[i]);
+        errors += (d > tol + 1e-9) || (d < -tol - 1e-9);
+    }
+    report("Correlator", t1 - t0, t2 - t1, errors);
+    return 0;
+}